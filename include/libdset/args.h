@@ -36,6 +36,10 @@ enum dset_keywords {
 	DSET_ARG_SKBMARK,			/* skbmark */
 	DSET_ARG_SKBPRIO,			/* skbprio */
 	DSET_ARG_SKBQUEUE,			/* skbqueue */
+	DSET_ARG_CATEGORIES,			/* categories */
+	DSET_ARG_CATEGORY,			/* category */
+	/* Hash types */
+	DSET_ARG_ELEMENTS,			/* elements */
 	DSET_ARG_MAX,
 };
 
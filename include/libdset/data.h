@@ -8,6 +8,7 @@
 #include <stdbool.h>				/* bool */
 #include <stdint.h>
 #include <stddef.h>
+#include <netinet/in.h>				/* struct in_addr, in6_addr */
 
 /* Data options */
 enum dset_opt {
@@ -50,6 +51,9 @@ enum dset_opt {
 	DSET_OPT_SKBMARK,
 	DSET_OPT_SKBPRIO,
 	DSET_OPT_SKBQUEUE,
+	DSET_OPT_CATEGORIES,
+	DSET_OPT_CATEGORY,
+	DSET_OPT_IP,
 	/* Internal options */
 	DSET_OPT_FLAGS = 48,	/* DSET_FLAG_EXIST| */
 	DSET_OPT_CADT_FLAGS,	/* DSET_FLAG_BEFORE| */
@@ -59,6 +63,11 @@ enum dset_opt {
 	DSET_OPT_REVISION,
 	DSET_OPT_REVISION_MIN,
 	DSET_OPT_INDEX,
+	DSET_OPT_GENERATION,
+	/* Shared sets */
+	DSET_OPT_NETNS,
+	DSET_OPT_PUBLISHED,
+	DSET_OPT_LINK,
 	DSET_OPT_MAX,
 };
 
@@ -80,7 +89,8 @@ enum dset_opt {
 	| DSET_FLAG(DSET_OPT_COUNTERS)	\
 	| DSET_FLAG(DSET_OPT_CREATE_COMMENT)\
 	| DSET_FLAG(DSET_OPT_FORCEADD)	\
-	| DSET_FLAG(DSET_OPT_SKBINFO))
+	| DSET_FLAG(DSET_OPT_SKBINFO)	\
+	| DSET_FLAG(DSET_OPT_CATEGORIES))
 
 #define DSET_ADT_FLAGS			\
 	(DSET_FLAG(DSET_OPT_TIMEOUT)	\
@@ -95,7 +105,17 @@ enum dset_opt {
 	| DSET_FLAG(DSET_OPT_ADT_COMMENT)	\
 	| DSET_FLAG(DSET_OPT_SKBMARK)	\
 	| DSET_FLAG(DSET_OPT_SKBPRIO)	\
-	| DSET_FLAG(DSET_OPT_SKBQUEUE))
+	| DSET_FLAG(DSET_OPT_SKBQUEUE)	\
+	| DSET_FLAG(DSET_OPT_CATEGORY))
+
+/* An IPv4 or IPv6 address, in network order */
+struct dset_ipaddr {
+	uint8_t family;				/* NFPROTO_IPV4 or NFPROTO_IPV6 */
+	union {
+		struct in_addr in;
+		struct in6_addr in6;
+	};
+};
 
 struct dset_data;
 
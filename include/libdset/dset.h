@@ -50,6 +50,10 @@ extern bool dset_match_envopt(const char *arg, const char * const name[]);
 extern int dset_parse_filename(struct dset *dset, int opt, const char *str);
 extern int dset_parse_output(struct dset *dset,
 			      int opt, const char *str);
+extern int dset_parse_bufsize(struct dset *dset,
+			      int opt, const char *str);
+extern int dset_parse_window(struct dset *dset,
+			      int opt, const char *str);
 extern int dset_envopt_parse(struct dset *dset,
 			      int env, const char *str);
 
@@ -39,17 +39,26 @@ enum dset_cmd
 	DSET_CMD_TYPE,		  /* 13: Get set type */
 	DSET_CMD_GET_BYNAME,  /* 14: Get set index by name */
 	DSET_CMD_GET_BYINDEX, /* 15: Get set name by index */
+	DSET_CMD_PUBLISH,	  /* 16: Share a set with other namespaces */
+	DSET_CMD_UNPUBLISH,	  /* 17: Stop sharing a set */
+	DSET_CMD_ATTACH,	  /* 18: Attach a published set read-only */
+	DSET_CMD_LOAD,		  /* 19: Bulk load a shadow table */
+	DSET_CMD_CHANGES,	  /* 20: Get the changes since a generation */
 	DSET_MSG_MAX,		  /* Netlink message commands */
 
 	/* Commands in userspace: */
-	DSET_CMD_RESTORE = DSET_MSG_MAX, /* 16: Enter restore mode */
-	DSET_CMD_HELP,					 /* 17: Get help */
-	DSET_CMD_VERSION,				 /* 18: Get program version */
-	DSET_CMD_QUIT,					 /* 19: Quit from interactive mode */
+	DSET_CMD_RESTORE = DSET_MSG_MAX, /* 21: Enter restore mode */
+	DSET_CMD_HELP,					 /* 22: Get help */
+	DSET_CMD_VERSION,				 /* 23: Get program version */
+	DSET_CMD_QUIT,					 /* 24: Quit from interactive mode */
+	DSET_CMD_SYNC,					 /* 25: Sync a set with a saved state */
+	DSET_CMD_SNAPSHOT,				 /* 26: Save the image of a set */
+	DSET_CMD_IMPORT,				 /* 27: Load the image of a set */
+	DSET_CMD_MONITOR,				 /* 28: Print the changes of the sets */
 
 	DSET_CMD_MAX,
 
-	DSET_CMD_COMMIT = DSET_CMD_MAX, /* 20: Commit buffered commands */
+	DSET_CMD_COMMIT = DSET_CMD_MAX, /* 29: Commit buffered commands */
 };
 
 /* Attributes at command level */
@@ -69,6 +78,13 @@ enum
 	DSET_ATTR_PROTOCOL_MIN,							 /* 10: Minimal supported version number */
 	DSET_ATTR_REVISION_MIN = DSET_ATTR_PROTOCOL_MIN, /* type rev min */
 	DSET_ATTR_INDEX,								 /* 11: Kernel index of set */
+	DSET_ATTR_LOAD,									 /* 12: Bulk load phase */
+	DSET_ATTR_GENERATION,							 /* 13: Generation of the set */
+	DSET_ATTR_CMD_PAD,								 /* 14: Padding of 64-bit attributes */
+	DSET_ATTR_NETNS_FD,								 /* 15: Owner namespace at attach */
+	DSET_ATTR_NETNS,								 /* 16: Name of the owner namespace */
+	DSET_ATTR_PUBLISHED,							 /* 17: Set is published */
+	DSET_ATTR_LINK,									 /* 18: Published name of an attached set */
 	__DSET_ATTR_CMD_MAX,
 };
 #define DSET_ATTR_CMD_MAX (__DSET_ATTR_CMD_MAX - 1)
@@ -111,6 +127,8 @@ enum
 	DSET_ATTR_SKBPRIO,
 	DSET_ATTR_SKBQUEUE,
 	DSET_ATTR_PAD,
+	DSET_ATTR_CATEGORY,
+	DSET_ATTR_IP,
 	__DSET_ATTR_ADT_MAX,
 };
 #define DSET_ATTR_ADT_MAX (__DSET_ATTR_ADT_MAX - 1)
@@ -141,11 +159,24 @@ enum dset_errno
 	DSET_ERR_COUNTER,
 	DSET_ERR_COMMENT,
 	DSET_ERR_SKBINFO,
+	DSET_ERR_CATEGORY,
+	DSET_ERR_ATTACHED,
+	DSET_ERR_NO_LOAD,
+	DSET_ERR_GENERATION,
 
 	/* Type specific error codes */
 	DSET_ERR_TYPE_SPECIFIC = 4352,
 };
 
+/* Phases of a bulk load, in DSET_ATTR_LOAD */
+enum dset_load_phase
+{
+	DSET_LOAD_BEGIN,  /* Start a new shadow table */
+	DSET_LOAD_DATA,	  /* Add elements to the shadow table */
+	DSET_LOAD_COMMIT, /* Publish the shadow table */
+	DSET_LOAD_ABORT,  /* Drop the shadow table */
+};
+
 /* Flags at command level or match/target flags, lower half of cmdattrs*/
 enum dset_cmd_flags
 {
@@ -171,6 +202,14 @@ enum dset_cmd_flags
 	DSET_FLAG_MAP_SKBPRIO = (1 << DSET_FLAG_BIT_MAP_SKBPRIO),
 	DSET_FLAG_BIT_MAP_SKBQUEUE = 10,
 	DSET_FLAG_MAP_SKBQUEUE = (1 << DSET_FLAG_BIT_MAP_SKBQUEUE),
+	DSET_FLAG_BIT_MATCH_ANSWERS = 11,
+	DSET_FLAG_MATCH_ANSWERS = (1 << DSET_FLAG_BIT_MATCH_ANSWERS),
+	DSET_FLAG_BIT_MATCH_CATEGORY = 12,
+	DSET_FLAG_MATCH_CATEGORY = (1 << DSET_FLAG_BIT_MATCH_CATEGORY),
+	DSET_FLAG_BIT_MAP_CATEGORY = 13,
+	DSET_FLAG_MAP_CATEGORY = (1 << DSET_FLAG_BIT_MAP_CATEGORY),
+	DSET_FLAG_BIT_LEARN_ANSWERS = 14,
+	DSET_FLAG_LEARN_ANSWERS = (1 << DSET_FLAG_BIT_LEARN_ANSWERS),
 	DSET_FLAG_CMD_MAX = 15,
 };
 
@@ -191,6 +230,8 @@ enum dset_cadt_flags
 	DSET_FLAG_WITH_FORCEADD = (1 << DSET_FLAG_BIT_WITH_FORCEADD),
 	DSET_FLAG_BIT_WITH_SKBINFO = 6,
 	DSET_FLAG_WITH_SKBINFO = (1 << DSET_FLAG_BIT_WITH_SKBINFO),
+	DSET_FLAG_BIT_WITH_CATEGORY = 7,
+	DSET_FLAG_WITH_CATEGORY = (1 << DSET_FLAG_BIT_WITH_CATEGORY),
 	DSET_FLAG_CADT_MAX = 15,
 };
 
@@ -245,6 +286,16 @@ enum domain_set_kopt
 	DSET_RETURN_NOMATCH = (1 << DSET_BIT_RETURN_NOMATCH),
 };
 
+/* Application payload the names are extracted from by the kernel */
+enum dset_payload
+{
+	DSET_PAYLOAD_DNS = 0,	/* Names of the DNS message (default) */
+	DSET_PAYLOAD_TLS_SNI,	/* server_name of a TLS ClientHello */
+	DSET_PAYLOAD_HTTP_HOST,	/* Host header of an HTTP/1.x request */
+	__DSET_PAYLOAD_MAX,
+};
+#define DSET_PAYLOAD_MAX (__DSET_PAYLOAD_MAX - 1)
+
 enum
 {
 	DSET_COUNTER_NONE = 0,
@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef __DOMAIN_SET_LIST_H
+#define __DOMAIN_SET_LIST_H
+
+/* List type specific error codes */
+enum
+{
+	/* Set name to be added/deleted/tested does not exist. */
+	DSET_ERR_NAME = DSET_ERR_TYPE_SPECIFIC,
+	/* list:set type is not permitted to add */
+	DSET_ERR_LOOP,
+	/* Missing reference set */
+	DSET_ERR_BEFORE,
+	/* Reference set does not exist */
+	DSET_ERR_NAMEREF,
+	/* Set is full */
+	DSET_ERR_LIST_FULL,
+	/* Reference set is not added to the set */
+	DSET_ERR_REF_EXIST,
+};
+
+#endif /* __DOMAIN_SET_LIST_H */
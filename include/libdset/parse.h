@@ -27,6 +27,8 @@ extern "C" {
 #endif
 extern int dset_parse_domain(struct dset_session *session,
 			     enum dset_opt opt, const char *str);
+extern int dset_parse_ip(struct dset_session *session,
+			 enum dset_opt opt, const char *str);
 extern int dset_parse_name(struct dset_session *session,
 			    enum dset_opt opt, const char *str);
 extern int dset_parse_before(struct dset_session *session,
@@ -27,6 +27,9 @@ extern int dset_print_name(char *buf, unsigned int len,
 extern int dset_print_domain(char *buf, unsigned int len,
 			     const struct dset_data *data,
 			     enum dset_opt opt, uint8_t env);
+extern int dset_print_ip(char *buf, unsigned int len,
+			 const struct dset_data *data,
+			 enum dset_opt opt, uint8_t env);
 extern int dset_print_comment(char *buf, unsigned int len,
 			     const struct dset_data *data,
 			     enum dset_opt opt, uint8_t env);
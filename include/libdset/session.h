@@ -15,6 +15,12 @@
 #define DSET_ERRORBUFLEN		1024
 #define DSET_OUTBUFLEN			8192
 
+/* Largest kernel message: the aggregated elements are nested into a
+ * single attribute, the length of which is 16 bits wide */
+#define DSET_BUFSIZE_MAX		65536
+/* Most pipelined messages in flight */
+#define DSET_WINDOW_MAX			64
+
 struct dset_session;
 struct dset_data;
 
@@ -101,6 +107,15 @@ enum dset_output_mode {
 extern int dset_session_output(struct dset_session *session,
 				enum dset_output_mode mode);
 
+extern int dset_session_bufsize(struct dset_session *session,
+				size_t bufsize);
+extern int dset_session_window(struct dset_session *session,
+				unsigned int window);
+extern int dset_session_load(struct dset_session *session,
+			     enum dset_load_phase phase);
+extern int dset_session_image_save(struct dset_session *session);
+extern int dset_session_image_load(struct dset_session *session);
+
 extern int dset_commit(struct dset_session *session);
 extern int dset_cmd(struct dset_session *session, enum dset_cmd cmd,
 		     uint32_t lineno);
@@ -113,6 +128,21 @@ extern int dset_session_print_outfn(struct dset_session *session,
 				     dset_print_outfn outfn,
 				     void *p);
 
+typedef int (*dset_list_elemfn)(struct dset_session *session, void *p);
+
+extern int dset_session_list_elemfn(struct dset_session *session,
+				     dset_list_elemfn elemfn,
+				     void *p);
+
+typedef int (*dset_notify_fn)(struct dset_session *session,
+			      enum dset_cmd cmd, void *p);
+
+extern int dset_session_subscribe(struct dset_session *session,
+				  dset_notify_fn notifyfn, void *p);
+extern int dset_session_receive(struct dset_session *session);
+extern int dset_session_changes(struct dset_session *session,
+				dset_notify_fn notifyfn, void *p);
+
 enum dset_io_type {
 	DSET_IO_INPUT,
 	DSET_IO_OUTPUT,
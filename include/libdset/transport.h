@@ -20,6 +20,15 @@ struct dset_transport {
 	void (*fill_hdr)(struct dset_handle *handle, enum dset_cmd cmd,
 			 void *buffer, size_t len, uint8_t envflags);
 	int (*query)(struct dset_handle *handle, void *buffer, size_t len);
+	/* Pipelined messages: send without waiting for the ACK, then
+	 * receive ACKs until at most window messages are in flight */
+	int (*send)(struct dset_handle *handle, void *buffer, size_t len);
+	int (*drain)(struct dset_handle *handle, void *buffer, size_t len,
+		     unsigned int window);
+	/* Change notifications: join the multicast group, then receive
+	 * the events of a datagram */
+	int (*subscribe)(struct dset_handle *handle);
+	int (*receive)(struct dset_handle *handle, void *buffer, size_t len);
 };
 
 #endif /* LIBDSET_TRANSPORT_H */
@@ -7,11 +7,13 @@
 
 #include <linux/ip.h>
 #include <linux/ipv6.h>
+#include <linux/mutex.h>
 #include <linux/netlink.h>
 #include <linux/netfilter.h>
 #include <linux/netfilter/x_tables.h>
 #include <linux/stringify.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <net/netlink.h>
 #include <linux/netfilter/dset/domain_set_compat.h>
 #include <uapi/linux/netfilter/dset/domain_set.h>
@@ -47,6 +49,8 @@ enum domain_set_extension
 	DSET_EXT_COMMENT = (1 << DSET_EXT_BIT_COMMENT),
 	DSET_EXT_BIT_SKBINFO = 3,
 	DSET_EXT_SKBINFO = (1 << DSET_EXT_BIT_SKBINFO),
+	DSET_EXT_BIT_CATEGORY = 4,
+	DSET_EXT_CATEGORY = (1 << DSET_EXT_BIT_CATEGORY),
 	/* Mark set with an extension which needs to call destroy */
 	DSET_EXT_BIT_DESTROY = 7,
 	DSET_EXT_DESTROY = (1 << DSET_EXT_BIT_DESTROY),
@@ -56,6 +60,7 @@ enum domain_set_extension
 #define SET_WITH_COUNTER(s) ((s)->extensions & DSET_EXT_COUNTER)
 #define SET_WITH_COMMENT(s) ((s)->extensions & DSET_EXT_COMMENT)
 #define SET_WITH_SKBINFO(s) ((s)->extensions & DSET_EXT_SKBINFO)
+#define SET_WITH_CATEGORY(s) ((s)->extensions & DSET_EXT_CATEGORY)
 #define SET_WITH_FORCEADD(s) ((s)->flags & DSET_CREATE_FLAG_FORCEADD)
 
 /* Extension id, in size order */
@@ -65,6 +70,7 @@ enum domain_set_ext_id
 	DSET_EXT_ID_TIMEOUT,
 	DSET_EXT_ID_SKBINFO,
 	DSET_EXT_ID_COMMENT,
+	DSET_EXT_ID_CATEGORY,
 	DSET_EXT_ID_MAX,
 };
 
@@ -117,11 +123,14 @@ struct domain_set_ext
 	u64 bytes;
 	char *comment;
 	u32 timeout;
+	u32 category;
 	u8 packets_op;
 	u8 bytes_op;
 };
 
 struct domain_set;
+struct dset_dns_msg;
+struct dset_dns_rr;
 
 #define ext_timeout(e, s) \
 	((unsigned long *)(((void *)(e)) + (s)->offset[DSET_EXT_ID_TIMEOUT]))
@@ -131,6 +140,12 @@ struct domain_set;
 	((struct domain_set_comment *)(((void *)(e)) + (s)->offset[DSET_EXT_ID_COMMENT]))
 #define ext_skbinfo(e, s) \
 	((struct domain_set_skbinfo *)(((void *)(e)) + (s)->offset[DSET_EXT_ID_SKBINFO]))
+#define ext_category(e, s) \
+	((u32 *)(((void *)(e)) + (s)->offset[DSET_EXT_ID_CATEGORY]))
+
+/* Command flag internal to the kernel, above the flags exchanged with
+ * userspace: the change is made by the packet path */
+#define DSET_FLAG_PACKET_PATH	(1U << 31)
 
 typedef int (*dset_adtfn)(struct domain_set *set, void *value,
 						  const struct domain_set_ext *ext,
@@ -142,6 +157,7 @@ struct domain_set_adt_opt
 	u8 family;				   /* Actual protocol family */
 	u8 dim;					   /* Dimension of match/target */
 	u8 flags;				   /* Direction and negation flags */
+	u8 payload;				   /* enum dset_payload */
 	u32 cmdflags;			   /* Command-like flags */
 	struct domain_set_ext ext; /* Extensions */
 };
@@ -157,6 +173,20 @@ struct domain_set_type_variant
 				const struct xt_action_param *par,
 				enum dset_adt adt, struct domain_set_adt_opt *opt);
 
+	/* Kernelspace: test/add/del entries named in a DNS message,
+	 * without an skb (XDP) or known packet offsets (tc, BPF)
+	 *		returns like kadt */
+	int (*dadt)(struct domain_set *set, const struct dset_dns_msg *msg,
+				enum dset_adt adt, struct domain_set_adt_opt *opt);
+
+	/* Kernelspace: test/add/del a single name already decoded from
+	 * a DNS message, so that list:set walks the message once for all
+	 * of its members
+	 *		returns like kadt */
+	int (*nadt)(struct domain_set *set, const struct dset_dns_msg *msg,
+				const struct dset_dns_rr *rr, enum dset_adt adt,
+				struct domain_set_adt_opt *opt);
+
 	/* Userspace: test/add/del entries
 	 *		returns negative error code,
 	 *			zero for no match/success to add/delete
@@ -169,6 +199,14 @@ struct domain_set_type_variant
 
 	/* When adding entries and set is full, try to resize the set */
 	int (*resize)(struct domain_set *set, bool retried);
+	/* Before adding a batch of n entries, grow the set to hold them */
+	int (*reserve)(struct domain_set *set, u32 n);
+	/* Bulk load: create an empty shadow of the set sized for the
+	 * expected elements, destroy it or publish it as the content of
+	 * the set */
+	struct domain_set *(*shadow)(struct domain_set *set, u32 elements);
+	void (*shadow_destroy)(struct domain_set *shadow);
+	void (*publish)(struct domain_set *set, struct domain_set *shadow);
 	/* Destroy the set */
 	void (*destroy)(struct domain_set *set);
 	/* Flush the elements */
@@ -187,6 +225,14 @@ struct domain_set_type_variant
 	/* Return true if "b" set is the same as "a"
 	 * according to the create set parameters */
 	bool (*same_set)(const struct domain_set *a, const struct domain_set *b);
+	/* The elements are locked by the type itself instead of the
+	 * set lock: by regions of the set for the hash types, by the
+	 * member sets for list:set */
+	bool own_lock;
+	/* Userspace adds and deletes run out of the nfnl mutex, in
+	 * parallel: the type locks the elements and serializes its
+	 * resizing by itself */
+	bool parallel_uadt;
 };
 
 /* The core set type structure */
@@ -263,6 +309,36 @@ struct domain_set
 	size_t offset[DSET_EXT_ID_MAX];
 	/* The type specific data */
 	void *data;
+	/* The namespace of the set, for the events of the packet path */
+	struct net *net;
+	/* Shadow of the set under bulk load and the netlink socket
+	 * which owns the load */
+	struct domain_set *shadow;
+	u32 shadow_portid;
+	/* Generation of the last change from userspace */
+	u64 generation;
+	/* The changes after this generation are in the change log */
+	u64 changelog_base;
+	/* Change log, oldest first, and its size, under changelog_mutex */
+	struct list_head changelog;
+	size_t changelog_size;
+	struct mutex changelog_mutex;
+	/* Changed by the packet path or by overlapping userspace
+	 * writers since the last reset of the log */
+	bool changelog_lost;
+	/* Userspace writers in progress and started */
+	atomic_t writers;
+	atomic_t writer_seq;
+	/* Event of the elements changed by the packet path, not sent yet,
+	 * its open DSET_ATTR_ADT nest and number of elements, under
+	 * event_lock
+	 */
+	spinlock_t event_lock;
+	struct sk_buff *event_skb;
+	struct nlattr *event_adt;
+	u32 event_elems;
+	u8 event_cmd;
+	struct delayed_work event_work;
 };
 
 static inline void
@@ -293,16 +369,54 @@ enum
 };
 
 /* register and unregister set references */
+extern domain_set_id_t domain_set_get_byname(struct net *net, const char *name,
+					     struct domain_set **set);
 extern void domain_set_put_byindex(struct net *net, domain_set_id_t index);
 extern void domain_set_name_byindex(struct net *net, domain_set_id_t index, char *name);
+extern u16 domain_set_features_byindex(struct net *net, domain_set_id_t index);
+extern bool domain_set_attached_byindex(struct net *net, domain_set_id_t index);
 extern domain_set_id_t domain_set_nfnl_get_byindex(struct net *net, domain_set_id_t index);
+extern domain_set_id_t domain_set_nfnl_get_byname(struct net *net, const char *name,
+						  struct domain_set **set);
 extern void domain_set_nfnl_put(struct net *net, domain_set_id_t index);
 
-/* API for iptables set match, and SET target */
+/* API for iptables set match, SET target, nftables and tc */
 
 extern int domain_set_test(domain_set_id_t id, const struct sk_buff *skb,
 						   const struct xt_action_param *par,
 						   struct domain_set_adt_opt *opt);
+extern int domain_set_add(domain_set_id_t id, const struct sk_buff *skb,
+						  const struct xt_action_param *par,
+						  struct domain_set_adt_opt *opt);
+extern int domain_set_del(domain_set_id_t id, const struct sk_buff *skb,
+						  const struct xt_action_param *par,
+						  struct domain_set_adt_opt *opt);
+extern int domain_set_add_net(struct net *net, domain_set_id_t id,
+							  const struct sk_buff *skb,
+							  const struct xt_action_param *par,
+							  struct domain_set_adt_opt *opt);
+extern int domain_set_del_net(struct net *net, domain_set_id_t id,
+							  const struct sk_buff *skb,
+							  const struct xt_action_param *par,
+							  struct domain_set_adt_opt *opt);
+extern int domain_set_test_net(struct net *net, domain_set_id_t index,
+							  const struct sk_buff *skb,
+							  struct domain_set_adt_opt *opt);
+extern int domain_set_test_dns(struct net *net, domain_set_id_t index,
+							  const struct dset_dns_msg *msg,
+							  struct domain_set_adt_opt *opt);
+extern int domain_set_test_name(struct net *net, domain_set_id_t index,
+								const struct dset_dns_msg *msg,
+								const struct dset_dns_rr *rr,
+								struct domain_set_adt_opt *opt);
+
+/* BPF kfuncs, registered by the core module */
+extern int domain_set_bpf_init(void);
+extern void domain_set_notify_kadt(struct domain_set *set,
+				   enum dset_cmd cmd,
+				   bool (*put)(struct sk_buff *skb,
+					       const void *elem),
+				   const void *elem);
 
 /* Utility functions */
 extern void *domain_set_alloc(size_t size);
@@ -313,6 +427,8 @@ extern int domain_set_get_extensions(struct domain_set *set, struct nlattr *tb[]
 									 struct domain_set_ext *ext);
 extern int domain_set_put_extensions(struct sk_buff *skb, const struct domain_set *set,
 									 const void *e, bool active);
+extern int domain_set_get_ipaddr(struct nlattr *nla, union nf_inet_addr *ip,
+								 u8 *family);
 extern bool domain_set_match_extensions(struct domain_set *set,
 										const struct domain_set_ext *ext,
 										struct domain_set_ext *mext,
@@ -361,6 +477,27 @@ domain_set_get_h16(const struct nlattr *attr)
 	return ntohs(nla_get_be16(attr));
 }
 
+/* Put an address as a nested DSET_ATTR_IPADDR_IPV4/IPV6 attribute */
+static inline int
+nla_put_ipaddr(struct sk_buff *skb, int type, const union nf_inet_addr *ip,
+			   u8 family)
+{
+	struct nlattr *__nested = nla_nest_start(skb, type | NLA_F_NESTED);
+	int ret;
+
+	if (!__nested)
+		return -EMSGSIZE;
+	if (family == NFPROTO_IPV4)
+		ret = nla_put_in_addr(skb, DSET_ATTR_IPADDR_IPV4 | NLA_F_NET_BYTEORDER,
+							  ip->ip);
+	else
+		ret = nla_put_in6_addr(skb, DSET_ATTR_IPADDR_IPV6 | NLA_F_NET_BYTEORDER,
+							   &ip->in6);
+	if (!ret)
+		nla_nest_end(skb, __nested);
+	return ret;
+}
+
 /* In order to support older kernels before patch ae0be8de9a53cda3:
  *
  * netlink: make nla_nest_start() add NLA_F_NESTED flag
@@ -446,12 +583,24 @@ domain_set_init_skbinfo(struct domain_set_skbinfo *skbinfo,
 	*skbinfo = ext->skbinfo;
 }
 
+static inline void
+domain_set_init_category(u32 *category, const struct domain_set_ext *ext)
+{
+	*category = ext->category;
+}
+
 #define DOMAIN_SET_INIT_KEXT(skb, opt, set)             \
 	{                                                   \
 		.bytes = (skb)->len, .packets = 1,              \
 		.timeout = domain_set_adt_opt_timeout(opt, set) \
 	}
 
+#define DOMAIN_SET_INIT_DEXT(msg, opt, set)             \
+	{                                                   \
+		.bytes = (msg)->pktlen, .packets = 1,           \
+		.timeout = domain_set_adt_opt_timeout(opt, set) \
+	}
+
 #define DOMAIN_SET_INIT_UEXT(set)                   \
 	{                                               \
 		.bytes = ULLONG_MAX, .packets = ULLONG_MAX, \
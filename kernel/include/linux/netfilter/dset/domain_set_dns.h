@@ -0,0 +1,97 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _DOMAIN_SET_DNS_H
+#define _DOMAIN_SET_DNS_H
+
+#include <linux/netfilter.h>
+#include <linux/skbuff.h>
+#include <linux/types.h>
+
+/* Fixed DNS message header, not aligned after a TCP length prefix */
+struct dset_dnshdr {
+	__be16 id;
+	__be16 flags;
+	__be16 qdcount;
+	__be16 ancount;
+	__be16 nscount;
+	__be16 arcount;
+} __packed;
+
+#define DSET_DNS_HDRLEN		sizeof(struct dset_dnshdr)
+
+/* Max compression pointers followed while decoding a single name */
+#define DSET_DNS_MAX_PTRS	16
+/* Max records (questions and answers) visited in a single message */
+#define DSET_DNS_MAX_RECORDS	32
+/* Max length-prefixed messages visited in a single TCP segment */
+#define DSET_DNS_MAX_TCP_MSGS	16
+/* DNS port, DNS over TCP is recognized by it */
+#define DSET_DNS_PORT		53
+
+/* Record types and class of the address records */
+#define DSET_DNS_TYPE_A		1
+#define DSET_DNS_TYPE_CNAME	5
+#define DSET_DNS_TYPE_AAAA	28
+#define DSET_DNS_CLASS_IN	1
+
+/* Sections of the DNS message to walk */
+enum dset_dns_section {
+	DSET_DNS_QUESTION = (1 << 0),
+	DSET_DNS_ANSWER = (1 << 1),
+	DSET_DNS_CNAME = (1 << 2),	/* Targets of the CNAME answers */
+	DSET_DNS_CHAIN = (1 << 3),	/* Answers on the qname CNAME chain only */
+};
+
+/* A DNS message inside an skb or in linear packet memory (XDP) */
+struct dset_dns_msg {
+	const struct sk_buff *skb;
+	const u8 *data;		/* DNS header in linear memory, when no skb */
+	unsigned int off;	/* Offset of the DNS header in skb */
+	unsigned int len;	/* Length of the DNS message */
+	unsigned int pktlen;	/* Length of the whole packet, for counters */
+	unsigned int next;	/* Offset of the next message in skb, TCP only */
+	unsigned int end;	/* End of the TCP payload in skb */
+	u8 count;		/* Messages visited in the TCP segment */
+};
+
+/* A decoded question or resource record */
+struct dset_dns_rr {
+	const char *name;	/* Dotted owner name, NUL terminated */
+	unsigned int namelen;	/* Length of name */
+	u8 section;		/* DSET_DNS_QUESTION, _ANSWER or _CNAME */
+	u16 type;
+	u16 class;
+	u32 ttl;		/* Zero for questions */
+	unsigned int rdoff;	/* RDATA offset in the message */
+	u16 rdlen;		/* RDATA length, zero for questions */
+};
+
+/* Called for every visited record: a nonzero return stops the walk */
+typedef int (*dset_dns_rrfn)(const struct dset_dns_msg *msg,
+			     const struct dset_dns_rr *rr, void *priv);
+
+extern int domain_set_transport(const struct sk_buff *skb, u8 family,
+				u8 *proto, unsigned int *thoff);
+extern int domain_set_dns_locate(const struct sk_buff *skb, u8 family,
+				 struct dset_dns_msg *msg);
+extern int domain_set_dns_next(struct dset_dns_msg *msg);
+extern int domain_set_dns_name(const struct dset_dns_msg *msg,
+			       unsigned int *pos, char *name);
+extern int domain_set_dns_walk(const struct dset_dns_msg *msg, u8 sections,
+			       dset_dns_rrfn fn, void *priv);
+extern u8 domain_set_dns_addr(const struct dset_dns_msg *msg,
+			      const struct dset_dns_rr *rr,
+			      union nf_inet_addr *addr);
+
+/* Max TLS extensions visited while looking for the server_name */
+#define DSET_TLS_MAX_EXTENSIONS	64
+/* Max bytes of an HTTP request scanned for the Host header */
+#define DSET_HTTP_MAX_SCAN	2048
+
+extern int domain_set_payload_name(const struct sk_buff *skb, u8 family,
+				   u8 payload, struct dset_dns_msg *msg,
+				   struct dset_dns_rr *rr, char *name);
+
+#endif /* _DOMAIN_SET_DNS_H */
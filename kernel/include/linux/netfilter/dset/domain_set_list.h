@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __DOMAIN_SET_LIST_H
+#define __DOMAIN_SET_LIST_H
+
+#include <uapi/linux/netfilter/dset/domain_set_list.h>
+
+#define DSET_LIST_DEFAULT_SIZE 8
+#define DSET_LIST_MIN_SIZE 4
+
+#endif /* __DOMAIN_SET_LIST_H */
@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI__DOMAIN_SET_LIST_H
+#define _UAPI__DOMAIN_SET_LIST_H
+
+#include <linux/netfilter/dset/domain_set.h>
+
+/* List type specific error codes */
+enum
+{
+	/* Set name to be added/deleted/tested does not exist. */
+	DSET_ERR_NAME = DSET_ERR_TYPE_SPECIFIC,
+	/* list:set type is not permitted to add */
+	DSET_ERR_LOOP,
+	/* Missing reference set */
+	DSET_ERR_BEFORE,
+	/* Reference set does not exist */
+	DSET_ERR_NAMEREF,
+	/* Set is full */
+	DSET_ERR_LIST_FULL,
+	/* Reference set is not added to the set */
+	DSET_ERR_REF_EXIST,
+};
+
+#endif /* _UAPI__DOMAIN_SET_LIST_H */
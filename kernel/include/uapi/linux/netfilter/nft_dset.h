@@ -0,0 +1,68 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _NFT_DSET_H
+#define _NFT_DSET_H
+
+/**
+ * enum nft_dset_attributes - nf_tables dset expression netlink attributes
+ *
+ * @NFTA_DSET_SETS: list of the referenced sets (NLA_NESTED: NFTA_DSET_SET_NAME)
+ * @NFTA_DSET_DREG: destination register (NLA_U32: nft_registers)
+ * @NFTA_DSET_FLAGS: expression flags (NLA_U32: enum nft_dset_flags)
+ * @NFTA_DSET_CATEGORY: category mask the matching element must have (NLA_U32)
+ * @NFTA_DSET_PAYLOAD: payload the name is extracted from (NLA_U32: enum dset_payload)
+ */
+enum nft_dset_attributes {
+	NFTA_DSET_UNSPEC,
+	NFTA_DSET_SETS,
+	NFTA_DSET_DREG,
+	NFTA_DSET_FLAGS,
+	NFTA_DSET_CATEGORY,
+	NFTA_DSET_PAYLOAD,
+	__NFTA_DSET_MAX
+};
+#define NFTA_DSET_MAX (__NFTA_DSET_MAX - 1)
+
+/**
+ * enum nft_dset_set_attributes - nf_tables dset set list attributes
+ *
+ * @NFTA_DSET_SET_NAME: name of a referenced set (NLA_STRING)
+ */
+enum nft_dset_set_attributes {
+	NFTA_DSET_SET_UNSPEC,
+	NFTA_DSET_SET_NAME,
+	__NFTA_DSET_SET_MAX
+};
+#define NFTA_DSET_SET_MAX (__NFTA_DSET_SET_MAX - 1)
+
+/* Max number of sets referenced by a single expression */
+#define NFT_DSET_MAX_SETS 8
+
+/**
+ * enum nft_dset_flags - nf_tables dset expression flags
+ *
+ * @NFT_DSET_F_INV: invert the match (no destination register only)
+ * @NFT_DSET_F_RETURN_NOMATCH: matching nomatch elements are reported
+ * @NFT_DSET_F_ANSWERS: match the answer owner names and CNAME targets of
+ *	DNS responses too
+ * @NFT_DSET_F_MARK: store the packet mark mapped by the skbinfo extension
+ *	of the matching element into the destination register
+ * @NFT_DSET_F_CATEGORY: store the category of the matching element
+ *	into the destination register
+ *
+ * Without a destination register the expression is a match: the rule
+ * breaks unless one of the sets matches. With a register and without
+ * NFT_DSET_F_MARK or NFT_DSET_F_CATEGORY the register is loaded with the 1-based position of
+ * the first matching set in the list, or zero.
+ */
+enum nft_dset_flags {
+	NFT_DSET_F_INV = (1 << 0),
+	NFT_DSET_F_RETURN_NOMATCH = (1 << 1),
+	NFT_DSET_F_ANSWERS = (1 << 2),
+	NFT_DSET_F_MARK = (1 << 3),
+	NFT_DSET_F_CATEGORY = (1 << 4),
+};
+#define NFT_DSET_F_MASK (NFT_DSET_F_INV | NFT_DSET_F_RETURN_NOMATCH | \
+			 NFT_DSET_F_ANSWERS | NFT_DSET_F_MARK | \
+			 NFT_DSET_F_CATEGORY)
+
+#endif /* _NFT_DSET_H */
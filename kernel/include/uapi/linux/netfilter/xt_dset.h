@@ -31,4 +31,49 @@ struct xt_dset_info_match_v0
 	__u32 flags;
 };
 
+/* Revision 1 match: category support */
+
+struct xt_dset_info_match_v1
+{
+	struct xt_dset_info match_set;
+	struct domain_set_counter_match packets;
+	struct domain_set_counter_match bytes;
+	__u32 flags;
+	__u32 category;		/* Category mask, with DSET_FLAG_MATCH_CATEGORY */
+};
+
+/* Revision 2 match: names extracted from other application payloads */
+
+struct xt_dset_info_match_v2
+{
+	struct xt_dset_info match_set;
+	struct domain_set_counter_match packets;
+	struct domain_set_counter_match bytes;
+	__u32 flags;
+	__u32 category;		/* Category mask, with DSET_FLAG_MATCH_CATEGORY */
+	__u32 payload;		/* enum dset_payload */
+};
+
+/* Revision 0 target */
+
+struct xt_dset_info_target_v0
+{
+	struct xt_dset_info add_set;
+	struct xt_dset_info del_set;
+	__u32 flags;
+	__u32 timeout;
+};
+
+/* Revision 1 target: category and skbinfo mapping */
+
+struct xt_dset_info_target_v1
+{
+	struct xt_dset_info add_set;
+	struct xt_dset_info del_set;
+	struct xt_dset_info map_set;
+	__u32 flags;
+	__u32 timeout;
+	__u32 map_mask;		/* Mark bits replaced by the category */
+};
+
 #endif /*_XT_DSET_H*/
@@ -0,0 +1,173 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* BPF kfuncs to test DNS messages against domain sets from XDP and tc */
+
+#include <linux/module.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/if_arp.h>
+#include <linux/if_ether.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+
+#if defined(HAVE_BTF_KFUNC_ID_SET) && IS_ENABLED(CONFIG_DEBUG_INFO_BTF_MODULES)
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <net/xdp.h>
+
+#ifndef __bpf_kfunc
+#define __bpf_kfunc		__used noinline
+#endif
+#ifndef __bpf_kfunc_start_defs
+#define __bpf_kfunc_start_defs()					\
+	__diag_push();							\
+	__diag_ignore_all("-Wmissing-prototypes",			\
+			  "Global kfuncs as their definitions will be in BTF")
+#define __bpf_kfunc_end_defs()	__diag_pop()
+#endif
+#ifndef BTF_KFUNCS_START
+#define BTF_KFUNCS_START(name)	BTF_SET8_START(name)
+#define BTF_KFUNCS_END(name)	BTF_SET8_END(name)
+#endif
+
+/* Command flags a BPF program may pass */
+#define DSET_BPF_FLAGS	(DSET_FLAG_RETURN_NOMATCH | DSET_FLAG_MATCH_ANSWERS | \
+			 DSET_FLAG_SKIP_COUNTER_UPDATE)
+
+#define DSET_BPF_ADT_OPT(n, f)				\
+	struct domain_set_adt_opt n = {			\
+		.family = NFPROTO_UNSPEC,		\
+		.dim = DSET_DIM_ONE,			\
+		.cmdflags = (f),			\
+		.ext.timeout = UINT_MAX,		\
+	}
+
+/* The family of the packet, checked against the family of the set */
+static u8 dset_bpf_family(__be16 proto)
+{
+	switch (proto) {
+	case htons(ETH_P_IP):
+		return NFPROTO_IPV4;
+	case htons(ETH_P_IPV6):
+		return NFPROTO_IPV6;
+	}
+	return NFPROTO_UNSPEC;
+}
+
+__bpf_kfunc_start_defs();
+
+/**
+ * bpf_xdp_dset_test - test a DNS message against a domain set
+ * @x: XDP context
+ * @index: set index, as returned by the SO_DOMAIN_SET sockopt
+ * @offset: offset of the DNS header from the start of the packet
+ * @flags: DSET_FLAG_RETURN_NOMATCH, DSET_FLAG_MATCH_ANSWERS,
+ *	   DSET_FLAG_SKIP_COUNTER_UPDATE
+ *
+ * The message is walked in the linear part of the packet only. The
+ * family of the packet is taken from the Ethernet header, so sets of
+ * a single family match untagged Ethernet frames only.
+ *
+ * Returns 1 if a name of the message matches, 0 if not and a negative
+ * error code for invalid arguments.
+ */
+__bpf_kfunc int
+bpf_xdp_dset_test(struct xdp_md *x, u32 index, u32 offset, u32 flags)
+{
+	struct xdp_buff *xdp = (struct xdp_buff *)x;
+	unsigned int len = xdp->data_end - xdp->data;
+	struct dset_dns_msg msg = {};
+	DSET_BPF_ADT_OPT(opt, flags);
+
+	if (flags & ~DSET_BPF_FLAGS)
+		return -EINVAL;
+	if (offset > len || len - offset < DSET_DNS_HDRLEN)
+		return -EINVAL;
+
+	if (xdp->rxq->dev->type == ARPHRD_ETHER && len >= ETH_HLEN)
+		opt.family = dset_bpf_family(
+			((const struct ethhdr *)xdp->data)->h_proto);
+
+	msg.data = xdp->data + offset;
+	msg.len = len - offset;
+	msg.pktlen = len;
+
+	return domain_set_test_dns(dev_net(xdp->rxq->dev), index, &msg, &opt);
+}
+
+/**
+ * bpf_skb_dset_test - test a DNS message against a domain set
+ * @s: tc context
+ * @index: set index, as returned by the SO_DOMAIN_SET sockopt
+ * @offset: offset of the DNS header from skb->data
+ * @flags: DSET_FLAG_RETURN_NOMATCH, DSET_FLAG_MATCH_ANSWERS,
+ *	   DSET_FLAG_SKIP_COUNTER_UPDATE
+ *
+ * Returns 1 if a name of the message matches, 0 if not and a negative
+ * error code for invalid arguments.
+ */
+__bpf_kfunc int
+bpf_skb_dset_test(struct __sk_buff *s, u32 index, u32 offset, u32 flags)
+{
+	struct sk_buff *skb = (struct sk_buff *)s;
+	struct dset_dns_msg msg = {};
+	DSET_BPF_ADT_OPT(opt, flags);
+
+	if (flags & ~DSET_BPF_FLAGS || !skb->dev)
+		return -EINVAL;
+	if (offset > skb->len || skb->len - offset < DSET_DNS_HDRLEN)
+		return -EINVAL;
+
+	opt.family = dset_bpf_family(skb->protocol);
+
+	msg.skb = skb;
+	msg.off = offset;
+	msg.len = skb->len - offset;
+	msg.pktlen = skb->len;
+
+	return domain_set_test_dns(dev_net(skb->dev), index, &msg, &opt);
+}
+
+__bpf_kfunc_end_defs();
+
+BTF_KFUNCS_START(domain_set_xdp_kfunc_ids)
+BTF_ID_FLAGS(func, bpf_xdp_dset_test)
+BTF_KFUNCS_END(domain_set_xdp_kfunc_ids)
+
+static const struct btf_kfunc_id_set domain_set_xdp_kfunc_set = {
+	.owner = THIS_MODULE,
+	.set = &domain_set_xdp_kfunc_ids,
+};
+
+BTF_KFUNCS_START(domain_set_skb_kfunc_ids)
+BTF_ID_FLAGS(func, bpf_skb_dset_test)
+BTF_KFUNCS_END(domain_set_skb_kfunc_ids)
+
+static const struct btf_kfunc_id_set domain_set_skb_kfunc_set = {
+	.owner = THIS_MODULE,
+	.set = &domain_set_skb_kfunc_ids,
+};
+
+int domain_set_bpf_init(void)
+{
+	int ret;
+
+	ret = register_btf_kfunc_id_set(BPF_PROG_TYPE_XDP,
+					&domain_set_xdp_kfunc_set);
+	if (ret)
+		return ret;
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_SCHED_CLS,
+					 &domain_set_skb_kfunc_set);
+}
+#else
+int domain_set_bpf_init(void)
+{
+	return 0;
+}
+#endif
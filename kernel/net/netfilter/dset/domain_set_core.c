@@ -30,6 +30,7 @@ struct domain_set_net {
 	domain_set_id_t domain_set_max; /* max number of sets */
 	bool is_deleted; /* deleted by domain_set_net_exit */
 	bool is_destroyed; /* all sets are destroyed */
+	atomic64_t generation; /* last generation given to a set */
 };
 
 static unsigned int domain_set_net_id __read_mostly;
@@ -40,12 +41,17 @@ static struct domain_set_net *domain_set_pernet(struct net *net)
 }
 
 #define DOMAIN_SET_INC 64
+/* Elements added/deleted per hold of the set lock in restore mode */
+#define DSET_AD_BATCH 64
 #define STRNCMP(a, b) (strncmp(a, b, DSET_MAXNAMELEN) == 0)
 
 static unsigned int max_sets;
+static unsigned int changelog_size = 1 << 16;
 
 module_param(max_sets, int, 0600);
 MODULE_PARM_DESC(max_sets, "maximal number of sets");
+module_param(changelog_size, uint, 0644);
+MODULE_PARM_DESC(changelog_size, "maximal size of the change log of a set");
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
 MODULE_DESCRIPTION("domain_set: protocol " __stringify(DSET_PROTOCOL));
@@ -289,7 +295,8 @@ static char *domain_set_comment_uget(struct nlattr *tb)
 	return nla_data(tb);
 }
 
-/* Called from uadd only, protected by the set spinlock.
+/* Called from uadd only, protected by the set spinlock or, for the
+ * types with region locks, by their exclusive table lock.
  * The kadt functions don't use the comment extensions in any way.
  */
 void domain_set_init_comment(struct domain_set *set,
@@ -312,7 +319,7 @@ void domain_set_init_comment(struct domain_set *set,
 	c = kmalloc(sizeof(*c) + len + 1, GFP_ATOMIC);
 	if (unlikely(!c))
 		return;
-	strlcpy(c->str, ext->comment, len + 1);
+	strscpy(c->str, ext->comment, len + 1);
 	set->ext_size += sizeof(*c) + strlen(c->str) + 1;
 	rcu_assign_pointer(comment->c, c);
 }
@@ -330,7 +337,7 @@ static int domain_set_put_comment(struct sk_buff *skb,
 }
 
 /* Called from uadd/udel, flush or the garbage collectors protected
- * by the set spinlock.
+ * by the set spinlock or the exclusive table lock of the type.
  * Called when the set is destroyed and when there can't be any user
  * of the set data anymore.
  */
@@ -379,6 +386,13 @@ const struct domain_set_ext_type domain_set_extensions[] = {
 			.align = __alignof__(struct domain_set_comment),
 			.destroy = domain_set_comment_free,
 		},
+	[DSET_EXT_ID_CATEGORY] =
+		{
+			.type = DSET_EXT_CATEGORY,
+			.flag = DSET_FLAG_WITH_CATEGORY,
+			.len = sizeof(u32),
+			.align = __alignof__(u32),
+		},
 };
 EXPORT_SYMBOL_GPL(domain_set_extensions);
 
@@ -424,7 +438,8 @@ int domain_set_get_extensions(struct domain_set *set, struct nlattr *tb[],
 		     !domain_set_optattr_netorder(tb, DSET_ATTR_BYTES) ||
 		     !domain_set_optattr_netorder(tb, DSET_ATTR_SKBMARK) ||
 		     !domain_set_optattr_netorder(tb, DSET_ATTR_SKBPRIO) ||
-		     !domain_set_optattr_netorder(tb, DSET_ATTR_SKBQUEUE)))
+		     !domain_set_optattr_netorder(tb, DSET_ATTR_SKBQUEUE) ||
+		     !domain_set_optattr_netorder(tb, DSET_ATTR_CATEGORY)))
 		return -DSET_ERR_PROTOCOL;
 
 	if (tb[DSET_ATTR_TIMEOUT]) {
@@ -466,10 +481,56 @@ int domain_set_get_extensions(struct domain_set *set, struct nlattr *tb[],
 		ext->skbinfo.skbqueue =
 			be16_to_cpu(nla_get_be16(tb[DSET_ATTR_SKBQUEUE]));
 	}
+	if (tb[DSET_ATTR_CATEGORY]) {
+		if (!SET_WITH_CATEGORY(set))
+			return -DSET_ERR_CATEGORY;
+		ext->category = be32_to_cpu(nla_get_be32(tb[DSET_ATTR_CATEGORY]));
+	}
 	return 0;
 }
 EXPORT_SYMBOL_GPL(domain_set_get_extensions);
 
+static const struct nla_policy
+domain_set_ipaddr_policy[DSET_ATTR_IPADDR_MAX + 1] = {
+	[DSET_ATTR_IPADDR_IPV4]	= { .type = NLA_U32 },
+	[DSET_ATTR_IPADDR_IPV6]	= { .type = NLA_BINARY,
+				    .len = sizeof(struct in6_addr) },
+};
+
+int domain_set_get_ipaddr(struct nlattr *nla, union nf_inet_addr *ip,
+			  u8 *family)
+{
+	struct nlattr *tb[DSET_ATTR_IPADDR_MAX + 1];
+
+	if (unlikely(!flag_nested(nla)))
+		return -DSET_ERR_PROTOCOL;
+	if (NLA_PARSE_NESTED(tb, DSET_ATTR_IPADDR_MAX, nla,
+			     domain_set_ipaddr_policy, NULL))
+		return -DSET_ERR_PROTOCOL;
+
+	memset(ip, 0, sizeof(*ip));
+	if (tb[DSET_ATTR_IPADDR_IPV4] && !tb[DSET_ATTR_IPADDR_IPV6]) {
+		if (unlikely(!domain_set_attr_netorder(tb,
+						       DSET_ATTR_IPADDR_IPV4)))
+			return -DSET_ERR_PROTOCOL;
+		ip->ip = nla_get_be32(tb[DSET_ATTR_IPADDR_IPV4]);
+		*family = NFPROTO_IPV4;
+	} else if (tb[DSET_ATTR_IPADDR_IPV6] && !tb[DSET_ATTR_IPADDR_IPV4]) {
+		if (unlikely(!domain_set_attr_netorder(tb,
+						       DSET_ATTR_IPADDR_IPV6) ||
+			     nla_len(tb[DSET_ATTR_IPADDR_IPV6]) !=
+			     sizeof(ip->in6)))
+			return -DSET_ERR_PROTOCOL;
+		memcpy(&ip->in6, nla_data(tb[DSET_ATTR_IPADDR_IPV6]),
+		       sizeof(ip->in6));
+		*family = NFPROTO_IPV6;
+	} else {
+		return -DSET_ERR_PROTOCOL;
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(domain_set_get_ipaddr);
+
 static u64 domain_set_get_bytes(const struct domain_set_counter *counter)
 {
 	return (u64)atomic64_read(&(counter)->bytes);
@@ -529,6 +590,11 @@ int domain_set_put_extensions(struct sk_buff *skb, const struct domain_set *set,
 	if (SET_WITH_SKBINFO(set) &&
 	    domain_set_put_skbinfo(skb, ext_skbinfo(e, set)))
 		return -EMSGSIZE;
+	/* Send nonzero category only */
+	if (SET_WITH_CATEGORY(set) && *ext_category(e, set) &&
+	    nla_put_net32(skb, DSET_ATTR_CATEGORY,
+			  htonl(*ext_category(e, set))))
+		return -EMSGSIZE;
 	return 0;
 }
 EXPORT_SYMBOL_GPL(domain_set_put_extensions);
@@ -587,6 +653,11 @@ bool domain_set_match_extensions(struct domain_set *set,
 	if (SET_WITH_TIMEOUT(set) &&
 	    domain_set_timeout_expired(ext_timeout(data, set)))
 		return false;
+	/* The category mask to match is passed in mext */
+	if ((flags & DSET_FLAG_MATCH_CATEGORY) &&
+	    !(SET_WITH_CATEGORY(set) &&
+	      (*ext_category(data, set) & mext->category)))
+		return false;
 	if (SET_WITH_COUNTER(set)) {
 		struct domain_set_counter *counter = ext_counter(data, set);
 
@@ -602,6 +673,8 @@ bool domain_set_match_extensions(struct domain_set *set,
 	if (SET_WITH_SKBINFO(set))
 		domain_set_get_skbinfo(ext_skbinfo(data, set), ext, mext,
 				       flags);
+	if (SET_WITH_CATEGORY(set))
+		mext->category = *ext_category(data, set);
 	return true;
 }
 EXPORT_SYMBOL_GPL(domain_set_match_extensions);
@@ -662,15 +735,27 @@ static struct domain_set *domain_set_rcu_get(struct net *net,
 	return set;
 }
 
-int domain_set_test(domain_set_id_t index, const struct sk_buff *skb,
-		    const struct xt_action_param *par,
-		    struct domain_set_adt_opt *opt)
+/* Lock the set for adding/deleting elements: the types with region
+ * locks serialize the writers of the same region only, by themselves,
+ * and list:set leaves the locking to its members.
+ */
+static inline void domain_set_lock(struct domain_set *set)
 {
-	struct domain_set *set = domain_set_rcu_get(DSET_DEV_NET(par), index);
-	int ret = 0;
+	if (!set->variant->own_lock)
+		spin_lock_bh(&set->lock);
+}
 
-	BUG_ON(!set);
-	pr_debug("set %s, index %u\n", set->name, index);
+static inline void domain_set_unlock(struct domain_set *set)
+{
+	if (!set->variant->own_lock)
+		spin_unlock_bh(&set->lock);
+}
+
+static int __domain_set_test(struct domain_set *set, const struct sk_buff *skb,
+			     const struct xt_action_param *par,
+			     struct domain_set_adt_opt *opt)
+{
+	int ret = 0;
 
 	if (!(opt->family == set->family || set->family == NFPROTO_UNSPEC))
 		return 0;
@@ -682,9 +767,11 @@ int domain_set_test(domain_set_id_t index, const struct sk_buff *skb,
 	if (ret == -EAGAIN) {
 		/* Type requests element to be completed */
 		pr_debug("element must be completed, ADD is triggered\n");
-		spin_lock_bh(&set->lock);
-		set->variant->kadt(set, skb, par, DSET_ADD, opt);
-		spin_unlock_bh(&set->lock);
+		opt->cmdflags |= DSET_FLAG_PACKET_PATH;
+		domain_set_lock(set);
+		if (!set->variant->kadt(set, skb, par, DSET_ADD, opt))
+			WRITE_ONCE(set->changelog_lost, true);
+		domain_set_unlock(set);
 		ret = 1;
 	} else {
 		/* --return-nomatch: invert matched element */
@@ -697,8 +784,254 @@ int domain_set_test(domain_set_id_t index, const struct sk_buff *skb,
 	/* Convert error codes to nomatch */
 	return (ret < 0 ? 0 : ret);
 }
+
+int domain_set_test(domain_set_id_t index, const struct sk_buff *skb,
+		    const struct xt_action_param *par,
+		    struct domain_set_adt_opt *opt)
+{
+	struct domain_set *set = domain_set_rcu_get(DSET_DEV_NET(par), index);
+
+	BUG_ON(!set);
+	pr_debug("set %s, index %u\n", set->name, index);
+
+	return __domain_set_test(set, skb, par, opt);
+}
 EXPORT_SYMBOL_GPL(domain_set_test);
 
+/* Add or delete from the packet path. The namespace is passed
+ * explicitly, because par is NULL out of xtables (nftables, tc).
+ */
+int domain_set_add_net(struct net *net, domain_set_id_t index,
+		       const struct sk_buff *skb,
+		       const struct xt_action_param *par,
+		       struct domain_set_adt_opt *opt)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+	int ret;
+
+	BUG_ON(!set);
+	pr_debug("set %s, index %u\n", set->name, index);
+
+	if (opt->dim < set->type->dimension ||
+	    !(opt->family == set->family || set->family == NFPROTO_UNSPEC))
+		return -DSET_ERR_TYPE_MISMATCH;
+
+	opt->cmdflags |= DSET_FLAG_PACKET_PATH;
+	domain_set_lock(set);
+	ret = set->variant->kadt(set, skb, par, DSET_ADD, opt);
+	if (!ret)
+		WRITE_ONCE(set->changelog_lost, true);
+	domain_set_unlock(set);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(domain_set_add_net);
+
+int domain_set_add(domain_set_id_t index, const struct sk_buff *skb,
+		   const struct xt_action_param *par,
+		   struct domain_set_adt_opt *opt)
+{
+	return domain_set_add_net(DSET_DEV_NET(par), index, skb, par, opt);
+}
+EXPORT_SYMBOL_GPL(domain_set_add);
+
+int domain_set_del_net(struct net *net, domain_set_id_t index,
+		       const struct sk_buff *skb,
+		       const struct xt_action_param *par,
+		       struct domain_set_adt_opt *opt)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+	int ret;
+
+	BUG_ON(!set);
+	pr_debug("set %s, index %u\n", set->name, index);
+
+	if (opt->dim < set->type->dimension ||
+	    !(opt->family == set->family || set->family == NFPROTO_UNSPEC))
+		return -DSET_ERR_TYPE_MISMATCH;
+
+	opt->cmdflags |= DSET_FLAG_PACKET_PATH;
+	domain_set_lock(set);
+	ret = set->variant->kadt(set, skb, par, DSET_DEL, opt);
+	if (!ret)
+		WRITE_ONCE(set->changelog_lost, true);
+	domain_set_unlock(set);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(domain_set_del_net);
+
+int domain_set_del(domain_set_id_t index, const struct sk_buff *skb,
+		   const struct xt_action_param *par,
+		   struct domain_set_adt_opt *opt)
+{
+	return domain_set_del_net(DSET_DEV_NET(par), index, skb, par, opt);
+}
+EXPORT_SYMBOL_GPL(domain_set_del);
+
+/* Test a packet against a set from outside of xtables (nftables, tc):
+ * the types must not rely on the xtables parameters in kadt.
+ */
+int domain_set_test_net(struct net *net, domain_set_id_t index,
+			const struct sk_buff *skb,
+			struct domain_set_adt_opt *opt)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+
+	BUG_ON(!set);
+	pr_debug("set %s, index %u\n", set->name, index);
+
+	return __domain_set_test(set, skb, NULL, opt);
+}
+EXPORT_SYMBOL_GPL(domain_set_test_net);
+
+/* Test the names of a DNS message against a set, without an skb
+ * (XDP) or with the message already located (tc, BPF). The set is
+ * looked up under RCU, so the caller does not need to hold a
+ * reference: destroying a set waits for the readers.
+ */
+int domain_set_test_dns(struct net *net, domain_set_id_t index,
+			const struct dset_dns_msg *msg,
+			struct domain_set_adt_opt *opt)
+{
+	struct domain_set_net *inst = domain_set_pernet(net);
+	struct domain_set *set;
+	int ret = 0;
+
+	if (index >= inst->domain_set_max)
+		return 0;
+
+	rcu_read_lock_bh();
+	set = rcu_dereference_bh(inst->domain_set_list)[index];
+	if (!set || !set->variant->dadt ||
+	    !(opt->family == set->family || set->family == NFPROTO_UNSPEC))
+		goto out;
+
+	ret = set->variant->dadt(set, msg, DSET_TEST, opt);
+	if (ret == -EAGAIN) {
+		/* Type requests element to be completed, like in
+		 * domain_set_test()
+		 */
+		pr_debug("element must be completed, ADD is triggered\n");
+		opt->cmdflags |= DSET_FLAG_PACKET_PATH;
+		domain_set_lock(set);
+		if (!set->variant->dadt(set, msg, DSET_ADD, opt))
+			WRITE_ONCE(set->changelog_lost, true);
+		domain_set_unlock(set);
+		ret = 1;
+	} else if ((opt->cmdflags & DSET_FLAG_RETURN_NOMATCH) &&
+		   (set->type->features & DSET_TYPE_NOMATCH) &&
+		   (ret > 0 || ret == -ENOTEMPTY)) {
+		/* --return-nomatch: invert matched element */
+		ret = -ret;
+	}
+out:
+	rcu_read_unlock_bh();
+
+	/* Convert error codes to nomatch */
+	return (ret < 0 ? 0 : ret);
+}
+EXPORT_SYMBOL_GPL(domain_set_test_dns);
+
+/* Test a single name of a DNS message against a set, for the types
+ * which walk the message once for all of their member sets (list:set).
+ * Must be called under rcu_read_lock_bh, the members are referenced.
+ */
+int domain_set_test_name(struct net *net, domain_set_id_t index,
+			 const struct dset_dns_msg *msg,
+			 const struct dset_dns_rr *rr,
+			 struct domain_set_adt_opt *opt)
+{
+	struct domain_set_net *inst = domain_set_pernet(net);
+	struct domain_set *set;
+	int ret;
+
+	set = rcu_dereference_bh(inst->domain_set_list)[index];
+	if (!set || !set->variant->nadt ||
+	    !(opt->family == set->family || set->family == NFPROTO_UNSPEC))
+		return 0;
+
+	ret = set->variant->nadt(set, msg, rr, DSET_TEST, opt);
+
+	/* Convert error codes and nomatch entries to nomatch */
+	return (ret < 0 ? 0 : ret);
+}
+EXPORT_SYMBOL_GPL(domain_set_test_name);
+
+/* Find set by name, reference it once. The reference makes sure the
+ * thing pointed to, does not go away under our feet.
+ *
+ * The nfnl mutex must already be held.
+ */
+domain_set_id_t domain_set_get_byname(struct net *net, const char *name,
+				      struct domain_set **set)
+{
+	domain_set_id_t i, index = DSET_INVALID_ID;
+	struct domain_set *s;
+	struct domain_set_net *inst = domain_set_pernet(net);
+
+	for (i = 0; i < inst->domain_set_max; i++) {
+		s = domain_set(inst, i);
+		if (s && STRNCMP(s->name, name)) {
+			__domain_set_get(s);
+			index = i;
+			*set = s;
+			break;
+		}
+	}
+
+	return index;
+}
+EXPORT_SYMBOL_GPL(domain_set_get_byname);
+
+/* If the given set pointer points to a valid set, decrement
+ * reference count by 1. The caller shall not assume the index
+ * to be valid, after calling this function.
+ *
+ * The nfnl mutex must already be held.
+ */
+void domain_set_put_byindex(struct net *net, domain_set_id_t index)
+{
+	struct domain_set *set;
+	struct domain_set_net *inst = domain_set_pernet(net);
+
+	if (inst->is_deleted) /* already deleted from domain_set_net_exit() */
+		return;
+	set = domain_set(inst, index);
+	if (set)
+		__domain_set_put(set);
+}
+EXPORT_SYMBOL_GPL(domain_set_put_byindex);
+
+/* Get the name of a set behind a set index.
+ * Set itself is protected by RCU, but its name isn't: to protect against
+ * renaming, grab domain_set_ref_lock as reader (see domain_set_rename()) and
+ * copy the name.
+ */
+void domain_set_name_byindex(struct net *net, domain_set_id_t index,
+			     char *name)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+
+	BUG_ON(!set);
+
+	read_lock_bh(&domain_set_ref_lock);
+	strncpy(name, set->name, DSET_MAXNAMELEN);
+	read_unlock_bh(&domain_set_ref_lock);
+}
+EXPORT_SYMBOL_GPL(domain_set_name_byindex);
+
+/* Get the features of the type of a set referenced by the caller */
+u16 domain_set_features_byindex(struct net *net, domain_set_id_t index)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+
+	BUG_ON(!set);
+
+	return set->type->features;
+}
+EXPORT_SYMBOL_GPL(domain_set_features_byindex);
+
 /* Find set by index, reference it once. The reference makes sure the
  * thing pointed to, does not go away under our feet.
  *
@@ -725,6 +1058,24 @@ domain_set_id_t domain_set_nfnl_get_byindex(struct net *net,
 }
 EXPORT_SYMBOL_GPL(domain_set_nfnl_get_byindex);
 
+/* Find set by name, reference it once, for the users outside of the
+ * nfnl callbacks (nftables).
+ *
+ * The nfnl mutex is used in the function.
+ */
+domain_set_id_t domain_set_nfnl_get_byname(struct net *net, const char *name,
+					   struct domain_set **set)
+{
+	domain_set_id_t index;
+
+	nfnl_lock(NFNL_SUBSYS_DSET);
+	index = domain_set_get_byname(net, name, set);
+	nfnl_unlock(NFNL_SUBSYS_DSET);
+
+	return index;
+}
+EXPORT_SYMBOL_GPL(domain_set_nfnl_get_byname);
+
 /* If the given set pointer points to a valid set, decrement
  * reference count by 1. The caller shall not assume the index
  * to be valid, after calling this function.
@@ -746,6 +1097,257 @@ void domain_set_nfnl_put(struct net *net, domain_set_id_t index)
 }
 EXPORT_SYMBOL_GPL(domain_set_nfnl_put);
 
+/* Sets shared between network namespaces.
+ *
+ * A namespace may publish one of its sets under the name of the set.
+ * The publication references the set index, so swapping in the owner
+ * replaces the shared set for everyone at once. Other namespaces attach
+ * the published set under a local name: the attached set is a link
+ * which forwards the tests to the set of the owner under RCU and
+ * refuses to be modified.
+ *
+ * The publications are keyed by the owner namespace and the name, so
+ * a namespace can neither take nor replace the publications of another
+ * one. The attaching namespace names the owner by a namespace file
+ * descriptor, the initial namespace by default.
+ *
+ * The publications are changed under the nfnl mutex and read under RCU
+ * by the dumps, the datapath reaches the owner through pub->inst, which
+ * is cleared when the owner namespace goes away.
+ */
+
+struct domain_set_pub {
+	struct list_head list;
+	struct rcu_head rcu;
+	struct domain_set_net __rcu *inst; /* owner, NULL after its exit */
+	const struct net *net; /* owner namespace, key of the publication */
+	domain_set_id_t index; /* index of the set in the owner */
+	u32 users; /* number of attached sets */
+	char name[DSET_MAXNAMELEN]; /* published name */
+};
+
+/* Data of an attached set */
+struct domain_set_link {
+	struct domain_set_pub *pub;
+	char netns[DSET_MAXNAMELEN]; /* owner namespace as named at attach */
+};
+
+static LIST_HEAD(domain_set_pub_list); /* all published sets */
+
+static const struct domain_set_type_variant domain_set_link_variant;
+
+#define domain_set_is_link(set) ((set)->variant == &domain_set_link_variant)
+#define domain_set_link_pub(set) \
+	(((const struct domain_set_link *)(set)->data)->pub)
+
+/* Attached sets are read-only: the targets refuse them up front */
+bool domain_set_attached_byindex(struct net *net, domain_set_id_t index)
+{
+	struct domain_set *set = domain_set_rcu_get(net, index);
+
+	BUG_ON(!set);
+
+	return domain_set_is_link(set);
+}
+EXPORT_SYMBOL_GPL(domain_set_attached_byindex);
+
+static struct domain_set_pub *find_pub(const struct net *net, const char *name)
+{
+	struct domain_set_pub *pub;
+
+	list_for_each_entry (pub, &domain_set_pub_list, list)
+		if (pub->net == net && STRNCMP(pub->name, name))
+			return pub;
+	return NULL;
+}
+
+/* Must be called under rcu_read_lock */
+static bool domain_set_is_published(const struct net *net,
+				    domain_set_id_t index)
+{
+	struct domain_set_pub *pub;
+
+	list_for_each_entry_rcu (pub, &domain_set_pub_list, list)
+		if (pub->net == net && pub->index == index)
+			return true;
+	return false;
+}
+
+/* Must be called under rcu_read_lock_bh */
+static struct domain_set *domain_set_link_rcu(const struct domain_set *set)
+{
+	const struct domain_set_pub *pub = domain_set_link_pub(set);
+	struct domain_set_net *inst = rcu_dereference_bh(pub->inst);
+
+	if (!inst)
+		return NULL;
+	return rcu_dereference_bh(inst->domain_set_list)[pub->index];
+}
+
+static int domain_set_link_kadt(struct domain_set *set,
+				const struct sk_buff *skb,
+				const struct xt_action_param *par,
+				enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set *s;
+
+	if (adt != DSET_TEST)
+		return -DSET_ERR_ATTACHED;
+	s = domain_set_link_rcu(set);
+	return s ? s->variant->kadt(s, skb, par, adt, opt) : 0;
+}
+
+static int domain_set_link_dadt(struct domain_set *set,
+				const struct dset_dns_msg *msg,
+				enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set *s;
+
+	if (adt != DSET_TEST)
+		return -DSET_ERR_ATTACHED;
+	s = domain_set_link_rcu(set);
+	return s && s->variant->dadt ? s->variant->dadt(s, msg, adt, opt) : 0;
+}
+
+static int domain_set_link_nadt(struct domain_set *set,
+				const struct dset_dns_msg *msg,
+				const struct dset_dns_rr *rr, enum dset_adt adt,
+				struct domain_set_adt_opt *opt)
+{
+	struct domain_set *s;
+
+	if (adt != DSET_TEST)
+		return -DSET_ERR_ATTACHED;
+	s = domain_set_link_rcu(set);
+	return s && s->variant->nadt ? s->variant->nadt(s, msg, rr, adt, opt) :
+				       0;
+}
+
+static int domain_set_link_uadt(struct domain_set *set, struct nlattr *tb[],
+				enum dset_adt adt, u32 *lineno, u32 flags,
+				bool retried)
+{
+	struct domain_set *s;
+
+	if (adt != DSET_TEST)
+		return -DSET_ERR_ATTACHED;
+	s = domain_set_link_rcu(set);
+	return s ? s->variant->uadt(s, tb, adt, lineno, flags, retried) : 0;
+}
+
+static void domain_set_link_destroy(struct domain_set *set)
+{
+	struct domain_set_link *link = set->data;
+	struct domain_set_pub *pub = link->pub;
+
+	/* The owner is gone, the last attached set frees the publication */
+	if (!--pub->users && !rcu_access_pointer(pub->inst))
+		kfree_rcu(pub, rcu);
+	kfree(link);
+	set->data = NULL;
+}
+
+static void domain_set_link_flush(struct domain_set *set)
+{
+}
+
+static int domain_set_link_head(struct domain_set *set, struct sk_buff *skb)
+{
+	struct domain_set *s;
+	struct nlattr *nested;
+	int ret = 0;
+
+	rcu_read_lock_bh();
+	s = domain_set_link_rcu(set);
+	if (s) {
+		ret = s->variant->head(s, skb);
+	} else {
+		nested = dset_nest_start(skb, DSET_ATTR_DATA);
+		if (!nested)
+			ret = -EMSGSIZE;
+		else
+			dset_nest_end(skb, nested);
+	}
+	rcu_read_unlock_bh();
+
+	return ret;
+}
+
+/* The elements of the shared set are not listed: a multi-message dump
+ * cannot follow the swaps in the owner namespace.
+ */
+static int domain_set_link_list(const struct domain_set *set,
+				struct sk_buff *skb,
+				struct netlink_callback *cb)
+{
+	struct nlattr *atd;
+
+	atd = dset_nest_start(skb, DSET_ATTR_ADT);
+	if (!atd)
+		return -EMSGSIZE;
+	dset_nest_end(skb, atd);
+	cb->args[DSET_CB_ARG0] = 0;
+
+	return 0;
+}
+
+static const struct domain_set_type_variant domain_set_link_variant = {
+	.kadt = domain_set_link_kadt,
+	.dadt = domain_set_link_dadt,
+	.nadt = domain_set_link_nadt,
+	.uadt = domain_set_link_uadt,
+	.destroy = domain_set_link_destroy,
+	.flush = domain_set_link_flush,
+	.head = domain_set_link_head,
+	.list = domain_set_link_list,
+};
+
+/* Publication state in the header of a listed set */
+static int domain_set_pub_head(const struct net *net, struct domain_set *set,
+			       domain_set_id_t index, struct sk_buff *skb)
+{
+	const struct domain_set_link *link;
+	bool published;
+
+	if (domain_set_is_link(set)) {
+		link = set->data;
+		if (nla_put_string(skb, DSET_ATTR_LINK, link->pub->name) ||
+		    (link->netns[0] &&
+		     nla_put_string(skb, DSET_ATTR_NETNS, link->netns)))
+			return -EMSGSIZE;
+		return 0;
+	}
+	rcu_read_lock();
+	published = domain_set_is_published(net, index);
+	rcu_read_unlock();
+	if (published && nla_put_flag(skb, DSET_ATTR_PUBLISHED))
+		return -EMSGSIZE;
+
+	return 0;
+}
+
+/* The owner namespace is going away: the attached sets match nothing
+ * from now on and the last of them frees the publication.
+ */
+static void domain_set_pub_net_exit(struct domain_set_net *inst)
+{
+	struct domain_set_pub *pub, *n;
+	bool unlinked = false;
+
+	list_for_each_entry_safe (pub, n, &domain_set_pub_list, list) {
+		if (rcu_access_pointer(pub->inst) != inst)
+			continue;
+		RCU_INIT_POINTER(pub->inst, NULL);
+		list_del_rcu(&pub->list);
+		if (!pub->users)
+			kfree_rcu(pub, rcu);
+		unlinked = true;
+	}
+	if (unlinked)
+		/* Wait for the readers of the attached sets */
+		synchronize_net();
+}
+
 /* Communication protocol with userspace over netlink.
  *
  * The commands are serialized by the nfnl mutex.
@@ -766,28 +1368,342 @@ static inline bool protocol_min_failed(const struct nlattr *const tb[])
 	return !tb[DSET_ATTR_PROTOCOL] || protocol(tb) < DSET_PROTOCOL_MIN;
 }
 
-static inline u32 flag_exist(const struct nlmsghdr *nlh)
+static inline u32 flag_exist(const struct nlmsghdr *nlh)
+{
+	return nlh->nlmsg_flags & NLM_F_EXCL ? 0 : DSET_FLAG_EXIST;
+}
+
+static struct nlmsghdr *start_msg(struct sk_buff *skb, u32 portid, u32 seq,
+				  unsigned int flags, enum dset_cmd cmd)
+{
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfmsg;
+
+	nlh = nlmsg_put(skb, portid, seq, nfnl_msg_type(NFNL_SUBSYS_DSET, cmd),
+			sizeof(*nfmsg), flags);
+	if (!nlh)
+		return NULL;
+
+	nfmsg = nlmsg_data(nlh);
+	nfmsg->nfgen_family = NFPROTO_UNSPEC;
+	nfmsg->version = NFNETLINK_V0;
+	nfmsg->res_id = 0;
+
+	return nlh;
+}
+
+/* Change notifications
+ *
+ * The successful changes made from userspace are published on the
+ * NFNLGRP_DSET multicast group in the message of the command: the
+ * setnames of the request, the type and the new generation of the
+ * changed set, and the elements of an add/del as they were sent. The
+ * elements of a restore message are published in a single event.
+ * The elements inserted into or removed from a set by the packet path
+ * are published without a generation, as they are not in the change
+ * log, and batched the same way: they are collected in a pending event
+ * of the set, sent when it is full, when the command changes or
+ * DSET_EVENT_DELAY after its first element. Refreshing the timeout of
+ * an element already in the set is not published.
+ */
+
+#define DSET_EVENT_DELAY	(HZ / 10)
+
+static void domain_set_notify(struct net *net, const struct sk_buff *skb,
+			      enum dset_cmd cmd,
+			      const struct nlattr *const attr[],
+			      const struct domain_set *set, u16 type,
+			      const void *data, int len)
+{
+#ifdef HAVE_NFNLGRP_DSET
+	struct sk_buff *skb2;
+	struct nlmsghdr *nlh2;
+	size_t size = NLMSG_DEFAULT_SIZE;
+
+	if (!nfnetlink_has_listeners(net, NFNLGRP_DSET))
+		return;
+
+	if (data)
+		size += nla_total_size(len);
+	skb2 = nlmsg_new(size, GFP_KERNEL);
+	if (!skb2)
+		goto failure;
+	nlh2 = start_msg(skb2, 0, 0, 0, cmd);
+	if (!nlh2)
+		goto nla_put_failure;
+	if (nla_put_u8(skb2, DSET_ATTR_PROTOCOL, DSET_PROTOCOL) ||
+	    (attr[DSET_ATTR_SETNAME] &&
+	     nla_put_string(skb2, DSET_ATTR_SETNAME,
+			    nla_data(attr[DSET_ATTR_SETNAME]))) ||
+	    (attr[DSET_ATTR_SETNAME2] &&
+	     nla_put_string(skb2, DSET_ATTR_SETNAME2,
+			    nla_data(attr[DSET_ATTR_SETNAME2]))) ||
+	    (attr[DSET_ATTR_LOAD] &&
+	     nla_put_u8(skb2, DSET_ATTR_LOAD,
+			nla_get_u8(attr[DSET_ATTR_LOAD]))) ||
+	    (attr[DSET_ATTR_NETNS] &&
+	     nla_put_string(skb2, DSET_ATTR_NETNS,
+			    nla_data(attr[DSET_ATTR_NETNS]))))
+		goto nla_put_failure;
+	if (set &&
+	    (nla_put_string(skb2, DSET_ATTR_TYPENAME, set->type->name) ||
+	     nla_put_u8(skb2, DSET_ATTR_REVISION, set->revision) ||
+	     DSET_NLA_PUT_NET64(skb2, DSET_ATTR_GENERATION,
+				cpu_to_be64(set->generation),
+				DSET_ATTR_CMD_PAD)))
+		goto nla_put_failure;
+	if (data && nla_put(skb2, type | NLA_F_NESTED, len, data))
+		goto nla_put_failure;
+	nlmsg_end(skb2, nlh2);
+
+	nfnetlink_send(skb2, net, NETLINK_PORTID(skb), NFNLGRP_DSET, 0,
+		       GFP_KERNEL);
+	return;
+
+nla_put_failure:
+	kfree_skb(skb2);
+failure:
+	nfnetlink_set_err(net, 0, NFNLGRP_DSET, -ENOBUFS);
+#endif
+}
+
+/* Detach the pending event of the set with its nests closed */
+static struct sk_buff *domain_set_event_detach(struct domain_set *set)
+{
+	struct sk_buff *skb = set->event_skb;
+
+	if (!skb)
+		return NULL;
+	dset_nest_end(skb, set->event_adt);
+	nlmsg_end(skb, nlmsg_hdr(skb));
+	set->event_skb = NULL;
+	set->event_elems = 0;
+	return skb;
+}
+
+static void domain_set_event_send(struct domain_set *set, struct sk_buff *skb)
+{
+#ifdef HAVE_NFNLGRP_DSET
+	if (skb)
+		nfnetlink_send(skb, set->net, 0, NFNLGRP_DSET, 0, GFP_ATOMIC);
+#endif
+}
+
+static void domain_set_event_work(struct work_struct *work)
+{
+	struct domain_set *set = container_of(to_delayed_work(work),
+					      struct domain_set, event_work);
+	struct sk_buff *skb;
+
+	spin_lock_bh(&set->event_lock);
+	skb = domain_set_event_detach(set);
+	spin_unlock_bh(&set->event_lock);
+	domain_set_event_send(set, skb);
+}
+
+static void domain_set_event_init(struct domain_set *set)
+{
+	spin_lock_init(&set->event_lock);
+	INIT_DELAYED_WORK(&set->event_work, domain_set_event_work);
+}
+
+/* Drop the pending event of a set being destroyed: the destroy event
+ * supersedes it
+ */
+static void domain_set_event_cancel(struct domain_set *set)
+{
+	cancel_delayed_work_sync(&set->event_work);
+	kfree_skb(set->event_skb);
+	set->event_skb = NULL;
+}
+
+#ifdef HAVE_NFNLGRP_DSET
+/* Start a new pending event of the set for the command */
+static int domain_set_event_start(struct domain_set *set, enum dset_cmd cmd)
+{
+	struct sk_buff *skb;
+	struct nlmsghdr *nlh;
+
+	skb = nlmsg_new(NLMSG_DEFAULT_SIZE, GFP_ATOMIC);
+	if (!skb)
+		return -ENOMEM;
+	nlh = start_msg(skb, 0, 0, 0, cmd);
+	if (!nlh ||
+	    nla_put_u8(skb, DSET_ATTR_PROTOCOL, DSET_PROTOCOL) ||
+	    nla_put_string(skb, DSET_ATTR_SETNAME, set->name) ||
+	    nla_put_string(skb, DSET_ATTR_TYPENAME, set->type->name) ||
+	    nla_put_u8(skb, DSET_ATTR_REVISION, set->revision))
+		goto nla_put_failure;
+	set->event_adt = dset_nest_start(skb, DSET_ATTR_ADT);
+	if (!set->event_adt)
+		goto nla_put_failure;
+	set->event_skb = skb;
+	set->event_cmd = cmd;
+	schedule_delayed_work(&set->event_work, DSET_EVENT_DELAY);
+	return 0;
+
+nla_put_failure:
+	kfree_skb(skb);
+	return -EMSGSIZE;
+}
+#endif
+
+/* Called by the types in the packet path, with the set or region lock
+ * released, when an element is inserted or removed: put() adds the
+ * attributes of the element to the pending event of the set.
+ */
+void domain_set_notify_kadt(struct domain_set *set, enum dset_cmd cmd,
+			    bool (*put)(struct sk_buff *skb, const void *elem),
+			    const void *elem)
+{
+#ifdef HAVE_NFNLGRP_DSET
+	struct sk_buff *full = NULL;
+	struct nlattr *nested;
+
+	if (!set->net || !nfnetlink_has_listeners(set->net, NFNLGRP_DSET))
+		return;
+
+	spin_lock_bh(&set->event_lock);
+	if (set->event_skb && set->event_cmd != cmd)
+		full = domain_set_event_detach(set);
+retry:
+	if (!set->event_skb && domain_set_event_start(set, cmd))
+		goto failure;
+	nested = dset_nest_start(set->event_skb, DSET_ATTR_DATA);
+	if (!nested || put(set->event_skb, elem)) {
+		if (nested)
+			nla_nest_cancel(set->event_skb, nested);
+		/* An element which does not fit into an empty event */
+		if (!set->event_elems)
+			goto failure;
+		full = domain_set_event_detach(set);
+		goto retry;
+	}
+	dset_nest_end(set->event_skb, nested);
+	set->event_elems++;
+	spin_unlock_bh(&set->event_lock);
+	domain_set_event_send(set, full);
+	return;
+
+failure:
+	if (set->event_skb && !set->event_elems) {
+		kfree_skb(set->event_skb);
+		set->event_skb = NULL;
+	}
+	spin_unlock_bh(&set->event_lock);
+	domain_set_event_send(set, full);
+	nfnetlink_set_err(set->net, 0, NFNLGRP_DSET, -ENOBUFS);
+#endif
+}
+EXPORT_SYMBOL_GPL(domain_set_notify_kadt);
+
+/* Change log
+ *
+ * Every change of a set from userspace gets a new generation from the
+ * counter of the namespace, so that the generations grow across the
+ * sets swapped, renamed or created under the same name. The add, del
+ * and flush changes are kept in the message format of the command in
+ * a log bounded by changelog_size bytes, from which the changes since
+ * a generation are sent back. A change which cannot be replayed, like
+ * the replacement of the content at a bulk load, restarts the log.
+ * The changes from the packet path and the expiry of the entries are
+ * not logged: the sets with timeout and the sets changed by the packet
+ * path since the last restart answer that they have to be listed
+ * again. The sets with timeout and the attached sets, which always
+ * answer so, keep no log at all, just the generations. So do the sets with userspace writers which overlapped, as
+ * their changes are not ordered.
+ */
+
+struct domain_set_change {
+	struct list_head list;
+	u64 generation;
+	u8 cmd;
+	u16 type;
+	int len;
+	char data[];
+};
+
+static void domain_set_changelog_free(struct domain_set *set)
+{
+	struct domain_set_change *c, *n;
+
+	list_for_each_entry_safe (c, n, &set->changelog, list) {
+		list_del(&c->list);
+		kfree(c);
+	}
+	set->changelog_size = 0;
+}
+
+static void domain_set_changelog_reset(struct domain_set_net *inst,
+				       struct domain_set *set)
+{
+	mutex_lock(&set->changelog_mutex);
+	domain_set_changelog_free(set);
+	set->changelog_base = atomic64_inc_return(&inst->generation);
+	WRITE_ONCE(set->generation, set->changelog_base);
+	mutex_unlock(&set->changelog_mutex);
+}
+
+static void domain_set_changelog_add(struct domain_set_net *inst,
+				     struct domain_set *set,
+				     enum dset_cmd cmd, u16 type,
+				     const void *data, int len)
+{
+	struct domain_set_change *c, *n;
+	size_t size = sizeof(*c) + len, max = READ_ONCE(changelog_size);
+
+	if (SET_WITH_TIMEOUT(set) || domain_set_is_link(set)) {
+		mutex_lock(&set->changelog_mutex);
+		WRITE_ONCE(set->generation,
+			   atomic64_inc_return(&inst->generation));
+		mutex_unlock(&set->changelog_mutex);
+		return;
+	}
+	c = size <= max ? kmalloc(size, GFP_KERNEL) : NULL;
+	if (!c) {
+		/* The change is lost for the log */
+		domain_set_changelog_reset(inst, set);
+		return;
+	}
+	c->cmd = cmd;
+	c->type = type;
+	c->len = len;
+	if (len)
+		memcpy(c->data, data, len);
+	mutex_lock(&set->changelog_mutex);
+	c->generation = atomic64_inc_return(&inst->generation);
+	list_add_tail(&c->list, &set->changelog);
+	set->changelog_size += size;
+	WRITE_ONCE(set->generation, c->generation);
+
+	list_for_each_entry_safe (c, n, &set->changelog, list) {
+		if (set->changelog_size <= max)
+			break;
+		set->changelog_size -= sizeof(*c) + c->len;
+		set->changelog_base = c->generation;
+		list_del(&c->list);
+		kfree(c);
+	}
+	mutex_unlock(&set->changelog_mutex);
+}
+
+/* Userspace writers of a set may run in parallel. A writer which
+ * overlaps another one, started before or during it, marks the log
+ * lost at its end, after its changes are logged.
+ */
+static bool domain_set_writer_begin(struct domain_set *set, int *seq)
 {
-	return nlh->nlmsg_flags & NLM_F_EXCL ? 0 : DSET_FLAG_EXIST;
+	*seq = atomic_inc_return(&set->writer_seq);
+	return atomic_inc_return(&set->writers) > 1;
 }
 
-static struct nlmsghdr *start_msg(struct sk_buff *skb, u32 portid, u32 seq,
-				  unsigned int flags, enum dset_cmd cmd)
+static void domain_set_writer_end(struct domain_set *set, int seq,
+				  bool overlap)
 {
-	struct nlmsghdr *nlh;
-	struct nfgenmsg *nfmsg;
-
-	nlh = nlmsg_put(skb, portid, seq, nfnl_msg_type(NFNL_SUBSYS_DSET, cmd),
-			sizeof(*nfmsg), flags);
-	if (!nlh)
-		return NULL;
-
-	nfmsg = nlmsg_data(nlh);
-	nfmsg->nfgen_family = NFPROTO_UNSPEC;
-	nfmsg->version = NFNETLINK_V0;
-	nfmsg->res_id = 0;
-
-	return nlh;
+	smp_mb();
+	if (overlap || atomic_read(&set->writer_seq) != seq)
+		WRITE_ONCE(set->changelog_lost, true);
+	atomic_dec(&set->writers);
 }
 
 /* Create a set */
@@ -853,6 +1769,34 @@ static int find_free_id(struct domain_set_net *inst, const char *name,
 	return 0;
 }
 
+/* No free slot remained: grow domain_set_list and return the first
+ * new index.
+ */
+static int grow_set_list(struct domain_set_net *inst, domain_set_id_t *index)
+{
+	struct domain_set **list, **tmp;
+	domain_set_id_t i = inst->domain_set_max + DOMAIN_SET_INC;
+
+	if (i < inst->domain_set_max || i == DSET_INVALID_ID)
+		/* Wraparound */
+		return -DSET_ERR_MAX_SETS;
+
+	list = kvcalloc(i, sizeof(struct domain_set *), GFP_KERNEL);
+	if (!list)
+		return -DSET_ERR_MAX_SETS;
+	/* nfnl mutex is held, both lists are valid */
+	tmp = domain_set_dereference(inst->domain_set_list);
+	memcpy(list, tmp, sizeof(struct domain_set *) * inst->domain_set_max);
+	rcu_assign_pointer(inst->domain_set_list, list);
+	/* Make sure all current packets have passed through */
+	synchronize_net();
+	/* Use new list */
+	*index = inst->domain_set_max;
+	inst->domain_set_max = i;
+	kvfree(tmp);
+	return 0;
+}
+
 static int DSET_CBFN(domain_set_none, struct net *net, struct sock *ctnl,
 		     struct sk_buff *skb, const struct nlmsghdr *nlh,
 		     const struct nlattr *const attr[],
@@ -897,9 +1841,13 @@ static int DSET_CBFN(domain_set_create, struct net *n, struct sock *ctnl,
 	if (!set)
 		return -ENOMEM;
 	spin_lock_init(&set->lock);
-	strlcpy(set->name, name, DSET_MAXNAMELEN);
+	INIT_LIST_HEAD(&set->changelog);
+	mutex_init(&set->changelog_mutex);
+	domain_set_event_init(set);
+	strscpy(set->name, name, DSET_MAXNAMELEN);
 	set->family = family;
 	set->revision = revision;
+	set->net = net;
 
 	/* Next, check that we know the type, and take
 	 * a reference on the type, to make sure it stays available
@@ -933,7 +1881,7 @@ static int DSET_CBFN(domain_set_create, struct net *n, struct sock *ctnl,
 	ret = find_free_id(inst, set->name, &index, &clash);
 	if (ret == -EEXIST) {
 		/* If this is the same set and requested, ignore error */
-		if ((flags & DSET_FLAG_EXIST) &&
+		if ((flags & DSET_FLAG_EXIST) && !domain_set_is_link(clash) &&
 		    STRNCMP(set->type->name, clash->type->name) &&
 		    set->type->family == clash->type->family &&
 		    set->type->revision_min == clash->type->revision_min &&
@@ -942,35 +1890,18 @@ static int DSET_CBFN(domain_set_create, struct net *n, struct sock *ctnl,
 			ret = 0;
 		goto cleanup;
 	} else if (ret == -DSET_ERR_MAX_SETS) {
-		struct domain_set **list, **tmp;
-		domain_set_id_t i = inst->domain_set_max + DOMAIN_SET_INC;
-
-		if (i < inst->domain_set_max || i == DSET_INVALID_ID)
-			/* Wraparound */
+		ret = grow_set_list(inst, &index);
+		if (ret)
 			goto cleanup;
-
-		list = kvcalloc(i, sizeof(struct domain_set *), GFP_KERNEL);
-		if (!list)
-			goto cleanup;
-		/* nfnl mutex is held, both lists are valid */
-		tmp = domain_set_dereference(inst->domain_set_list);
-		memcpy(list, tmp,
-		       sizeof(struct domain_set *) * inst->domain_set_max);
-		rcu_assign_pointer(inst->domain_set_list, list);
-		/* Make sure all current packets have passed through */
-		synchronize_net();
-		/* Use new list */
-		index = inst->domain_set_max;
-		inst->domain_set_max = i;
-		kvfree(tmp);
-		ret = 0;
 	} else if (ret) {
 		goto cleanup;
 	}
 
 	/* Finally! Add our shiny new set to the list, and be done. */
 	pr_debug("create: '%s' created with index %u!\n", set->name, index);
+	domain_set_changelog_reset(inst, set);
 	domain_set(inst, index) = set;
+	domain_set_notify(net, skb, DSET_CMD_CREATE, attr, set, 0, NULL, 0);
 
 	return ret;
 
@@ -992,11 +1923,22 @@ static const struct nla_policy
 					.len = DSET_MAXNAMELEN - 1 },
 	};
 
+static void domain_set_shadow_destroy(struct domain_set *set)
+{
+	if (set->shadow) {
+		set->shadow->variant->shadow_destroy(set->shadow);
+		set->shadow = NULL;
+	}
+}
+
 static void domain_set_destroy_set(struct domain_set *set)
 {
 	pr_debug("set: %s\n", set->name);
 
 	/* Must call it without holding any lock */
+	domain_set_event_cancel(set);
+	domain_set_shadow_destroy(set);
+	domain_set_changelog_free(set);
 	set->variant->destroy(set);
 	module_put(set->type->me);
 	kfree(set);
@@ -1009,7 +1951,7 @@ static int DSET_CBFN(domain_set_destroy, struct net *net, struct sock *ctnl,
 {
 	struct domain_set_net *inst =
 		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
-	struct domain_set *s;
+	struct domain_set **list, **tmp, *s;
 	domain_set_id_t i;
 	int ret = 0;
 
@@ -1029,27 +1971,37 @@ static int DSET_CBFN(domain_set_destroy, struct net *net, struct sock *ctnl,
 	 * counter, so if it's already zero, we can proceed
 	 * without holding the lock.
 	 */
-	read_lock_bh(&domain_set_ref_lock);
 	if (!attr[DSET_ATTR_SETNAME]) {
+		/* The sets are unlinked at once by replacing the list,
+		 * so that the readers are waited for a single time
+		 */
+		list = kvcalloc(inst->domain_set_max, sizeof(struct domain_set *),
+				GFP_KERNEL);
+		if (!list)
+			return -ENOMEM;
+		read_lock_bh(&domain_set_ref_lock);
 		for (i = 0; i < inst->domain_set_max; i++) {
 			s = domain_set(inst, i);
 			if (s && (s->ref || s->ref_netlink)) {
-				ret = -DSET_ERR_BUSY;
-				goto out;
+				read_unlock_bh(&domain_set_ref_lock);
+				kvfree(list);
+				return -DSET_ERR_BUSY;
 			}
 		}
 		inst->is_destroyed = true;
+		tmp = domain_set_dereference(inst->domain_set_list);
+		rcu_assign_pointer(inst->domain_set_list, list);
 		read_unlock_bh(&domain_set_ref_lock);
-		for (i = 0; i < inst->domain_set_max; i++) {
-			s = domain_set(inst, i);
-			if (s) {
-				domain_set(inst, i) = NULL;
-				domain_set_destroy_set(s);
-			}
-		}
+		/* Wait for the readers without reference (BPF) */
+		synchronize_net();
+		for (i = 0; i < inst->domain_set_max; i++)
+			if (tmp[i])
+				domain_set_destroy_set(tmp[i]);
+		kvfree(tmp);
 		/* Modified by domain_set_destroy() only, which is serialized */
 		inst->is_destroyed = false;
 	} else {
+		read_lock_bh(&domain_set_ref_lock);
 		s = find_set_and_id(inst, nla_data(attr[DSET_ATTR_SETNAME]),
 				    &i);
 		if (!s) {
@@ -1062,8 +2014,12 @@ static int DSET_CBFN(domain_set_destroy, struct net *net, struct sock *ctnl,
 		domain_set(inst, i) = NULL;
 		read_unlock_bh(&domain_set_ref_lock);
 
+		/* Wait for the readers without reference (BPF) */
+		synchronize_net();
 		domain_set_destroy_set(s);
 	}
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_DESTROY,
+			  attr, NULL, 0, NULL, 0);
 	return 0;
 out:
 	read_unlock_bh(&domain_set_ref_lock);
@@ -1072,13 +2028,20 @@ out:
 
 /* Flush sets */
 
-static void domain_set_flush_set(struct domain_set *set)
+static void domain_set_flush_set(struct domain_set_net *inst,
+				 struct domain_set *set)
 {
+	bool overlap;
+	int seq;
+
 	pr_debug("set: %s\n", set->name);
 
-	spin_lock_bh(&set->lock);
+	overlap = domain_set_writer_begin(set, &seq);
+	domain_set_lock(set);
 	set->variant->flush(set);
-	spin_unlock_bh(&set->lock);
+	domain_set_unlock(set);
+	domain_set_changelog_add(inst, set, DSET_CMD_FLUSH, 0, NULL, 0);
+	domain_set_writer_end(set, seq, overlap);
 }
 
 static int DSET_CBFN(domain_set_flush, struct net *net, struct sock *ctnl,
@@ -1098,15 +2061,19 @@ static int DSET_CBFN(domain_set_flush, struct net *net, struct sock *ctnl,
 		for (i = 0; i < inst->domain_set_max; i++) {
 			s = domain_set(inst, i);
 			if (s)
-				domain_set_flush_set(s);
+				domain_set_flush_set(inst, s);
 		}
 	} else {
 		s = find_set(inst, nla_data(attr[DSET_ATTR_SETNAME]));
 		if (!s)
 			return -ENOENT;
+		if (domain_set_is_link(s))
+			return -DSET_ERR_ATTACHED;
 
-		domain_set_flush_set(s);
+		domain_set_flush_set(inst, s);
 	}
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_FLUSH,
+			  attr, attr[DSET_ATTR_SETNAME] ? s : NULL, 0, NULL, 0);
 
 	return 0;
 }
@@ -1160,6 +2127,12 @@ static int DSET_CBFN(domain_set_rename, struct net *net, struct sock *ctnl,
 
 out:
 	write_unlock_bh(&domain_set_ref_lock);
+	if (!ret) {
+		/* The generations of the former set of the name are void */
+		domain_set_changelog_reset(inst, set);
+		domain_set_notify(DSET_SOCK_NET(net, ctnl), skb,
+				  DSET_CMD_RENAME, attr, set, 0, NULL, 0);
+	}
 	return ret;
 }
 
@@ -1203,6 +2176,9 @@ static int DSET_CBFN(domain_set_swap, struct net *net, struct sock *ctnl,
 	if (!(from->type->features == to->type->features &&
 	      from->family == to->family))
 		return -DSET_ERR_TYPE_MISMATCH;
+	/* Published indices must not end up pointing to attached sets */
+	if (domain_set_is_link(from) != domain_set_is_link(to))
+		return -DSET_ERR_TYPE_MISMATCH;
 
 	write_lock_bh(&domain_set_ref_lock);
 
@@ -1219,8 +2195,195 @@ static int DSET_CBFN(domain_set_swap, struct net *net, struct sock *ctnl,
 	domain_set(inst, from_id) = to;
 	domain_set(inst, to_id) = from;
 	write_unlock_bh(&domain_set_ref_lock);
+	domain_set_changelog_reset(inst, from);
+	domain_set_changelog_reset(inst, to);
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_SWAP, attr,
+			  NULL, 0, NULL, 0);
+
+	return 0;
+}
+
+/* Publish a set for the other namespaces */
+
+static int DSET_CBFN(domain_set_publish, struct net *net, struct sock *ctnl,
+		     struct sk_buff *skb, const struct nlmsghdr *nlh,
+		     const struct nlattr *const attr[],
+		     struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct domain_set_pub *pub;
+	struct domain_set *set;
+	domain_set_id_t index;
+
+	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME]))
+		return -DSET_ERR_PROTOCOL;
+
+	set = find_set_and_id(inst, nla_data(attr[DSET_ATTR_SETNAME]), &index);
+	if (!set)
+		return -ENOENT;
+	if (domain_set_is_link(set))
+		return -DSET_ERR_ATTACHED;
+	if (find_pub(DSET_SOCK_NET(net, ctnl), set->name))
+		return -EEXIST;
+
+	pub = kzalloc(sizeof(*pub), GFP_KERNEL);
+	if (!pub)
+		return -ENOMEM;
+	strscpy(pub->name, set->name, DSET_MAXNAMELEN);
+	pub->net = DSET_SOCK_NET(net, ctnl);
+	pub->index = index;
+	rcu_assign_pointer(pub->inst, inst);
+	/* The reference follows the index when the set is swapped */
+	__domain_set_get(set);
+	list_add_tail_rcu(&pub->list, &domain_set_pub_list);
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_PUBLISH,
+			  attr, set, 0, NULL, 0);
+
+	return 0;
+}
+
+static int DSET_CBFN(domain_set_unpublish, struct net *net, struct sock *ctnl,
+		     struct sk_buff *skb, const struct nlmsghdr *nlh,
+		     const struct nlattr *const attr[],
+		     struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct domain_set_pub *pub;
+	struct domain_set *set;
+
+	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME]))
+		return -DSET_ERR_PROTOCOL;
+
+	pub = find_pub(DSET_SOCK_NET(net, ctnl),
+		       nla_data(attr[DSET_ATTR_SETNAME]));
+	if (!pub)
+		return -ENOENT;
+	if (pub->users)
+		return -DSET_ERR_BUSY;
+
+	set = domain_set(inst, pub->index);
+	__domain_set_put(set);
+	list_del_rcu(&pub->list);
+	kfree_rcu(pub, rcu);
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_UNPUBLISH,
+			  attr, set, 0, NULL, 0);
+
+	return 0;
+}
+
+/* Attach a published set under a local name */
+
+static const struct nla_policy
+	domain_set_attach_policy[DSET_ATTR_CMD_MAX + 1] = {
+		[DSET_ATTR_PROTOCOL] = { .type = NLA_U8 },
+		[DSET_ATTR_SETNAME] = { .type = NLA_NUL_STRING,
+					.len = DSET_MAXNAMELEN - 1 },
+		[DSET_ATTR_SETNAME2] = { .type = NLA_NUL_STRING,
+					 .len = DSET_MAXNAMELEN - 1 },
+		[DSET_ATTR_NETNS_FD] = { .type = NLA_U32 },
+		[DSET_ATTR_NETNS] = { .type = NLA_NUL_STRING,
+				      .len = DSET_MAXNAMELEN - 1 },
+	};
+
+/* The owner namespace is given by a file descriptor of the sender,
+ * the publications of the initial namespace are attached by default.
+ */
+static struct domain_set_pub *find_attach_pub(const struct nlattr *const attr[])
+{
+	struct domain_set_pub *pub;
+	struct net *owner;
+
+	if (!attr[DSET_ATTR_NETNS_FD])
+		return find_pub(&init_net, nla_data(attr[DSET_ATTR_SETNAME]));
+
+	owner = get_net_ns_by_fd(nla_get_u32(attr[DSET_ATTR_NETNS_FD]));
+	if (IS_ERR(owner))
+		return ERR_CAST(owner);
+	pub = find_pub(owner, nla_data(attr[DSET_ATTR_SETNAME]));
+	put_net(owner);
+
+	return pub;
+}
+
+static int DSET_CBFN(domain_set_attach, struct net *net, struct sock *ctnl,
+		     struct sk_buff *skb, const struct nlmsghdr *nlh,
+		     const struct nlattr *const attr[],
+		     struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *owner, *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct domain_set *set, *s, *clash = NULL;
+	domain_set_id_t index = DSET_INVALID_ID;
+	struct domain_set_link *link;
+	struct domain_set_pub *pub;
+	int ret;
+
+	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME] ||
+		     !attr[DSET_ATTR_SETNAME2]))
+		return -DSET_ERR_PROTOCOL;
+
+	pub = find_attach_pub(attr);
+	if (IS_ERR(pub))
+		return PTR_ERR(pub);
+	if (!pub)
+		return -ENOENT;
+	/* Published sets are unlinked when the owner goes away */
+	owner = rcu_dereference_protected(
+		pub->inst, lockdep_nfnl_is_held(NFNL_SUBSYS_DSET));
+	s = domain_set(owner, pub->index);
+
+	set = kzalloc(sizeof(*set), GFP_KERNEL);
+	if (!set)
+		return -ENOMEM;
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	link->pub = pub;
+	if (attr[DSET_ATTR_NETNS])
+		nla_strscpy(link->netns, attr[DSET_ATTR_NETNS],
+			    DSET_MAXNAMELEN);
+	spin_lock_init(&set->lock);
+	INIT_LIST_HEAD(&set->changelog);
+	mutex_init(&set->changelog_mutex);
+	domain_set_event_init(set);
+	strscpy(set->name, nla_data(attr[DSET_ATTR_SETNAME2]), DSET_MAXNAMELEN);
+	set->family = s->family;
+	set->revision = s->revision;
+	set->type = s->type;
+	set->variant = &domain_set_link_variant;
+	set->data = link;
+	set->net = DSET_SOCK_NET(net, ctnl);
+	if (!try_module_get(set->type->me)) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	ret = find_free_id(inst, set->name, &index, &clash);
+	if (ret == -EEXIST)
+		ret = -DSET_ERR_EXIST_SETNAME2;
+	else if (ret == -DSET_ERR_MAX_SETS)
+		ret = grow_set_list(inst, &index);
+	if (ret)
+		goto put_out;
+
+	pub->users++;
+	domain_set_changelog_reset(inst, set);
+	domain_set(inst, index) = set;
+	domain_set_notify(DSET_SOCK_NET(net, ctnl), skb, DSET_CMD_ATTACH,
+			  attr, set, 0, NULL, 0);
 
 	return 0;
+
+put_out:
+	module_put(set->type->me);
+out:
+	kfree(link);
+	kfree(set);
+	return ret;
 }
 
 /* List/save set data */
@@ -1247,6 +2410,8 @@ int domain_set_put_flags(struct sk_buff *skb, struct domain_set *set)
 		cadt_flags |= DSET_FLAG_WITH_COMMENT;
 	if (SET_WITH_SKBINFO(set))
 		cadt_flags |= DSET_FLAG_WITH_SKBINFO;
+	if (SET_WITH_CATEGORY(set))
+		cadt_flags |= DSET_FLAG_WITH_CATEGORY;
 	if (SET_WITH_FORCEADD(set))
 		cadt_flags |= DSET_FLAG_WITH_FORCEADD;
 
@@ -1335,6 +2500,7 @@ static int domain_set_dump_start(struct sk_buff *skb,
 	struct domain_set_net *inst = domain_set_pernet(sock_net(skb->sk));
 	u32 dump_type, dump_flags;
 	bool is_destroyed;
+	u64 generation;
 	int ret = 0;
 
 	if (!cb->args[DSET_CB_DUMP]) {
@@ -1417,6 +2583,15 @@ dump_last:
 			if (cb->args[DSET_CB_PROTO] > DSET_PROTOCOL_MIN &&
 			    nla_put_net16(skb, DSET_ATTR_INDEX, htons(index)))
 				goto nla_put_failure;
+			/* Changed under the nfnl mutex, which is not held */
+			generation = READ_ONCE(set->generation);
+			if (DSET_NLA_PUT_NET64(skb, DSET_ATTR_GENERATION,
+					       cpu_to_be64(generation),
+					       DSET_ATTR_CMD_PAD))
+				goto nla_put_failure;
+			if (domain_set_pub_head(sock_net(skb->sk), set, index,
+						skb))
+				goto nla_put_failure;
 			ret = set->variant->head(set, skb);
 			if (ret < 0)
 				goto release_refcount;
@@ -1505,8 +2680,49 @@ static const struct nla_policy domain_set_adt_policy[DSET_ATTR_CMD_MAX + 1] = {
 	[DSET_ATTR_LINENO] = { .type = NLA_U32 },
 	[DSET_ATTR_DATA] = { .type = NLA_NESTED },
 	[DSET_ATTR_ADT] = { .type = NLA_NESTED },
+	[DSET_ATTR_LOAD] = { .type = NLA_U8 },
 };
 
+/* Error in restore/batch mode: send back lineno */
+static int call_ad_lineno(struct sock *ctnl, struct sk_buff *skb,
+			  int ret, u32 lineno)
+{
+	struct nlmsghdr *rep, *nlh = nlmsg_hdr(skb);
+	struct sk_buff *skb2;
+	struct nlmsgerr *errmsg;
+	size_t payload = min(SIZE_MAX, sizeof(*errmsg) + nlmsg_len(nlh));
+	int min_len = nlmsg_total_size(sizeof(struct nfgenmsg));
+	struct nlattr *cda[DSET_ATTR_CMD_MAX + 1];
+	struct nlattr *cmdattr;
+	u32 *errline;
+
+	skb2 = nlmsg_new(payload, GFP_KERNEL);
+	if (!skb2)
+		return -ENOMEM;
+	rep = __nlmsg_put(skb2, NETLINK_PORTID(skb), nlh->nlmsg_seq,
+			  NLMSG_ERROR, payload, 0);
+	errmsg = nlmsg_data(rep);
+	errmsg->error = ret;
+	memcpy(&errmsg->msg, nlh, nlh->nlmsg_len);
+	cmdattr = (void *)&errmsg->msg + min_len;
+
+	ret = NLA_PARSE(cda, DSET_ATTR_CMD_MAX, cmdattr,
+			nlh->nlmsg_len - min_len, domain_set_adt_policy,
+			NULL);
+
+	if (ret) {
+		nlmsg_free(skb2);
+		return ret;
+	}
+	errline = nla_data(cda[DSET_ATTR_LINENO]);
+
+	*errline = lineno;
+
+	netlink_unicast(ctnl, skb2, NETLINK_PORTID(skb), MSG_DONTWAIT);
+	/* Signal netlink not to send its ACK/errmsg.  */
+	return -EINTR;
+}
+
 static int call_ad(struct sock *ctnl, struct sk_buff *skb,
 		   struct domain_set *set, struct nlattr *tb[],
 		   enum dset_adt adt, u32 flags, bool use_lineno)
@@ -1516,54 +2732,148 @@ static int call_ad(struct sock *ctnl, struct sk_buff *skb,
 	bool eexist = flags & DSET_FLAG_EXIST, retried = false;
 
 	do {
-		spin_lock_bh(&set->lock);
+		domain_set_lock(set);
 		ret = set->variant->uadt(set, tb, adt, &lineno, flags, retried);
-		spin_unlock_bh(&set->lock);
+		domain_set_unlock(set);
 		retried = true;
 	} while (ret == -EAGAIN && set->variant->resize &&
 		 (ret = set->variant->resize(set, retried)) == 0);
 
 	if (!ret || (ret == -DSET_ERR_EXIST && eexist))
 		return 0;
-	if (lineno && use_lineno) {
-		/* Error in restore/batch mode: send back lineno */
-		struct nlmsghdr *rep, *nlh = nlmsg_hdr(skb);
-		struct sk_buff *skb2;
-		struct nlmsgerr *errmsg;
-		size_t payload =
-			min(SIZE_MAX, sizeof(*errmsg) + nlmsg_len(nlh));
-		int min_len = nlmsg_total_size(sizeof(struct nfgenmsg));
-		struct nlattr *cda[DSET_ATTR_CMD_MAX + 1];
-		struct nlattr *cmdattr;
-		u32 *errline;
-
-		skb2 = nlmsg_new(payload, GFP_KERNEL);
-		if (!skb2)
-			return -ENOMEM;
-		rep = __nlmsg_put(skb2, NETLINK_PORTID(skb), nlh->nlmsg_seq,
-				  NLMSG_ERROR, payload, 0);
-		errmsg = nlmsg_data(rep);
-		errmsg->error = ret;
-		memcpy(&errmsg->msg, nlh, nlh->nlmsg_len);
-		cmdattr = (void *)&errmsg->msg + min_len;
+	if (lineno && use_lineno)
+		return call_ad_lineno(ctnl, skb, ret, lineno);
 
-		ret = NLA_PARSE(cda, DSET_ATTR_CMD_MAX, cmdattr,
-				nlh->nlmsg_len - min_len, domain_set_adt_policy,
-				NULL);
+	return ret;
+}
 
-		if (ret) {
-			nlmsg_free(skb2);
-			return ret;
+/* Add/delete the elements of a restore message under a single hold of
+ * the set lock. The set is grown once for the whole batch up front and
+ * the lock is released every DSET_AD_BATCH elements, so that the packet
+ * path and the garbage collector are not starved by a large message.
+ * The types which lock themselves lock each element on their own instead.
+ * The length of the leading elements which have been applied is
+ * returned in applied, even when a later element fails.
+ */
+static int call_ad_batch(struct sock *ctnl, struct sk_buff *skb,
+			 struct domain_set *set, const struct nlattr *adt_attr,
+			 enum dset_adt adt, u32 flags, int *applied)
+{
+	struct nlattr *tb[DSET_ATTR_ADT_MAX + 1] = {};
+	const struct nlattr *nla;
+	bool eexist = flags & DSET_FLAG_EXIST;
+	unsigned int held = 0;
+	u32 n = 0, lineno = 0;
+	int nla_rem, ret = 0;
+
+	nla_for_each_nested (nla, adt_attr, nla_rem) {
+		if (nla_type(nla) != DSET_ATTR_DATA || !flag_nested(nla))
+			return -DSET_ERR_PROTOCOL;
+		n++;
+	}
+	/* Best effort: a failed reservation is retried by resize */
+	if (adt == DSET_ADD && set->variant->reserve)
+		set->variant->reserve(set, n);
+
+	domain_set_lock(set);
+	nla_for_each_nested (nla, adt_attr, nla_rem) {
+		lineno = 0;
+		if (NLA_PARSE_NESTED(tb, DSET_ATTR_ADT_MAX, nla,
+				     set->type->adt_policy, NULL)) {
+			ret = -DSET_ERR_PROTOCOL;
+			break;
 		}
-		errline = nla_data(cda[DSET_ATTR_LINENO]);
+		ret = set->variant->uadt(set, tb, adt, &lineno, flags, false);
+		while (ret == -EAGAIN && set->variant->resize) {
+			domain_set_unlock(set);
+			ret = set->variant->resize(set, true);
+			domain_set_lock(set);
+			held = 0;
+			if (ret)
+				break;
+			ret = set->variant->uadt(set, tb, adt, &lineno, flags,
+						 true);
+		}
+		if (ret && !(ret == -DSET_ERR_EXIST && eexist))
+			break;
+		ret = 0;
+		/* The elements up to this one are to be published */
+		*applied = min_t(int, nla_len(adt_attr),
+				 (const char *)nla + NLA_ALIGN(nla->nla_len) -
+				 (const char *)nla_data(adt_attr));
+		if (++held >= DSET_AD_BATCH || need_resched()) {
+			domain_set_unlock(set);
+			cond_resched();
+			domain_set_lock(set);
+			held = 0;
+		}
+	}
+	domain_set_unlock(set);
 
-		*errline = lineno;
+	if (ret && lineno)
+		return call_ad_lineno(ctnl, skb, ret, lineno);
 
-		netlink_unicast(ctnl, skb2, NETLINK_PORTID(skb), MSG_DONTWAIT);
-		/* Signal netlink not to send its ACK/errmsg.  */
-		return -EINTR;
-	}
+	return ret;
+}
 
+static bool ad_attr_failed(const struct nlattr *const attr[])
+{
+	return protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME] ||
+	       !((attr[DSET_ATTR_DATA] != NULL) ^
+		 (attr[DSET_ATTR_ADT] != NULL)) ||
+	       (attr[DSET_ATTR_DATA] && !flag_nested(attr[DSET_ATTR_DATA])) ||
+	       (attr[DSET_ATTR_ADT] &&
+		(!flag_nested(attr[DSET_ATTR_ADT]) || !attr[DSET_ATTR_LINENO]));
+}
+
+/* Add/delete the elements of a request to the set, or to its shadow
+ * under bulk load, and log and notify the changes of the live set.
+ */
+static int domain_set_ad_set(struct domain_set_net *inst, struct net *net,
+			     struct sock *ctnl, struct sk_buff *skb,
+			     struct domain_set *set, enum dset_adt adt,
+			     const struct nlattr *const attr[], u32 flags)
+{
+	struct nlattr *tb[DSET_ATTR_ADT_MAX + 1] = {};
+	enum dset_cmd cmd = adt == DSET_ADD ? DSET_CMD_ADD : DSET_CMD_DEL;
+	bool use_lineno = !!attr[DSET_ATTR_LINENO], load = !!attr[DSET_ATTR_LOAD];
+	bool overlap = false;
+	int ret = 0, applied = 0, seq = 0;
+
+	if (!load)
+		overlap = domain_set_writer_begin(set, &seq);
+	if (attr[DSET_ATTR_DATA]) {
+		if (NLA_PARSE_NESTED(tb, DSET_ATTR_ADT_MAX,
+				     attr[DSET_ATTR_DATA],
+				     set->type->adt_policy, NULL)) {
+			ret = -DSET_ERR_PROTOCOL;
+			goto out;
+		}
+		ret = call_ad(ctnl, skb, set, tb, adt, flags, use_lineno);
+		if (ret || load)
+			goto out;
+		domain_set_changelog_add(inst, set, cmd, DSET_ATTR_DATA,
+					 nla_data(attr[DSET_ATTR_DATA]),
+					 nla_len(attr[DSET_ATTR_DATA]));
+		domain_set_notify(net, skb, cmd, attr, set, DSET_ATTR_DATA,
+				  nla_data(attr[DSET_ATTR_DATA]),
+				  nla_len(attr[DSET_ATTR_DATA]));
+	} else {
+		ret = call_ad_batch(ctnl, skb, set, attr[DSET_ATTR_ADT], adt,
+				    flags, &applied);
+		/* Even the part of a failed batch has been applied */
+		if (applied && !load) {
+			domain_set_changelog_add(inst, set, cmd, DSET_ATTR_ADT,
+						 nla_data(attr[DSET_ATTR_ADT]),
+						 applied);
+			domain_set_notify(net, skb, cmd, attr, set,
+					  DSET_ATTR_ADT,
+					  nla_data(attr[DSET_ATTR_ADT]), applied);
+		}
+	}
+out:
+	if (!load)
+		domain_set_writer_end(set, seq, overlap);
 	return ret;
 }
 
@@ -1576,58 +2886,109 @@ static int DSET_CBFN_AD(domain_set_ad, struct net *net, struct sock *ctnl,
 	struct domain_set_net *inst =
 		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
 	struct domain_set *set;
-	struct nlattr *tb[DSET_ATTR_ADT_MAX + 1] = {};
-	const struct nlattr *nla;
-	u32 flags = flag_exist(nlh);
-	bool use_lineno;
-	int ret = 0;
 
-	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME] ||
-		     !((attr[DSET_ATTR_DATA] != NULL) ^
-		       (attr[DSET_ATTR_ADT] != NULL)) ||
-		     (attr[DSET_ATTR_DATA] &&
-		      !flag_nested(attr[DSET_ATTR_DATA])) ||
-		     (attr[DSET_ATTR_ADT] &&
-		      (!flag_nested(attr[DSET_ATTR_ADT]) ||
-		       !attr[DSET_ATTR_LINENO]))))
+	if (unlikely(ad_attr_failed(attr)))
+		return -DSET_ERR_PROTOCOL;
+
+	set = find_set(inst, nla_data(attr[DSET_ATTR_SETNAME]));
+	if (!set)
+		return -ENOENT;
+	/* The elements of a bulk load go to the shadow table */
+	if (attr[DSET_ATTR_LOAD]) {
+		if (adt != DSET_ADD ||
+		    nla_get_u8(attr[DSET_ATTR_LOAD]) != DSET_LOAD_DATA)
+			return -DSET_ERR_PROTOCOL;
+		if (!set->shadow)
+			return -DSET_ERR_NO_LOAD;
+		if (set->shadow_portid != NETLINK_PORTID(skb))
+			return -EBUSY;
+		set = set->shadow;
+	}
+
+	return domain_set_ad_set(inst, DSET_SOCK_NET(net, ctnl), ctnl, skb,
+				 set, adt, attr, flag_exist(nlh));
+}
+
+#ifdef HAVE_NFNL_CALLBACK_CALL_RCU
+/* Find a set by name out of the nfnl mutex and make sure it won't be
+ * destroyed, renamed or swapped meanwhile.
+ */
+static struct domain_set *
+domain_set_get_netlink_byname(struct domain_set_net *inst, const char *name)
+{
+	struct domain_set *set = NULL, *s;
+	domain_set_id_t i;
+
+	write_lock_bh(&domain_set_ref_lock);
+	for (i = 0; i < inst->domain_set_max; i++) {
+		s = domain_set(inst, i);
+		if (s && STRNCMP(s->name, name)) {
+			s->ref_netlink++;
+			set = s;
+			break;
+		}
+	}
+	write_unlock_bh(&domain_set_ref_lock);
+
+	return set;
+}
+
+/* Add/delete called under RCU instead of the nfnl mutex, so that the
+ * writers of a set run in parallel when the type supports it. The RCU
+ * read lock is dropped, as adding may sleep, and the module is held
+ * meanwhile. The other types and the bulk loads are handled under the
+ * nfnl mutex, like the rest of the commands.
+ */
+static int DSET_CBFN_AD(domain_set_ad_rcu, struct net *net,
+			struct sock *ctnl, struct sk_buff *skb,
+			enum dset_adt adt, const struct nlmsghdr *nlh,
+			const struct nlattr *const attr[],
+			struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct domain_set *set = NULL;
+	int ret;
+
+	if (unlikely(ad_attr_failed(attr)))
 		return -DSET_ERR_PROTOCOL;
-
-	set = find_set(inst, nla_data(attr[DSET_ATTR_SETNAME]));
-	if (!set)
+	if (!try_module_get(THIS_MODULE))
 		return -ENOENT;
+	rcu_read_unlock();
 
-	use_lineno = !!attr[DSET_ATTR_LINENO];
-	if (attr[DSET_ATTR_DATA]) {
-		if (NLA_PARSE_NESTED(tb, DSET_ATTR_ADT_MAX,
-				     attr[DSET_ATTR_DATA],
-				     set->type->adt_policy, NULL))
-			return -DSET_ERR_PROTOCOL;
-		ret = call_ad(ctnl, skb, set, tb, adt, flags, use_lineno);
+	if (!attr[DSET_ATTR_LOAD])
+		set = domain_set_get_netlink_byname(inst,
+				nla_data(attr[DSET_ATTR_SETNAME]));
+	if (set && set->variant->parallel_uadt) {
+		ret = domain_set_ad_set(inst, DSET_SOCK_NET(net, ctnl), ctnl,
+					skb, set, adt, attr, flag_exist(nlh));
+		__domain_set_put_netlink(set);
 	} else {
-		int nla_rem;
-
-		nla_for_each_nested (nla, attr[DSET_ATTR_ADT], nla_rem) {
-			if (nla_type(nla) != DSET_ATTR_DATA ||
-			    !flag_nested(nla) ||
-			    NLA_PARSE_NESTED(tb, DSET_ATTR_ADT_MAX, nla,
-					     set->type->adt_policy, NULL))
-				return -DSET_ERR_PROTOCOL;
-			ret = call_ad(ctnl, skb, set, tb, adt, flags,
-				      use_lineno);
-			if (ret < 0)
-				return ret;
-		}
+		if (set)
+			__domain_set_put_netlink(set);
+		nfnl_lock(NFNL_SUBSYS_DSET);
+		ret = DSET_CBFN_AD(domain_set_ad, net, ctnl, skb, adt, nlh,
+				   attr, extack);
+		nfnl_unlock(NFNL_SUBSYS_DSET);
 	}
+
+	/* The module is not unloaded before the RCU readers are done */
+	rcu_read_lock();
+	module_put(THIS_MODULE);
 	return ret;
 }
+#define domain_set_ad_cb	domain_set_ad_rcu
+#else
+#define domain_set_ad_cb	domain_set_ad
+#endif
 
 static int DSET_CBFN(domain_set_uadd, struct net *net, struct sock *ctnl,
 		     struct sk_buff *skb, const struct nlmsghdr *nlh,
 		     const struct nlattr *const attr[],
 		     struct netlink_ext_ack *extack)
 {
-	return DSET_CBFN_AD(domain_set_ad, net, ctnl, skb, DSET_ADD, nlh, attr,
-			    extack);
+	return DSET_CBFN_AD(domain_set_ad_cb, net, ctnl, skb, DSET_ADD, nlh,
+			    attr, extack);
 }
 
 static int DSET_CBFN(domain_set_udel, struct net *net, struct sock *ctnl,
@@ -1635,8 +2996,102 @@ static int DSET_CBFN(domain_set_udel, struct net *net, struct sock *ctnl,
 		     const struct nlattr *const attr[],
 		     struct netlink_ext_ack *extack)
 {
-	return DSET_CBFN_AD(domain_set_ad, net, ctnl, skb, DSET_DEL, nlh, attr,
-			    extack);
+	return DSET_CBFN_AD(domain_set_ad_cb, net, ctnl, skb, DSET_DEL, nlh,
+			    attr, extack);
+}
+
+/* Bulk load: the elements are added to a shadow table off to the side
+ * of the live one, without taking the lock of the set, and the shadow
+ * is published at commit by a single pointer swap.
+ *
+ * The load is owned by the netlink socket which began it: only that
+ * socket may add to and commit the shadow, and the load is aborted when
+ * the socket is released. Any socket may abort it explicitly.
+ *
+ * Binary images are ingested here as well: userspace replays the
+ * element attributes of the image into the shadow. The hash tables are
+ * never dumped or reinstated raw, as their buckets hold jiffies based
+ * timeouts, comment pointers and a per-set random seed.
+ */
+
+static const struct nla_policy domain_set_load_policy[DSET_ATTR_CMD_MAX + 1] = {
+	[DSET_ATTR_PROTOCOL] = { .type = NLA_U8 },
+	[DSET_ATTR_SETNAME] = { .type = NLA_NUL_STRING,
+				.len = DSET_MAXNAMELEN - 1 },
+	[DSET_ATTR_DATA] = { .type = NLA_NESTED },
+	[DSET_ATTR_LOAD] = { .type = NLA_U8 },
+};
+
+static int DSET_CBFN(domain_set_load, struct net *net, struct sock *ctnl,
+		     struct sk_buff *skb, const struct nlmsghdr *nlh,
+		     const struct nlattr *const attr[],
+		     struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct nlattr *tb[DSET_ATTR_CREATE_MAX + 1] = {};
+	struct domain_set *set;
+	u32 elements = 0;
+	bool overlap;
+	int seq;
+
+	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME] ||
+		     !attr[DSET_ATTR_LOAD] ||
+		     (attr[DSET_ATTR_DATA] &&
+		      !flag_nested(attr[DSET_ATTR_DATA]))))
+		return -DSET_ERR_PROTOCOL;
+
+	set = find_set(inst, nla_data(attr[DSET_ATTR_SETNAME]));
+	if (!set)
+		return -ENOENT;
+	if (domain_set_is_link(set))
+		return -DSET_ERR_ATTACHED;
+	if (!set->variant->shadow)
+		return -EOPNOTSUPP;
+
+	switch (nla_get_u8(attr[DSET_ATTR_LOAD])) {
+	case DSET_LOAD_BEGIN:
+		/* Expected number of elements, like at create */
+		if (attr[DSET_ATTR_DATA]) {
+			if (NLA_PARSE_NESTED(tb, DSET_ATTR_CREATE_MAX,
+					     attr[DSET_ATTR_DATA],
+					     set->type->create_policy, NULL) ||
+			    !domain_set_optattr_netorder(tb,
+							 DSET_ATTR_ELEMENTS))
+				return -DSET_ERR_PROTOCOL;
+			if (tb[DSET_ATTR_ELEMENTS])
+				elements = domain_set_get_h32(
+					tb[DSET_ATTR_ELEMENTS]);
+		}
+		if (set->shadow)
+			return -EBUSY;
+		set->shadow = set->variant->shadow(set, elements);
+		if (!set->shadow)
+			return -ENOMEM;
+		set->shadow_portid = NETLINK_PORTID(skb);
+		return 0;
+	case DSET_LOAD_COMMIT:
+		if (!set->shadow)
+			return -DSET_ERR_NO_LOAD;
+		if (set->shadow_portid != NETLINK_PORTID(skb))
+			return -EBUSY;
+		overlap = domain_set_writer_begin(set, &seq);
+		set->variant->publish(set, set->shadow);
+		set->shadow = NULL;
+		/* The content is replaced: listeners have to list the set */
+		domain_set_changelog_reset(inst, set);
+		domain_set_writer_end(set, seq, overlap);
+		domain_set_notify(DSET_SOCK_NET(net, ctnl), skb,
+				  DSET_CMD_LOAD, attr, set, 0, NULL, 0);
+		return 0;
+	case DSET_LOAD_ABORT:
+		if (!set->shadow)
+			return -DSET_ERR_NO_LOAD;
+		domain_set_shadow_destroy(set);
+		return 0;
+	default:
+		return -DSET_ERR_PROTOCOL;
+	}
 }
 
 static int DSET_CBFN(domain_set_utest, struct net *net, struct sock *ctnl,
@@ -1706,7 +3161,10 @@ static int DSET_CBFN(domain_set_header, struct net *net, struct sock *ctnl,
 	    nla_put_string(skb2, DSET_ATTR_SETNAME, set->name) ||
 	    nla_put_string(skb2, DSET_ATTR_TYPENAME, set->type->name) ||
 	    nla_put_u8(skb2, DSET_ATTR_FAMILY, set->family) ||
-	    nla_put_u8(skb2, DSET_ATTR_REVISION, set->revision))
+	    nla_put_u8(skb2, DSET_ATTR_REVISION, set->revision) ||
+	    DSET_NLA_PUT_NET64(skb2, DSET_ATTR_GENERATION,
+			       cpu_to_be64(set->generation),
+			       DSET_ATTR_CMD_PAD))
 		goto nla_put_failure;
 	nlmsg_end(skb2, nlh2);
 
@@ -1723,6 +3181,280 @@ nlmsg_failure:
 	return -EMSGSIZE;
 }
 
+/* Get the changes of a set since a generation: a message with the
+ * current generation of the set, followed by the logged changes in
+ * the message format of their commands. The changes are dumped, so
+ * that a long log is sent as the client reads it. The dump continues
+ * without the nfnl mutex, the log is read under the mutex of the log
+ * then, and the changes logged after the start are left for the next
+ * request. When a part of the changes is dropped from the log during
+ * the dump, the dump fails and the set has to be listed again.
+ */
+
+static const struct nla_policy
+	domain_set_changes_policy[DSET_ATTR_CMD_MAX + 1] = {
+		[DSET_ATTR_PROTOCOL] = { .type = NLA_U8 },
+		[DSET_ATTR_SETNAME] = { .type = NLA_NUL_STRING,
+					.len = DSET_MAXNAMELEN - 1 },
+		[DSET_ATTR_GENERATION] = { .type = NLA_U64 },
+	};
+
+struct domain_set_changes_pos {
+	u64 since;	/* generation of the last change sent */
+	u64 until;	/* generation of the set at the start */
+	int offset;	/* part of the batch of the next change sent */
+};
+
+static int domain_set_changes_done(struct netlink_callback *cb)
+{
+	struct domain_set_changes_pos *pos =
+		(struct domain_set_changes_pos *)cb->args[DSET_CB_PRIVATE];
+
+	if (pos) {
+		struct domain_set_net *inst =
+			(struct domain_set_net *)cb->args[DSET_CB_NET];
+		domain_set_id_t index =
+			(domain_set_id_t)cb->args[DSET_CB_INDEX];
+
+		__domain_set_put_netlink(domain_set_ref_netlink(inst, index));
+		kfree(pos);
+	}
+	return 0;
+}
+
+static int changes_init(struct netlink_callback *cb,
+			struct domain_set_net *inst)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(cb->skb);
+	int min_len = nlmsg_total_size(sizeof(struct nfgenmsg));
+	struct nlattr *cda[DSET_ATTR_CMD_MAX + 1];
+	struct nlattr *attr = (void *)nlh + min_len;
+	struct domain_set_changes_pos *pos;
+	struct domain_set *set;
+	domain_set_id_t index;
+	int ret;
+
+	ret = NLA_PARSE(cda, DSET_ATTR_CMD_MAX, attr, nlh->nlmsg_len - min_len,
+			domain_set_changes_policy, NULL);
+	if (ret)
+		return ret;
+
+	/* The attributes are checked by domain_set_changes() */
+	set = find_set_and_id(inst, nla_data(cda[DSET_ATTR_SETNAME]), &index);
+	if (!set)
+		return -ENOENT;
+	pos = kzalloc(sizeof(*pos), GFP_KERNEL);
+	if (!pos)
+		return -ENOMEM;
+	pos->since = be64_to_cpu(nla_get_be64(cda[DSET_ATTR_GENERATION]));
+	pos->until = READ_ONCE(set->generation);
+
+	/* Make sure set won't be destroyed */
+	write_lock_bh(&domain_set_ref_lock);
+	set->ref_netlink++;
+	write_unlock_bh(&domain_set_ref_lock);
+
+	cb->args[DSET_CB_NET] = (unsigned long)inst;
+	cb->args[DSET_CB_PROTO] = nla_get_u8(cda[DSET_ATTR_PROTOCOL]);
+	cb->args[DSET_CB_INDEX] = index;
+	cb->args[DSET_CB_PRIVATE] = (unsigned long)pos;
+
+	return 0;
+}
+
+static struct nlmsghdr *changes_start(struct sk_buff *skb,
+				      struct netlink_callback *cb,
+				      const struct domain_set *set,
+				      enum dset_cmd cmd, u64 generation)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = start_msg(skb, NETLINK_PORTID(cb->skb), cb->nlh->nlmsg_seq,
+			NLM_F_MULTI, cmd);
+	if (!nlh)
+		return NULL;
+	if (nla_put_u8(skb, DSET_ATTR_PROTOCOL, cb->args[DSET_CB_PROTO]) ||
+	    nla_put_string(skb, DSET_ATTR_SETNAME, set->name) ||
+	    nla_put_string(skb, DSET_ATTR_TYPENAME, set->type->name) ||
+	    nla_put_u8(skb, DSET_ATTR_REVISION, set->revision) ||
+	    DSET_NLA_PUT_NET64(skb, DSET_ATTR_GENERATION,
+			       cpu_to_be64(generation), DSET_ATTR_CMD_PAD)) {
+		nlmsg_cancel(skb, nlh);
+		return NULL;
+	}
+	return nlh;
+}
+
+/* Put a logged change from pos->offset on. A batch of a restore may
+ * not fit into a dump buffer: its elements are split over messages of
+ * the same generation then.
+ */
+static int changes_put(struct sk_buff *skb, struct netlink_callback *cb,
+		       const struct domain_set *set,
+		       const struct domain_set_change *c,
+		       struct domain_set_changes_pos *pos)
+{
+	const struct nlattr *elem;
+	struct nlattr *nested;
+	struct nlmsghdr *nlh;
+	int rem, n = 0;
+
+	nlh = changes_start(skb, cb, set, c->cmd, c->generation);
+	if (!nlh)
+		return -EMSGSIZE;
+	if (c->type != DSET_ATTR_ADT) {
+		if (c->len &&
+		    nla_put(skb, c->type | NLA_F_NESTED, c->len, c->data))
+			goto nla_put_failure;
+		nlmsg_end(skb, nlh);
+		return 0;
+	}
+	nested = dset_nest_start(skb, DSET_ATTR_ADT);
+	if (!nested)
+		goto nla_put_failure;
+	nla_for_each_attr (elem, (const struct nlattr *)(c->data + pos->offset),
+			   c->len - pos->offset, rem) {
+		if (nla_put(skb, elem->nla_type, nla_len(elem), nla_data(elem)))
+			break;
+		pos->offset += nla_total_size(nla_len(elem));
+		n++;
+	}
+	if (!n)
+		goto nla_put_failure;
+	dset_nest_end(skb, nested);
+	nlmsg_end(skb, nlh);
+
+	return pos->offset + NLA_HDRLEN <= c->len ? -EMSGSIZE : 0;
+
+nla_put_failure:
+	nlmsg_cancel(skb, nlh);
+	return -EMSGSIZE;
+}
+
+static int domain_set_changes_dump(struct sk_buff *skb,
+				   struct netlink_callback *cb)
+{
+	struct domain_set_net *inst = domain_set_pernet(sock_net(skb->sk));
+	const struct domain_set_change *c;
+	struct domain_set_changes_pos *pos;
+	struct domain_set *set;
+	int ret = 0;
+
+	if (!cb->args[DSET_CB_PRIVATE]) {
+		ret = changes_init(cb, inst);
+		if (ret < 0) {
+			struct nlmsghdr *nlh = nlmsg_hdr(cb->skb);
+
+			/* We have to create and send the error message
+			 * manually :-(
+			 */
+			if (nlh->nlmsg_flags & NLM_F_ACK)
+				NETLINK_ACK(cb->skb, nlh, ret, NULL);
+			return ret;
+		}
+	}
+	pos = (struct domain_set_changes_pos *)cb->args[DSET_CB_PRIVATE];
+	set = domain_set_ref_netlink(inst,
+				     (domain_set_id_t)cb->args[DSET_CB_INDEX]);
+
+	mutex_lock(&set->changelog_mutex);
+	if (pos->since < pos->until && pos->since < set->changelog_base) {
+		/* Dropped from the log since the previous part */
+		ret = -DSET_ERR_GENERATION;
+		goto out;
+	}
+	if (!cb->args[DSET_CB_ARG0]) {
+		struct nlmsghdr *nlh;
+
+		nlh = changes_start(skb, cb, set, DSET_CMD_CHANGES, pos->until);
+		if (!nlh) {
+			ret = -EMSGSIZE;
+			goto out;
+		}
+		nlmsg_end(skb, nlh);
+		cb->args[DSET_CB_ARG0] = 1;
+	}
+	list_for_each_entry (c, &set->changelog, list) {
+		if (c->generation <= pos->since)
+			continue;
+		if (c->generation > pos->until)
+			break;
+		ret = changes_put(skb, cb, set, c, pos);
+		if (ret) {
+			/* Continue with the next part, unless the change
+			 * does not fit even into an empty buffer
+			 */
+			if (skb->len)
+				ret = 0;
+			break;
+		}
+		pos->since = c->generation;
+		pos->offset = 0;
+	}
+out:
+	mutex_unlock(&set->changelog_mutex);
+
+	return ret < 0 ? ret : skb->len;
+}
+
+static int DSET_CBFN(domain_set_changes, struct net *net, struct sock *ctnl,
+		     struct sk_buff *skb, const struct nlmsghdr *nlh,
+		     const struct nlattr *const attr[],
+		     struct netlink_ext_ack *extack)
+{
+	struct domain_set_net *inst =
+		domain_set_pernet(DSET_SOCK_NET(net, ctnl));
+	struct domain_set *set;
+	u64 since;
+	bool out;
+
+	if (unlikely(protocol_min_failed(attr) || !attr[DSET_ATTR_SETNAME] ||
+		     !attr[DSET_ATTR_GENERATION]))
+		return -DSET_ERR_PROTOCOL;
+
+	set = find_set(inst, nla_data(attr[DSET_ATTR_SETNAME]));
+	if (!set)
+		return -ENOENT;
+	if (domain_set_is_link(set))
+		return -DSET_ERR_ATTACHED;
+
+	/* The expired entries are not logged */
+	if (SET_WITH_TIMEOUT(set))
+		return -DSET_ERR_GENERATION;
+	/* Neither are the changes from the packet path, and the order of
+	 * overlapping writers is unknown: the log restarts, so that the
+	 * set can be followed from a listing after this answer
+	 */
+	if (READ_ONCE(set->changelog_lost)) {
+		WRITE_ONCE(set->changelog_lost, false);
+		domain_set_changelog_reset(inst, set);
+		return -DSET_ERR_GENERATION;
+	}
+	since = be64_to_cpu(nla_get_be64(attr[DSET_ATTR_GENERATION]));
+	/* Out of the log: the client has to list the set again */
+	mutex_lock(&set->changelog_mutex);
+	out = since < set->changelog_base || since > set->generation;
+	mutex_unlock(&set->changelog_mutex);
+	if (out)
+		return -DSET_ERR_GENERATION;
+
+#if HAVE_NETLINK_DUMP_START_ARGS == 5
+	return netlink_dump_start(ctnl, skb, nlh, domain_set_changes_dump,
+				  domain_set_changes_done);
+#elif HAVE_NETLINK_DUMP_START_ARGS == 6
+	return netlink_dump_start(ctnl, skb, nlh, domain_set_changes_dump,
+				  domain_set_changes_done, 0);
+#else
+	{
+		struct netlink_dump_control c = {
+			.dump = domain_set_changes_dump,
+			.done = domain_set_changes_done,
+		};
+		return netlink_dump_start(ctnl, skb, nlh, &c);
+	}
+#endif
+}
+
 /* Get type data */
 
 static const struct nla_policy domain_set_type_policy[DSET_ATTR_CMD_MAX + 1] = {
@@ -1982,13 +3714,21 @@ static const struct nfnl_callback domain_set_netlink_subsys_cb[DSET_MSG_MAX] = {
 		},
 	[DSET_CMD_ADD] =
 		{
+#ifdef HAVE_NFNL_CALLBACK_CALL_RCU
+			.call_rcu = domain_set_uadd,
+#else
 			.call = domain_set_uadd,
+#endif
 			.attr_count = DSET_ATTR_CMD_MAX,
 			.policy = domain_set_adt_policy,
 		},
 	[DSET_CMD_DEL] =
 		{
+#ifdef HAVE_NFNL_CALLBACK_CALL_RCU
+			.call_rcu = domain_set_udel,
+#else
 			.call = domain_set_udel,
+#endif
 			.attr_count = DSET_ATTR_CMD_MAX,
 			.policy = domain_set_adt_policy,
 		},
@@ -2028,6 +3768,36 @@ static const struct nfnl_callback domain_set_netlink_subsys_cb[DSET_MSG_MAX] = {
 			.attr_count = DSET_ATTR_CMD_MAX,
 			.policy = domain_set_index_policy,
 		},
+	[DSET_CMD_PUBLISH] =
+		{
+			.call = domain_set_publish,
+			.attr_count = DSET_ATTR_CMD_MAX,
+			.policy = domain_set_setname_policy,
+		},
+	[DSET_CMD_UNPUBLISH] =
+		{
+			.call = domain_set_unpublish,
+			.attr_count = DSET_ATTR_CMD_MAX,
+			.policy = domain_set_setname_policy,
+		},
+	[DSET_CMD_ATTACH] =
+		{
+			.call = domain_set_attach,
+			.attr_count = DSET_ATTR_CMD_MAX,
+			.policy = domain_set_attach_policy,
+		},
+	[DSET_CMD_LOAD] =
+		{
+			.call = domain_set_load,
+			.attr_count = DSET_ATTR_CMD_MAX,
+			.policy = domain_set_load_policy,
+		},
+	[DSET_CMD_CHANGES] =
+		{
+			.call = domain_set_changes,
+			.attr_count = DSET_ATTR_CMD_MAX,
+			.policy = domain_set_changes_policy,
+		},
 };
 
 static struct nfnetlink_subsystem domain_set_netlink_subsys __read_mostly = {
@@ -2189,6 +3959,12 @@ static int __net_init domain_set_net_init(struct net *net)
 	inst->domain_set_max = max_sets ? max_sets : CONFIG_DOMAIN_SET_MAX;
 	if (inst->domain_set_max >= DSET_INVALID_ID)
 		inst->domain_set_max = DSET_INVALID_ID - 1;
+	/* The generations grow across reboots and module reloads, so that
+	 * a generation seen before is not taken for a current one, as
+	 * long as the wall clock is not set back: the clients have to
+	 * list the sets again after a reload, see the changes command
+	 */
+	atomic64_set(&inst->generation, ktime_get_real_ns());
 
 	list = kvcalloc(inst->domain_set_max, sizeof(struct domain_set *),
 			GFP_KERNEL);
@@ -2220,6 +3996,7 @@ static void __net_exit domain_set_net_exit(struct net *net)
 	inst->is_deleted = true; /* flag for domain_set_nfnl_put */
 
 	nfnl_lock(NFNL_SUBSYS_DSET);
+	domain_set_pub_net_exit(inst);
 	for (i = 0; i < inst->domain_set_max; i++) {
 		set = domain_set(inst, i);
 		if (set) {
@@ -2256,6 +4033,37 @@ static struct pernet_operations domain_set_net_ops = {
 	unregister_pernet_gen_device(domain_set_net_id, s);
 #endif
 
+/* Abort the bulk loads owned by a released netlink socket */
+static int domain_set_netlink_event(struct notifier_block *this,
+				    unsigned long event, void *ptr)
+{
+	struct netlink_notify *n = ptr;
+	struct domain_set_net *inst;
+	struct domain_set *set;
+	domain_set_id_t i;
+
+	if (event != NETLINK_URELEASE || n->protocol != NETLINK_NETFILTER)
+		return NOTIFY_DONE;
+
+	inst = domain_set_pernet(n->net);
+	nfnl_lock(NFNL_SUBSYS_DSET);
+	for (i = 0; i < inst->domain_set_max; i++) {
+		set = domain_set(inst, i);
+		if (set && set->shadow &&
+		    set->shadow_portid == NETLINK_NOTIFY_PORTID(n)) {
+			pr_debug("abort load of set %s\n", set->name);
+			domain_set_shadow_destroy(set);
+		}
+	}
+	nfnl_unlock(NFNL_SUBSYS_DSET);
+
+	return NOTIFY_DONE;
+}
+
+static struct notifier_block domain_set_netlink_notifier = {
+	.notifier_call = domain_set_netlink_event,
+};
+
 static int __init domain_set_init(void)
 {
 	int ret = REGISTER_PERNET_SUBSYS(&domain_set_net_ops);
@@ -2279,11 +4087,31 @@ static int __init domain_set_init(void)
 		UNREGISTER_PERNET_SUBSYS(&domain_set_net_ops);
 		return ret;
 	}
+
+	ret = domain_set_bpf_init();
+	if (ret != 0) {
+		pr_err("domain_set: cannot register BPF kfuncs: %d\n", ret);
+		nf_unregister_sockopt(&so_set);
+		nfnetlink_subsys_unregister(&domain_set_netlink_subsys);
+		UNREGISTER_PERNET_SUBSYS(&domain_set_net_ops);
+		return ret;
+	}
+
+	ret = netlink_register_notifier(&domain_set_netlink_notifier);
+	if (ret != 0) {
+		pr_err("domain_set: cannot register netlink notifier: %d\n",
+		       ret);
+		nf_unregister_sockopt(&so_set);
+		nfnetlink_subsys_unregister(&domain_set_netlink_subsys);
+		UNREGISTER_PERNET_SUBSYS(&domain_set_net_ops);
+		return ret;
+	}
 	return 0;
 }
 
 static void __exit domain_set_fini(void)
 {
+	netlink_unregister_notifier(&domain_set_netlink_notifier);
 	nf_unregister_sockopt(&so_set);
 	nfnetlink_subsys_unregister(&domain_set_netlink_subsys);
 
@@ -0,0 +1,489 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Bounded, allocation-free DNS message walker for the set types */
+
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/skbuff.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+
+/* Fixed part of a resource record, after the owner name */
+struct dset_dns_rrhdr {
+	__be16 type;
+	__be16 class;
+	__be32 ttl;
+	__be16 rdlen;
+} __packed;
+
+/* Fixed part of a question, after the name */
+struct dset_dns_qhdr {
+	__be16 type;
+	__be16 class;
+} __packed;
+
+#define DSET_DNS_PTR_MASK	0xC0
+#define DSET_DNS_PTR_OFFSET(hi, lo)	((((hi) & 0x3F) << 8) | (lo))
+
+/* The length prefixes of TCP messages, and the messages after the
+ * first one, are not aligned in the segment
+ */
+static inline unsigned int
+dset_dns_get16(const u8 *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static inline const void *
+dset_dns_ptr(const struct dset_dns_msg *msg, unsigned int pos,
+	     unsigned int len, void *buf)
+{
+	if (pos > msg->len || len > msg->len - pos)
+		return NULL;
+	if (!msg->skb)
+		return msg->data + pos;
+	return skb_header_pointer(msg->skb, msg->off + pos, len, buf);
+}
+
+static u8
+dset_dns_family(const struct sk_buff *skb)
+{
+	const u8 *vp;
+	u8 _v;
+
+	vp = skb_header_pointer(skb, skb_network_offset(skb), 1, &_v);
+	if (!vp)
+		return NFPROTO_UNSPEC;
+	switch (*vp >> 4) {
+	case 4:
+		return NFPROTO_IPV4;
+	case 6:
+		return NFPROTO_IPV6;
+	default:
+		return NFPROTO_UNSPEC;
+	}
+}
+
+/* Find the transport header of the packet and its protocol.
+ * Non-first fragments are rejected. Families other than IPv4/IPv6
+ * (bridge, tc) are resolved from the network header.
+ */
+int
+domain_set_transport(const struct sk_buff *skb, u8 family, u8 *proto,
+		     unsigned int *thoff)
+{
+	if (family != NFPROTO_IPV4 && family != NFPROTO_IPV6)
+		family = dset_dns_family(skb);
+
+	switch (family) {
+	case NFPROTO_IPV4: {
+		const struct iphdr *iph;
+		struct iphdr _iph;
+
+		iph = skb_header_pointer(skb, skb_network_offset(skb),
+					 sizeof(_iph), &_iph);
+		if (!iph || iph->ihl < 5)
+			return -EINVAL;
+		if (ntohs(iph->frag_off) & IP_OFFSET)
+			return -EINVAL;
+		*proto = iph->protocol;
+		*thoff = skb_network_offset(skb) + iph->ihl * 4;
+		return 0;
+	}
+#if IS_ENABLED(CONFIG_IPV6)
+	case NFPROTO_IPV6: {
+		const struct ipv6hdr *ip6h;
+		struct ipv6hdr _ip6h;
+		__be16 frag_off;
+		u8 nexthdr;
+		int off;
+
+		ip6h = skb_header_pointer(skb, skb_network_offset(skb),
+					  sizeof(_ip6h), &_ip6h);
+		if (!ip6h)
+			return -EINVAL;
+		nexthdr = ip6h->nexthdr;
+		off = ipv6_skip_exthdr(skb, skb_network_offset(skb) +
+				       sizeof(_ip6h), &nexthdr, &frag_off);
+		if (off < 0 || (frag_off & htons(~0x7)))
+			return -EINVAL;
+		*proto = nexthdr;
+		*thoff = off;
+		return 0;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+EXPORT_SYMBOL_GPL(domain_set_transport);
+
+/* Check that the TCP payload from off is framed as a sequence of whole
+ * length-prefixed messages, ending exactly at the end of the segment.
+ * Segments are never reassembled and there is no stream state to tell
+ * where a message starts, so a segment which continues a message of an
+ * earlier one, or is cut in the middle of a message, would be parsed
+ * from a random length prefix: it is skipped as a whole instead.
+ */
+static int
+dset_dns_tcp_framed(const struct dset_dns_msg *msg, unsigned int off)
+{
+	const u8 *lp;
+	u8 _len[2];
+	unsigned int len, count = 0;
+
+	if (off >= msg->end)
+		return -ENOENT;
+	while (off < msg->end) {
+		if (++count > DSET_DNS_MAX_TCP_MSGS ||
+		    msg->end - off < sizeof(_len))
+			return -ENOENT;
+		lp = skb_header_pointer(msg->skb, off, sizeof(_len), _len);
+		if (!lp)
+			return -EINVAL;
+		len = dset_dns_get16(lp);
+		off += sizeof(_len);
+		if (len < DSET_DNS_HDRLEN || len > msg->end - off)
+			return -ENOENT;
+		off += len;
+	}
+	return 0;
+}
+
+/* Take the length-prefixed message at off of a TCP segment whose
+ * framing has been checked by dset_dns_tcp_framed.
+ */
+static int
+dset_dns_tcp_msg(struct dset_dns_msg *msg, unsigned int off)
+{
+	const u8 *lp;
+	u8 _len[2];
+
+	if (off >= msg->end || msg->count >= DSET_DNS_MAX_TCP_MSGS)
+		return -ENOENT;
+	lp = skb_header_pointer(msg->skb, off, sizeof(_len), _len);
+	if (!lp)
+		return -EINVAL;
+	msg->count++;
+	msg->off = off + sizeof(_len);
+	msg->len = dset_dns_get16(lp);
+	msg->next = msg->off + msg->len;
+	return 0;
+}
+
+/* Find the DNS message carried by the UDP payload of the packet, or the
+ * first message of a TCP segment from or to the DNS port which carries
+ * whole messages only.
+ * Non-first fragments and other protocols are rejected.
+ */
+int
+domain_set_dns_locate(const struct sk_buff *skb, u8 family,
+		      struct dset_dns_msg *msg)
+{
+	const struct udphdr *uh;
+	struct udphdr _udph;
+	const struct tcphdr *th;
+	struct tcphdr _tcph;
+	unsigned int thoff, len;
+	u8 proto;
+	int ret;
+
+	ret = domain_set_transport(skb, family, &proto, &thoff);
+	if (ret < 0)
+		return ret;
+
+	msg->skb = skb;
+	msg->data = NULL;
+	msg->pktlen = skb->len;
+	msg->next = 0;
+	msg->count = 0;
+
+	switch (proto) {
+	case IPPROTO_UDP:
+		uh = skb_header_pointer(skb, thoff, sizeof(_udph), &_udph);
+		if (!uh)
+			return -EINVAL;
+		len = min_t(unsigned int, ntohs(uh->len), skb->len - thoff);
+		if (len < sizeof(_udph) + DSET_DNS_HDRLEN)
+			return -EINVAL;
+		msg->off = thoff + sizeof(_udph);
+		msg->len = len - sizeof(_udph);
+		msg->end = msg->off + msg->len;
+		return 0;
+	case IPPROTO_TCP:
+		th = skb_header_pointer(skb, thoff, sizeof(_tcph), &_tcph);
+		if (!th || th->doff * 4 < sizeof(_tcph))
+			return -EINVAL;
+		if (th->source != htons(DSET_DNS_PORT) &&
+		    th->dest != htons(DSET_DNS_PORT))
+			return -EPROTONOSUPPORT;
+		msg->end = skb->len;
+		ret = dset_dns_tcp_framed(msg, thoff + th->doff * 4);
+		if (ret < 0)
+			return ret;
+		return dset_dns_tcp_msg(msg, thoff + th->doff * 4);
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+EXPORT_SYMBOL_GPL(domain_set_dns_locate);
+
+/* Advance to the next complete message of the TCP segment.
+ *
+ * Returns zero when msg is set to the next message, -ENOENT when there
+ * are no more messages (always with UDP and linear messages).
+ */
+int
+domain_set_dns_next(struct dset_dns_msg *msg)
+{
+	if (!msg->skb || !msg->next)
+		return -ENOENT;
+	return dset_dns_tcp_msg(msg, msg->next);
+}
+EXPORT_SYMBOL_GPL(domain_set_dns_next);
+
+/* Decode the name at *pos into name, which must be able to hold
+ * DSET_MAX_DOMAIN_LEN bytes. Compression pointers must point backward
+ * and at most DSET_DNS_MAX_PTRS of them are followed, so crafted
+ * messages cannot make us loop. On return *pos points right after the
+ * name at its original location.
+ *
+ * Returns the length of the dotted name (zero for the root) or
+ * a negative error code.
+ */
+int
+domain_set_dns_name(const struct dset_dns_msg *msg, unsigned int *pos,
+		    char *name)
+{
+	unsigned int p = *pos, next = 0, len = 0, hops = 0, target;
+	const u8 *lp;
+	const char *label;
+	u8 buf[2];
+
+	for (;;) {
+		lp = dset_dns_ptr(msg, p, 1, buf);
+		if (!lp)
+			return -EINVAL;
+		if (!*lp)
+			break;
+
+		switch (*lp & DSET_DNS_PTR_MASK) {
+		case DSET_DNS_PTR_MASK:
+			lp = dset_dns_ptr(msg, p, 2, buf);
+			if (!lp)
+				return -EINVAL;
+			target = DSET_DNS_PTR_OFFSET(lp[0], lp[1]);
+			if (target >= p || ++hops > DSET_DNS_MAX_PTRS)
+				return -ELOOP;
+			if (!next)
+				next = p + 2;
+			p = target;
+			break;
+		case 0:
+			if (len + *lp + 1 > DSET_MAX_DOMAIN_LEN)
+				return -ENAMETOOLONG;
+			label = dset_dns_ptr(msg, p + 1, *lp, name + len);
+			if (!label)
+				return -EINVAL;
+			if (label != name + len)
+				memcpy(name + len, label, *lp);
+			len += *lp;
+			name[len++] = '.';
+			p += *lp + 1;
+			break;
+		default:
+			/* Extended label types are not supported */
+			return -EINVAL;
+		}
+	}
+
+	*pos = next ? next : p + 1;
+	if (len)
+		len--;
+	name[len] = '\0';
+
+	return len;
+}
+EXPORT_SYMBOL_GPL(domain_set_dns_name);
+
+/* Walk the questions and optionally the answers of the message and call
+ * fn for every record of the requested sections, in message order.
+ * At most DSET_DNS_MAX_RECORDS records are visited.
+ *
+ * With DSET_DNS_CNAME the target of every CNAME answer is decoded and
+ * passed to fn as well, right after its record, so that a name cloaked
+ * by a CNAME chain is seen even when the response omits the records of
+ * the target. An answer owned by the target of the previous CNAME,
+ * which is the usual next link of the chain, is then not passed twice.
+ *
+ * With DSET_DNS_CHAIN only the answers owned by the name of the first
+ * question or by a link of its CNAME chain are passed, so that records
+ * injected for unrelated names are ignored. The links are followed in
+ * message order, as servers send them; it is not combined with
+ * DSET_DNS_CNAME.
+ *
+ * Returns the first nonzero value returned by fn, zero when the walk
+ * completed or a negative error code for malformed messages.
+ */
+int
+domain_set_dns_walk(const struct dset_dns_msg *msg, u8 sections,
+		    dset_dns_rrfn fn, void *priv)
+{
+	const struct dset_dnshdr *dh;
+	struct dset_dnshdr _dh;
+	char name[DSET_MAX_DOMAIN_LEN], target[DSET_MAX_DOMAIN_LEN];
+	struct dset_dns_rr rr = { .name = name }, trr;
+	unsigned int pos = DSET_DNS_HDRLEN, qdcount, count, i, tpos;
+	unsigned int targetlen = 0;
+	bool chained = false;
+	int ret;
+
+	dh = dset_dns_ptr(msg, 0, sizeof(_dh), &_dh);
+	if (!dh)
+		return -EINVAL;
+	qdcount = ntohs(dh->qdcount);
+	count = qdcount;
+	if (sections & (DSET_DNS_ANSWER | DSET_DNS_CNAME))
+		count += ntohs(dh->ancount);
+	count = min_t(unsigned int, count, DSET_DNS_MAX_RECORDS);
+
+	for (i = 0; i < count; i++) {
+		ret = domain_set_dns_name(msg, &pos, name);
+		if (ret < 0)
+			return ret;
+		rr.namelen = ret;
+
+		if (i < qdcount) {
+			const struct dset_dns_qhdr *qh;
+			struct dset_dns_qhdr _qh;
+
+			qh = dset_dns_ptr(msg, pos, sizeof(_qh), &_qh);
+			if (!qh)
+				return -EINVAL;
+			rr.section = DSET_DNS_QUESTION;
+			rr.type = ntohs(qh->type);
+			rr.class = ntohs(qh->class);
+			rr.ttl = 0;
+			pos += sizeof(_qh);
+			rr.rdoff = pos;
+			rr.rdlen = 0;
+			/* The chain starts at the qname */
+			if (i == 0 && (sections & DSET_DNS_CHAIN)) {
+				memcpy(target, name, rr.namelen + 1);
+				targetlen = rr.namelen;
+				chained = true;
+			}
+		} else {
+			const struct dset_dns_rrhdr *rh;
+			struct dset_dns_rrhdr _rh;
+
+			rh = dset_dns_ptr(msg, pos, sizeof(_rh), &_rh);
+			if (!rh)
+				return -EINVAL;
+			rr.section = DSET_DNS_ANSWER;
+			rr.type = ntohs(rh->type);
+			rr.class = ntohs(rh->class);
+			rr.ttl = ntohl(rh->ttl);
+			rr.rdlen = ntohs(rh->rdlen);
+			pos += sizeof(_rh);
+			rr.rdoff = pos;
+			if (rr.rdlen > msg->len - pos)
+				return -EINVAL;
+			pos += rr.rdlen;
+		}
+
+		if (rr.section == DSET_DNS_ANSWER &&
+		    (sections & DSET_DNS_CHAIN)) {
+			if (!chained || rr.namelen != targetlen ||
+			    strncasecmp(name, target, targetlen) != 0)
+				continue;
+			ret = fn(msg, &rr, priv);
+			if (ret)
+				return ret;
+			if (rr.type != DSET_DNS_TYPE_CNAME)
+				continue;
+			/* Move to the next link of the chain */
+			tpos = rr.rdoff;
+			ret = domain_set_dns_name(msg, &tpos, target);
+			if (ret < 0)
+				return ret;
+			if (tpos > rr.rdoff + rr.rdlen)
+				return -EINVAL;
+			targetlen = ret;
+			continue;
+		}
+
+		if ((sections & rr.section) &&
+		    !(rr.section == DSET_DNS_ANSWER && targetlen &&
+		      rr.namelen == targetlen &&
+		      memcmp(name, target, targetlen) == 0)) {
+			ret = fn(msg, &rr, priv);
+			if (ret)
+				return ret;
+		}
+
+		if (!(sections & DSET_DNS_CNAME) ||
+		    rr.section != DSET_DNS_ANSWER ||
+		    rr.type != DSET_DNS_TYPE_CNAME)
+			continue;
+		tpos = rr.rdoff;
+		ret = domain_set_dns_name(msg, &tpos, target);
+		if (ret < 0)
+			return ret;
+		if (tpos > rr.rdoff + rr.rdlen)
+			return -EINVAL;
+		targetlen = ret;
+		trr = rr;
+		trr.name = target;
+		trr.namelen = targetlen;
+		trr.section = DSET_DNS_CNAME;
+		ret = fn(msg, &trr, priv);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(domain_set_dns_walk);
+
+/* Copy the address carried by an IN A or AAAA answer record into addr.
+ *
+ * Returns NFPROTO_IPV4 or NFPROTO_IPV6 according to the record type and
+ * NFPROTO_UNSPEC for any other record.
+ */
+u8
+domain_set_dns_addr(const struct dset_dns_msg *msg,
+		    const struct dset_dns_rr *rr, union nf_inet_addr *addr)
+{
+	const void *p;
+	u8 family;
+
+	if (rr->section != DSET_DNS_ANSWER || rr->class != DSET_DNS_CLASS_IN)
+		return NFPROTO_UNSPEC;
+	if (rr->type == DSET_DNS_TYPE_A && rr->rdlen == sizeof(addr->in))
+		family = NFPROTO_IPV4;
+	else if (rr->type == DSET_DNS_TYPE_AAAA &&
+		 rr->rdlen == sizeof(addr->in6))
+		family = NFPROTO_IPV6;
+	else
+		return NFPROTO_UNSPEC;
+
+	memset(addr, 0, sizeof(*addr));
+	p = dset_dns_ptr(msg, rr->rdoff, rr->rdlen, addr);
+	if (!p)
+		return NFPROTO_UNSPEC;
+	if (p != addr)
+		memcpy(addr, p, rr->rdlen);
+
+	return family;
+}
+EXPORT_SYMBOL_GPL(domain_set_dns_addr);
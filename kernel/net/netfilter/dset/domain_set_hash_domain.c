@@ -16,12 +16,16 @@
 #include <linux/netfilter.h>
 #include <linux/netfilter/dset/domain_set.h>
 #include <linux/netfilter/dset/domain_set_hash.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
 
 #define DSET_TYPE_REV_MIN 0
 /*				1	   Counters support */
 /*				2	   Comments support */
 /*				3	   Forceadd support */
-#define DSET_TYPE_REV_MAX 4 /* skbinfo support  */
+/*				4	   skbinfo support */
+/*				5	   category support */
+/*				6	   nomatch support */
+#define DSET_TYPE_REV_MAX 7 /* elements support */
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
@@ -35,8 +39,12 @@ MODULE_ALIAS("domain_set_hash:domain");
 struct hash_domain_elem
 {
 	char domain[DSET_MAX_DOMAIN_LEN];
+	u8 nomatch;
 };
 
+/* The nomatch flag is not part of the key */
+#define HKEY_DATALEN DSET_MAX_DOMAIN_LEN
+
 /* Common functions */
 
 static bool hash_domain_data_equal(const struct hash_domain_elem *e1,
@@ -49,71 +57,153 @@ static bool hash_domain_data_equal(const struct hash_domain_elem *e1,
 static bool hash_domain_data_list(struct sk_buff *skb,
 								  const struct hash_domain_elem *e)
 {
-	return nla_put(skb, DSET_ATTR_DOMAIN, DSET_MAX_DOMAIN_LEN, e->domain);
+	u32 flags = e->nomatch ? DSET_FLAG_NOMATCH : 0;
+
+	/* The name only, not the whole zero padded key */
+	if (nla_put_string(skb, DSET_ATTR_DOMAIN, e->domain) ||
+		(flags &&
+		 nla_put_net32(skb, DSET_ATTR_CADT_FLAGS, htonl(flags))))
+		goto nla_put_failure;
+	return false;
+
+nla_put_failure:
+	return true;
 }
 
-static void hash_domain_data_next(struct hash_domain_elem *next,
-								  const struct hash_domain_elem *e)
+static inline void hash_domain_data_set_flags(struct hash_domain_elem *elem,
+											  u32 flags)
+{
+	elem->nomatch = (flags >> 16) & DSET_FLAG_NOMATCH;
+}
+
+static inline int hash_domain_do_data_match(const struct hash_domain_elem *elem)
 {
-	strncpy(next->domain, e->domain, DSET_MAX_DOMAIN_LEN);
+	return elem->nomatch ? -ENOTEMPTY : 1;
 }
 
 #define MTYPE hash_domain
 
 #define DOMAIN_SET_EMIT_CREATE
 #define DOMAIN_SET_PROTO_UNDEF
+#define DSET_HASH_WITH_NOMATCH
 #include "domain_set_hash_gen.h"
 
-#define DOMAIN_OFFSET 40
+/* Packet lookup context, passed to the DNS walker */
+struct hash_domain_dadt_ctx
+{
+	struct domain_set *set;
+	dset_adtfn adtfn;
+	struct domain_set_ext *ext;
+	struct domain_set_adt_opt *opt;
+	enum dset_adt adt;
+};
 
-static int hash_domain_kadt(struct domain_set *set, const struct sk_buff *skb,
-							const struct xt_action_param *par,
-							enum dset_adt adt, struct domain_set_adt_opt *opt)
+static int hash_domain_dadt_rr(const struct dset_dns_msg *msg,
+							   const struct dset_dns_rr *rr, void *priv)
 {
-	dset_adtfn adtfn = set->variant->adt[adt];
+	struct hash_domain_dadt_ctx *ctx = priv;
 	struct hash_domain_elem e = {0};
-	struct domain_set_ext ext = DOMAIN_SET_INIT_KEXT(skb, opt, set);
-	char *domain = skb->data + DOMAIN_OFFSET;
-	int label_length, total_length = 0, i, ret;
-	char doamin_name[DSET_MAX_DOMAIN_LEN];
-	while ((label_length = *domain) != 0)
+	const char *p = rr->name, *dot;
+	unsigned int len = rr->namelen, prev;
+	int ret;
+
+	if (!len)
+		return 0;
+
+	memcpy(e.domain, p, len);
+	if (ctx->adt != DSET_TEST)
+		return ctx->adtfn(ctx->set, &e, ctx->ext, &ctx->opt->ext,
+						  ctx->opt->cmdflags);
+
+	/* Test the full name first, then its parent domains up to the top
+	 * level domain, so the most specific entry decides: a nomatch
+	 * entry stops the walk with -ENOTEMPTY. The suffixes get shorter,
+	 * so the tail of the previous one is cleared to keep the element
+	 * zero padded.
+	 */
+	for (;;)
 	{
-		if (total_length + label_length >= DSET_MAX_DOMAIN_LEN)
-		{
+		ret = ctx->adtfn(ctx->set, &e, ctx->ext, &ctx->opt->ext,
+						 ctx->opt->cmdflags);
+		if (ret != 0)
+			return ret;
+		dot = memchr(p, '.', len);
+		if (!dot)
 			return 0;
-		}
-		strncpy(doamin_name + total_length, ++domain, label_length);
-		total_length += label_length;
-		*(doamin_name + total_length) = '.';
-		total_length++;
-		domain += label_length;
+		prev = len;
+		len -= dot + 1 - p;
+		p = dot + 1;
+		memcpy(e.domain, p, len);
+		memset(e.domain + len, 0, prev - len);
 	}
-	*(doamin_name + total_length - 1) = '\0';
+}
 
-	if (adt == DSET_TEST)
+static int hash_domain_dadt(struct domain_set *set,
+							const struct dset_dns_msg *msg,
+							enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set_ext ext = DOMAIN_SET_INIT_DEXT(msg, opt, set);
+	struct hash_domain_dadt_ctx ctx = {
+		.set = set,
+		.adtfn = set->variant->adt[adt],
+		.ext = &ext,
+		.opt = opt,
+		.adt = adt,
+	};
+	u8 sections = DSET_DNS_QUESTION;
+
+	if (opt->cmdflags & DSET_FLAG_MATCH_ANSWERS)
+		sections |= DSET_DNS_ANSWER | DSET_DNS_CNAME;
+
+	return domain_set_dns_walk(msg, sections, hash_domain_dadt_rr, &ctx);
+}
+
+static int hash_domain_nadt(struct domain_set *set,
+							const struct dset_dns_msg *msg,
+							const struct dset_dns_rr *rr,
+							enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set_ext ext = DOMAIN_SET_INIT_DEXT(msg, opt, set);
+	struct hash_domain_dadt_ctx ctx = {
+		.set = set,
+		.adtfn = set->variant->adt[adt],
+		.ext = &ext,
+		.opt = opt,
+		.adt = adt,
+	};
+
+	return hash_domain_dadt_rr(msg, rr, &ctx);
+}
+
+static int hash_domain_kadt(struct domain_set *set, const struct sk_buff *skb,
+							const struct xt_action_param *par,
+							enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct dset_dns_msg msg;
+	struct dset_dns_rr rr;
+	char name[DSET_MAX_DOMAIN_LEN];
+	int ret;
+
+	/* A single name extracted from another application payload */
+	if (opt->payload != DSET_PAYLOAD_DNS)
 	{
-		for (i = total_length - 1; i >= 0; i--)
-		{
-			if (*(doamin_name + i) == '.')
-			{
-				strncpy(e.domain, doamin_name + i + 1,
-						total_length - i - 1);
-				ret = adtfn(set, &e, &ext, &opt->ext,
-							opt->cmdflags);
-				if (ret != 0)
-				{
-					return ret;
-				}
-			}
-		}
-		strncpy(e.domain, doamin_name + i + 1, total_length - i - 1);
-		return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+		if (domain_set_payload_name(skb, opt->family, opt->payload,
+									&msg, &rr, name) < 0)
+			return 0;
+		return hash_domain_nadt(set, &msg, &rr, adt, opt);
 	}
-	else
+
+	/* A TCP segment may carry several messages */
+	ret = domain_set_dns_locate(skb, opt->family, &msg);
+	while (ret == 0)
 	{
-		strncpy(e.domain, doamin_name, DSET_MAX_DOMAIN_LEN);
-		return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+		ret = hash_domain_dadt(set, &msg, adt, opt);
+		if (ret)
+			return ret;
+		ret = domain_set_dns_next(&msg);
 	}
+
+	return 0;
 }
 
 static int hash_domain_uadt(struct domain_set *set, struct nlattr *tb[],
@@ -131,14 +221,25 @@ static int hash_domain_uadt(struct domain_set *set, struct nlattr *tb[],
 	if (unlikely(!tb[DSET_ATTR_DOMAIN]))
 		return -DSET_ERR_PROTOCOL;
 
-	nla_strlcpy(e.domain, tb[DSET_ATTR_DOMAIN], DSET_MAX_DOMAIN_LEN);
+	nla_strscpy(e.domain, tb[DSET_ATTR_DOMAIN], DSET_MAX_DOMAIN_LEN);
 	ret = domain_set_get_extensions(set, tb, &ext);
 
 	if (ret)
 		return ret;
 
+	if (tb[DSET_ATTR_CADT_FLAGS])
+	{
+		u32 cadt_flags = domain_set_get_h32(tb[DSET_ATTR_CADT_FLAGS]);
+
+		if (cadt_flags & DSET_FLAG_NOMATCH)
+			flags |= (DSET_FLAG_NOMATCH << 16);
+	}
+
 	if (adt == DSET_TEST)
-		return adtfn(set, &e, &ext, &ext, flags);
+	{
+		ret = adtfn(set, &e, &ext, &ext, flags);
+		return domain_set_enomatch(ret, flags, adt, set) ? -ret : ret;
+	}
 
 	ret = adtfn(set, &e, &ext, &ext, flags);
 
@@ -151,7 +252,7 @@ static int hash_domain_uadt(struct domain_set *set, struct nlattr *tb[],
 static struct domain_set_type hash_domain_type __read_mostly = {
 	.name = "hash:domain",
 	.protocol = DSET_PROTOCOL,
-	.features = DSET_TYPE_DOMAIN,
+	.features = DSET_TYPE_DOMAIN | DSET_TYPE_NOMATCH,
 	.dimension = DSET_DIM_ONE,
 	.family = NFPROTO_UNSPEC,
 	.revision_min = DSET_TYPE_REV_MIN,
@@ -165,12 +266,14 @@ static struct domain_set_type hash_domain_type __read_mostly = {
 			[DSET_ATTR_RESIZE] = {.type = NLA_U8},
 			[DSET_ATTR_TIMEOUT] = {.type = NLA_U32},
 			[DSET_ATTR_CADT_FLAGS] = {.type = NLA_U32},
+			[DSET_ATTR_ELEMENTS] = {.type = NLA_U32},
 		},
 	.adt_policy =
 		{
 			[DSET_ATTR_DOMAIN] = {.type = NLA_NUL_STRING,
 								  .len = DSET_MAX_DOMAIN_LEN},
 			[DSET_ATTR_TIMEOUT] = {.type = NLA_U32},
+			[DSET_ATTR_CADT_FLAGS] = {.type = NLA_U32},
 			[DSET_ATTR_LINENO] = {.type = NLA_U32},
 			[DSET_ATTR_BYTES] = {.type = NLA_U64},
 			[DSET_ATTR_PACKETS] = {.type = NLA_U64},
@@ -179,6 +282,7 @@ static struct domain_set_type hash_domain_type __read_mostly = {
 			[DSET_ATTR_SKBMARK] = {.type = NLA_U64},
 			[DSET_ATTR_SKBPRIO] = {.type = NLA_U32},
 			[DSET_ATTR_SKBQUEUE] = {.type = NLA_U16},
+			[DSET_ATTR_CATEGORY] = {.type = NLA_U32},
 		},
 	.me = THIS_MODULE,
 };
@@ -9,11 +9,12 @@
 #include <linux/rcupdate.h>
 #include <linux/jhash.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 #include <linux/netfilter/dset/domain_set.h>
 
 #define __dset_dereference_protected(p, c)	rcu_dereference_protected(p, c)
-#define dset_dereference_protected(p, set) \
-	__dset_dereference_protected(p, lockdep_is_held(&(set)->lock))
+#define dset_dereference_protected(p, h) \
+	__dset_dereference_protected(p, lockdep_is_held(&(h)->lock))
 
 #define rcu_dereference_bh_nfnl(p)	rcu_dereference_bh_check(p, 1)
 
@@ -24,10 +25,23 @@
  *
  * Readers and resizing
  *
- * Resizing can be triggered by userspace command only, and those
- * are serialized by the nfnl mutex. During resizing the set is
- * read-locked, so the only possible concurrent operations are
- * the kernel side readers. Those must be protected by proper RCU locking.
+ * Resizing can be triggered by userspace command only. The userspace
+ * writers run in parallel, so resizing is done by a worker of the set,
+ * which serializes the resizings, while the writers wait for it. During
+ * resizing the table lock is held exclusively, so the only possible
+ * concurrent operations are the kernel side readers. Those must be
+ * protected by proper RCU locking.
+ *
+ * Writers and regions
+ *
+ * The buckets are grouped into regions of 2^HTABLE_REGION_BITS buckets,
+ * each with its own lock and element counters. Writers hold the table
+ * lock of the set shared and the lock of the region of their bucket,
+ * so that the packet path, the garbage collector and the userspace
+ * writers adding to different regions do not serialize. Replacing the
+ * table (resize, flush, bulk load) holds the table lock exclusively.
+ * The comments are accounted in the set, so writers of a set with
+ * comments hold the table lock exclusively too.
  */
 
 /* Number of elements to store in an initial array block */
@@ -36,6 +50,12 @@
 #define AHASH_MAX_SIZE			(3 * AHASH_INIT_SIZE)
 /* Max muber of elements in the array block when tuned */
 #define AHASH_MAX_TUNED			64
+/* Average number of elements per bucket when the hash is sized for a
+ * known number of elements. With one element per bucket the fullest
+ * bucket of even millions of elements stays well below AHASH_MAX_SIZE,
+ * while at two a few buckets already overflow it and force a resize.
+ */
+#define AHASH_PRESIZE_LOAD		1
 
 /* Max number of elements can be tuned */
 #ifdef DOMAIN_SET_HASH_WITH_MULTI
@@ -74,14 +94,41 @@ struct hbucket {
 		__aligned(__alignof__(u64));
 };
 
+/* A region of the hash table with its lock and counters */
+struct hregion {
+	spinlock_t lock;	/* the region lock */
+	size_t ext_size;	/* size of the dynamic extensions */
+	u32 elements;		/* number of elements (vs timeout) */
+};
+
 /* The hash table: the table size stored here in order to make resizing easy */
 struct htable {
 	atomic_t ref;		/* References for resizing */
 	atomic_t uref;		/* References for dumping */
+	bool ext_owner;		/* Destroy the extensions with the table */
 	u8 htable_bits;		/* size of hash table == 2^htable_bits */
+	u32 maxelem;		/* share of maxelem of a region */
+	struct hregion *hregion; /* region locks and counters */
 	struct hbucket __rcu *bucket[0]; /* hashtable buckets */
 };
 
+/* Number of buckets in a region is 2^HTABLE_REGION_BITS */
+#define HTABLE_REGION_BITS	10
+#define ahash_numof_locks(htable_bits)		\
+	((htable_bits) < HTABLE_REGION_BITS ? 1	\
+		: jhash_size((htable_bits) - HTABLE_REGION_BITS))
+#define ahash_sizeof_regions(htable_bits)	\
+	(ahash_numof_locks(htable_bits) * sizeof(struct hregion))
+#define ahash_region(n, htable_bits)		\
+	((htable_bits) < HTABLE_REGION_BITS ? 0	\
+		: (n) >> HTABLE_REGION_BITS)
+#define ahash_bucket_start(r, htable_bits)	\
+	((r) * jhash_size(HTABLE_REGION_BITS))
+#define ahash_bucket_end(r, htable_bits)	\
+	((htable_bits) < HTABLE_REGION_BITS	\
+		? jhash_size(htable_bits)	\
+		: ((r) + 1) * jhash_size(HTABLE_REGION_BITS))
+
 #define hbucket(h, i)		((h)->bucket[i])
 #define ext_size(n, dsize)	\
 	(sizeof(struct hbucket) + (n) * (dsize))
@@ -127,6 +174,63 @@ htable_bits(u32 hashsize)
 	return bits;
 }
 
+/* Allocate an empty hash table of 2^hbits buckets with its regions */
+static struct htable *
+htable_alloc(u8 hbits, u32 maxelem)
+{
+	struct htable *t;
+	size_t hsize = htable_size(hbits);
+	u32 i;
+
+	if (hsize == 0)
+		return NULL;
+	t = domain_set_alloc(hsize);
+	if (!t)
+		return NULL;
+	t->hregion = domain_set_alloc(ahash_sizeof_regions(hbits));
+	if (!t->hregion) {
+		domain_set_free(t);
+		return NULL;
+	}
+	t->htable_bits = hbits;
+	t->maxelem = maxelem / ahash_numof_locks(hbits);
+	for (i = 0; i < ahash_numof_locks(hbits); i++)
+		spin_lock_init(&t->hregion[i].lock);
+
+	return t;
+}
+
+static void
+htable_free(struct htable *t)
+{
+	domain_set_free(t->hregion);
+	domain_set_free(t);
+}
+
+/* The counters of the regions are read without their locks */
+static u32
+htable_elements(const struct htable *t)
+{
+	u32 i, elements = 0;
+
+	for (i = 0; i < ahash_numof_locks(t->htable_bits); i++)
+		elements += READ_ONCE(t->hregion[i].elements);
+
+	return elements;
+}
+
+static size_t
+htable_ext_size(const struct htable *t)
+{
+	size_t ext_size = 0;
+	u32 i;
+
+	for (i = 0; i < ahash_numof_locks(t->htable_bits); i++)
+		ext_size += READ_ONCE(t->hregion[i].ext_size);
+
+	return ext_size;
+}
+
 #define NLEN			0
 
 #endif /* _DOMAIN_SET_HASH_GEN_H */
@@ -149,7 +253,6 @@ htable_bits(u32 hashsize)
 #undef mtype_data_reset_flags
 #undef mtype_data_netmask
 #undef mtype_data_list
-#undef mtype_data_next
 #undef mtype_elem
 
 #undef mtype_ahash_destroy
@@ -161,15 +264,29 @@ htable_bits(u32 hashsize)
 #undef mtype_destroy
 #undef mtype_same_set
 #undef mtype_kadt
+#undef mtype_dadt
+#undef mtype_nadt
 #undef mtype_uadt
 
+#undef mtype_table_lock
+#undef mtype_table_unlock
+#undef mtype_event_put
 #undef mtype_add
 #undef mtype_del
 #undef mtype_test_cidrs
 #undef mtype_test
 #undef mtype_uref
 #undef mtype_expire
+#undef mtype_expire_regions
+#undef mtype_expire_all
+#undef mtype_rehash
+#undef mtype_resize_work
+#undef mtype_resize_wait
 #undef mtype_resize
+#undef mtype_reserve
+#undef mtype_shadow
+#undef mtype_shadow_destroy
+#undef mtype_publish
 #undef mtype_head
 #undef mtype_list
 #undef mtype_gc
@@ -181,13 +298,16 @@ htable_bits(u32 hashsize)
 #undef HKEY
 
 #define mtype_data_equal	DSET_TOKEN(MTYPE, _data_equal)
+#ifdef DSET_HASH_WITH_NOMATCH
+#define mtype_do_data_match	DSET_TOKEN(MTYPE, _do_data_match)
+#else
 #define mtype_do_data_match(d)	1
+#endif
 #define mtype_data_set_flags	DSET_TOKEN(MTYPE, _data_set_flags)
 #define mtype_data_reset_elem	DSET_TOKEN(MTYPE, _data_reset_elem)
 #define mtype_data_reset_flags	DSET_TOKEN(MTYPE, _data_reset_flags)
 #define mtype_data_netmask	DSET_TOKEN(MTYPE, _data_netmask)
 #define mtype_data_list		DSET_TOKEN(MTYPE, _data_list)
-#define mtype_data_next		DSET_TOKEN(MTYPE, _data_next)
 #define mtype_elem		DSET_TOKEN(MTYPE, _elem)
 
 #define mtype_ahash_destroy	DSET_TOKEN(MTYPE, _ahash_destroy)
@@ -199,15 +319,29 @@ htable_bits(u32 hashsize)
 #define mtype_destroy		DSET_TOKEN(MTYPE, _destroy)
 #define mtype_same_set		DSET_TOKEN(MTYPE, _same_set)
 #define mtype_kadt		DSET_TOKEN(MTYPE, _kadt)
+#define mtype_dadt		DSET_TOKEN(MTYPE, _dadt)
+#define mtype_nadt		DSET_TOKEN(MTYPE, _nadt)
 #define mtype_uadt		DSET_TOKEN(MTYPE, _uadt)
 
+#define mtype_table_lock	DSET_TOKEN(MTYPE, _table_lock)
+#define mtype_table_unlock	DSET_TOKEN(MTYPE, _table_unlock)
+#define mtype_event_put		DSET_TOKEN(MTYPE, _event_put)
 #define mtype_add		DSET_TOKEN(MTYPE, _add)
 #define mtype_del		DSET_TOKEN(MTYPE, _del)
 #define mtype_test_cidrs	DSET_TOKEN(MTYPE, _test_cidrs)
 #define mtype_test		DSET_TOKEN(MTYPE, _test)
 #define mtype_uref		DSET_TOKEN(MTYPE, _uref)
 #define mtype_expire		DSET_TOKEN(MTYPE, _expire)
+#define mtype_expire_regions	DSET_TOKEN(MTYPE, _expire_regions)
+#define mtype_expire_all	DSET_TOKEN(MTYPE, _expire_all)
+#define mtype_rehash		DSET_TOKEN(MTYPE, _rehash)
+#define mtype_resize_work	DSET_TOKEN(MTYPE, _resize_work)
+#define mtype_resize_wait	DSET_TOKEN(MTYPE, _resize_wait)
 #define mtype_resize		DSET_TOKEN(MTYPE, _resize)
+#define mtype_reserve		DSET_TOKEN(MTYPE, _reserve)
+#define mtype_shadow		DSET_TOKEN(MTYPE, _shadow)
+#define mtype_shadow_destroy	DSET_TOKEN(MTYPE, _shadow_destroy)
+#define mtype_publish		DSET_TOKEN(MTYPE, _publish)
 #define mtype_head		DSET_TOKEN(MTYPE, _head)
 #define mtype_list		DSET_TOKEN(MTYPE, _list)
 #define mtype_gc		DSET_TOKEN(MTYPE, _gc)
@@ -234,10 +368,13 @@ htable_bits(u32 hashsize)
 /* The generic hash structure */
 struct htype {
 	struct htable __rcu *table; /* the hash table */
+	rwlock_t lock;		/* table replacement vs region writers */
 	struct timer_list gc;	/* garbage collection when timeout enabled */
-#ifdef HAVE_TIMER_SETUP
 	struct domain_set *set;	/* attached to this domain_set */
-#endif
+	struct work_struct resize_work; /* resizing for the writers */
+	spinlock_t resize_lock;	/* protects resize_bits */
+	u8 resize_bits;		/* size requested by the writers */
+	int resize_ret;		/* result of the last resizing */
 	u32 maxelem;		/* max elements in the hash */
 	u32 initval;		/* random jhash init value */
 #ifdef DOMAIN_SET_HASH_WITH_MARKMASK
@@ -246,14 +383,32 @@ struct htype {
 #ifdef DOMAIN_SET_HASH_WITH_MULTI
 	u8 ahash_max;		/* max elements in an array block */
 #endif
-	struct mtype_elem next; /* temporary storage for uadd */
 };
 
 /* Calculate the actual memory size of the set data */
 static size_t
 mtype_ahash_memsize(const struct htype *h, const struct htable *t)
 {
-	return sizeof(*h) + sizeof(*t);
+	return sizeof(*h) + sizeof(*t) + ahash_sizeof_regions(t->htable_bits);
+}
+
+/* Lock the table against replacing it, before taking a region lock */
+static void
+mtype_table_lock(struct domain_set *set, struct htype *h)
+{
+	if (SET_WITH_COMMENT(set))
+		write_lock_bh(&h->lock);
+	else
+		read_lock_bh(&h->lock);
+}
+
+static void
+mtype_table_unlock(struct domain_set *set, struct htype *h)
+{
+	if (SET_WITH_COMMENT(set))
+		write_unlock_bh(&h->lock);
+	else
+		read_unlock_bh(&h->lock);
 }
 
 /* Get the ith element from the array block n */
@@ -279,7 +434,8 @@ mtype_flush(struct domain_set *set)
 	struct hbucket *n;
 	u32 i;
 
-	t = dset_dereference_protected(h->table, set);
+	write_lock_bh(&h->lock);
+	t = dset_dereference_protected(h->table, h);
 	for (i = 0; i < jhash_size(t->htable_bits); i++) {
 		n = __dset_dereference_protected(hbucket(t, i), 1);
 		if (!n)
@@ -290,8 +446,12 @@ mtype_flush(struct domain_set *set)
 		rcu_assign_pointer(hbucket(t, i), NULL);
 		kfree_rcu(n, rcu);
 	}
-	set->elements = 0;
+	for (i = 0; i < ahash_numof_locks(t->htable_bits); i++) {
+		t->hregion[i].elements = 0;
+		t->hregion[i].ext_size = 0;
+	}
 	set->ext_size = 0;
+	write_unlock_bh(&h->lock);
 }
 
 /* Destroy the hashtable part of the set */
@@ -311,7 +471,7 @@ mtype_ahash_destroy(struct domain_set *set, struct htable *t, bool ext_destroy)
 		kfree(n);
 	}
 
-	domain_set_free(t);
+	htable_free(t);
 }
 
 /* Destroy a hash type of set */
@@ -322,6 +482,7 @@ mtype_destroy(struct domain_set *set)
 
 	if (SET_WITH_TIMEOUT(set))
 		del_timer_sync(&h->gc);
+	cancel_work_sync(&h->resize_work);
 
 	mtype_ahash_destroy(set,
 			    __dset_dereference_protected(h->table, 1), true);
@@ -356,18 +517,20 @@ mtype_same_set(const struct domain_set *a, const struct domain_set *b)
 	       a->extensions == b->extensions;
 }
 
-/* Delete expired elements from the hashtable */
+/* Delete expired elements from a region of the hashtable,
+ * the region lock is held by the caller
+ */
 static void
-mtype_expire(struct domain_set *set, struct htype *h)
+mtype_expire(struct domain_set *set, struct htable *t, u32 r)
 {
-	struct htable *t;
+	struct hregion *region = &t->hregion[r];
 	struct hbucket *n, *tmp;
 	struct mtype_elem *data;
 	u32 i, j, d;
 	size_t dsize = set->dsize;
 
-	t = dset_dereference_protected(h->table, set);
-	for (i = 0; i < jhash_size(t->htable_bits); i++) {
+	for (i = ahash_bucket_start(r, t->htable_bits);
+	     i < ahash_bucket_end(r, t->htable_bits); i++) {
 		n = __dset_dereference_protected(hbucket(t, i), 1);
 		if (!n)
 			continue;
@@ -383,12 +546,12 @@ mtype_expire(struct domain_set *set, struct htype *h)
 			clear_bit(j, n->used);
 			smp_mb__after_atomic();
 			domain_set_ext_destroy(set, data);
-			set->elements--;
+			region->elements--;
 			d++;
 		}
 		if (d >= AHASH_INIT_SIZE) {
 			if (d >= n->size) {
-				set->ext_size -= ext_size(n->size, dsize);
+				region->ext_size -= ext_size(n->size, dsize);
 				rcu_assign_pointer(hbucket(t, i), NULL);
 				kfree_rcu(n, rcu);
 				continue;
@@ -409,52 +572,65 @@ mtype_expire(struct domain_set *set, struct htype *h)
 				d++;
 			}
 			tmp->pos = d;
-			set->ext_size -= ext_size(AHASH_INIT_SIZE, dsize);
+			region->ext_size -= ext_size(AHASH_INIT_SIZE, dsize);
 			rcu_assign_pointer(hbucket(t, i), tmp);
 			kfree_rcu(n, rcu);
 		}
 	}
 }
 
+/* Expire the regions one by one, so that writers of the other regions
+ * can proceed meanwhile. The table lock is held by the caller.
+ */
+static void
+mtype_expire_regions(struct domain_set *set, struct htable *t)
+{
+	u32 r;
+
+	for (r = 0; r < ahash_numof_locks(t->htable_bits); r++) {
+		spin_lock(&t->hregion[r].lock);
+		mtype_expire(set, t, r);
+		spin_unlock(&t->hregion[r].lock);
+	}
+}
+
+static void
+mtype_expire_all(struct domain_set *set, struct htype *h)
+{
+	mtype_table_lock(set, h);
+	mtype_expire_regions(set, dset_dereference_protected(h->table, h));
+	mtype_table_unlock(set, h);
+}
+
 static void
 mtype_gc(GC_ARG)
 {
 	INIT_GC_VARS(htype, h);
 
 	pr_debug("called\n");
-	spin_lock_bh(&set->lock);
-	mtype_expire(set, h);
-	spin_unlock_bh(&set->lock);
+	mtype_expire_all(set, h);
 
 	h->gc.expires = jiffies + DSET_GC_PERIOD(set->timeout) * HZ;
 	add_timer(&h->gc);
 }
 
-/* Resize a hash: create a new hash table with doubling the hashsize
- * and inserting the elements to it. Repeat until we succeed or
- * fail due to memory pressures.
+/* Rehash into a new hash table of 2^htable_bits buckets. Increase the
+ * size further until we succeed or fail due to memory pressures.
  */
 static int
-mtype_resize(struct domain_set *set, bool retried)
+mtype_rehash(struct domain_set *set, u8 htable_bits)
 {
 	struct htype *h = set->data;
 	struct htable *t, *orig;
-	u8 htable_bits;
-	size_t extsize, dsize = set->dsize;
+	size_t dsize = set->dsize;
 	struct mtype_elem *data;
 	struct mtype_elem *d;
 	struct hbucket *n, *m;
-	u32 i, j, key;
+	u32 i, j, r, key;
 	int ret;
 
-	rcu_read_lock_bh();
-	orig = rcu_dereference_bh_nfnl(h->table);
-	htable_bits = orig->htable_bits;
-	rcu_read_unlock_bh();
-
 retry:
 	ret = 0;
-	htable_bits++;
 	if (!htable_bits) {
 		/* In case we have plenty of memory :-) */
 		pr_warn("Cannot increase the hashsize of set %s further\n",
@@ -462,19 +638,17 @@ retry:
 		ret = -DSET_ERR_HASH_FULL;
 		goto out;
 	}
-	t = domain_set_alloc(htable_size(htable_bits));
+	t = htable_alloc(htable_bits, h->maxelem);
 	if (!t) {
 		ret = -ENOMEM;
 		goto out;
 	}
-	t->htable_bits = htable_bits;
 
-	spin_lock_bh(&set->lock);
-	orig = __dset_dereference_protected(h->table, 1);
+	write_lock_bh(&h->lock);
+	orig = dset_dereference_protected(h->table, h);
 	/* There can't be another parallel resizing, but dumping is possible */
 	atomic_set(&orig->ref, 1);
 	atomic_inc(&orig->uref);
-	extsize = 0;
 	pr_debug("attempt to resize set %s from %u to %u, t %p\n",
 		 set->name, orig->htable_bits, htable_bits, orig);
 	for (i = 0; i < jhash_size(orig->htable_bits); i++) {
@@ -486,6 +660,7 @@ retry:
 				continue;
 			data = ahash_data(n, j, dsize);
 			key = HKEY(data, h->initval, htable_bits);
+			r = ahash_region(key, htable_bits);
 			m = __dset_dereference_protected(hbucket(t, key), 1);
 			if (!m) {
 				m = kzalloc(sizeof(*m) +
@@ -496,7 +671,8 @@ retry:
 					goto cleanup;
 				}
 				m->size = AHASH_INIT_SIZE;
-				extsize += ext_size(AHASH_INIT_SIZE, dsize);
+				t->hregion[r].ext_size +=
+					ext_size(AHASH_INIT_SIZE, dsize);
 				RCU_INIT_POINTER(hbucket(t, key), m);
 			} else if (m->pos >= m->size) {
 				struct hbucket *ht;
@@ -516,7 +692,8 @@ retry:
 				memcpy(ht, m, sizeof(struct hbucket) +
 					      m->size * dsize);
 				ht->size = m->size + AHASH_INIT_SIZE;
-				extsize += ext_size(AHASH_INIT_SIZE, dsize);
+				t->hregion[r].ext_size +=
+					ext_size(AHASH_INIT_SIZE, dsize);
 				kfree(m);
 				m = ht;
 				RCU_INIT_POINTER(hbucket(t, key), ht);
@@ -524,12 +701,12 @@ retry:
 			d = ahash_data(m, m->pos, dsize);
 			memcpy(d, data, dsize);
 			set_bit(m->pos++, m->used);
+			t->hregion[r].elements++;
 		}
 	}
 	rcu_assign_pointer(h->table, t);
-	set->ext_size = extsize;
 
-	spin_unlock_bh(&set->lock);
+	write_unlock_bh(&h->lock);
 
 	/* Give time to other readers of the set */
 	synchronize_rcu_bh();
@@ -548,13 +725,227 @@ out:
 cleanup:
 	atomic_set(&orig->ref, 0);
 	atomic_dec(&orig->uref);
-	spin_unlock_bh(&set->lock);
+	write_unlock_bh(&h->lock);
 	mtype_ahash_destroy(set, t, false);
-	if (ret == -EAGAIN)
+	if (ret == -EAGAIN) {
+		htable_bits++;
 		goto retry;
+	}
 	goto out;
 }
 
+/* Resize the table to the size requested by the writers, unless it has
+ * been resized for them already. Running as a single work item of the
+ * set, the resizings of the set are serialized.
+ */
+static void
+mtype_resize_work(struct work_struct *work)
+{
+	struct htype *h = container_of(work, struct htype, resize_work);
+	u8 htable_bits, want;
+	int ret = 0;
+
+	rcu_read_lock_bh();
+	htable_bits = rcu_dereference_bh_nfnl(h->table)->htable_bits;
+	rcu_read_unlock_bh();
+
+	spin_lock_bh(&h->resize_lock);
+	want = h->resize_bits;
+	spin_unlock_bh(&h->resize_lock);
+
+	if (want > htable_bits)
+		ret = mtype_rehash(h->set, want);
+	WRITE_ONCE(h->resize_ret, ret);
+}
+
+/* Request the table of 2^htable_bits buckets at least from the worker
+ * and wait for it
+ */
+static int
+mtype_resize_wait(struct htype *h, u8 htable_bits)
+{
+	spin_lock_bh(&h->resize_lock);
+	if (h->resize_bits < htable_bits)
+		h->resize_bits = htable_bits;
+	spin_unlock_bh(&h->resize_lock);
+
+	schedule_work(&h->resize_work);
+	flush_work(&h->resize_work);
+
+	return READ_ONCE(h->resize_ret);
+}
+
+/* Resize a hash: create a new hash table with doubling the hashsize
+ * and inserting the elements to it.
+ */
+static int
+mtype_resize(struct domain_set *set, bool retried)
+{
+	struct htype *h = set->data;
+	u8 htable_bits;
+
+	rcu_read_lock_bh();
+	htable_bits = rcu_dereference_bh_nfnl(h->table)->htable_bits;
+	rcu_read_unlock_bh();
+
+	return mtype_resize_wait(h, htable_bits + 1);
+}
+
+/* Grow the hash once before a batch of n elements is added, instead of
+ * doubling it each time a bucket of the batch fills up. A forceadd set
+ * replaces elements once full instead of refusing them, so the batch
+ * size says nothing about its final size: it is left alone.
+ */
+static int
+mtype_reserve(struct domain_set *set, u32 n)
+{
+	struct htype *h = set->data;
+	const struct htable *t;
+	u32 elements;
+	u8 bits, want;
+
+	if (SET_WITH_FORCEADD(set))
+		return 0;
+
+	rcu_read_lock_bh();
+	t = rcu_dereference_bh_nfnl(h->table);
+	bits = t->htable_bits;
+	elements = min_t(u64, (u64)htable_elements(t) + n, h->maxelem);
+	rcu_read_unlock_bh();
+
+	if (!elements)
+		return 0;
+
+	want = htable_bits(DIV_ROUND_UP(elements, AHASH_PRESIZE_LOAD));
+	if (want <= bits)
+		return 0;
+
+	pr_debug("reserve %u elements in set %s: %u -> %u bits\n",
+		 n, set->name, bits, want);
+	return mtype_resize_wait(h, want);
+}
+
+/* Create an empty shadow of the set for a bulk load: a private copy of
+ * the set header with its own lock and counters and a new hash table,
+ * sized for the expected number of elements when known. The shadow is
+ * filled up with the regular add function without touching the live
+ * table and its lock.
+ */
+static struct domain_set *
+mtype_shadow(struct domain_set *set, u32 elements)
+{
+	struct htype *h = set->data, *x;
+	struct domain_set *shadow;
+	struct htable *t;
+	u8 bits;
+
+	if (elements) {
+		elements = min(elements, h->maxelem);
+		bits = htable_bits(max_t(u32, DSET_MIMINAL_HASHSIZE,
+				 DIV_ROUND_UP(elements, AHASH_PRESIZE_LOAD)));
+	} else {
+		rcu_read_lock_bh();
+		bits = rcu_dereference_bh_nfnl(h->table)->htable_bits;
+		rcu_read_unlock_bh();
+	}
+
+	shadow = kmemdup(set, sizeof(*set), GFP_KERNEL);
+	if (!shadow)
+		return NULL;
+	x = kmemdup(h, sizeof(*h), GFP_KERNEL);
+	if (!x)
+		goto free_shadow;
+	t = htable_alloc(bits, h->maxelem);
+	if (!t)
+		goto free_htype;
+	RCU_INIT_POINTER(x->table, t);
+	rwlock_init(&x->lock);
+	x->set = shadow;
+	INIT_WORK(&x->resize_work, mtype_resize_work);
+	spin_lock_init(&x->resize_lock);
+	x->resize_bits = 0;
+	/* The garbage collector of the live set expires the elements
+	 * once the table is published
+	 */
+	memset(&x->gc, 0, sizeof(x->gc));
+
+	spin_lock_init(&shadow->lock);
+	INIT_LIST_HEAD(&shadow->changelog);
+	mutex_init(&shadow->changelog_mutex);
+	shadow->changelog_size = 0;
+	shadow->data = x;
+	shadow->elements = 0;
+	shadow->ext_size = 0;
+	pr_debug("shadow of set %s with %u bits: %p\n", set->name, bits, t);
+
+	return shadow;
+
+free_htype:
+	kfree(x);
+free_shadow:
+	kfree(shadow);
+	return NULL;
+}
+
+/* Destroy a shadow which is not published */
+static void
+mtype_shadow_destroy(struct domain_set *shadow)
+{
+	struct htype *x = shadow->data;
+
+	cancel_work_sync(&x->resize_work);
+	mtype_ahash_destroy(shadow,
+			    __dset_dereference_protected(x->table, 1), true);
+	kfree(x);
+	kfree(shadow);
+}
+
+/* Replace the table of the set with the one of the shadow by a single
+ * pointer swap and destroy the shadow. Elements added to the live table
+ * while the shadow was filled up are dropped with the old table.
+ */
+static void
+mtype_publish(struct domain_set *set, struct domain_set *shadow)
+{
+	struct htype *h = set->data, *x = shadow->data;
+	struct htable *t, *orig;
+
+	t = __dset_dereference_protected(x->table, 1);
+	cancel_work_sync(&x->resize_work);
+
+	write_lock_bh(&h->lock);
+	orig = dset_dereference_protected(h->table, h);
+	/* Dumping of the old table may still run, like at resizing, but
+	 * unlike at resizing its elements are not carried over: whoever
+	 * destroys the table last destroys their extensions too
+	 */
+	atomic_set(&orig->ref, 1);
+	orig->ext_owner = true;
+	atomic_inc(&orig->uref);
+	rcu_assign_pointer(h->table, t);
+	set->ext_size = shadow->ext_size;
+	write_unlock_bh(&h->lock);
+
+	kfree(x);
+	kfree(shadow);
+
+	/* Give time to other readers of the set */
+	synchronize_rcu_bh();
+
+	pr_debug("set %s published %p, old table %p\n", set->name, t, orig);
+	if (atomic_dec_and_test(&orig->uref)) {
+		pr_debug("Table destroy by publish %p\n", orig);
+		mtype_ahash_destroy(set, orig, true);
+	}
+}
+
+/* Put the attributes of an element changed by the packet path */
+static bool
+mtype_event_put(struct sk_buff *skb, const void *elem)
+{
+	return mtype_data_list(skb, elem);
+}
+
 /* Add an element to a hash and update the internal counters when succeeded,
  * otherwise report the proper error code.
  */
@@ -567,32 +958,49 @@ mtype_add(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 	const struct mtype_elem *d = value;
 	struct mtype_elem *data;
 	struct hbucket *n, *old = ERR_PTR(-ENOENT);
-	int i, j = -1;
+	int i, j = -1, ret = 0;
 	bool flag_exist = flags & DSET_FLAG_EXIST;
-	bool deleted = false, forceadd = false, reuse = false;
-	u32 key, multi = 0;
+	bool deleted = false, forceadd = false, reuse = false, refresh = false;
+	u32 r, key, multi = 0, elements, maxelem;
 
-	if (set->elements >= h->maxelem) {
-		if (SET_WITH_TIMEOUT(set))
-			/* FIXME: when set is full, we slow down here */
-			mtype_expire(set, h);
-		if (set->elements >= h->maxelem && SET_WITH_FORCEADD(set))
+	mtype_table_lock(set, h);
+	t = dset_dereference_protected(h->table, h);
+	key = HKEY(value, h->initval, t->htable_bits);
+	r = ahash_region(key, t->htable_bits);
+	spin_lock(&t->hregion[r].lock);
+
+	/* The whole set is counted only when the region used up its share */
+	elements = t->hregion[r].elements;
+	maxelem = t->maxelem;
+	if (elements >= maxelem) {
+		if (SET_WITH_TIMEOUT(set)) {
+			/* FIXME: when set is full, we slow down here.
+			 * The whole set is expired, as it is counted over
+			 * all the regions, taking their locks one by one.
+			 */
+			spin_unlock(&t->hregion[r].lock);
+			mtype_expire_regions(set, t);
+			spin_lock(&t->hregion[r].lock);
+		}
+		maxelem = h->maxelem;
+		elements = htable_elements(t);
+		if (elements >= maxelem && SET_WITH_FORCEADD(set))
 			forceadd = true;
 	}
 
-	t = dset_dereference_protected(h->table, set);
-	key = HKEY(value, h->initval, t->htable_bits);
 	n = __dset_dereference_protected(hbucket(t, key), 1);
 	if (!n) {
-		if (forceadd || set->elements >= h->maxelem)
+		if (forceadd || elements >= maxelem)
 			goto set_full;
 		old = NULL;
 		n = kzalloc(sizeof(*n) + AHASH_INIT_SIZE * set->dsize,
 			    GFP_ATOMIC);
-		if (!n)
-			return -ENOMEM;
+		if (!n) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
 		n->size = AHASH_INIT_SIZE;
-		set->ext_size += ext_size(AHASH_INIT_SIZE, set->dsize);
+		t->hregion[r].ext_size += ext_size(AHASH_INIT_SIZE, set->dsize);
 		goto copy_elem;
 	}
 	for (i = 0; i < n->pos; i++) {
@@ -606,14 +1014,17 @@ mtype_add(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 		}
 		data = ahash_data(n, i, set->dsize);
 		if (mtype_data_equal(data, d, &multi)) {
-			if (flag_exist ||
-			    (SET_WITH_TIMEOUT(set) &&
-			     domain_set_timeout_expired(ext_timeout(data, set)))) {
+			bool expired = SET_WITH_TIMEOUT(set) &&
+				domain_set_timeout_expired(ext_timeout(data, set));
+
+			if (flag_exist || expired) {
 				/* Just the extensions could be overwritten */
+				refresh = !expired;
 				j = i;
 				goto overwrite_extensions;
 			}
-			return -DSET_ERR_EXIST;
+			ret = -DSET_ERR_EXIST;
+			goto unlock;
 		}
 		/* Reuse first timed out entry */
 		if (SET_WITH_TIMEOUT(set) &&
@@ -627,45 +1038,52 @@ mtype_add(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 		data = ahash_data(n, j, set->dsize);
 		if (!deleted) {
 			domain_set_ext_destroy(set, data);
-			set->elements--;
+			t->hregion[r].elements--;
 		}
 		goto copy_data;
 	}
-	if (set->elements >= h->maxelem)
+	if (elements >= maxelem)
 		goto set_full;
 	/* Create a new slot */
 	if (n->pos >= n->size) {
 		TUNE_AHASH_MAX(h, multi);
 		if (n->size >= AHASH_MAX(h)) {
 			/* Trigger rehashing */
-			mtype_data_next(&h->next, d);
-			return -EAGAIN;
+			ret = -EAGAIN;
+			goto unlock;
 		}
 		old = n;
 		n = kzalloc(sizeof(*n) +
 			    (old->size + AHASH_INIT_SIZE) * set->dsize,
 			    GFP_ATOMIC);
-		if (!n)
-			return -ENOMEM;
+		if (!n) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
 		memcpy(n, old, sizeof(struct hbucket) +
 		       old->size * set->dsize);
 		n->size = old->size + AHASH_INIT_SIZE;
-		set->ext_size += ext_size(AHASH_INIT_SIZE, set->dsize);
+		t->hregion[r].ext_size += ext_size(AHASH_INIT_SIZE, set->dsize);
 	}
 
 copy_elem:
 	j = n->pos++;
 	data = ahash_data(n, j, set->dsize);
 copy_data:
-	set->elements++;
+	t->hregion[r].elements++;
 	memcpy(data, d, sizeof(struct mtype_elem));
 overwrite_extensions:
+#ifdef DSET_HASH_WITH_NOMATCH
+	mtype_data_set_flags(data, flags);
+#endif
 	if (SET_WITH_COUNTER(set))
 		domain_set_init_counter(ext_counter(data, set), ext);
 	if (SET_WITH_COMMENT(set))
 		domain_set_init_comment(set, ext_comment(data, set), ext);
 	if (SET_WITH_SKBINFO(set))
 		domain_set_init_skbinfo(ext_skbinfo(data, set), ext);
+	if (SET_WITH_CATEGORY(set))
+		domain_set_init_category(ext_category(data, set), ext);
 	/* Must come last for the case when timed out entry is reused */
 	if (SET_WITH_TIMEOUT(set))
 		domain_set_timeout_set(ext_timeout(data, set), ext->timeout);
@@ -676,13 +1094,20 @@ overwrite_extensions:
 		if (old)
 			kfree_rcu(old, rcu);
 	}
+	goto unlock;
 
-	return 0;
 set_full:
 	if (net_ratelimit())
 		pr_warn("Set %s is full, maxelem %u reached\n",
 			set->name, h->maxelem);
-	return -DSET_ERR_HASH_FULL;
+	ret = -DSET_ERR_HASH_FULL;
+unlock:
+	spin_unlock(&t->hregion[r].lock);
+	mtype_table_unlock(set, h);
+	/* Refreshing an element in the set is not an insertion */
+	if (!ret && !refresh && (flags & DSET_FLAG_PACKET_PATH))
+		domain_set_notify_kadt(set, DSET_CMD_ADD, mtype_event_put, d);
+	return ret;
 }
 
 /* Delete an element from the hash and free up space if possible.
@@ -697,11 +1122,14 @@ mtype_del(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 	struct mtype_elem *data;
 	struct hbucket *n;
 	int i, j, k, ret = -DSET_ERR_EXIST;
-	u32 key, multi = 0;
+	u32 r, key, multi = 0;
 	size_t dsize = set->dsize;
 
-	t = dset_dereference_protected(h->table, set);
+	mtype_table_lock(set, h);
+	t = dset_dereference_protected(h->table, h);
 	key = HKEY(value, h->initval, t->htable_bits);
+	r = ahash_region(key, t->htable_bits);
+	spin_lock(&t->hregion[r].lock);
 	n = __dset_dereference_protected(hbucket(t, key), 1);
 	if (!n)
 		goto out;
@@ -722,7 +1150,7 @@ mtype_del(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 		smp_mb__after_atomic();
 		if (i + 1 == n->pos)
 			n->pos--;
-		set->elements--;
+		t->hregion[r].elements--;
 		domain_set_ext_destroy(set, data);
 
 		for (; i < n->pos; i++) {
@@ -730,7 +1158,7 @@ mtype_del(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 				k++;
 		}
 		if (n->pos == 0 && k == 0) {
-			set->ext_size -= ext_size(n->size, dsize);
+			t->hregion[r].ext_size -= ext_size(n->size, dsize);
 			rcu_assign_pointer(hbucket(t, key), NULL);
 			kfree_rcu(n, rcu);
 		} else if (k >= AHASH_INIT_SIZE) {
@@ -749,7 +1177,8 @@ mtype_del(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 				k++;
 			}
 			tmp->pos = k;
-			set->ext_size -= ext_size(AHASH_INIT_SIZE, dsize);
+			t->hregion[r].ext_size -=
+				ext_size(AHASH_INIT_SIZE, dsize);
 			rcu_assign_pointer(hbucket(t, key), tmp);
 			kfree_rcu(n, rcu);
 		}
@@ -757,6 +1186,10 @@ mtype_del(struct domain_set *set, void *value, const struct domain_set_ext *ext,
 	}
 
 out:
+	spin_unlock(&t->hregion[r].lock);
+	mtype_table_unlock(set, h);
+	if (!ret && (flags & DSET_FLAG_PACKET_PATH))
+		domain_set_notify_kadt(set, DSET_CMD_DEL, mtype_event_put, d);
 	return ret;
 }
 
@@ -812,23 +1245,22 @@ mtype_head(struct domain_set *set, struct sk_buff *skb)
 	const struct htable *t;
 	struct nlattr *nested;
 	size_t memsize;
+	u32 elements;
 	u8 htable_bits;
 
-	/* If any members have expired, set->elements will be wrong
-	 * mytype_expire function will update it with the right count.
-	 * we do not hold set->lock here, so grab it first.
-	 * set->elements can still be incorrect in the case of a huge set,
+	/* If any members have expired, the element counters will be wrong
+	 * mytype_expire function will update them with the right count.
+	 * The counters can still be incorrect in the case of a huge set,
 	 * because elements might time out during the listing.
 	 */
-	if (SET_WITH_TIMEOUT(set)) {
-		spin_lock_bh(&set->lock);
-		mtype_expire(set, h);
-		spin_unlock_bh(&set->lock);
-	}
+	if (SET_WITH_TIMEOUT(set))
+		mtype_expire_all(set, h);
 
 	rcu_read_lock_bh();
 	t = rcu_dereference_bh_nfnl(h->table);
-	memsize = mtype_ahash_memsize(h, t) + set->ext_size;
+	memsize = mtype_ahash_memsize(h, t) + htable_ext_size(t) +
+		  set->ext_size;
+	elements = htable_elements(t);
 	htable_bits = t->htable_bits;
 	rcu_read_unlock_bh();
 
@@ -845,7 +1277,7 @@ mtype_head(struct domain_set *set, struct sk_buff *skb)
 #endif
 	if (nla_put_net32(skb, DSET_ATTR_REFERENCES, htonl(set->ref)) ||
 	    nla_put_net32(skb, DSET_ATTR_MEMSIZE, htonl(memsize)) ||
-	    nla_put_net32(skb, DSET_ATTR_ELEMENTS, htonl(set->elements)))
+	    nla_put_net32(skb, DSET_ATTR_ELEMENTS, htonl(elements)))
 		goto nla_put_failure;
 	if (unlikely(domain_set_put_flags(skb, set)))
 		goto nla_put_failure;
@@ -872,9 +1304,9 @@ mtype_uref(struct domain_set *set, struct netlink_callback *cb, bool start)
 	} else if (cb->args[DSET_CB_PRIVATE]) {
 		t = (struct htable *)cb->args[DSET_CB_PRIVATE];
 		if (atomic_dec_and_test(&t->uref) && atomic_read(&t->ref)) {
-			/* Resizing didn't destroy the hash table */
+			/* Resizing or publishing didn't destroy the table */
 			pr_debug("Table destroy by dump: %p\n", t);
-			mtype_ahash_destroy(set, t, false);
+			mtype_ahash_destroy(set, t, t->ext_owner);
 		}
 		cb->args[DSET_CB_PRIVATE] = 0;
 	}
@@ -962,6 +1394,17 @@ DSET_TOKEN(MTYPE, _kadt)(struct domain_set *set, const struct sk_buff *skb,
 			  const struct xt_action_param *par,
 			  enum dset_adt adt, struct domain_set_adt_opt *opt);
 
+static int
+DSET_TOKEN(MTYPE, _dadt)(struct domain_set *set,
+			  const struct dset_dns_msg *msg,
+			  enum dset_adt adt, struct domain_set_adt_opt *opt);
+
+static int
+DSET_TOKEN(MTYPE, _nadt)(struct domain_set *set,
+			  const struct dset_dns_msg *msg,
+			  const struct dset_dns_rr *rr,
+			  enum dset_adt adt, struct domain_set_adt_opt *opt);
+
 static int
 DSET_TOKEN(MTYPE, _uadt)(struct domain_set *set, struct nlattr *tb[],
 			  enum dset_adt adt, u32 *lineno, u32 flags,
@@ -969,6 +1412,8 @@ DSET_TOKEN(MTYPE, _uadt)(struct domain_set *set, struct nlattr *tb[],
 
 static const struct domain_set_type_variant mtype_variant = {
 	.kadt	= mtype_kadt,
+	.dadt	= mtype_dadt,
+	.nadt	= mtype_nadt,
 	.uadt	= mtype_uadt,
 	.adt	= {
 		[DSET_ADD] = mtype_add,
@@ -981,7 +1426,13 @@ static const struct domain_set_type_variant mtype_variant = {
 	.list	= mtype_list,
 	.uref	= mtype_uref,
 	.resize	= mtype_resize,
+	.reserve = mtype_reserve,
+	.shadow	= mtype_shadow,
+	.shadow_destroy = mtype_shadow_destroy,
+	.publish = mtype_publish,
 	.same_set = mtype_same_set,
+	.own_lock = true,
+	.parallel_uadt = true,
 };
 
 #ifdef DOMAIN_SET_EMIT_CREATE
@@ -1012,7 +1463,8 @@ DSET_TOKEN(HTYPE, _create)(struct net *net, struct domain_set *set,
 	if (unlikely(!domain_set_optattr_netorder(tb, DSET_ATTR_HASHSIZE) ||
 		     !domain_set_optattr_netorder(tb, DSET_ATTR_MAXELEM) ||
 		     !domain_set_optattr_netorder(tb, DSET_ATTR_TIMEOUT) ||
-		     !domain_set_optattr_netorder(tb, DSET_ATTR_CADT_FLAGS)))
+		     !domain_set_optattr_netorder(tb, DSET_ATTR_CADT_FLAGS) ||
+		     !domain_set_optattr_netorder(tb, DSET_ATTR_ELEMENTS)))
 		return -DSET_ERR_PROTOCOL;
 
 #ifdef DOMAIN_SET_HASH_WITH_MARKMASK
@@ -1037,18 +1489,24 @@ DSET_TOKEN(HTYPE, _create)(struct net *net, struct domain_set *set,
 	if (tb[DSET_ATTR_MAXELEM])
 		maxelem = domain_set_get_h32(tb[DSET_ATTR_MAXELEM]);
 
+	/* Expected number of elements: size the hash at once, so that
+	 * filling it up does not resize it step by step
+	 */
+	if (tb[DSET_ATTR_ELEMENTS]) {
+		u32 elements = min(domain_set_get_h32(tb[DSET_ATTR_ELEMENTS]),
+				   maxelem);
+
+		hashsize = max(hashsize,
+			       DIV_ROUND_UP(elements, AHASH_PRESIZE_LOAD));
+	}
+
 	hsize = sizeof(*h);
 	h = kzalloc(hsize, GFP_KERNEL);
 	if (!h)
 		return -ENOMEM;
 
 	hbits = htable_bits(hashsize);
-	hsize = htable_size(hbits);
-	if (hsize == 0) {
-		kfree(h);
-		return -ENOMEM;
-	}
-	t = domain_set_alloc(hsize);
+	t = htable_alloc(hbits, maxelem);
 	if (!t) {
 		kfree(h);
 		return -ENOMEM;
@@ -1059,12 +1517,11 @@ DSET_TOKEN(HTYPE, _create)(struct net *net, struct domain_set *set,
 #endif
 	get_random_bytes(&h->initval, sizeof(h->initval));
 
-	t->htable_bits = hbits;
 	RCU_INIT_POINTER(h->table, t);
-
-#ifdef HAVE_TIMER_SETUP
+	rwlock_init(&h->lock);
 	h->set = set;
-#endif
+	INIT_WORK(&h->resize_work, mtype_resize_work);
+	spin_lock_init(&h->resize_lock);
 	set->data = h;
 #ifndef DOMAIN_SET_PROTO_UNDEF
 	if (set->family == NFPROTO_IPV4) {
@@ -0,0 +1,278 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Kernel module implementing an IP set type: the hash:ip type, filled
+ * from the address answers of DNS responses
+ */
+
+#include <linux/jhash.h>
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/random.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/netlink.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_hash.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+
+#define DSET_TYPE_REV_MIN 0
+/*				0	   Counters, comments, forceadd, skbinfo, category */
+#define DSET_TYPE_REV_MAX 1 /* elements support */
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
+DOMAIN_SET_MODULE_DESC("hash:ip", DSET_TYPE_REV_MIN, DSET_TYPE_REV_MAX);
+MODULE_ALIAS("domain_set_hash:ip");
+
+/* Type specific function prefix */
+#define HTYPE hash_ip
+
+/* Member elements: IPv4 and IPv6 addresses share the table */
+struct hash_ip_elem
+{
+	union nf_inet_addr ip;
+	u8 family;
+	u8 padding[3];
+};
+
+/* Common functions */
+
+static bool hash_ip_data_equal(const struct hash_ip_elem *e1,
+							   const struct hash_ip_elem *e2,
+							   u32 *multi)
+{
+	return e1->family == e2->family &&
+		   ipv6_addr_equal(&e1->ip.in6, &e2->ip.in6);
+}
+
+static bool hash_ip_data_list(struct sk_buff *skb,
+							  const struct hash_ip_elem *e)
+{
+	if (nla_put_ipaddr(skb, DSET_ATTR_IP, &e->ip, e->family))
+		goto nla_put_failure;
+	return false;
+
+nla_put_failure:
+	return true;
+}
+
+#define MTYPE hash_ip
+
+#define DOMAIN_SET_EMIT_CREATE
+#define DOMAIN_SET_PROTO_UNDEF
+#include "domain_set_hash_gen.h"
+
+/* Learning context, passed to the DNS walker */
+struct hash_ip_dadt_ctx
+{
+	struct domain_set *set;
+	dset_adtfn adtfn;
+	struct domain_set_ext *ext;
+	struct domain_set_adt_opt *opt;
+	enum dset_adt adt;
+};
+
+static int hash_ip_dadt_rr(const struct dset_dns_msg *msg,
+						   const struct dset_dns_rr *rr, void *priv)
+{
+	struct hash_ip_dadt_ctx *ctx = priv;
+	struct hash_ip_elem e = {0};
+	u32 timeout;
+	int ret;
+
+	e.family = domain_set_dns_addr(msg, rr, &e.ip);
+	if (e.family == NFPROTO_UNSPEC)
+		return 0;
+
+	/* Learnt addresses live as long as the record may be cached:
+	 * the rule timeout is an upper bound only, and a zero TTL still
+	 * must not make the element permanent.
+	 */
+	if (ctx->adt == DSET_ADD && SET_WITH_TIMEOUT(ctx->set))
+	{
+		timeout = min_t(u32, rr->ttl, DSET_MAX_TIMEOUT);
+		if (ctx->opt->ext.timeout != DSET_NO_TIMEOUT)
+			timeout = min_t(u32, timeout, ctx->opt->ext.timeout);
+		ctx->ext->timeout = timeout ? timeout : 1;
+	}
+
+	ret = ctx->adtfn(ctx->set, &e, ctx->ext, &ctx->opt->ext,
+					 ctx->opt->cmdflags);
+
+	/* A full bucket or an existing element must not stop the learning
+	 * of the remaining answers
+	 */
+	return ctx->adt == DSET_TEST ? ret : 0;
+}
+
+static int hash_ip_dadt(struct domain_set *set,
+						const struct dset_dns_msg *msg,
+						enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set_ext ext = DOMAIN_SET_INIT_DEXT(msg, opt, set);
+	struct hash_ip_dadt_ctx ctx = {
+		.set = set,
+		.adtfn = set->variant->adt[adt],
+		.ext = &ext,
+		.opt = opt,
+		.adt = adt,
+	};
+
+	/* Only the addresses of the queried name are learnt */
+	return domain_set_dns_walk(msg, DSET_DNS_ANSWER | DSET_DNS_CHAIN,
+							   hash_ip_dadt_rr, &ctx);
+}
+
+static int hash_ip_nadt(struct domain_set *set,
+						const struct dset_dns_msg *msg,
+						const struct dset_dns_rr *rr,
+						enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct domain_set_ext ext = DOMAIN_SET_INIT_DEXT(msg, opt, set);
+	struct hash_ip_dadt_ctx ctx = {
+		.set = set,
+		.adtfn = set->variant->adt[adt],
+		.ext = &ext,
+		.opt = opt,
+		.adt = adt,
+	};
+
+	return hash_ip_dadt_rr(msg, rr, &ctx);
+}
+
+static int hash_ip_kadt(struct domain_set *set, const struct sk_buff *skb,
+						const struct xt_action_param *par,
+						enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	dset_adtfn adtfn = set->variant->adt[adt];
+	struct hash_ip_elem e = {0};
+	struct domain_set_ext ext = DOMAIN_SET_INIT_KEXT(skb, opt, set);
+	bool src = opt->flags & DSET_DIM_ONE_SRC;
+	struct dset_dns_msg msg;
+	const u8 *vp;
+	u8 _v;
+
+	/* Learn the answers of a DNS response instead of the packet
+	 * address itself
+	 */
+	if (adt != DSET_TEST && (opt->cmdflags & DSET_FLAG_LEARN_ANSWERS))
+	{
+		if (domain_set_dns_locate(skb, opt->family, &msg) < 0)
+			return 0;
+		do
+			hash_ip_dadt(set, &msg, adt, opt);
+		while (domain_set_dns_next(&msg) == 0);
+		return 0;
+	}
+
+	e.family = opt->family;
+	if (e.family != NFPROTO_IPV4 && e.family != NFPROTO_IPV6)
+	{
+		vp = skb_header_pointer(skb, skb_network_offset(skb), 1, &_v);
+		if (!vp)
+			return 0;
+		if (*vp >> 4 == 4)
+			e.family = NFPROTO_IPV4;
+		else if (*vp >> 4 == 6)
+			e.family = NFPROTO_IPV6;
+	}
+
+	if (e.family == NFPROTO_IPV4)
+		e.ip.ip = src ? ip_hdr(skb)->saddr : ip_hdr(skb)->daddr;
+	else if (e.family == NFPROTO_IPV6)
+		e.ip.in6 = src ? ipv6_hdr(skb)->saddr : ipv6_hdr(skb)->daddr;
+	else
+		return 0;
+
+	return adtfn(set, &e, &ext, &opt->ext, opt->cmdflags);
+}
+
+static int hash_ip_uadt(struct domain_set *set, struct nlattr *tb[],
+						enum dset_adt adt, u32 *lineno, u32 flags,
+						bool retried)
+{
+	dset_adtfn adtfn = set->variant->adt[adt];
+	struct hash_ip_elem e = {0};
+	struct domain_set_ext ext = DOMAIN_SET_INIT_UEXT(set);
+	int ret = 0;
+
+	if (tb[DSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[DSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[DSET_ATTR_IP]))
+		return -DSET_ERR_PROTOCOL;
+
+	ret = domain_set_get_ipaddr(tb[DSET_ATTR_IP], &e.ip, &e.family);
+	if (ret)
+		return ret;
+	if (ipv6_addr_any(&e.ip.in6))
+		return -DSET_ERR_HASH_ELEM;
+
+	ret = domain_set_get_extensions(set, tb, &ext);
+	if (ret)
+		return ret;
+
+	ret = adtfn(set, &e, &ext, &ext, flags);
+
+	if (ret && !domain_set_eexist(ret, flags))
+		return ret;
+
+	return ret;
+}
+
+static struct domain_set_type hash_ip_type __read_mostly = {
+	.name = "hash:ip",
+	.protocol = DSET_PROTOCOL,
+	.features = 0,
+	.dimension = DSET_DIM_ONE,
+	.family = NFPROTO_UNSPEC,
+	.revision_min = DSET_TYPE_REV_MIN,
+	.revision_max = DSET_TYPE_REV_MAX,
+	.create = hash_ip_create,
+	.create_policy =
+		{
+			[DSET_ATTR_HASHSIZE] = {.type = NLA_U32},
+			[DSET_ATTR_MAXELEM] = {.type = NLA_U32},
+			[DSET_ATTR_PROBES] = {.type = NLA_U8},
+			[DSET_ATTR_RESIZE] = {.type = NLA_U8},
+			[DSET_ATTR_TIMEOUT] = {.type = NLA_U32},
+			[DSET_ATTR_CADT_FLAGS] = {.type = NLA_U32},
+			[DSET_ATTR_ELEMENTS] = {.type = NLA_U32},
+		},
+	.adt_policy =
+		{
+			[DSET_ATTR_IP] = {.type = NLA_NESTED},
+			[DSET_ATTR_TIMEOUT] = {.type = NLA_U32},
+			[DSET_ATTR_CADT_FLAGS] = {.type = NLA_U32},
+			[DSET_ATTR_LINENO] = {.type = NLA_U32},
+			[DSET_ATTR_BYTES] = {.type = NLA_U64},
+			[DSET_ATTR_PACKETS] = {.type = NLA_U64},
+			[DSET_ATTR_COMMENT] = {.type = NLA_NUL_STRING,
+								   .len = DSET_MAX_COMMENT_SIZE},
+			[DSET_ATTR_SKBMARK] = {.type = NLA_U64},
+			[DSET_ATTR_SKBPRIO] = {.type = NLA_U32},
+			[DSET_ATTR_SKBQUEUE] = {.type = NLA_U16},
+			[DSET_ATTR_CATEGORY] = {.type = NLA_U32},
+		},
+	.me = THIS_MODULE,
+};
+
+static int __init hash_ip_init(void)
+{
+	return domain_set_type_register(&hash_ip_type);
+}
+
+static void __exit hash_ip_fini(void)
+{
+	rcu_barrier();
+	domain_set_type_unregister(&hash_ip_type);
+}
+
+module_init(hash_ip_init);
+module_exit(hash_ip_fini);
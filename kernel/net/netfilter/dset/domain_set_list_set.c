@@ -0,0 +1,580 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Kernel module implementing an DOMAIN set type: the list:set type */
+
+#include <linux/module.h>
+#include <linux/skbuff.h>
+#include <linux/errno.h>
+#include <linux/rculist.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_list.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+
+#define DSET_TYPE_REV_MIN 0
+#define DSET_TYPE_REV_MAX 0 /* Single parse of the DNS message */
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
+DOMAIN_SET_MODULE_DESC("list:set", DSET_TYPE_REV_MIN, DSET_TYPE_REV_MAX);
+MODULE_ALIAS("domain_set_list:set");
+
+/* Member elements  */
+struct set_elem
+{
+	struct rcu_head rcu;
+	struct list_head list;
+	domain_set_id_t id;
+};
+
+/* add/del/test element from userspace */
+struct set_adt_elem
+{
+	domain_set_id_t id;
+	domain_set_id_t refid;
+	int before;
+};
+
+/* Type structure */
+struct list_set
+{
+	u32 size;				 /* size of set list array */
+	struct net *net;		 /* namespace of the member sets */
+	struct list_head members; /* the set members */
+};
+
+/* Packet lookup context, passed to the DNS walker */
+struct list_set_dadt_ctx
+{
+	struct list_set *map;
+	struct domain_set_adt_opt *opt;
+};
+
+/* Probe the members in order with a name decoded once: each member
+ * applies its own nomatch entries and fills in the extensions of its
+ * matching element, so the first matching member decides.
+ */
+static int list_set_dadt_rr(const struct dset_dns_msg *msg,
+							const struct dset_dns_rr *rr, void *priv)
+{
+	struct list_set_dadt_ctx *ctx = priv;
+	struct set_elem *e;
+	int ret;
+
+	if (!rr->namelen)
+		return 0;
+
+	list_for_each_entry_rcu(e, &ctx->map->members, list)
+	{
+		ret = domain_set_test_name(ctx->map->net, e->id, msg, rr,
+								   ctx->opt);
+		if (ret > 0)
+			return ret;
+	}
+	return 0;
+}
+
+static int list_set_dadt(struct domain_set *set,
+						 const struct dset_dns_msg *msg,
+						 enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct list_set_dadt_ctx ctx = {
+		.map = set->data,
+		.opt = opt,
+	};
+	u8 sections = DSET_DNS_QUESTION;
+
+	if (adt != DSET_TEST)
+		return -EINVAL;
+
+	if (opt->cmdflags & DSET_FLAG_MATCH_ANSWERS)
+		sections |= DSET_DNS_ANSWER | DSET_DNS_CNAME;
+
+	return domain_set_dns_walk(msg, sections, list_set_dadt_rr, &ctx);
+}
+
+static int list_set_kadd(struct domain_set *set, const struct sk_buff *skb,
+						 const struct xt_action_param *par,
+						 struct domain_set_adt_opt *opt)
+{
+	struct list_set *map = set->data;
+	struct set_elem *e;
+	int ret;
+
+	list_for_each_entry_rcu(e, &map->members, list)
+	{
+		ret = domain_set_add_net(map->net, e->id, skb, par, opt);
+		if (ret == 0)
+			return ret;
+	}
+	return 0;
+}
+
+static int list_set_kdel(struct domain_set *set, const struct sk_buff *skb,
+						 const struct xt_action_param *par,
+						 struct domain_set_adt_opt *opt)
+{
+	struct list_set *map = set->data;
+	struct set_elem *e;
+	int ret;
+
+	list_for_each_entry_rcu(e, &map->members, list)
+	{
+		ret = domain_set_del_net(map->net, e->id, skb, par, opt);
+		if (ret == 0)
+			return ret;
+	}
+	return 0;
+}
+
+static int list_set_kadt(struct domain_set *set, const struct sk_buff *skb,
+						 const struct xt_action_param *par,
+						 enum dset_adt adt, struct domain_set_adt_opt *opt)
+{
+	struct list_set_dadt_ctx ctx = {
+		.map = set->data,
+		.opt = opt,
+	};
+	struct dset_dns_msg msg;
+	struct dset_dns_rr rr;
+	char name[DSET_MAX_DOMAIN_LEN];
+	int ret = -EINVAL;
+
+	rcu_read_lock();
+	switch (adt)
+	{
+	case DSET_TEST:
+		/* Locate the message or extract the name once for all of
+		 * the members
+		 */
+		ret = 0;
+		if (opt->payload != DSET_PAYLOAD_DNS)
+		{
+			if (domain_set_payload_name(skb, opt->family, opt->payload,
+										&msg, &rr, name) >= 0)
+				ret = list_set_dadt_rr(&msg, &rr, &ctx);
+		}
+		else if (domain_set_dns_locate(skb, opt->family, &msg) == 0)
+		{
+			do
+				ret = list_set_dadt(set, &msg, adt, opt);
+			while (!ret && domain_set_dns_next(&msg) == 0);
+		}
+		break;
+	case DSET_ADD:
+		ret = list_set_kadd(set, skb, par, opt);
+		break;
+	case DSET_DEL:
+		ret = list_set_kdel(set, skb, par, opt);
+		break;
+	default:
+		break;
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
+/* Userspace interfaces: we are protected by the nfnl mutex */
+
+static void list_set_del(struct domain_set *set, struct set_elem *e)
+{
+	struct list_set *map = set->data;
+
+	set->elements--;
+	list_del_rcu(&e->list);
+	domain_set_put_byindex(map->net, e->id);
+	kfree_rcu(e, rcu);
+}
+
+static int list_set_utest(struct domain_set *set, void *value,
+						  const struct domain_set_ext *ext,
+						  struct domain_set_ext *mext, u32 flags)
+{
+	struct list_set *map = set->data;
+	struct set_adt_elem *d = value;
+	struct set_elem *e, *next, *prev = NULL;
+
+	list_for_each_entry(e, &map->members, list)
+	{
+		if (e->id != d->id)
+		{
+			prev = e;
+			continue;
+		}
+		if (d->before == 0)
+			return 1;
+		if (d->before > 0)
+		{
+			next = list_next_entry(e, list);
+			return !list_is_last(&e->list, &map->members) &&
+				   next->id == d->refid;
+		}
+		return prev && prev->id == d->refid;
+	}
+	return 0;
+}
+
+static int list_set_uadd(struct domain_set *set, void *value,
+						 const struct domain_set_ext *ext,
+						 struct domain_set_ext *mext, u32 flags)
+{
+	struct list_set *map = set->data;
+	struct set_adt_elem *d = value;
+	struct set_elem *e, *n = NULL, *prev = NULL, *next = NULL;
+
+	/* Find where to add the new entry */
+	list_for_each_entry(e, &map->members, list)
+	{
+		if (e->id == d->id)
+			n = e;
+		else if (d->before == 0 || e->id != d->refid)
+			continue;
+		else if (d->before > 0)
+			next = e;
+		else
+			prev = e;
+	}
+
+	/* If before/after is used on an empty set */
+	if ((d->before > 0 && !next) ||
+		(d->before < 0 && !prev))
+		return -DSET_ERR_REF_EXIST;
+
+	/* Re-add already existing element */
+	if (n)
+	{
+		if (!(flags & DSET_FLAG_EXIST))
+			return -DSET_ERR_EXIST;
+		/* Set is already added to the list */
+		domain_set_put_byindex(map->net, d->id);
+		return 0;
+	}
+
+	if (set->elements >= map->size)
+		return -DSET_ERR_LIST_FULL;
+
+	e = kzalloc(set->dsize, GFP_ATOMIC);
+	if (!e)
+		return -ENOMEM;
+	e->id = d->id;
+	INIT_LIST_HEAD(&e->list);
+
+	if (d->before == 0)
+		list_add_tail_rcu(&e->list, &map->members);
+	else if (d->before > 0)
+		list_add_tail_rcu(&e->list, &next->list);
+	else
+		list_add_rcu(&e->list, &prev->list);
+	set->elements++;
+
+	return 0;
+}
+
+static int list_set_udel(struct domain_set *set, void *value,
+						 const struct domain_set_ext *ext,
+						 struct domain_set_ext *mext, u32 flags)
+{
+	struct list_set *map = set->data;
+	struct set_adt_elem *d = value;
+	struct set_elem *e, *next, *prev = NULL;
+
+	list_for_each_entry(e, &map->members, list)
+	{
+		if (e->id != d->id)
+		{
+			prev = e;
+			continue;
+		}
+
+		if (d->before > 0)
+		{
+			next = list_next_entry(e, list);
+			if (list_is_last(&e->list, &map->members) ||
+				next->id != d->refid)
+				return -DSET_ERR_REF_EXIST;
+		}
+		else if (d->before < 0)
+		{
+			if (!prev || prev->id != d->refid)
+				return -DSET_ERR_REF_EXIST;
+		}
+		list_set_del(set, e);
+		return 0;
+	}
+	return d->before != 0 ? -DSET_ERR_REF_EXIST : -DSET_ERR_EXIST;
+}
+
+static int list_set_uadt(struct domain_set *set, struct nlattr *tb[],
+						 enum dset_adt adt, u32 *lineno, u32 flags,
+						 bool retried)
+{
+	struct list_set *map = set->data;
+	dset_adtfn adtfn = set->variant->adt[adt];
+	struct set_adt_elem e = {.refid = DSET_INVALID_ID};
+	struct domain_set_ext ext = DOMAIN_SET_INIT_UEXT(set);
+	struct domain_set *s;
+	int ret = 0;
+
+	if (tb[DSET_ATTR_LINENO])
+		*lineno = nla_get_u32(tb[DSET_ATTR_LINENO]);
+
+	if (unlikely(!tb[DSET_ATTR_NAME] ||
+				 !domain_set_optattr_netorder(tb, DSET_ATTR_CADT_FLAGS)))
+		return -DSET_ERR_PROTOCOL;
+
+	e.id = domain_set_get_byname(map->net, nla_data(tb[DSET_ATTR_NAME]), &s);
+	if (e.id == DSET_INVALID_ID)
+		return -DSET_ERR_NAME;
+	/* "Loop detection" */
+	if (s->type->features & DSET_TYPE_NAME)
+	{
+		ret = -DSET_ERR_LOOP;
+		goto finish;
+	}
+
+	if (tb[DSET_ATTR_CADT_FLAGS])
+	{
+		u32 f = domain_set_get_h32(tb[DSET_ATTR_CADT_FLAGS]);
+
+		e.before = f & DSET_FLAG_BEFORE;
+	}
+
+	if (e.before && !tb[DSET_ATTR_NAMEREF])
+	{
+		ret = -DSET_ERR_BEFORE;
+		goto finish;
+	}
+
+	if (tb[DSET_ATTR_NAMEREF])
+	{
+		e.refid = domain_set_get_byname(map->net,
+										nla_data(tb[DSET_ATTR_NAMEREF]),
+										&s);
+		if (e.refid == DSET_INVALID_ID)
+		{
+			ret = -DSET_ERR_NAMEREF;
+			goto finish;
+		}
+		if (!e.before)
+			e.before = -1;
+	}
+
+	ret = adtfn(set, &e, &ext, &ext, flags);
+
+finish:
+	if (e.refid != DSET_INVALID_ID)
+		domain_set_put_byindex(map->net, e.refid);
+	if (adt != DSET_ADD || ret)
+		domain_set_put_byindex(map->net, e.id);
+
+	return domain_set_eexist(ret, flags) ? 0 : ret;
+}
+
+static void list_set_flush(struct domain_set *set)
+{
+	struct list_set *map = set->data;
+	struct set_elem *e, *n;
+
+	list_for_each_entry_safe(e, n, &map->members, list)
+		list_set_del(set, e);
+	set->elements = 0;
+}
+
+static void list_set_destroy(struct domain_set *set)
+{
+	struct list_set *map = set->data;
+	struct set_elem *e, *n;
+
+	list_for_each_entry_safe(e, n, &map->members, list)
+	{
+		list_del(&e->list);
+		domain_set_put_byindex(map->net, e->id);
+		kfree(e);
+	}
+	kfree(map);
+
+	set->data = NULL;
+}
+
+static int list_set_head(struct domain_set *set, struct sk_buff *skb)
+{
+	const struct list_set *map = set->data;
+	struct nlattr *nested;
+	size_t memsize = sizeof(*map) + set->elements * set->dsize;
+
+	nested = dset_nest_start(skb, DSET_ATTR_DATA);
+	if (!nested)
+		goto nla_put_failure;
+	if (nla_put_net32(skb, DSET_ATTR_SIZE, htonl(map->size)) ||
+		nla_put_net32(skb, DSET_ATTR_REFERENCES, htonl(set->ref)) ||
+		nla_put_net32(skb, DSET_ATTR_MEMSIZE, htonl(memsize)) ||
+		nla_put_net32(skb, DSET_ATTR_ELEMENTS, htonl(set->elements)))
+		goto nla_put_failure;
+	if (unlikely(domain_set_put_flags(skb, set)))
+		goto nla_put_failure;
+	dset_nest_end(skb, nested);
+
+	return 0;
+nla_put_failure:
+	return -EMSGSIZE;
+}
+
+static int list_set_list(const struct domain_set *set,
+						 struct sk_buff *skb, struct netlink_callback *cb)
+{
+	const struct list_set *map = set->data;
+	struct nlattr *atd, *nested = NULL;
+	u32 i = 0, first = cb->args[DSET_CB_ARG0];
+	char name[DSET_MAXNAMELEN];
+	struct set_elem *e;
+	int ret = 0;
+
+	atd = dset_nest_start(skb, DSET_ATTR_ADT);
+	if (!atd)
+		return -EMSGSIZE;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(e, &map->members, list)
+	{
+		if (i < first)
+		{
+			i++;
+			continue;
+		}
+		nested = dset_nest_start(skb, DSET_ATTR_DATA);
+		if (!nested)
+			goto nla_put_failure;
+		domain_set_name_byindex(map->net, e->id, name);
+		if (nla_put_string(skb, DSET_ATTR_NAME, name))
+			goto nla_put_failure;
+		dset_nest_end(skb, nested);
+		i++;
+	}
+
+	dset_nest_end(skb, atd);
+	/* Set listing finished */
+	cb->args[DSET_CB_ARG0] = 0;
+	goto out;
+
+nla_put_failure:
+	nla_nest_cancel(skb, nested);
+	if (unlikely(i == first))
+	{
+		nla_nest_cancel(skb, atd);
+		cb->args[DSET_CB_ARG0] = 0;
+		ret = -EMSGSIZE;
+	}
+	else
+	{
+		cb->args[DSET_CB_ARG0] = i;
+		dset_nest_end(skb, atd);
+	}
+out:
+	rcu_read_unlock();
+	return ret;
+}
+
+static bool list_set_same_set(const struct domain_set *a,
+							  const struct domain_set *b)
+{
+	const struct list_set *x = a->data;
+	const struct list_set *y = b->data;
+
+	return x->size == y->size &&
+		   a->extensions == b->extensions;
+}
+
+static const struct domain_set_type_variant set_variant = {
+	.kadt = list_set_kadt,
+	.dadt = list_set_dadt,
+	.uadt = list_set_uadt,
+	.adt = {
+		[DSET_ADD] = list_set_uadd,
+		[DSET_DEL] = list_set_udel,
+		[DSET_TEST] = list_set_utest,
+	},
+	.destroy = list_set_destroy,
+	.flush = list_set_flush,
+	.head = list_set_head,
+	.list = list_set_list,
+	.same_set = list_set_same_set,
+	/* The members are under RCU and lock themselves */
+	.own_lock = true,
+};
+
+static int list_set_create(struct net *net, struct domain_set *set,
+						   struct nlattr *tb[], u32 flags)
+{
+	struct list_set *map;
+	u32 size = DSET_LIST_DEFAULT_SIZE;
+
+	if (set->family != NFPROTO_UNSPEC)
+		return -DSET_ERR_INVALID_FAMILY;
+
+	if (unlikely(!domain_set_optattr_netorder(tb, DSET_ATTR_SIZE)))
+		return -DSET_ERR_PROTOCOL;
+
+	if (tb[DSET_ATTR_SIZE])
+		size = domain_set_get_h32(tb[DSET_ATTR_SIZE]);
+	if (size < DSET_LIST_MIN_SIZE)
+		size = DSET_LIST_MIN_SIZE;
+
+	map = kzalloc(sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	map->size = size;
+	map->net = net;
+	INIT_LIST_HEAD(&map->members);
+
+	set->data = map;
+	set->variant = &set_variant;
+	set->dsize = sizeof(struct set_elem);
+	set->timeout = DSET_NO_TIMEOUT;
+
+	return 0;
+}
+
+static struct domain_set_type list_set_type __read_mostly = {
+	.name = "list:set",
+	.protocol = DSET_PROTOCOL,
+	.features = DSET_TYPE_NAME | DSET_DUMP_LAST,
+	.dimension = DSET_DIM_ONE,
+	.family = NFPROTO_UNSPEC,
+	.revision_min = DSET_TYPE_REV_MIN,
+	.revision_max = DSET_TYPE_REV_MAX,
+	.create = list_set_create,
+	.create_policy =
+		{
+			[DSET_ATTR_SIZE] = {.type = NLA_U32},
+		},
+	.adt_policy =
+		{
+			[DSET_ATTR_NAME] = {.type = NLA_NUL_STRING,
+								.len = DSET_MAXNAMELEN - 1},
+			[DSET_ATTR_NAMEREF] = {.type = NLA_NUL_STRING,
+								   .len = DSET_MAXNAMELEN - 1},
+			[DSET_ATTR_LINENO] = {.type = NLA_U32},
+			[DSET_ATTR_CADT_FLAGS] = {.type = NLA_U32},
+		},
+	.me = THIS_MODULE,
+};
+
+static int __init list_set_init(void)
+{
+	return domain_set_type_register(&list_set_type);
+}
+
+static void __exit list_set_fini(void)
+{
+	rcu_barrier();
+	domain_set_type_unregister(&list_set_type);
+}
+
+module_init(list_set_init);
+module_exit(list_set_fini);
@@ -0,0 +1,303 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Bounded, allocation-free extraction of the names carried by
+ * application payloads other than DNS
+ */
+
+#include <linux/ctype.h>
+#include <linux/skbuff.h>
+#include <linux/tcp.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+
+/* TLS record, handshake and extension values of a ClientHello */
+#define DSET_TLS_HANDSHAKE		22
+#define DSET_TLS_CLIENT_HELLO		1
+#define DSET_TLS_EXT_SERVER_NAME	0
+#define DSET_TLS_SNI_HOST_NAME		0
+
+#define DSET_TLS_RECORD_HDRLEN		5
+#define DSET_TLS_HANDSHAKE_HDRLEN	4
+/* Client version and random */
+#define DSET_TLS_HELLO_FIXEDLEN		(2 + 32)
+
+static inline const u8 *
+dset_payload_ptr(const struct dset_dns_msg *msg, unsigned int pos,
+		 unsigned int len, void *buf)
+{
+	if (pos > msg->len || len > msg->len - pos)
+		return NULL;
+	return skb_header_pointer(msg->skb, msg->off + pos, len, buf);
+}
+
+static inline unsigned int
+dset_get16(const u8 *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+/* The payload of the first data segment of a TCP connection. The
+ * payload is not linearized and segments are never reassembled.
+ */
+static int
+dset_tcp_payload(const struct sk_buff *skb, u8 family,
+		 struct dset_dns_msg *msg)
+{
+	const struct tcphdr *th;
+	struct tcphdr _tcph;
+	unsigned int thoff, doff;
+	u8 proto;
+	int ret;
+
+	ret = domain_set_transport(skb, family, &proto, &thoff);
+	if (ret < 0)
+		return ret;
+	if (proto != IPPROTO_TCP)
+		return -EPROTONOSUPPORT;
+
+	th = skb_header_pointer(skb, thoff, sizeof(_tcph), &_tcph);
+	if (!th)
+		return -EINVAL;
+	doff = th->doff * 4;
+	if (doff < sizeof(_tcph) || thoff + doff >= skb->len)
+		return -EINVAL;
+
+	msg->skb = skb;
+	msg->data = NULL;
+	msg->off = thoff + doff;
+	msg->len = skb->len - msg->off;
+	msg->pktlen = skb->len;
+	msg->next = 0;
+
+	return 0;
+}
+
+/* Lowercase the name in place and drop the trailing dot of a fully
+ * qualified name, so that it is looked up like a decoded DNS name.
+ *
+ * Returns the length of the name or a negative error code.
+ */
+static int
+dset_name_normalize(char *name, unsigned int len)
+{
+	unsigned int i;
+
+	if (len && name[len - 1] == '.')
+		len--;
+	if (!len)
+		return -EINVAL;
+	for (i = 0; i < len; i++) {
+		if (!name[i])
+			return -EINVAL;
+		name[i] = tolower(name[i]);
+	}
+	name[len] = '\0';
+
+	return len;
+}
+
+/* Extract the host_name of the server_name extension of a TLS
+ * ClientHello. Only the part of the handshake carried by the segment is
+ * parsed and at most DSET_TLS_MAX_EXTENSIONS extensions are visited.
+ */
+static int
+dset_tls_sni(const struct dset_dns_msg *msg, char *name)
+{
+	struct dset_dns_msg hello = *msg;
+	unsigned int pos, end, len, type, i;
+	const u8 *p;
+	u8 buf[DSET_TLS_RECORD_HDRLEN];
+
+	p = dset_payload_ptr(&hello, 0, DSET_TLS_RECORD_HDRLEN, buf);
+	if (!p || p[0] != DSET_TLS_HANDSHAKE || p[1] != 3)
+		return -EINVAL;
+	end = DSET_TLS_RECORD_HDRLEN + dset_get16(p + 3);
+	hello.len = min(hello.len, end);
+
+	pos = DSET_TLS_RECORD_HDRLEN;
+	p = dset_payload_ptr(&hello, pos, DSET_TLS_HANDSHAKE_HDRLEN, buf);
+	if (!p || p[0] != DSET_TLS_CLIENT_HELLO)
+		return -EINVAL;
+	pos += DSET_TLS_HANDSHAKE_HDRLEN;
+	end = pos + ((p[1] << 16) | dset_get16(p + 2));
+	hello.len = min(hello.len, end);
+	pos += DSET_TLS_HELLO_FIXEDLEN;
+
+	/* Session id */
+	p = dset_payload_ptr(&hello, pos, 1, buf);
+	if (!p)
+		return -EINVAL;
+	pos += 1 + p[0];
+	/* Cipher suites */
+	p = dset_payload_ptr(&hello, pos, 2, buf);
+	if (!p)
+		return -EINVAL;
+	pos += 2 + dset_get16(p);
+	/* Compression methods */
+	p = dset_payload_ptr(&hello, pos, 1, buf);
+	if (!p)
+		return -EINVAL;
+	pos += 1 + p[0];
+	/* Extensions */
+	p = dset_payload_ptr(&hello, pos, 2, buf);
+	if (!p)
+		return -EINVAL;
+	pos += 2;
+	hello.len = min(hello.len, pos + dset_get16(p));
+
+	for (i = 0; i < DSET_TLS_MAX_EXTENSIONS; i++) {
+		p = dset_payload_ptr(&hello, pos, 4, buf);
+		if (!p)
+			return -ENOENT;
+		type = dset_get16(p);
+		len = dset_get16(p + 2);
+		pos += 4;
+		if (type != DSET_TLS_EXT_SERVER_NAME) {
+			pos += len;
+			continue;
+		}
+
+		/* Server name list length, name type, name length */
+		p = dset_payload_ptr(&hello, pos, 5, buf);
+		if (!p || len < 5 || p[2] != DSET_TLS_SNI_HOST_NAME)
+			return -EINVAL;
+		len = min(len - 5, dset_get16(p + 3));
+		if (len >= DSET_MAX_DOMAIN_LEN)
+			return -ENAMETOOLONG;
+		p = dset_payload_ptr(&hello, pos + 5, len, name);
+		if (!p)
+			return -EINVAL;
+		if (p != (const u8 *)name)
+			memcpy(name, p, len);
+		return dset_name_normalize(name, len);
+	}
+
+	return -ENOENT;
+}
+
+/* Does the payload start with an HTTP request line? Only the method
+ * token is checked: uppercase letters followed by a space.
+ */
+static bool
+dset_http_request(const struct dset_dns_msg *msg)
+{
+	const u8 *p;
+	u8 buf[8];
+	unsigned int i;
+
+	p = dset_payload_ptr(msg, 0, sizeof(buf), buf);
+	if (!p)
+		return false;
+	for (i = 0; i < sizeof(buf); i++) {
+		if (p[i] == ' ')
+			return i >= 3;
+		if (p[i] < 'A' || p[i] > 'Z')
+			return false;
+	}
+	return false;
+}
+
+/* Extract the host of the Host header of an HTTP/1.x request. The
+ * header name is matched case insensitively, the port is stripped and
+ * at most DSET_HTTP_MAX_SCAN bytes of the segment are scanned, in small
+ * chunks so that the payload is never linearized.
+ */
+static int
+dset_http_host(const struct dset_dns_msg *msg, char *name)
+{
+	static const char header[] = "\nhost:";
+	unsigned int pos, end, i, n, m = 0, len = 0;
+	bool value = false;
+	const u8 *p;
+	u8 buf[64], c;
+
+	if (!dset_http_request(msg))
+		return -EINVAL;
+
+	end = min_t(unsigned int, msg->len, DSET_HTTP_MAX_SCAN);
+	for (pos = 0; pos < end; pos += n) {
+		n = min_t(unsigned int, sizeof(buf), end - pos);
+		p = dset_payload_ptr(msg, pos, n, buf);
+		if (!p)
+			return -EINVAL;
+		for (i = 0; i < n; i++) {
+			c = p[i];
+			if (value) {
+				if ((c == ' ' || c == '\t') && !len)
+					continue;
+				if (c == ' ' || c == '\t' || c == '\r' ||
+				    c == '\n' || c == ':')
+					goto found;
+				if (len == DSET_MAX_DOMAIN_LEN - 1)
+					return -ENAMETOOLONG;
+				name[len++] = c;
+				continue;
+			}
+			/* An empty line ends the header */
+			if (m == 1 && (c == '\r' || c == '\n'))
+				return -ENOENT;
+			if (tolower(c) == header[m]) {
+				if (++m == sizeof(header) - 1)
+					value = true;
+			} else {
+				m = c == '\n';
+			}
+		}
+	}
+	/* The header is not complete in the segment */
+	return value ? -EINVAL : -ENOENT;
+
+found:
+	/* IPv6 literals are not names */
+	if (len && name[0] == '[')
+		return -EINVAL;
+	return dset_name_normalize(name, len);
+}
+
+/* Extract the name carried by the application payload of the packet
+ * into name, which must be able to hold DSET_MAX_DOMAIN_LEN bytes, and
+ * describe it in rr as if it were the question of a DNS message: the
+ * set types look it up with the same suffix semantics. msg is set to
+ * the payload, for the counters.
+ *
+ * Returns the length of the name or a negative error code.
+ */
+int
+domain_set_payload_name(const struct sk_buff *skb, u8 family, u8 payload,
+			struct dset_dns_msg *msg, struct dset_dns_rr *rr,
+			char *name)
+{
+	int ret;
+
+	switch (payload) {
+	case DSET_PAYLOAD_TLS_SNI:
+		ret = dset_tcp_payload(skb, family, msg);
+		if (ret < 0)
+			return ret;
+		ret = dset_tls_sni(msg, name);
+		break;
+	case DSET_PAYLOAD_HTTP_HOST:
+		ret = dset_tcp_payload(skb, family, msg);
+		if (ret < 0)
+			return ret;
+		ret = dset_http_host(msg, name);
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+	if (ret < 0)
+		return ret;
+
+	memset(rr, 0, sizeof(*rr));
+	rr->name = name;
+	rr->namelen = ret;
+	rr->section = DSET_DNS_QUESTION;
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(domain_set_payload_name);
@@ -0,0 +1,263 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Kernel module which implements the dset expression for nftables */
+
+#include <linux/module.h>
+#include <linux/netlink.h>
+#include <linux/skbuff.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+#include <net/netfilter/nf_tables.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <uapi/linux/netfilter/nft_dset.h>
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
+MODULE_DESCRIPTION("nftables: domain set expression");
+MODULE_ALIAS_NFT_EXPR("dset");
+
+struct nft_dset {
+	domain_set_id_t index[NFT_DSET_MAX_SETS];
+	struct net *net;
+	u32 flags;
+	u32 cmdflags;
+	u32 category;
+	u8 payload;
+	u8 nsets;
+	u8 dreg;
+	bool has_dreg;
+};
+
+static void
+nft_dset_eval(const struct nft_expr *expr, struct nft_regs *regs,
+	      const struct nft_pktinfo *pkt)
+{
+	const struct nft_dset *priv = nft_expr_priv(expr);
+	struct domain_set_adt_opt opt = {
+		.family = nft_pf(pkt),
+		.dim = DSET_DIM_ONE,
+		.payload = priv->payload,
+		.cmdflags = priv->cmdflags,
+		.ext.timeout = UINT_MAX,
+		.ext.category = priv->category,
+	};
+	u32 match = 0;
+	u8 i;
+
+	for (i = 0; i < priv->nsets; i++) {
+		if (domain_set_test_net(nft_net(pkt), priv->index[i],
+					pkt->skb, &opt)) {
+			match = i + 1;
+			break;
+		}
+	}
+
+	if (!priv->has_dreg) {
+		if (priv->flags & NFT_DSET_F_INV)
+			match = !match;
+		if (!match)
+			regs->verdict.code = NFT_BREAK;
+		return;
+	}
+
+	if (priv->flags & NFT_DSET_F_MARK) {
+		u32 mark = pkt->skb->mark;
+
+		if (match)
+			mark = (mark & ~opt.ext.skbinfo.skbmarkmask) ^
+			       opt.ext.skbinfo.skbmark;
+		regs->data[priv->dreg] = mark;
+	} else if (priv->flags & NFT_DSET_F_CATEGORY) {
+		regs->data[priv->dreg] = match ? opt.ext.category : 0;
+	} else {
+		regs->data[priv->dreg] = match;
+	}
+}
+
+static const struct nla_policy nft_dset_policy[NFTA_DSET_MAX + 1] = {
+	[NFTA_DSET_SETS] = { .type = NLA_NESTED },
+	[NFTA_DSET_DREG] = { .type = NLA_U32 },
+	[NFTA_DSET_FLAGS] = { .type = NLA_U32 },
+	[NFTA_DSET_CATEGORY] = { .type = NLA_U32 },
+	[NFTA_DSET_PAYLOAD] = { .type = NLA_U32 },
+};
+
+static void
+nft_dset_put_sets(struct nft_dset *priv)
+{
+	while (priv->nsets)
+		domain_set_nfnl_put(priv->net, priv->index[--priv->nsets]);
+}
+
+static int
+nft_dset_init(const struct nft_ctx *ctx, const struct nft_expr *expr,
+	      const struct nlattr * const tb[])
+{
+	struct nft_dset *priv = nft_expr_priv(expr);
+	char name[DSET_MAXNAMELEN];
+	struct domain_set *set;
+	domain_set_id_t index;
+	const struct nlattr *nla;
+	int rem, err;
+
+	if (!tb[NFTA_DSET_SETS])
+		return -EINVAL;
+
+	if (tb[NFTA_DSET_FLAGS]) {
+		priv->flags = ntohl(nla_get_be32(tb[NFTA_DSET_FLAGS]));
+		if (priv->flags & ~NFT_DSET_F_MASK)
+			return -EOPNOTSUPP;
+	}
+	/* Inverting is meaningful for a plain match only,
+	 * the mapped mark needs a register to be stored into
+	 */
+	if (tb[NFTA_DSET_DREG] && (priv->flags & NFT_DSET_F_INV))
+		return -EINVAL;
+	if (!tb[NFTA_DSET_DREG] &&
+	    (priv->flags & (NFT_DSET_F_MARK | NFT_DSET_F_CATEGORY)))
+		return -EINVAL;
+	if ((priv->flags & NFT_DSET_F_MARK) &&
+	    (priv->flags & NFT_DSET_F_CATEGORY))
+		return -EINVAL;
+
+	if (priv->flags & NFT_DSET_F_RETURN_NOMATCH)
+		priv->cmdflags |= DSET_FLAG_RETURN_NOMATCH;
+	if (priv->flags & NFT_DSET_F_ANSWERS)
+		priv->cmdflags |= DSET_FLAG_MATCH_ANSWERS;
+	if (priv->flags & NFT_DSET_F_MARK)
+		priv->cmdflags |= DSET_FLAG_MAP_SKBMARK;
+	if (tb[NFTA_DSET_CATEGORY]) {
+		priv->category = ntohl(nla_get_be32(tb[NFTA_DSET_CATEGORY]));
+		priv->cmdflags |= DSET_FLAG_MATCH_CATEGORY;
+	}
+
+	if (tb[NFTA_DSET_PAYLOAD]) {
+		u32 payload = ntohl(nla_get_be32(tb[NFTA_DSET_PAYLOAD]));
+
+		if (payload > DSET_PAYLOAD_MAX)
+			return -EOPNOTSUPP;
+		priv->payload = payload;
+	}
+
+	if (tb[NFTA_DSET_DREG]) {
+		err = nft_parse_register_store(ctx, tb[NFTA_DSET_DREG],
+					       &priv->dreg, NULL,
+					       NFT_DATA_VALUE, sizeof(u32));
+		if (err < 0)
+			return err;
+		priv->has_dreg = true;
+	}
+
+	priv->net = ctx->net;
+	nla_for_each_nested(nla, tb[NFTA_DSET_SETS], rem) {
+		if (nla_type(nla) != NFTA_DSET_SET_NAME) {
+			err = -EINVAL;
+			goto err;
+		}
+		if (priv->nsets == NFT_DSET_MAX_SETS) {
+			err = -E2BIG;
+			goto err;
+		}
+		nla_strscpy(name, nla, sizeof(name));
+		index = domain_set_nfnl_get_byname(ctx->net, name, &set);
+		if (index == DSET_INVALID_ID) {
+			err = -ENOENT;
+			goto err;
+		}
+		priv->index[priv->nsets++] = index;
+		/* Address sets know nothing of names in other payloads */
+		if (priv->payload != DSET_PAYLOAD_DNS &&
+		    !(set->type->features & (DSET_TYPE_DOMAIN |
+					     DSET_TYPE_NAME))) {
+			err = -EOPNOTSUPP;
+			goto err;
+		}
+	}
+	if (!priv->nsets)
+		return -EINVAL;
+
+	return 0;
+
+err:
+	nft_dset_put_sets(priv);
+	return err;
+}
+
+static void
+nft_dset_destroy(const struct nft_ctx *ctx, const struct nft_expr *expr)
+{
+	struct nft_dset *priv = nft_expr_priv(expr);
+
+	nft_dset_put_sets(priv);
+}
+
+static int
+nft_dset_dump(NFT_DUMP_ARGS)
+{
+	const struct nft_dset *priv = nft_expr_priv(expr);
+	char name[DSET_MAXNAMELEN];
+	struct nlattr *nest;
+	u8 i;
+
+	nest = nla_nest_start(skb, NFTA_DSET_SETS);
+	if (!nest)
+		goto nla_put_failure;
+	for (i = 0; i < priv->nsets; i++) {
+		domain_set_name_byindex(priv->net, priv->index[i], name);
+		if (nla_put_string(skb, NFTA_DSET_SET_NAME, name))
+			goto nla_put_failure;
+	}
+	nla_nest_end(skb, nest);
+
+	if (priv->has_dreg &&
+	    nft_dump_register(skb, NFTA_DSET_DREG, priv->dreg))
+		goto nla_put_failure;
+	if (nla_put_be32(skb, NFTA_DSET_FLAGS, htonl(priv->flags)))
+		goto nla_put_failure;
+	if ((priv->cmdflags & DSET_FLAG_MATCH_CATEGORY) &&
+	    nla_put_be32(skb, NFTA_DSET_CATEGORY, htonl(priv->category)))
+		goto nla_put_failure;
+	if (priv->payload &&
+	    nla_put_be32(skb, NFTA_DSET_PAYLOAD, htonl(priv->payload)))
+		goto nla_put_failure;
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+static struct nft_expr_type nft_dset_type;
+static const struct nft_expr_ops nft_dset_ops = {
+	.type = &nft_dset_type,
+	.size = NFT_EXPR_SIZE(sizeof(struct nft_dset)),
+	.eval = nft_dset_eval,
+	.init = nft_dset_init,
+	.destroy = nft_dset_destroy,
+	.dump = nft_dset_dump,
+};
+
+static struct nft_expr_type nft_dset_type __read_mostly = {
+	.name = "dset",
+	.ops = &nft_dset_ops,
+	.policy = nft_dset_policy,
+	.maxattr = NFTA_DSET_MAX,
+	.owner = THIS_MODULE,
+};
+
+static int __init nft_dset_module_init(void)
+{
+	return nft_register_expr(&nft_dset_type);
+}
+
+static void __exit nft_dset_module_exit(void)
+{
+	nft_unregister_expr(&nft_dset_type);
+}
+
+module_init(nft_dset_module_init);
+module_exit(nft_dset_module_exit);
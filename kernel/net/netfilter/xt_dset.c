@@ -8,6 +8,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/netdevice.h>
 #include <linux/skbuff.h>
 
 #include <linux/netfilter/x_tables.h>
@@ -16,7 +17,7 @@
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Bin Cheng <cbdog94@gmail.com>");
-MODULE_DESCRIPTION("Xtables: domain set match");
+MODULE_DESCRIPTION("Xtables: domain set match and target module");
 MODULE_ALIAS("xt_DSET");
 MODULE_ALIAS("ipt_dset");
 MODULE_ALIAS("ebt_dset");
@@ -115,7 +116,96 @@ dset_match_v0(const struct sk_buff *skb, CONST struct xt_action_param *par)
 					  info->match_set.flags & DSET_INV_MATCH);
 }
 
-/* Revision 0 interface: backward compatible with netfilter/iptables */
+/* Revision 1 match: category support. The first members match the
+ * revision 0 layout, so checkentry and destroy are shared.
+ */
+
+static bool
+dset_match_v1(const struct sk_buff *skb, CONST struct xt_action_param *par)
+{
+	const struct xt_dset_info_match_v1 *info = par->matchinfo;
+
+	ADT_OPT(opt, XT_FAMILY(par), info->match_set.dim,
+			info->match_set.flags, info->flags, UINT_MAX,
+			info->packets.value, info->bytes.value,
+			info->packets.op, info->bytes.op);
+
+	if (info->packets.op != DSET_COUNTER_NONE ||
+		info->bytes.op != DSET_COUNTER_NONE)
+		opt.cmdflags |= DSET_FLAG_MATCH_COUNTERS;
+	/* The mask is passed in and the matching category returned */
+	if (info->flags & DSET_FLAG_MATCH_CATEGORY)
+		opt.ext.category = info->category;
+
+	return match_dset(info->match_set.index, skb, par, &opt,
+					  info->match_set.flags & DSET_INV_MATCH);
+}
+
+/* Revision 2 match: the name is extracted from the TLS ClientHello or
+ * other application payloads instead of a DNS message. The first
+ * members match the revision 1 layout.
+ */
+
+static FTYPE
+dset_match_v2_checkentry(const struct xt_mtchk_param *par)
+{
+	const struct xt_dset_info_match_v2 *info = par->matchinfo;
+	u16 features;
+	FTYPE ret;
+
+	if (info->payload > DSET_PAYLOAD_MAX)
+	{
+		pr_warn("Protocol error: unknown payload %u to match\n",
+				info->payload);
+		return CHECK_FAIL(-EINVAL);
+	}
+
+	ret = dset_match_v0_checkentry(par);
+	if (ret != CHECK_OK)
+		return ret;
+
+	/* The address sets match the packet address and learn from DNS
+	 * messages only, a name in another payload means nothing to them
+	 */
+	features = domain_set_features_byindex(XT_PAR_NET(par),
+										   info->match_set.index);
+	if (info->payload != DSET_PAYLOAD_DNS &&
+		!(features & (DSET_TYPE_DOMAIN | DSET_TYPE_NAME)))
+	{
+		pr_warn("Set identified by id %u cannot match payload %u\n",
+				info->match_set.index, info->payload);
+		domain_set_nfnl_put(XT_PAR_NET(par), info->match_set.index);
+		return CHECK_FAIL(-EINVAL);
+	}
+
+	return CHECK_OK;
+}
+
+static bool
+dset_match_v2(const struct sk_buff *skb, CONST struct xt_action_param *par)
+{
+	const struct xt_dset_info_match_v2 *info = par->matchinfo;
+
+	ADT_OPT(opt, XT_FAMILY(par), info->match_set.dim,
+			info->match_set.flags, info->flags, UINT_MAX,
+			info->packets.value, info->bytes.value,
+			info->packets.op, info->bytes.op);
+
+	if (info->packets.op != DSET_COUNTER_NONE ||
+		info->bytes.op != DSET_COUNTER_NONE)
+		opt.cmdflags |= DSET_FLAG_MATCH_COUNTERS;
+	if (info->flags & DSET_FLAG_MATCH_CATEGORY)
+		opt.ext.category = info->category;
+	opt.payload = info->payload;
+
+	return match_dset(info->match_set.index, skb, par, &opt,
+					  info->match_set.flags & DSET_INV_MATCH);
+}
+
+/* DSET target: add or delete the queried domain (or the learned answers)
+ * to/from the add_set/del_set, and in revision 1 map the set extensions
+ * of the matching element onto the packet.
+ */
 
 #ifdef HAVE_XT_TARGET_PARAM
 #undef xt_action_param
@@ -125,6 +215,217 @@ dset_match_v0(const struct sk_buff *skb, CONST struct xt_action_param *par)
 #define CAST_TO_MATCH
 #endif
 
+static void
+dset_target_add_del(struct sk_buff *skb, const struct xt_action_param *par,
+					const struct xt_dset_info *add_set,
+					const struct xt_dset_info *del_set,
+					u32 flags, u32 timeout)
+{
+	ADT_OPT(add_opt, XT_FAMILY(par), add_set->dim,
+			add_set->flags, flags, timeout,
+			0, 0, 0, 0);
+	ADT_OPT(del_opt, XT_FAMILY(par), del_set->dim,
+			del_set->flags, flags & DSET_FLAG_LEARN_ANSWERS, UINT_MAX,
+			0, 0, 0, 0);
+
+	/* Normalize to fit into jiffies */
+	if (add_opt.ext.timeout != DSET_NO_TIMEOUT &&
+		add_opt.ext.timeout > DSET_MAX_TIMEOUT)
+		add_opt.ext.timeout = DSET_MAX_TIMEOUT;
+	if (add_set->index != DSET_INVALID_ID)
+		domain_set_add(add_set->index, skb, CAST_TO_MATCH par,
+					   &add_opt);
+	if (del_set->index != DSET_INVALID_ID)
+		domain_set_del(del_set->index, skb, CAST_TO_MATCH par,
+					   &del_opt);
+}
+
+static int
+dset_target_get(struct net *net, const struct xt_dset_info *set,
+				const char *what, bool writable)
+{
+	domain_set_id_t index;
+
+	if (set->index == DSET_INVALID_ID)
+		return 0;
+
+	index = domain_set_nfnl_get_byindex(net, set->index);
+	if (index == DSET_INVALID_ID)
+	{
+		pr_warn("Cannot find %s index %u as target\n",
+				what, set->index);
+		return -ENOENT;
+	}
+	if (set->dim > DSET_DIM_MAX)
+	{
+		pr_warn("Protocol error: DSET target dimension is over the limit!\n");
+		domain_set_nfnl_put(net, set->index);
+		return -ERANGE;
+	}
+	if (writable && domain_set_attached_byindex(net, set->index))
+	{
+		pr_warn("Attached set index %u is read-only, cannot be used as %s\n",
+				set->index, what);
+		domain_set_nfnl_put(net, set->index);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static void
+dset_target_put(struct net *net, const struct xt_dset_info *set)
+{
+	if (set->index != DSET_INVALID_ID)
+		domain_set_nfnl_put(net, set->index);
+}
+
+static unsigned int
+dset_target_v0(struct sk_buff *skb, const struct xt_action_param *par)
+{
+	const struct xt_dset_info_target_v0 *info = par->targinfo;
+
+	dset_target_add_del(skb, par, &info->add_set, &info->del_set,
+						info->flags, info->timeout);
+
+	return XT_CONTINUE;
+}
+
+static FTYPE
+dset_target_v0_checkentry(const struct xt_tgchk_param *par)
+{
+	const struct xt_dset_info_target_v0 *info = par->targinfo;
+	int ret;
+
+	ret = dset_target_get(XT_PAR_NET(par), &info->add_set, "add_set",
+						  true);
+	if (ret)
+		return CHECK_FAIL(ret);
+	ret = dset_target_get(XT_PAR_NET(par), &info->del_set, "del_set",
+						  true);
+	if (ret)
+	{
+		dset_target_put(XT_PAR_NET(par), &info->add_set);
+		return CHECK_FAIL(ret);
+	}
+
+	return CHECK_OK;
+}
+
+static void
+dset_target_v0_destroy(const struct xt_tgdtor_param *par)
+{
+	const struct xt_dset_info_target_v0 *info = par->targinfo;
+
+	dset_target_put(XT_PAR_NET(par), &info->add_set);
+	dset_target_put(XT_PAR_NET(par), &info->del_set);
+}
+
+/* Revision 1: category and skbinfo mapping */
+
+#define DSET_TARGET_MAP_FLAGS \
+	(DSET_FLAG_MAP_CATEGORY | DSET_FLAG_MAP_SKBMARK | \
+	 DSET_FLAG_MAP_SKBPRIO | DSET_FLAG_MAP_SKBQUEUE)
+
+static unsigned int
+dset_target_v1(struct sk_buff *skb, const struct xt_action_param *par)
+{
+	const struct xt_dset_info_target_v1 *info = par->targinfo;
+
+	ADT_OPT(map_opt, XT_FAMILY(par), info->map_set.dim,
+			info->map_set.flags, info->flags, UINT_MAX,
+			0, 0, 0, 0);
+
+	dset_target_add_del(skb, par, &info->add_set, &info->del_set,
+						info->flags & (DSET_FLAG_EXIST |
+									   DSET_FLAG_LEARN_ANSWERS),
+						info->timeout);
+
+	if (info->map_set.index == DSET_INVALID_ID)
+		return XT_CONTINUE;
+
+	/* The category and skbinfo of the matching element are
+	 * returned in map_opt
+	 */
+	if (!match_dset(info->map_set.index, skb, CAST_TO_MATCH par,
+					&map_opt, info->map_set.flags & DSET_INV_MATCH))
+		return XT_CONTINUE;
+
+	if (info->flags & DSET_FLAG_MAP_CATEGORY)
+		skb->mark = (skb->mark & ~info->map_mask) |
+					(map_opt.ext.category & info->map_mask);
+	if (info->flags & DSET_FLAG_MAP_SKBMARK)
+		skb->mark = (skb->mark & ~map_opt.ext.skbinfo.skbmarkmask) ^
+					map_opt.ext.skbinfo.skbmark;
+	if (info->flags & DSET_FLAG_MAP_SKBPRIO)
+		skb->priority = map_opt.ext.skbinfo.skbprio;
+	if ((info->flags & DSET_FLAG_MAP_SKBQUEUE) &&
+		skb->dev &&
+		skb->dev->real_num_tx_queues > map_opt.ext.skbinfo.skbqueue)
+		skb_set_queue_mapping(skb, map_opt.ext.skbinfo.skbqueue);
+
+	return XT_CONTINUE;
+}
+
+static FTYPE
+dset_target_v1_checkentry(const struct xt_tgchk_param *par)
+{
+	const struct xt_dset_info_target_v1 *info = par->targinfo;
+	int ret;
+
+	if ((info->flags & DSET_TARGET_MAP_FLAGS) &&
+		info->map_set.index == DSET_INVALID_ID)
+	{
+		pr_warn("Protocol error: mapping requires a map_set\n");
+		return CHECK_FAIL(-EINVAL);
+	}
+	if ((info->flags & DSET_TARGET_MAP_FLAGS) &&
+		strcmp(par->table, "mangle") != 0)
+	{
+		pr_warn("mapping is allowed only from the mangle table\n");
+		return CHECK_FAIL(-EINVAL);
+	}
+	if ((info->flags & (DSET_FLAG_MAP_SKBPRIO | DSET_FLAG_MAP_SKBQUEUE)) &&
+		(par->hook_mask & ~(1 << NF_INET_FORWARD |
+							1 << NF_INET_LOCAL_OUT |
+							1 << NF_INET_POST_ROUTING)))
+	{
+		pr_warn("mapping of prio or/and queue is allowed only "
+				"from OUTPUT/FORWARD/POSTROUTING chains\n");
+		return CHECK_FAIL(-EINVAL);
+	}
+
+	ret = dset_target_get(XT_PAR_NET(par), &info->add_set, "add_set",
+						  true);
+	if (ret)
+		return CHECK_FAIL(ret);
+	ret = dset_target_get(XT_PAR_NET(par), &info->del_set, "del_set",
+						  true);
+	if (ret)
+		goto put_add;
+	ret = dset_target_get(XT_PAR_NET(par), &info->map_set, "map_set",
+						  false);
+	if (ret)
+		goto put_del;
+
+	return CHECK_OK;
+
+put_del:
+	dset_target_put(XT_PAR_NET(par), &info->del_set);
+put_add:
+	dset_target_put(XT_PAR_NET(par), &info->add_set);
+	return CHECK_FAIL(ret);
+}
+
+static void
+dset_target_v1_destroy(const struct xt_tgdtor_param *par)
+{
+	const struct xt_dset_info_target_v1 *info = par->targinfo;
+
+	dset_target_put(XT_PAR_NET(par), &info->add_set);
+	dset_target_put(XT_PAR_NET(par), &info->del_set);
+	dset_target_put(XT_PAR_NET(par), &info->map_set);
+}
+
 static struct xt_match set_matches[] __read_mostly = {
 	{.name = "dset",
 	 .family = NFPROTO_UNSPEC,
@@ -133,16 +434,62 @@ static struct xt_match set_matches[] __read_mostly = {
 	 .matchsize = sizeof(struct xt_dset_info_match_v0),
 	 .checkentry = dset_match_v0_checkentry,
 	 .destroy = dset_match_v0_destroy,
+	 .me = THIS_MODULE},
+	{.name = "dset",
+	 .family = NFPROTO_UNSPEC,
+	 .revision = 1,
+	 .match = dset_match_v1,
+	 .matchsize = sizeof(struct xt_dset_info_match_v1),
+	 .checkentry = dset_match_v0_checkentry,
+	 .destroy = dset_match_v0_destroy,
+	 .me = THIS_MODULE},
+	{.name = "dset",
+	 .family = NFPROTO_UNSPEC,
+	 .revision = 2,
+	 .match = dset_match_v2,
+	 .matchsize = sizeof(struct xt_dset_info_match_v2),
+	 .checkentry = dset_match_v2_checkentry,
+	 .destroy = dset_match_v0_destroy,
+	 .me = THIS_MODULE}};
+
+/* The target adds or deletes the queried names of DNS messages */
+static struct xt_target set_targets[] __read_mostly = {
+	{.name = "DSET",
+	 .family = NFPROTO_UNSPEC,
+	 .revision = 0,
+	 .target = dset_target_v0,
+	 .targetsize = sizeof(struct xt_dset_info_target_v0),
+	 .checkentry = dset_target_v0_checkentry,
+	 .destroy = dset_target_v0_destroy,
+	 .me = THIS_MODULE},
+	{.name = "DSET",
+	 .family = NFPROTO_UNSPEC,
+	 .revision = 1,
+	 .target = dset_target_v1,
+	 .targetsize = sizeof(struct xt_dset_info_target_v1),
+	 .checkentry = dset_target_v1_checkentry,
+	 .destroy = dset_target_v1_destroy,
 	 .me = THIS_MODULE}};
 
 static int __init xt_set_init(void)
 {
-	return xt_register_matches(set_matches, ARRAY_SIZE(set_matches));
+	int ret = xt_register_matches(set_matches, ARRAY_SIZE(set_matches));
+
+	if (!ret)
+	{
+		ret = xt_register_targets(set_targets,
+								  ARRAY_SIZE(set_targets));
+		if (ret)
+			xt_unregister_matches(set_matches,
+								  ARRAY_SIZE(set_matches));
+	}
+	return ret;
 }
 
 static void __exit xt_set_fini(void)
 {
 	xt_unregister_matches(set_matches, ARRAY_SIZE(set_matches));
+	xt_unregister_targets(set_targets, ARRAY_SIZE(set_targets));
 }
 
 module_init(xt_set_init);
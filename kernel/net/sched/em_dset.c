@@ -14,10 +14,10 @@
 #include <linux/kernel.h>
 #include <linux/string.h>
 #include <linux/skbuff.h>
-#include <linux/netfilter/xt_dset.h>
-#include <linux/netfilter/dset/domain_set_compat.h>
-#include <linux/ipv6.h>
-#include <net/ip.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/dset/domain_set.h>
+#include <linux/netfilter/dset/domain_set_dns.h>
+#include <uapi/linux/netfilter/xt_dset.h>
 #include <net/pkt_cls.h>
 
 #ifdef HAVE_TCF_EMATCH_OPS_CHANGE_ARG_NET
@@ -28,7 +28,7 @@ static int em_dset_change(struct tcf_proto *tp, void *data, int data_len,
 			   struct tcf_ematch *em)
 #endif
 {
-	struct xt_set_info *set = data;
+	struct xt_dset_info *set = data;
 	domain_set_id_t index;
 #ifndef HAVE_TCF_EMATCH_OPS_CHANGE_ARG_NET
 	struct net *net = dev_net(qdisc_dev(tp->q));
@@ -56,7 +56,7 @@ static void em_dset_destroy(struct tcf_ematch *em)
 static void em_dset_destroy(struct tcf_proto *p, struct tcf_ematch *em)
 #endif
 {
-	const struct xt_set_info *set = (const void *) em->data;
+	const struct xt_dset_info *set = (const void *) em->data;
 
 	if (set) {
 #ifdef HAVE_TCF_EMATCH_STRUCT_NET
@@ -69,88 +69,45 @@ static void em_dset_destroy(struct tcf_proto *p, struct tcf_ematch *em)
 }
 
 static int em_dset_match(struct sk_buff *skb, struct tcf_ematch *em,
-			  struct tcf_pkt_info *info)
+			 struct tcf_pkt_info *info)
 {
-	struct domain_set_adt_opt opt;
-	struct xt_action_param acpar;
-	const struct xt_set_info *set = (const void *) em->data;
-	struct net_device *dev, *indev = NULL;
-#ifdef HAVE_STATE_IN_XT_ACTION_PARAM
-	struct nf_hook_state state = {
-		.net	= em->net,
+	const struct xt_dset_info *set = (const void *) em->data;
+	struct dset_dns_msg msg;
+	struct domain_set_adt_opt opt = {
+		.dim = set->dim,
+		.flags = set->flags,
+		.ext.timeout = ~0u,
 	};
-#endif
-	int ret, network_offset;
-
-#ifdef HAVE_STATE_IN_XT_ACTION_PARAM
-#define ACPAR_FAMILY(f)		state.pf = f
+#ifdef HAVE_TCF_EMATCH_STRUCT_NET
+	struct net *net = em->net;
 #else
-#define ACPAR_FAMILY(f)		acpar.family = f
+	struct net *net = dev_net(skb->dev);
 #endif
+
 	switch (tc_skb_protocol(skb)) {
 	case htons(ETH_P_IP):
-		ACPAR_FAMILY(NFPROTO_IPV4);
-		if (!pskb_network_may_pull(skb, sizeof(struct iphdr)))
-			return 0;
-		acpar.thoff = ip_hdrlen(skb);
+		opt.family = NFPROTO_IPV4;
 		break;
 	case htons(ETH_P_IPV6):
-		ACPAR_FAMILY(NFPROTO_IPV6);
-		if (!pskb_network_may_pull(skb, sizeof(struct ipv6hdr)))
-			return 0;
-		/* doesn't call ipv6_find_hdr() because dset doesn't use
-		 * thoff, yet
-		 */
-		acpar.thoff = sizeof(struct ipv6hdr);
+		opt.family = NFPROTO_IPV6;
 		break;
 	default:
 		return 0;
 	}
 
-#ifdef HAVE_STATE_IN_XT_ACTION_PARAM
-	opt.family = state.pf;
-#else
-	acpar.hooknum = 0;
-
-	opt.family = acpar.family;
-#endif
-	opt.dim = set->dim;
-	opt.flags = set->flags;
-	opt.cmdflags = 0;
-	opt.ext.timeout = ~0u;
-
-	network_offset = skb_network_offset(skb);
-	skb_pull(skb, network_offset);
-
-	dev = skb->dev;
-
-	rcu_read_lock();
-
-	if (skb->skb_iif)
-#ifdef HAVE_TCF_EMATCH_STRUCT_NET
-		indev = dev_get_by_index_rcu(em->net, skb->skb_iif);
-#else
-		indev = dev_get_by_index_rcu(dev_net(dev), skb->skb_iif);
-#endif
-
-#ifdef HAVE_STATE_IN_XT_ACTION_PARAM
-	state.in      = indev ? indev : dev;
-	state.out     = dev;
-	acpar.state   = &state;
-#else
-#ifdef HAVE_NET_IN_XT_ACTION_PARAM
-	acpar.net     = em->net;
-#endif
-	acpar.in      = indev ? indev : dev;
-	acpar.out     = dev;
-#endif /* HAVE_STATE_IN_XT_ACTION_PARAM */
-
-	ret = domain_set_test(set->index, skb, &acpar, &opt);
+	/* The message is located by offsets from the network header,
+	 * the skb is neither pulled nor modified.
+	 */
+	if (domain_set_dns_locate(skb, opt.family, &msg) < 0)
+		return 0;
 
-	rcu_read_unlock();
+	/* A TCP segment may carry several messages */
+	do {
+		if (domain_set_test_dns(net, set->index, &msg, &opt))
+			return 1;
+	} while (domain_set_dns_next(&msg) == 0);
 
-	skb_push(skb, network_offset);
-	return ret;
+	return 0;
 }
 
 static struct tcf_ematch_ops em_dset_ops = {
@@ -166,6 +166,30 @@ static const struct dset_arg dset_args[] = {
 		.print = dset_print_number,
 		.help = "[skbqueue VALUE]",
 	},
+	[DSET_ARG_CATEGORIES] = {
+		.name = {"categories", NULL},
+		.has_arg = DSET_NO_ARG,
+		.opt = DSET_OPT_CATEGORIES,
+		.parse = dset_parse_flag,
+		.print = dset_print_flag,
+		.help = "[categories]",
+	},
+	[DSET_ARG_CATEGORY] = {
+		.name = {"category", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.opt = DSET_OPT_CATEGORY,
+		.parse = dset_parse_uint32,
+		.print = dset_print_number,
+		.help = "[category VALUE]",
+	},
+	[DSET_ARG_ELEMENTS] = {
+		.name = {"elements", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.opt = DSET_OPT_ELEMENTS,
+		.parse = dset_parse_uint32,
+		.print = dset_print_number,
+		.help = "[elements VALUE]",
+	},
 };
 
 const struct dset_arg *
@@ -35,8 +35,13 @@ struct dset_data
 	uint32_t cadt_flags; /* data level flags */
 	uint32_t timeout;
 	char domaindata[DSET_MAX_DOMAIN_LEN];
+	struct dset_ipaddr ip;
 
 	uint16_t index;
+	uint64_t generation;
+	/* Shared sets */
+	char netns[DSET_MAXNAMELEN];
+	char link[DSET_MAXNAMELEN];
 	union {
 		/* RENAME/SWAP */
 		char setname2[DSET_MAXNAMELEN];
@@ -70,6 +75,7 @@ struct dset_data
 			uint64_t skbmark;
 			uint32_t skbprio;
 			uint16_t skbqueue;
+			uint32_t category;
 		} adt;
 	};
 };
@@ -234,12 +240,26 @@ int dset_data_set(struct dset_data *data, enum dset_opt opt, const void *value)
 					 DSET_MAX_DOMAIN_LEN);
 		D("domain set to %s", data->domaindata);
 		break;
+	case DSET_OPT_IP:
+		memcpy(&data->ip, value, sizeof(data->ip));
+		break;
 	case DSET_OPT_TIMEOUT:
 		data->timeout = *(const uint32_t *)value;
 		break;
 	case DSET_OPT_INDEX:
 		data->index = *(const uint16_t *)value;
 		break;
+	case DSET_OPT_GENERATION:
+		data->generation = *(const uint64_t *)value;
+		break;
+	case DSET_OPT_NETNS:
+		dset_strlcpy(data->netns, value, DSET_MAXNAMELEN);
+		break;
+	case DSET_OPT_PUBLISHED:
+		break;
+	case DSET_OPT_LINK:
+		dset_strlcpy(data->link, value, DSET_MAXNAMELEN);
+		break;
 	/* Create-specific options */
 	case DSET_OPT_GC:
 		data->create.gc = *(const uint32_t *)value;
@@ -271,6 +291,9 @@ int dset_data_set(struct dset_data *data, enum dset_opt opt, const void *value)
 	case DSET_OPT_SKBINFO:
 		cadt_flag_type_attr(data, opt, DSET_FLAG_WITH_SKBINFO);
 		break;
+	case DSET_OPT_CATEGORIES:
+		cadt_flag_type_attr(data, opt, DSET_FLAG_WITH_CATEGORY);
+		break;
 	/* Create-specific options, filled out by the kernel */
 	case DSET_OPT_ELEMENTS:
 		data->create.elements = *(const uint32_t *)value;
@@ -318,6 +341,9 @@ int dset_data_set(struct dset_data *data, enum dset_opt opt, const void *value)
 	case DSET_OPT_SKBQUEUE:
 		data->adt.skbqueue = *(const uint16_t *)value;
 		break;
+	case DSET_OPT_CATEGORY:
+		data->adt.category = *(const uint32_t *)value;
+		break;
 	/* Swap/rename */
 	case DSET_OPT_SETNAME2:
 		dset_strlcpy(data->setname2, value, DSET_MAXNAMELEN);
@@ -358,6 +384,9 @@ int dset_data_set(struct dset_data *data, enum dset_opt opt, const void *value)
 		if (data->cadt_flags & DSET_FLAG_WITH_SKBINFO)
 			dset_data_flags_set(data,
 								DSET_FLAG(DSET_OPT_SKBINFO));
+		if (data->cadt_flags & DSET_FLAG_WITH_CATEGORY)
+			dset_data_flags_set(data,
+								DSET_FLAG(DSET_OPT_CATEGORIES));
 		break;
 	default:
 		return -1;
@@ -402,11 +431,19 @@ dset_data_get(const struct dset_data *data, enum dset_opt opt)
 		return &data->family;
 	case DSET_OPT_DOMAIN:
 		return data->domaindata;
+	case DSET_OPT_IP:
+		return &data->ip;
 	/* CADT options */
 	case DSET_OPT_TIMEOUT:
 		return &data->timeout;
 	case DSET_OPT_INDEX:
 		return &data->index;
+	case DSET_OPT_GENERATION:
+		return &data->generation;
+	case DSET_OPT_NETNS:
+		return data->netns;
+	case DSET_OPT_LINK:
+		return data->link;
 	/* Create-specific options */
 	case DSET_OPT_GC:
 		return &data->create.gc;
@@ -449,6 +486,8 @@ dset_data_get(const struct dset_data *data, enum dset_opt opt)
 		return &data->adt.skbprio;
 	case DSET_OPT_SKBQUEUE:
 		return &data->adt.skbqueue;
+	case DSET_OPT_CATEGORY:
+		return &data->adt.category;
 	/* Swap/rename */
 	case DSET_OPT_SETNAME2:
 		return data->setname2;
@@ -464,6 +503,7 @@ dset_data_get(const struct dset_data *data, enum dset_opt opt)
 	case DSET_OPT_CREATE_COMMENT:
 	case DSET_OPT_FORCEADD:
 	case DSET_OPT_SKBINFO:
+	case DSET_OPT_CATEGORIES:
 		return &data->cadt_flags;
 	default:
 		return NULL;
@@ -486,12 +526,16 @@ dset_data_sizeof(enum dset_opt opt, uint8_t family)
 	{
 	case DSET_OPT_DOMAIN:
 		return DSET_MAX_DOMAIN_LEN;
+	case DSET_OPT_IP:
+		return sizeof(struct dset_ipaddr);
 	case DSET_OPT_SKBQUEUE:
 	case DSET_OPT_INDEX:
 		return sizeof(uint16_t);
 	case DSET_SETNAME:
 	case DSET_OPT_NAME:
 	case DSET_OPT_NAMEREF:
+	case DSET_OPT_NETNS:
+	case DSET_OPT_LINK:
 		return DSET_MAXNAMELEN;
 	case DSET_OPT_TIMEOUT:
 	case DSET_OPT_GC:
@@ -502,10 +546,12 @@ dset_data_sizeof(enum dset_opt opt, uint8_t family)
 	case DSET_OPT_REFERENCES:
 	case DSET_OPT_MEMSIZE:
 	case DSET_OPT_SKBPRIO:
+	case DSET_OPT_CATEGORY:
 		return sizeof(uint32_t);
 	case DSET_OPT_PACKETS:
 	case DSET_OPT_BYTES:
 	case DSET_OPT_SKBMARK:
+	case DSET_OPT_GENERATION:
 		return sizeof(uint64_t);
 	case DSET_OPT_PROBES:
 	case DSET_OPT_RESIZE:
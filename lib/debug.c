@@ -51,6 +51,7 @@ static const struct dset_attrname adtattr2name[] = {
 	[DSET_ATTR_SKBMARK] = {.name = "SKBMARK"},
 	[DSET_ATTR_SKBPRIO] = {.name = "SKBPRIO"},
 	[DSET_ATTR_SKBQUEUE] = {.name = "SKBQUEUE"},
+	[DSET_ATTR_CATEGORY] = {.name = "CATEGORY"},
 };
 
 static void
@@ -46,6 +46,9 @@ struct dset
 	char *newargv[MAX_ARGS];
 	int newargc;
 	const char *filename; /* Input/output filename */
+	char bulk[DSET_MAXNAMELEN];	  /* Set under load or sync */
+	struct dset_sync *sync;		  /* Entries of the set under sync */
+	dset_print_outfn print_outfn; /* Output function of the session */
 };
 
 /* Commands and environment options */
@@ -117,6 +120,56 @@ const struct dset_commands dset_commands[] = {
 		.help = "\n"
 				"        Restore a saved state",
 	},
+	{
+		/* sy[nc] */
+		.cmd = DSET_CMD_SYNC,
+		.name = {"sync", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.help = "SETNAME\n"
+				"        Add and delete the entries which differ between\n"
+				"        the saved entries of a set and the set",
+	},
+	{
+		/* lo[ad] */
+		.cmd = DSET_CMD_LOAD,
+		.name = {"load", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.help = "SETNAME [elements N]\n"
+				"        Load the saved entries of a set off to the side\n"
+				"        and replace the content of the set at once",
+	},
+	{
+		/* sn[apshot] */
+		.cmd = DSET_CMD_SNAPSHOT,
+		.name = {"snapshot", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.help = "SETNAME\n"
+				"        Save the binary image of a set to stdout",
+	},
+	{
+		/* i[mport] */
+		.cmd = DSET_CMD_IMPORT,
+		.name = {"import", NULL},
+		.has_arg = DSET_OPTIONAL_ARG,
+		.help = "[SETNAME]\n"
+				"        Replace the content of a set with a saved image",
+	},
+	{
+		/* m[onitor] */
+		.cmd = DSET_CMD_MONITOR,
+		.name = {"monitor", NULL},
+		.has_arg = DSET_NO_ARG,
+		.help = "\n"
+				"        Print the changes of the sets as they happen",
+	},
+	{
+		/* ch[anges] */
+		.cmd = DSET_CMD_CHANGES,
+		.name = {"changes", NULL},
+		.has_arg = DSET_MANDATORY_ARG2,
+		.help = "SETNAME GENERATION\n"
+				"        Print the changes of a set since a generation",
+	},
 	{
 		/* f[lush], --flush, -F */
 		.cmd = DSET_CMD_FLUSH,
@@ -141,6 +194,31 @@ const struct dset_commands dset_commands[] = {
 		.help = "FROM-SETNAME TO-SETNAME\n"
 				"        Swap the contect of two existing sets",
 	},
+	{
+		/* pu[blish] */
+		.cmd = DSET_CMD_PUBLISH,
+		.name = {"publish", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.help = "SETNAME\n"
+				"        Share a set with the other network namespaces",
+	},
+	{
+		/* un[publish] */
+		.cmd = DSET_CMD_UNPUBLISH,
+		.name = {"unpublish", NULL},
+		.has_arg = DSET_MANDATORY_ARG,
+		.help = "SETNAME\n"
+				"        Stop sharing a set",
+	},
+	{
+		/* att[ach] */
+		.cmd = DSET_CMD_ATTACH,
+		.name = {"attach", NULL},
+		.has_arg = DSET_MANDATORY_ARG2,
+		.help = "PUBLISHED-SETNAME SETNAME [netns NAME]\n"
+				"        Attach a set published by the initial or the\n"
+				"        given network namespace read-only under a local name",
+	},
 	{
 		/* h[elp, --help, -H */
 		.cmd = DSET_CMD_HELP,
@@ -281,6 +359,24 @@ const struct dset_envopts dset_envopts[] = {
 				"        When listing, list setnames and set headers\n"
 				"        from kernel only.",
 	},
+	{
+		.name = {"-buffer"},
+		.parse = dset_parse_bufsize,
+		.has_arg = DSET_MANDATORY_ARG,
+		.flag = DSET_OPT_MAX,
+		.help = "bytes\n"
+				"        Size of the messages the elements are sent\n"
+				"        to the kernel in by restore.",
+	},
+	{
+		.name = {"-window"},
+		.parse = dset_parse_window,
+		.has_arg = DSET_MANDATORY_ARG,
+		.flag = DSET_OPT_MAX,
+		.help = "messages\n"
+				"        Number of messages restore sends before\n"
+				"        waiting for the acknowledgement of the first.",
+	},
 	{
 		.name = {"-f", "-file"},
 		.parse = dset_parse_filename,
@@ -405,6 +501,71 @@ int dset_parse_output(struct dset *dset,
 					"Syntax error: unknown output mode '%s'", str);
 }
 
+static int
+dset_parse_count(struct dset *dset, const char *str, unsigned long *count)
+{
+	char *end;
+
+	errno = 0;
+	*count = strtoul(str, &end, 10);
+	if (errno || end == str || *end != '\0' || str[0] == '-')
+		return dset_err(dset_session(dset),
+						"Syntax error: '%s' is not a number", str);
+	return 0;
+}
+
+/**
+ * dset_parse_bufsize - parse the size of the kernel messages
+ * @dset: dset structure
+ * @opt: option kind of the data
+ * @str: string to parse
+ *
+ * Parse the "-buffer" option and set the message size of the session.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_parse_bufsize(struct dset *dset,
+					   int opt UNUSED, const char *str)
+{
+	unsigned long bufsize;
+
+	assert(dset);
+	assert(str);
+
+	if (dset_parse_count(dset, str, &bufsize) < 0)
+		return -1;
+	if (bufsize > DSET_BUFSIZE_MAX)
+		bufsize = DSET_BUFSIZE_MAX + 1;
+
+	return dset_session_bufsize(dset_session(dset), bufsize);
+}
+
+/**
+ * dset_parse_window - parse the number of pipelined messages
+ * @dset: dset structure
+ * @opt: option kind of the data
+ * @str: string to parse
+ *
+ * Parse the "-window" option and set the window of the session.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_parse_window(struct dset *dset,
+					  int opt UNUSED, const char *str)
+{
+	unsigned long window;
+
+	assert(dset);
+	assert(str);
+
+	if (dset_parse_count(dset, str, &window) < 0)
+		return -1;
+	if (window > DSET_WINDOW_MAX)
+		window = DSET_WINDOW_MAX + 1;
+
+	return dset_session_window(dset_session(dset), window);
+}
+
 /**
  * dset_envopt_parse - parse/set environment option
  * @dset: dset structure
@@ -635,6 +796,480 @@ restore(struct dset *dset)
 	return dset_parse_stream(dset, f);
 }
 
+/* Build a new table for the set from the add commands of the stream
+ * and replace the content of the set with it at the end.
+ */
+static int
+load(struct dset *dset, const char *setname)
+{
+	struct dset_session *session = dset_session(dset);
+	void *p = dset_session_printf_private(session);
+	FILE *f = stdin; /* Default from stdin */
+	int ret;
+
+	if (dset->filename)
+	{
+		ret = dset_session_io_normal(session, dset->filename,
+									 DSET_IO_INPUT);
+		if (ret < 0)
+			return ret;
+		f = dset_session_io_stream(session, DSET_IO_INPUT);
+	}
+	ret = dset_session_load(session, DSET_LOAD_BEGIN);
+	if (ret < 0)
+		return dset->standard_error(dset, p);
+
+	dset_strlcpy(dset->bulk, setname, DSET_MAXNAMELEN);
+	ret = dset_parse_stream(dset, f);
+	dset->bulk[0] = '\0';
+	dset->restore_line = 0;
+	if (ret < 0)
+	{
+		dset_session_load(session, DSET_LOAD_ABORT);
+		return ret;
+	}
+
+	ret = dset_session_load(session, DSET_LOAD_COMMIT);
+	if (ret < 0)
+	{
+		dset->standard_error(dset, p);
+		dset_session_load(session, DSET_LOAD_ABORT);
+	}
+	return ret;
+}
+
+/* Sync: the entries of the input and of the set are hashed by their
+ * element, so that only the differences are sent to the kernel.
+ */
+
+#define DSET_SYNC_INIT_BITS 10
+#define DSET_SYNC_KEYLEN 1024
+
+struct dset_sync_entry
+{
+	struct dset_sync_entry *next;
+	char *line;		 /* Add line of the input, NULL if missing there */
+	uint32_t lineno; /* Line number of the add line */
+	uint32_t hash;	 /* Hash of the element */
+	bool kernel;	 /* The set has got the element */
+	bool differ;	 /* ... with other options than the input */
+	char key[];		 /* Element, '\0', options */
+};
+
+struct dset_sync
+{
+	struct dset_sync_entry **bucket;
+	uint8_t bits;
+	uint32_t count;
+};
+
+/* FNV-1a */
+static uint32_t
+sync_hash(const char *elem)
+{
+	uint32_t hash = 2166136261U;
+
+	while (*elem)
+		hash = (hash ^ (uint8_t)*elem++) * 16777619U;
+	return hash;
+}
+
+/* The element and its options in the format of save. As a sync key
+ * the element is terminated by '\0' and only the options which are kept
+ * by the set as they were added are printed: timeouts and counters
+ * change in the set by themselves.
+ */
+static int
+print_entry(char *buf, unsigned int len, const struct dset_data *data,
+			bool key)
+{
+	const struct dset_type *type = dset_data_get(data, DSET_OPT_TYPE);
+	const struct dset_arg *arg;
+	unsigned int offset;
+	int i, size;
+
+	size = dset_print_elem(buf, len, data, DSET_OPT_ELEM, 0);
+	if (size < 0 || (unsigned int)size + 1 >= len)
+		return -1;
+	offset = key ? size + 1 : (unsigned int)size;
+	buf[offset] = '\0';
+	for (i = 0; type->cmd[DSET_ADD].args[i] != DSET_ARG_NONE; i++)
+	{
+		arg = dset_keyword(type->cmd[DSET_ADD].args[i]);
+		if (!(arg->print && dset_data_test(data, arg->opt)) ||
+			(key && (arg->opt == DSET_OPT_TIMEOUT ||
+					 arg->opt == DSET_OPT_PACKETS ||
+					 arg->opt == DSET_OPT_BYTES)))
+			continue;
+		size = snprintf(buf + offset, len - offset, " %s", arg->name[0]);
+		if (size < 0 || (unsigned int)size >= len - offset)
+			return -1;
+		offset += size;
+		if (arg->has_arg == DSET_NO_ARG)
+			continue;
+		size = snprintf(buf + offset, len - offset, " ");
+		if (size < 0 || (unsigned int)size >= len - offset)
+			return -1;
+		offset += size;
+		size = arg->print(buf + offset, len - offset, data, arg->opt, 0);
+		if (size < 0 || (unsigned int)size >= len - offset)
+			return -1;
+		offset += size;
+	}
+	return offset;
+}
+
+static inline const char *
+sync_opts(const char *key)
+{
+	return key + strlen(key) + 1;
+}
+
+static struct dset_sync_entry *
+sync_find(struct dset_sync *sync, const char *key, uint32_t hash)
+{
+	struct dset_sync_entry *e;
+
+	for (e = sync->bucket[hash & ((1U << sync->bits) - 1)]; e; e = e->next)
+		if (e->hash == hash && STREQ(e->key, key))
+			return e;
+	return NULL;
+}
+
+/* Double the buckets when there are more entries than buckets */
+static int
+sync_grow(struct dset_sync *sync)
+{
+	struct dset_sync_entry **bucket, *e, *next;
+	uint32_t i, mask = (1U << (sync->bits + 1)) - 1;
+
+	bucket = calloc(mask + 1, sizeof(*bucket));
+	if (!bucket)
+		return -1;
+	for (i = 0; i < 1U << sync->bits; i++)
+	{
+		for (e = sync->bucket[i]; e; e = next)
+		{
+			next = e->next;
+			e->next = bucket[e->hash & mask];
+			bucket[e->hash & mask] = e;
+		}
+	}
+	free(sync->bucket);
+	sync->bucket = bucket;
+	sync->bits++;
+	return 0;
+}
+
+static struct dset_sync_entry *
+sync_add(struct dset_sync *sync, const char *key, int len, uint32_t hash)
+{
+	struct dset_sync_entry *e;
+	uint32_t i;
+
+	if (sync->count >= 1U << sync->bits && sync->bits < 31 &&
+		sync_grow(sync) < 0)
+		return NULL;
+	e = calloc(1, sizeof(*e) + len + 1);
+	if (!e)
+		return NULL;
+	memcpy(e->key, key, len);
+	e->hash = hash;
+	i = hash & ((1U << sync->bits) - 1);
+	e->next = sync->bucket[i];
+	sync->bucket[i] = e;
+	sync->count++;
+	return e;
+}
+
+static void
+sync_free(struct dset_sync *sync)
+{
+	struct dset_sync_entry *e, *next;
+	uint32_t i;
+
+	if (!sync)
+		return;
+	for (i = 0; sync->bucket && i < 1U << sync->bits; i++)
+	{
+		for (e = sync->bucket[i]; e; e = next)
+		{
+			next = e->next;
+			free(e->line);
+			free(e);
+		}
+	}
+	free(sync->bucket);
+	free(sync);
+}
+
+/* An add line of the input: the parsed entry is in the session data */
+static int
+sync_input(struct dset *dset)
+{
+	struct dset_session *session = dset_session(dset);
+	struct dset_data *data = dset_session_data(session);
+	void *p = dset_session_printf_private(session);
+	struct dset_sync_entry *e;
+	char key[DSET_SYNC_KEYLEN];
+	uint32_t hash;
+	int len;
+
+	len = print_entry(key, sizeof(key), data, true);
+	dset_data_reset(data);
+	if (len < 0)
+		return dset->custom_error(dset, p, DSET_PARAMETER_PROBLEM,
+								  "Entry is too long.");
+	hash = sync_hash(key);
+	e = sync_find(dset->sync, key, hash);
+	if (!e)
+		e = sync_add(dset->sync, key, len, hash);
+	if (!e)
+		return dset->custom_error(dset, p, DSET_OTHER_PROBLEM,
+								  "Cannot allocate memory.");
+	/* The last one of the duplicated entries wins */
+	free(e->line);
+	e->line = strdup(dset->cmdline);
+	if (!e->line)
+		return dset->custom_error(dset, p, DSET_OTHER_PROBLEM,
+								  "Cannot allocate memory.");
+	e->lineno = dset->restore_line;
+	return 0;
+}
+
+/* An element of the set, listed from the kernel */
+static int
+sync_kernel(struct dset_session *session, void *p)
+{
+	struct dset_sync *sync = p;
+	struct dset_sync_entry *e;
+	char key[DSET_SYNC_KEYLEN];
+	uint32_t hash;
+	int len;
+
+	len = print_entry(key, sizeof(key), dset_session_data(session),
+					  true);
+	if (len < 0)
+		return dset_err(session, "Listed entry is too long.");
+	hash = sync_hash(key);
+	e = sync_find(sync, key, hash);
+	if (!e)
+		e = sync_add(sync, key, len, hash);
+	else if (!STREQ(sync_opts(e->key), sync_opts(key)))
+		e->differ = true;
+	if (!e)
+		return dset_err(session, "Cannot allocate memory.");
+	e->kernel = true;
+	return 0;
+}
+
+static int __attribute__((format(printf, 3, 4)))
+sync_discard(struct dset_session *session UNUSED, void *p UNUSED,
+			 const char *fmt UNUSED, ...)
+{
+	return 0;
+}
+
+/* Delete the entries missing from the input, then add the ones which
+ * are missing from the set or differ in their options. Existing entries
+ * are updated by adding them again.
+ */
+static int
+sync_apply(struct dset *dset, struct dset_sync *sync, const char *setname)
+{
+	struct dset_session *session = dset_session(dset);
+	struct dset_sync_entry *e;
+	uint32_t i, lineno = dset->restore_line;
+	int del, ret = 0;
+
+	dset_envopt_set(session, DSET_ENV_EXIST);
+	for (del = 1; del >= 0; del--)
+	{
+		for (i = 0; i < 1U << sync->bits; i++)
+		{
+			for (e = sync->bucket[i]; e; e = e->next)
+			{
+				if (del && !e->line)
+				{
+					snprintf(dset->cmdline, sizeof(dset->cmdline),
+							 "del %s %s\n", setname, e->key);
+					dset->restore_line = ++lineno;
+				}
+				else if (!del && e->line && (!e->kernel || e->differ))
+				{
+					dset_strlcpy(dset->cmdline, e->line,
+								 sizeof(dset->cmdline));
+					dset->restore_line = e->lineno;
+				}
+				else
+					continue;
+				ret = dset_parse_line(dset, dset->cmdline);
+				if (ret < 0)
+					return ret;
+			}
+		}
+	}
+	return dset_commit(session);
+}
+
+/* Make the set hold the entries of the stream: the set is listed and
+ * only the differences are sent to the kernel.
+ */
+static int
+sync_set(struct dset *dset, const char *setname)
+{
+	struct dset_session *session = dset_session(dset);
+	void *p = dset_session_printf_private(session);
+	FILE *f = stdin; /* Default from stdin */
+	struct dset_sync *sync;
+	int ret;
+
+	if (dset->filename)
+	{
+		ret = dset_session_io_normal(session, dset->filename,
+									 DSET_IO_INPUT);
+		if (ret < 0)
+			return ret;
+		f = dset_session_io_stream(session, DSET_IO_INPUT);
+	}
+	/* The set must exist */
+	if (!dset_type_get(session, DSET_CMD_ADD))
+		return dset->standard_error(dset, p);
+	dset_data_reset(dset_session_data(session));
+
+	sync = calloc(1, sizeof(*sync));
+	if (sync)
+		sync->bucket = calloc(1U << DSET_SYNC_INIT_BITS,
+							  sizeof(*sync->bucket));
+	if (!sync || !sync->bucket)
+	{
+		sync_free(sync);
+		return dset->custom_error(dset, p, DSET_OTHER_PROBLEM,
+								  "Cannot allocate memory.");
+	}
+	sync->bits = DSET_SYNC_INIT_BITS;
+
+	/* Hash the add lines of the input */
+	dset->sync = sync;
+	dset_strlcpy(dset->bulk, setname, DSET_MAXNAMELEN);
+	ret = dset_parse_stream(dset, f);
+	dset->bulk[0] = '\0';
+	dset->sync = NULL;
+	if (ret < 0)
+		goto out;
+
+	/* List the set into the hash instead of printing it */
+	ret = dset_parse_setname(session, DSET_SETNAME, setname);
+	if (ret < 0)
+		goto error;
+	dset_session_list_elemfn(session, sync_kernel, sync);
+	dset_session_print_outfn(session, sync_discard, p);
+	ret = dset_cmd(session, DSET_CMD_LIST, 0);
+	dset_session_print_outfn(session, dset->print_outfn, p);
+	dset_session_list_elemfn(session, NULL, NULL);
+	if (ret < 0)
+		goto error;
+
+	ret = sync_apply(dset, sync, setname);
+	if (ret < 0)
+		goto error;
+	goto out;
+
+error:
+	dset->standard_error(dset, p);
+out:
+	sync_free(sync);
+	dset->restore_line = 0;
+	return ret;
+}
+
+/* Monitor: the changes are printed in the format of save, so that
+ * they can be restored elsewhere.
+ */
+static int
+monitor_event(struct dset_session *session, enum dset_cmd cmd, void *p)
+{
+	struct dset_data *data = dset_session_data(session);
+	FILE *f = p;
+	const char *setname = dset_data_test(data, DSET_SETNAME)
+							  ? dset_data_setname(data)
+							  : NULL;
+	const struct dset_type *type;
+	const uint64_t *generation;
+	char entry[DSET_SYNC_KEYLEN];
+
+	switch (cmd)
+	{
+	case DSET_CMD_CREATE:
+		type = dset_data_get(data, DSET_OPT_TYPE);
+		fprintf(f, "create %s %s\n", setname, type->name);
+		break;
+	case DSET_CMD_ADD:
+	case DSET_CMD_DEL:
+		if (print_entry(entry, sizeof(entry), data,
+						false) < 0)
+			return dset_err(session, "Changed entry is too long.");
+		fprintf(f, "%s %s %s\n", cmd == DSET_CMD_ADD ? "add" : "del",
+				setname, entry);
+		break;
+	case DSET_CMD_DESTROY:
+	case DSET_CMD_FLUSH:
+		fprintf(f, "%s%s%s\n",
+				cmd == DSET_CMD_DESTROY ? "destroy" : "flush",
+				setname ? " " : "", setname ? setname : "");
+		break;
+	case DSET_CMD_RENAME:
+	case DSET_CMD_SWAP:
+		fprintf(f, "%s %s %s\n",
+				cmd == DSET_CMD_RENAME ? "rename" : "swap", setname,
+				(const char *)dset_data_get(data, DSET_OPT_SETNAME2));
+		break;
+	case DSET_CMD_PUBLISH:
+	case DSET_CMD_UNPUBLISH:
+		fprintf(f, "%s %s\n",
+				cmd == DSET_CMD_PUBLISH ? "publish" : "unpublish",
+				setname);
+		break;
+	case DSET_CMD_ATTACH:
+		fprintf(f, "attach %s %s", setname,
+				(const char *)dset_data_get(data, DSET_OPT_SETNAME2));
+		if (dset_data_test(data, DSET_OPT_NETNS))
+			fprintf(f, " netns %s",
+					(const char *)dset_data_get(data, DSET_OPT_NETNS));
+		fputc('\n', f);
+		break;
+	case DSET_CMD_LOAD:
+		/* The whole content is replaced */
+		fprintf(f, "# load %s\n", setname);
+		break;
+	case DSET_CMD_CHANGES:
+		/* The changes follow */
+		generation = dset_data_get(data, DSET_OPT_GENERATION);
+		fprintf(f, "# changes %s %llu\n", setname,
+				(unsigned long long)*generation);
+		break;
+	default:
+		return 0;
+	}
+	return fflush(f) == 0 ? 0 : dset_err(session, "Cannot write: %s",
+											 strerror(errno));
+}
+
+static int
+monitor(struct dset *dset)
+{
+	struct dset_session *session = dset_session(dset);
+	void *p = dset_session_printf_private(session);
+	FILE *f = dset_session_io_stream(session, DSET_IO_OUTPUT);
+	int ret;
+
+	ret = dset_session_subscribe(session, monitor_event, f);
+	while (ret == 0)
+		ret = dset_session_receive(session);
+
+	return dset->standard_error(dset, p);
+}
+
 static bool do_parse(const struct dset_arg *arg, bool family)
 {
 	return family != true;
@@ -984,6 +1619,12 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 
 		if (dset->restore_line != 0 &&
 			(command->cmd == DSET_CMD_RESTORE ||
+			 command->cmd == DSET_CMD_LOAD ||
+			 command->cmd == DSET_CMD_SYNC ||
+			 command->cmd == DSET_CMD_SNAPSHOT ||
+			 command->cmd == DSET_CMD_IMPORT ||
+			 command->cmd == DSET_CMD_MONITOR ||
+			 command->cmd == DSET_CMD_CHANGES ||
 			 command->cmd == DSET_CMD_VERSION ||
 			 command->cmd == DSET_CMD_HELP))
 			return dset->custom_error(dset, p,
@@ -991,12 +1632,32 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 									  "Command `%s' is invalid "
 									  "in restore mode.",
 									  command->name[0]);
+		if (dset->bulk[0] != '\0' &&
+			command->cmd != DSET_CMD_CREATE &&
+			command->cmd != DSET_CMD_ADD)
+			return dset->custom_error(dset, p,
+									  DSET_PARAMETER_PROBLEM,
+									  "Command `%s' is invalid "
+									  "in %s mode.",
+									  command->name[0],
+									  dset->sync ? "sync" : "load");
 		if (dset->interactive && command->cmd == DSET_CMD_RESTORE)
 		{
 			printf("Restore command is not supported "
 				   "in interactive mode\n");
 			return 0;
 		}
+		if (dset->interactive &&
+			(command->cmd == DSET_CMD_LOAD ||
+			 command->cmd == DSET_CMD_SYNC ||
+			 command->cmd == DSET_CMD_IMPORT ||
+			 command->cmd == DSET_CMD_MONITOR))
+		{
+			printf("%s command is not supported "
+				   "in interactive mode\n",
+				   command->cmd == DSET_CMD_LOAD ? "Load" : command->cmd == DSET_CMD_SYNC ? "Sync" : command->cmd == DSET_CMD_IMPORT ? "Import" : "Monitor");
+			return 0;
+		}
 
 		/* Shift off matched command arg */
 		dset_shift_argv(&argc, argv, 1);
@@ -1162,6 +1823,17 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 	switch (cmd)
 	{
 	case DSET_CMD_CREATE:
+		/* The saved header of the loaded set: it exists already */
+		if (dset->bulk[0] != '\0')
+		{
+			if (STREQ(arg0, dset->bulk))
+				return 0;
+			return dset->custom_error(dset, p,
+									  DSET_PARAMETER_PROBLEM,
+									  "Set %s cannot be created "
+									  "in %s mode.",
+									  arg0, dset->sync ? "sync" : "load");
+		}
 		/* Args: setname typename [type specific options] */
 		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
 		if (ret < 0)
@@ -1206,6 +1878,8 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 		/* Fall through to parse optional setname */
 	case DSET_CMD_DESTROY:
 	case DSET_CMD_FLUSH:
+	case DSET_CMD_PUBLISH:
+	case DSET_CMD_UNPUBLISH:
 		/* Args: [setname] */
 		if (arg0)
 		{
@@ -1218,6 +1892,7 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 
 	case DSET_CMD_RENAME:
 	case DSET_CMD_SWAP:
+	case DSET_CMD_ATTACH:
 		/* Args: from-setname to-setname */
 		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
 		if (ret < 0)
@@ -1225,6 +1900,22 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 		ret = dset_parse_setname(session, DSET_OPT_SETNAME2, arg1);
 		if (ret < 0)
 			return dset->standard_error(dset, p);
+		/* Args: [netns NAME] */
+		if (cmd == DSET_CMD_ATTACH && argc > 2 &&
+			STREQ(argv[1], "netns"))
+		{
+			if (strlen(argv[2]) >= DSET_MAXNAMELEN)
+				return dset->custom_error(dset,
+										  p, DSET_PARAMETER_PROBLEM,
+										  "Network namespace name %s is too long",
+										  argv[2]);
+			ret = dset_data_set(dset_session_data(session),
+								DSET_OPT_NETNS, argv[2]);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+			dset_shift_argv(&argc, argv, 1);
+			dset_shift_argv(&argc, argv, 1);
+		}
 		break;
 
 	case DSET_CMD_RESTORE:
@@ -1234,6 +1925,119 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 									  p, DSET_PARAMETER_PROBLEM,
 									  "Unknown argument %s", argv[1]);
 		return restore(dset);
+	case DSET_CMD_LOAD:
+		/* Args: setname [elements N] */
+		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		if (argc > 2 && STREQ(argv[1], "elements"))
+		{
+			ret = dset_parse_uint32(session, DSET_OPT_ELEMENTS,
+									argv[2]);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+			dset_shift_argv(&argc, argv, 1);
+			dset_shift_argv(&argc, argv, 1);
+		}
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		return load(dset, arg0);
+	case DSET_CMD_SYNC:
+		/* Args: setname */
+		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		return sync_set(dset, arg0);
+	case DSET_CMD_SNAPSHOT:
+		/* Args: setname */
+		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		if (dset->filename != NULL)
+		{
+			ret = dset_session_io_normal(session,
+										 dset->filename, DSET_IO_OUTPUT);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+		}
+		ret = dset_session_image_save(session);
+		dset_session_io_close(session, DSET_IO_OUTPUT);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		return ret;
+	case DSET_CMD_IMPORT:
+		/* Args: [setname] */
+		if (arg0)
+		{
+			ret = dset_parse_setname(session, DSET_SETNAME, arg0);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+		}
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		if (dset->filename != NULL)
+		{
+			ret = dset_session_io_normal(session,
+										 dset->filename, DSET_IO_INPUT);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+		}
+		ret = dset_session_image_load(session);
+		dset_session_io_close(session, DSET_IO_INPUT);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		return ret;
+	case DSET_CMD_CHANGES:
+		/* Args: setname generation */
+		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		ret = dset_parse_uint64(session, DSET_OPT_GENERATION, arg1);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		if (dset->filename != NULL)
+		{
+			ret = dset_session_io_normal(session,
+										 dset->filename, DSET_IO_OUTPUT);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+		}
+		ret = dset_session_changes(session, monitor_event,
+								   dset_session_io_stream(session,
+														  DSET_IO_OUTPUT));
+		dset_session_io_close(session, DSET_IO_OUTPUT);
+		if (ret < 0)
+			return dset->standard_error(dset, p);
+		return ret;
+	case DSET_CMD_MONITOR:
+		if (argc > 1)
+			return dset->custom_error(dset,
+									  p, DSET_PARAMETER_PROBLEM,
+									  "Unknown argument %s", argv[1]);
+		if (dset->filename != NULL)
+		{
+			ret = dset_session_io_normal(session,
+										 dset->filename, DSET_IO_OUTPUT);
+			if (ret < 0)
+				return dset->standard_error(dset, p);
+		}
+		return monitor(dset);
 	case DSET_CMD_ADD:
 	case DSET_CMD_DEL:
 	case DSET_CMD_TEST:
@@ -1242,6 +2046,11 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 		ret = dset_parse_setname(session, DSET_SETNAME, arg0);
 		if (ret < 0)
 			return dset->standard_error(dset, p);
+		if (dset->bulk[0] != '\0' && !STREQ(arg0, dset->bulk))
+			return dset->custom_error(dset, p,
+									  DSET_PARAMETER_PROBLEM,
+									  "Set %s is not under %s.",
+									  arg0, dset->sync ? "sync" : "load");
 
 		type = dset_type_get(session, cmd);
 		if (type == NULL)
@@ -1270,6 +2079,8 @@ int dset_parse_argv(struct dset *dset, int oargc, char *oargv[])
 	if (argc > 1)
 		return dset->custom_error(dset, p, DSET_PARAMETER_PROBLEM,
 								  "Unknown argument %s", argv[1]);
+	if (dset->sync && cmd == DSET_CMD_ADD)
+		return sync_input(dset);
 	ret = dset_cmd(session, cmd, dset->restore_line);
 	D("ret %d", ret);
 	/* In the case of warning, the return code is success */
@@ -1409,6 +2220,7 @@ int dset_custom_printf(struct dset *dset,
 		custom_error ? custom_error : default_custom_error;
 	dset->standard_error =
 		standard_error ? standard_error : default_standard_error;
+	dset->print_outfn = print_outfn;
 
 	return dset_session_print_outfn(dset->session, print_outfn, p);
 }
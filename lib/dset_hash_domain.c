@@ -67,8 +67,212 @@ static struct dset_type dset_hash_domain0 = {
 	.description = "Initial revision",
 };
 
+/* Category support */
+static struct dset_type dset_hash_domain5 = {
+	.name = "hash:domain",
+	.alias = {"dhash", NULL},
+	.revision = 5,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_domain,
+			.print = dset_print_domain,
+			.opt = DSET_OPT_DOMAIN},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				/* Aliases */
+				DSET_ARG_HASHSIZE,
+				DSET_ARG_MAXELEM,
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORIES,
+				DSET_ARG_SKBINFO,
+				/* Ignored options: backward compatibilty */
+				DSET_ARG_PROBES,
+				DSET_ARG_RESIZE,
+				DSET_ARG_GC,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORY,
+				DSET_ARG_SKBMARK,
+				DSET_ARG_SKBPRIO,
+				DSET_ARG_SKBQUEUE,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+	},
+	.usage = "Domain supported.",
+	.description = "category support",
+};
+
+/* Nomatch support */
+static struct dset_type dset_hash_domain6 = {
+	.name = "hash:domain",
+	.alias = {"dhash", NULL},
+	.revision = 6,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_domain,
+			.print = dset_print_domain,
+			.opt = DSET_OPT_DOMAIN},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				/* Aliases */
+				DSET_ARG_HASHSIZE,
+				DSET_ARG_MAXELEM,
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORIES,
+				DSET_ARG_SKBINFO,
+				/* Ignored options: backward compatibilty */
+				DSET_ARG_PROBES,
+				DSET_ARG_RESIZE,
+				DSET_ARG_GC,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORY,
+				DSET_ARG_SKBMARK,
+				DSET_ARG_SKBPRIO,
+				DSET_ARG_SKBQUEUE,
+				DSET_ARG_NOMATCH,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+	},
+	.usage = "Domain supported.",
+	.description = "nomatch support",
+};
+
+/* Elements support */
+static struct dset_type dset_hash_domain7 = {
+	.name = "hash:domain",
+	.alias = {"dhash", NULL},
+	.revision = 7,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_domain,
+			.print = dset_print_domain,
+			.opt = DSET_OPT_DOMAIN},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				/* Aliases */
+				DSET_ARG_HASHSIZE,
+				DSET_ARG_MAXELEM,
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORIES,
+				DSET_ARG_SKBINFO,
+				DSET_ARG_ELEMENTS,
+				/* Ignored options: backward compatibilty */
+				DSET_ARG_PROBES,
+				DSET_ARG_RESIZE,
+				DSET_ARG_GC,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORY,
+				DSET_ARG_SKBMARK,
+				DSET_ARG_SKBPRIO,
+				DSET_ARG_SKBQUEUE,
+				DSET_ARG_NOMATCH,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_DOMAIN),
+			.full = DSET_FLAG(DSET_OPT_DOMAIN),
+			.help = "DOMAIN",
+		},
+	},
+	.usage = "Domain supported.",
+	.description = "elements support",
+};
+
 void _init(void);
 void _init(void)
 {
 	dset_type_add(&dset_hash_domain0);
+	dset_type_add(&dset_hash_domain5);
+	dset_type_add(&dset_hash_domain6);
+	dset_type_add(&dset_hash_domain7);
 }
@@ -0,0 +1,148 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <libdset/data.h>  /* DSET_OPT_* */
+#include <libdset/parse.h> /* parser functions */
+#include <libdset/print.h> /* printing functions */
+#include <libdset/types.h> /* prototypes */
+
+/* Initial release */
+static struct dset_type dset_hash_ip0 = {
+	.name = "hash:ip",
+	.alias = {"iphash", NULL},
+	.revision = 0,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_ip,
+			.print = dset_print_ip,
+			.opt = DSET_OPT_IP},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				/* Aliases */
+				DSET_ARG_HASHSIZE,
+				DSET_ARG_MAXELEM,
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORIES,
+				DSET_ARG_SKBINFO,
+				/* Ignored options: backward compatibilty */
+				DSET_ARG_PROBES,
+				DSET_ARG_RESIZE,
+				DSET_ARG_GC,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORY,
+				DSET_ARG_SKBMARK,
+				DSET_ARG_SKBPRIO,
+				DSET_ARG_SKBQUEUE,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+	},
+	.usage = "IPv4 and IPv6 addresses supported.",
+	.description = "Initial revision",
+};
+
+/* Elements support */
+static struct dset_type dset_hash_ip1 = {
+	.name = "hash:ip",
+	.alias = {"iphash", NULL},
+	.revision = 1,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_ip,
+			.print = dset_print_ip,
+			.opt = DSET_OPT_IP},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				/* Aliases */
+				DSET_ARG_HASHSIZE,
+				DSET_ARG_MAXELEM,
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORIES,
+				DSET_ARG_SKBINFO,
+				DSET_ARG_ELEMENTS,
+				/* Ignored options: backward compatibilty */
+				DSET_ARG_PROBES,
+				DSET_ARG_RESIZE,
+				DSET_ARG_GC,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_TIMEOUT,
+				DSET_ARG_CATEGORY,
+				DSET_ARG_SKBMARK,
+				DSET_ARG_SKBPRIO,
+				DSET_ARG_SKBQUEUE,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_IP),
+			.full = DSET_FLAG(DSET_OPT_IP),
+			.help = "IP",
+		},
+	},
+	.usage = "IPv4 and IPv6 addresses supported.",
+	.description = "elements support",
+};
+
+void _init(void);
+void _init(void)
+{
+	dset_type_add(&dset_hash_ip0);
+	dset_type_add(&dset_hash_ip1);
+}
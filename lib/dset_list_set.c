@@ -0,0 +1,74 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <libdset/data.h>  /* DSET_OPT_* */
+#include <libdset/parse.h> /* parser functions */
+#include <libdset/print.h> /* printing functions */
+#include <libdset/types.h> /* prototypes */
+
+/* Initial release */
+static struct dset_type dset_list_set0 = {
+	.name = "list:set",
+	.alias = {"setlist", NULL},
+	.revision = 0,
+	.family = NFPROTO_UNSPEC,
+	.dimension = DSET_DIM_ONE,
+	.elem = {
+		[DSET_DIM_ONE - 1] = {
+			.parse = dset_parse_name_compat,
+			.print = dset_print_name,
+			.opt = DSET_OPT_NAME},
+	},
+	.cmd = {
+		[DSET_CREATE] = {
+			.args = {
+				DSET_ARG_SIZE,
+				DSET_ARG_NONE,
+			},
+			.need = 0,
+			.full = 0,
+			.help = "",
+		},
+		[DSET_ADD] = {
+			.args = {
+				DSET_ARG_BEFORE,
+				DSET_ARG_AFTER,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_NAME),
+			.full = DSET_FLAG(DSET_OPT_NAME) | DSET_FLAG(DSET_OPT_BEFORE) | DSET_FLAG(DSET_OPT_NAMEREF),
+			.help = "SETNAME",
+		},
+		[DSET_DEL] = {
+			.args = {
+				DSET_ARG_BEFORE,
+				DSET_ARG_AFTER,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_NAME),
+			.full = DSET_FLAG(DSET_OPT_NAME) | DSET_FLAG(DSET_OPT_BEFORE) | DSET_FLAG(DSET_OPT_NAMEREF),
+			.help = "SETNAME",
+		},
+		[DSET_TEST] = {
+			.args = {
+				DSET_ARG_BEFORE,
+				DSET_ARG_AFTER,
+				DSET_ARG_NONE,
+			},
+			.need = DSET_FLAG(DSET_OPT_NAME),
+			.full = DSET_FLAG(DSET_OPT_NAME) | DSET_FLAG(DSET_OPT_BEFORE) | DSET_FLAG(DSET_OPT_NAMEREF),
+			.help = "SETNAME",
+		},
+	},
+	.usage = "where SETNAME are the set names to be added/deleted/tested,\n"
+			 "      in the order the DNS names are probed against them.\n"
+			 "      Use \"before|after SETNAME\" to position a member.",
+	.description = "Initial revision",
+};
+
+void _init(void);
+void _init(void)
+{
+	dset_type_add(&dset_list_set0);
+}
@@ -13,6 +13,7 @@
 #include <libdset/utils.h>   /* STRNEQ */
 #include <libdset/errcode.h> /* prototypes */
 #include <libdset/linux_domain_set_hash.h> /* hash specific errcodes */
+#include <libdset/linux_domain_set_list.h> /* list specific errcodes */
 
 /* Core kernel error codes */
 static const struct dset_errcode_table core_errcode_table[] = {
@@ -53,6 +54,41 @@ static const struct dset_errcode_table core_errcode_table[] = {
 	{DSET_ERR_TYPE_MISMATCH, DSET_CMD_SWAP,
 	 "The sets cannot be swapped: their type does not match"},
 
+	/* PUBLISH specific error codes */
+	{EEXIST, DSET_CMD_PUBLISH,
+	 "Set cannot be published: it is already published"},
+	{DSET_ERR_ATTACHED, DSET_CMD_PUBLISH,
+	 "Set cannot be published: it is attached from another namespace"},
+
+	/* UNPUBLISH specific error codes */
+	{ENOENT, DSET_CMD_UNPUBLISH,
+	 "The set with the given name is not published by this namespace"},
+	{DSET_ERR_BUSY, DSET_CMD_UNPUBLISH,
+	 "Set cannot be unpublished: it is attached in other namespaces"},
+
+	/* ATTACH specific error codes */
+	{ENOENT, DSET_CMD_ATTACH,
+	 "The set with the given name is not published by the owner namespace"},
+	{EINVAL, DSET_CMD_ATTACH,
+	 "The given file is not a network namespace"},
+	{DSET_ERR_EXIST_SETNAME2, DSET_CMD_ATTACH,
+	 "Set cannot be attached: a set with the local name already exists"},
+
+	/* LOAD specific error codes */
+	{DSET_ERR_NO_LOAD, 0,
+	 "No bulk load of the set is in progress"},
+	{EOPNOTSUPP, DSET_CMD_LOAD,
+	 "The set type does not support bulk loading"},
+	{EBUSY, DSET_CMD_LOAD,
+	 "The set is under bulk load by another process"},
+	{EBUSY, DSET_CMD_ADD,
+	 "The set is under bulk load by another process"},
+
+	/* CHANGES specific error codes */
+	{DSET_ERR_GENERATION, DSET_CMD_CHANGES,
+	 "The changes since the given generation are not kept: "
+	 "the set has to be listed again"},
+
 	/* LIST/SAVE specific error codes */
 
 	/* Generic (CADT) error codes */
@@ -64,6 +100,10 @@ static const struct dset_errcode_table core_errcode_table[] = {
 	 "Comment cannot be used: set was created without comment support"},
 	{DSET_ERR_SKBINFO, 0,
 	 "Skbinfo mapping cannot be used: set was created without skbinfo support"},
+	{DSET_ERR_CATEGORY, 0,
+	 "Category cannot be used: set was created without category support"},
+	{DSET_ERR_ATTACHED, 0,
+	 "The set is attached from another namespace and is read-only"},
 
 	/* ADD specific error codes */
 	{DSET_ERR_EXIST, DSET_CMD_ADD,
@@ -104,6 +144,26 @@ static const struct dset_errcode_table hash_errcode_table[] = {
 	{},
 };
 
+/* List type-specific error codes */
+static const struct dset_errcode_table list_errcode_table[] = {
+	/* Generic (CADT) error codes */
+	{DSET_ERR_NAME, 0,
+	 "Set to be added/deleted/tested as element does not exist."},
+	{DSET_ERR_LOOP, 0,
+	 "Sets with list:set type cannot be added to the set."},
+	{DSET_ERR_BEFORE, 0,
+	 "No reference set specified."},
+	{DSET_ERR_NAMEREF, 0,
+	 "The set to which you referred with 'before' or 'after' "
+	 "does not exist."},
+	{DSET_ERR_LIST_FULL, 0,
+	 "The set is full, more elements cannot be added."},
+	{DSET_ERR_REF_EXIST, 0,
+	 "The set to which you referred with 'before' or 'after' "
+	 "is not added to the set."},
+	{},
+};
+
 /* Match set type names */
 #define MATCH_TYPENAME(a, b) STRNEQ(a, b, strlen(b))
 
@@ -131,6 +191,8 @@ int dset_errcode(struct dset_session *session, enum dset_cmd cmd, int errcode)
 		{
 			if (MATCH_TYPENAME(type->name, "hash:"))
 				table = hash_errcode_table;
+			else if (MATCH_TYPENAME(type->name, "list:"))
+				table = list_errcode_table;
 		}
 	}
 
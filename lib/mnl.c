@@ -19,6 +19,11 @@
 #define NFNL_SUBSYS_DSET 12
 #endif
 
+/* Multicast group of the change notifications */
+#ifndef DSET_NFNLGRP
+#define DSET_NFNLGRP 10
+#endif
+
 /* Internal data structure for the kernel-userspace communication parameters */
 struct dset_handle
 {
@@ -27,6 +32,7 @@ struct dset_handle
 	unsigned int portid;  /* the socket port identifier */
 	mnl_cb_t *cb_ctl;	 /* control block callbacks */
 	void *data;			  /* data pointer */
+	unsigned int inflight; /* pipelined messages not acknowledged yet */
 };
 
 /* Netlink flags of the commands */
@@ -45,6 +51,11 @@ static const uint16_t cmdflags[] = {
 	[DSET_CMD_HEADER - 1] = NLM_F_REQUEST,
 	[DSET_CMD_TYPE - 1] = NLM_F_REQUEST,
 	[DSET_CMD_PROTOCOL - 1] = NLM_F_REQUEST,
+	[DSET_CMD_PUBLISH - 1] = NLM_F_REQUEST | NLM_F_ACK,
+	[DSET_CMD_UNPUBLISH - 1] = NLM_F_REQUEST | NLM_F_ACK,
+	[DSET_CMD_ATTACH - 1] = NLM_F_REQUEST | NLM_F_ACK,
+	[DSET_CMD_LOAD - 1] = NLM_F_REQUEST | NLM_F_ACK,
+	[DSET_CMD_CHANGES - 1] = NLM_F_REQUEST | NLM_F_ACK | NLM_F_DUMP,
 };
 
 /**
@@ -117,6 +128,115 @@ dset_mnl_query(struct dset_handle *handle, void *buffer, size_t len)
 	return ret;
 }
 
+static int
+dset_mnl_send(struct dset_handle *handle, void *buffer, size_t len UNUSED)
+{
+	struct nlmsghdr *nlh = buffer;
+
+	assert(handle);
+	assert(buffer);
+
+	nlh->nlmsg_seq = ++handle->seq;
+#ifdef DSET_DEBUG
+	dset_debug_msg("sent", nlh, nlh->nlmsg_len);
+#endif
+	if (mnl_socket_sendto(handle->h, nlh, nlh->nlmsg_len) < 0)
+		return -ECOMM;
+	handle->inflight++;
+
+	return 0;
+}
+
+/* Every pipelined message is answered by exactly one ACK or error
+ * report, in the order the messages were sent. The replies are matched
+ * by sequence number against the messages in flight. After the first
+ * error the remaining replies are consumed without running the
+ * callbacks, so the report of the first failing message is kept.
+ */
+static int
+dset_mnl_drain(struct dset_handle *handle, void *buffer, size_t len,
+			   unsigned int window)
+{
+	const struct nlmsghdr *nlh;
+	unsigned int first;
+	int ret, err = 0;
+
+	assert(handle);
+	assert(buffer);
+
+	while (handle->inflight > window || (err && handle->inflight))
+	{
+		ret = mnl_socket_recvfrom(handle->h, buffer, len);
+#ifdef DSET_DEBUG
+		dset_debug_msg("received", buffer, ret);
+#endif
+		if (ret <= 0)
+			goto lost;
+		for (nlh = buffer; mnl_nlmsg_ok(nlh, ret);
+			 nlh = mnl_nlmsg_next(nlh, &ret))
+		{
+			first = handle->seq - handle->inflight + 1;
+			if (!handle->inflight ||
+				nlh->nlmsg_seq - first >= handle->inflight)
+			{
+				errno = EPROTO;
+				goto lost;
+			}
+			if (!err &&
+				mnl_cb_run2(nlh, nlh->nlmsg_len,
+							nlh->nlmsg_seq, handle->portid,
+							handle->cb_ctl[NLMSG_MIN_TYPE],
+							handle->data,
+							handle->cb_ctl, NLMSG_MIN_TYPE) < 0)
+				err = -1;
+			D("seq %u, inflight %u, err %d",
+			  nlh->nlmsg_seq, handle->inflight, err);
+			if (nlh->nlmsg_type == NLMSG_ERROR)
+				handle->inflight--;
+		}
+	}
+	return err;
+
+lost:
+	/* The remaining replies cannot be matched anymore */
+	handle->inflight = 0;
+	return -1;
+}
+
+static int
+dset_mnl_subscribe(struct dset_handle *handle)
+{
+	int group = DSET_NFNLGRP;
+
+	assert(handle);
+
+	if (mnl_socket_setsockopt(handle->h, NETLINK_ADD_MEMBERSHIP,
+							  &group, sizeof(group)) < 0)
+		return -1;
+	return 0;
+}
+
+/* The events are not answers: no sequence number, sent by the kernel */
+static int
+dset_mnl_receive(struct dset_handle *handle, void *buffer, size_t len)
+{
+	int ret;
+
+	assert(handle);
+	assert(buffer);
+
+	ret = mnl_socket_recvfrom(handle->h, buffer, len);
+#ifdef DSET_DEBUG
+	dset_debug_msg("received", buffer, ret);
+#endif
+	if (ret <= 0)
+		return -1;
+	return mnl_cb_run2(buffer, ret, 0, 0,
+					   handle->cb_ctl[NLMSG_MIN_TYPE],
+					   handle->data,
+					   handle->cb_ctl, NLMSG_MIN_TYPE);
+}
+
 static struct dset_handle *
 dset_mnl_init(mnl_cb_t *cb_ctl, void *data)
 {
@@ -168,4 +288,8 @@ const struct dset_transport dset_mnl_transport = {
 	.fini = dset_mnl_fini,
 	.fill_hdr = dset_mnl_fill_hdr,
 	.query = dset_mnl_query,
+	.send = dset_mnl_send,
+	.drain = dset_mnl_drain,
+	.subscribe = dset_mnl_subscribe,
+	.receive = dset_mnl_receive,
 };
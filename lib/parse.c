@@ -6,6 +6,7 @@
 #include <errno.h>  /* errno */
 #include <limits.h> /* ULLONG_MAX */
 #include <netdb.h>  /* getservbyname, getaddrinfo */
+#include <arpa/inet.h> /* inet_pton */
 #include <stdlib.h> /* strtoull, etc. */
 #include <stdio.h>  /* strtoull, etc. */
 
@@ -556,6 +557,36 @@ int dset_parse_comment(struct dset_session *session,
 	return dset_data_set(data, opt, str);
 }
 
+/**
+ * dset_parse_ip - parse an IPv4 or IPv6 address
+ * @session: session structure
+ * @opt: option kind of the data
+ * @str: string to parse
+ *
+ * Parse string as an IPv4 or IPv6 address in numeric form. The
+ * family of the address is stored with the address itself.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_parse_ip(struct dset_session *session,
+				  enum dset_opt opt, const char *str)
+{
+	struct dset_ipaddr ip = {0};
+
+	assert(session);
+	assert(opt == DSET_OPT_IP);
+	assert(str);
+
+	if (inet_pton(AF_INET, str, &ip.in) == 1)
+		ip.family = NFPROTO_IPV4;
+	else if (inet_pton(AF_INET6, str, &ip.in6) == 1)
+		ip.family = NFPROTO_IPV6;
+	else
+		return syntax_err("cannot parse %s as an IP address", str);
+
+	return dset_data_set(dset_session_data(session), opt, &ip);
+}
+
 int dset_parse_skbmark(struct dset_session *session,
 					   enum dset_opt opt, const char *str)
 {
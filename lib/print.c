@@ -6,6 +6,7 @@
 #include <errno.h>	/* errno */
 #include <stdio.h>	/* snprintf */
 #include <inttypes.h> /* PRIx macro */
+#include <arpa/inet.h> /* inet_ntop */
 
 #include <libdset/debug.h>   /* D() */
 #include <libdset/data.h>	/* dset_data_* */
@@ -180,6 +181,40 @@ int dset_print_domain(char *buf, unsigned int len,
 	return offset;
 }
 
+/**
+ * dset_print_ip - print an IPv4 or IPv6 address
+ * @buf: printing buffer
+ * @len: length of available buffer space
+ * @data: data blob
+ * @opt: the option kind
+ * @env: environment flags
+ *
+ * Print the address in numeric form to output buffer.
+ *
+ * Return lenght of printed string or error size.
+ */
+int dset_print_ip(char *buf, unsigned int len,
+				  const struct dset_data *data, enum dset_opt opt,
+				  uint8_t env UNUSED)
+{
+	const struct dset_ipaddr *ip;
+	char tmp[INET6_ADDRSTRLEN];
+	int size, offset = 0;
+
+	assert(buf);
+	assert(len > 0);
+	assert(data);
+	assert(opt == DSET_OPT_IP);
+	ip = dset_data_get(data, opt);
+	assert(ip);
+	if (!inet_ntop(ip->family == NFPROTO_IPV4 ? AF_INET : AF_INET6,
+				   &ip->in6, tmp, sizeof(tmp)))
+		return -1;
+	size = snprintf(buf + offset, len, "%s", tmp);
+	SNPRINTF_FAILURE(size, len, offset);
+	return offset;
+}
+
 /**
  * dset_print_comment - print arbitrary parameter string
  * @buf: printing buffer
@@ -359,6 +394,9 @@ int dset_print_data(char *buf, unsigned int len,
 	case DSET_OPT_DOMAIN:
 		size = dset_print_domain(buf, len, data, opt, env);
 		break;
+	case DSET_OPT_IP:
+		size = dset_print_ip(buf, len, data, opt, env);
+		break;
 	case DSET_OPT_TYPE:
 		size = dset_print_type(buf, len, data, opt, env);
 		break;
@@ -3,8 +3,10 @@
  * published by the Free Software Foundation.
  */
 #include <assert.h>		  /* assert */
+#include <byteswap.h>	  /* bswap_32 */
 #include <endian.h>		  /* htobe64 */
 #include <errno.h>		  /* errno */
+#include <fcntl.h>		  /* open */
 #include <setjmp.h>		  /* setjmp, longjmp */
 #include <stdio.h>		  /* snprintf */
 #include <stdarg.h>		  /* va_* */
@@ -53,6 +55,9 @@ struct dset_session
 	uint8_t nestid;						  /* Current nest level */
 	uint8_t protocol;					  /* The protocol used */
 	bool version_checked;				  /* Version checked */
+	char load_setname[DSET_MAXNAMELEN];	  /* Set under bulk load */
+	enum dset_load_phase load;			  /* Bulk load phase to send */
+	int netns_fd;						  /* Owner namespace at attach */
 	/* Output buffer */
 	char *outbuf;				  /* Output buffer */
 	size_t outbuflen;			  /* Output buffer size */
@@ -63,6 +68,12 @@ struct dset_session
 	dset_print_outfn print_outfn; /* Output function to file */
 	void *p;					  /* Private data for print_outfn */
 	bool sort;					  /* Print sorted hash:* types */
+	dset_list_elemfn list_elemfn; /* Called instead of printing elements */
+	void *list_p;				  /* Private data for list_elemfn */
+	struct dset_image *image;	  /* Set image under save */
+	dset_notify_fn notify_fn;	  /* Called for the received changes */
+	void *notify_p;				  /* Private data for notify_fn */
+	int notify_ret;				  /* Stopping value of notify_fn */
 	/* Session IO */
 	bool normal_io, full_io; /* Default/normal/full IO */
 	FILE *istream, *ostream; /* Session input/output stream */
@@ -73,6 +84,9 @@ struct dset_session
 	/* Kernel message buffer */
 	size_t bufsize;
 	void *buffer;
+	size_t rcvbufsize;	 /* Room for the error report of a full message */
+	void *rcvbuffer;	 /* Replies to pipelined messages */
+	unsigned int window; /* Pipelined messages in flight in restore mode */
 };
 
 /*
@@ -376,6 +390,33 @@ static const struct dset_attr_policy cmd_attrs[] = {
 		.type = MNL_TYPE_U16,
 		.opt = DSET_OPT_INDEX,
 	},
+	[DSET_ATTR_LOAD] = {
+		.type = MNL_TYPE_U8,
+	},
+	[DSET_ATTR_GENERATION] = {
+		.type = MNL_TYPE_U64,
+		.opt = DSET_OPT_GENERATION,
+	},
+	[DSET_ATTR_CMD_PAD] = {
+		.type = MNL_TYPE_UNSPEC,
+	},
+	[DSET_ATTR_NETNS_FD] = {
+		.type = MNL_TYPE_U32,
+	},
+	[DSET_ATTR_NETNS] = {
+		.type = MNL_TYPE_NUL_STRING,
+		.opt = DSET_OPT_NETNS,
+		.len = DSET_MAXNAMELEN,
+	},
+	[DSET_ATTR_PUBLISHED] = {
+		.type = MNL_TYPE_FLAG,
+		.opt = DSET_OPT_PUBLISHED,
+	},
+	[DSET_ATTR_LINK] = {
+		.type = MNL_TYPE_NUL_STRING,
+		.opt = DSET_OPT_LINK,
+		.len = DSET_MAXNAMELEN,
+	},
 };
 
 static const struct dset_attr_policy create_attrs[] = {
@@ -486,6 +527,25 @@ static const struct dset_attr_policy adt_attrs[] = {
 		.type = MNL_TYPE_UNSPEC,
 		.len = 0,
 	},
+	[DSET_ATTR_CATEGORY] = {
+		.type = MNL_TYPE_U32,
+		.opt = DSET_OPT_CATEGORY,
+	},
+	[DSET_ATTR_IP] = {
+		.type = MNL_TYPE_NESTED,
+		.opt = DSET_OPT_IP,
+		.len = MNL_ATTR_HDRLEN + sizeof(struct in6_addr),
+	},
+};
+
+static const struct dset_attr_policy ipaddr_attrs[] = {
+	[DSET_ATTR_IPADDR_IPV4] = {
+		.type = MNL_TYPE_U32,
+	},
+	[DSET_ATTR_IPADDR_IPV6] = {
+		.type = MNL_TYPE_BINARY,
+		.len = sizeof(struct in6_addr),
+	},
 };
 
 #ifdef DSET_DEBUG
@@ -532,6 +592,13 @@ adt_attr_cb(const struct nlattr *attr, void *data)
 								DSET_ATTR_ADT_MAX, adt_attrs);
 }
 
+static int
+ipaddr_attr_cb(const struct nlattr *attr, void *data)
+{
+	return generic_data_attr_cb(attr, data,
+								DSET_ATTR_IPADDR_MAX, ipaddr_attrs);
+}
+
 #define FAILURE(format, args...)           \
 	{                                      \
 		dset_err(session, format, ##args); \
@@ -556,6 +623,34 @@ attr2data(struct dset_session *session, struct nlattr *nla[],
 	if (attr->type == MNL_TYPE_UNSPEC)
 		return 0;
 
+	if (attr->type == MNL_TYPE_NESTED && attr->opt == DSET_OPT_IP)
+	{
+		struct nlattr *ipattr[DSET_ATTR_IPADDR_MAX + 1] = {};
+		struct dset_ipaddr ip = {};
+
+		if (mnl_attr_parse_nested(nla[type], ipaddr_attr_cb, ipattr) < 0)
+			FAILURE("Broken kernel message, cannot validate "
+					"IP address attribute!");
+		if (ipattr[DSET_ATTR_IPADDR_IPV4])
+		{
+			ip.family = NFPROTO_IPV4;
+			memcpy(&ip.in, mnl_attr_get_payload(ipattr[DSET_ATTR_IPADDR_IPV4]),
+				   sizeof(ip.in));
+		}
+		else if (ipattr[DSET_ATTR_IPADDR_IPV6] &&
+				 mnl_attr_get_payload_len(ipattr[DSET_ATTR_IPADDR_IPV6]) ==
+					 sizeof(ip.in6))
+		{
+			ip.family = NFPROTO_IPV6;
+			memcpy(&ip.in6, mnl_attr_get_payload(ipattr[DSET_ATTR_IPADDR_IPV6]),
+				   sizeof(ip.in6));
+		}
+		else
+			FAILURE("Broken kernel message: IP address attribute "
+					"missing!");
+		return dset_data_set(data, attr->opt, &ip);
+	}
+
 	if (nla[type]->nla_type & NLA_F_NET_BYTEORDER)
 	{
 		D("netorder attr type %u", type);
@@ -611,7 +706,7 @@ attr2data(struct dset_session *session, struct nlattr *nla[],
 	if (attr2data(session, nla, type, attrs) < 0) \
 	return MNL_CB_ERROR
 
-static const char cmd2name[][9] = {
+static const char cmd2name[][10] = {
 	[DSET_CMD_NONE] = "NONE",
 	[DSET_CMD_CREATE] = "CREATE",
 	[DSET_CMD_DESTROY] = "DESTROY",
@@ -626,6 +721,11 @@ static const char cmd2name[][9] = {
 	[DSET_CMD_HEADER] = "HEADER",
 	[DSET_CMD_TYPE] = "TYPE",
 	[DSET_CMD_PROTOCOL] = "PROTOCOL",
+	[DSET_CMD_PUBLISH] = "PUBLISH",
+	[DSET_CMD_UNPUBLISH] = "UNPUBLISH",
+	[DSET_CMD_ATTACH] = "ATTACH",
+	[DSET_CMD_LOAD] = "LOAD",
+	[DSET_CMD_CHANGES] = "CHANGES",
 };
 
 static inline int
@@ -761,6 +861,11 @@ list_adt(struct dset_session *session, struct nlattr *nla[])
 	if (!found)
 		return MNL_CB_OK;
 
+	if (session->list_elemfn)
+		return session->list_elemfn(session, session->list_p) < 0
+				   ? MNL_CB_ERROR
+				   : MNL_CB_OK;
+
 	if (session->sort)
 	{
 		if (session->outbuflen <= session->pos + 1)
@@ -876,6 +981,22 @@ list_create(struct dset_session *session, struct nlattr *nla[])
 		return MNL_CB_ERROR;
 	// family = dset_data_family(data);
 
+	if (session->mode == DSET_LIST_SAVE &&
+		dset_data_test(data, DSET_OPT_LINK))
+	{
+		/* Attached sets are restored by attaching them again */
+		safe_snprintf(session, "attach %s %s",
+					  (const char *)dset_data_get(data, DSET_OPT_LINK),
+					  dset_data_setname(data));
+		if (dset_data_test(data, DSET_OPT_NETNS))
+			safe_snprintf(session, " netns %s",
+						  (const char *)dset_data_get(data, DSET_OPT_NETNS));
+		safe_snprintf(session, "\n");
+		session->printed_set++;
+		session->sort = false;
+		return MNL_CB_OK;
+	}
+
 	switch (session->mode)
 	{
 	case DSET_LIST_SAVE:
@@ -913,6 +1034,11 @@ list_create(struct dset_session *session, struct nlattr *nla[])
 		if (!arg->print ||
 			!dset_data_test(data, arg->opt))
 			continue;
+		/* The number of entries is listed separately, it is a create
+		 * option to presize the set in restore only */
+		if (arg->opt == DSET_OPT_ELEMENTS &&
+			session->mode != DSET_LIST_SAVE)
+			continue;
 		switch (session->mode)
 		{
 		case DSET_LIST_SAVE:
@@ -944,17 +1070,35 @@ list_create(struct dset_session *session, struct nlattr *nla[])
 	{
 	case DSET_LIST_SAVE:
 		safe_snprintf(session, "\n");
+		if (dset_data_test(data, DSET_OPT_PUBLISHED))
+			safe_snprintf(session, "publish %s\n",
+						  dset_data_setname(data));
 		break;
 	case DSET_LIST_PLAIN:
 		safe_snprintf(session, "\nSize in memory: ");
 		safe_dprintf(session, dset_print_number, DSET_OPT_MEMSIZE);
 		safe_snprintf(session, "\nReferences: ");
 		safe_dprintf(session, dset_print_number, DSET_OPT_REFERENCES);
+		if (dset_data_test(data, DSET_OPT_PUBLISHED))
+			safe_snprintf(session, "\nPublished: yes");
+		if (dset_data_test(data, DSET_OPT_LINK))
+		{
+			safe_snprintf(session, "\nAttached: %s",
+						  (const char *)dset_data_get(data, DSET_OPT_LINK));
+			if (dset_data_test(data, DSET_OPT_NETNS))
+				safe_snprintf(session, " netns %s",
+							  (const char *)dset_data_get(data, DSET_OPT_NETNS));
+		}
 		if (dset_data_test(data, DSET_OPT_ELEMENTS))
 		{
 			safe_snprintf(session, "\nNumber of entries: ");
 			safe_dprintf(session, dset_print_number, DSET_OPT_ELEMENTS);
 		}
+		if (dset_data_test(data, DSET_OPT_GENERATION))
+		{
+			safe_snprintf(session, "\nGeneration: ");
+			safe_dprintf(session, dset_print_number, DSET_OPT_GENERATION);
+		}
 		safe_snprintf(session,
 					  session->envopts & DSET_ENV_LIST_HEADER ? "\n" : "\nMembers:\n");
 		break;
@@ -964,12 +1108,28 @@ list_create(struct dset_session *session, struct nlattr *nla[])
 		safe_snprintf(session, "</memsize>\n<references>");
 		safe_dprintf(session, dset_print_number, DSET_OPT_REFERENCES);
 		safe_snprintf(session, "</references>\n");
+		if (dset_data_test(data, DSET_OPT_PUBLISHED))
+			safe_snprintf(session, "<published/>\n");
+		if (dset_data_test(data, DSET_OPT_LINK))
+		{
+			safe_snprintf(session, "<attached>%s</attached>\n",
+						  (const char *)dset_data_get(data, DSET_OPT_LINK));
+			if (dset_data_test(data, DSET_OPT_NETNS))
+				safe_snprintf(session, "<netns>%s</netns>\n",
+							  (const char *)dset_data_get(data, DSET_OPT_NETNS));
+		}
 		if (dset_data_test(data, DSET_OPT_ELEMENTS))
 		{
 			safe_snprintf(session, "<numentries>");
 			safe_dprintf(session, dset_print_number, DSET_OPT_ELEMENTS);
 			safe_snprintf(session, "</numentries>\n");
 		}
+		if (dset_data_test(data, DSET_OPT_GENERATION))
+		{
+			safe_snprintf(session, "<generation>");
+			safe_dprintf(session, dset_print_number, DSET_OPT_GENERATION);
+			safe_snprintf(session, "</generation>\n");
+		}
 		safe_snprintf(session,
 					  session->envopts & DSET_ENV_LIST_HEADER ? "</header>\n" : "</header>\n<members>\n");
 		break;
@@ -1047,12 +1207,211 @@ print_set_done(struct dset_session *session, bool callback_done)
 	return call_outfn(session) ? MNL_CB_ERROR : MNL_CB_STOP;
 }
 
+/*
+ * Set images
+ *
+ * An image is the header and the elements of a set in the attributes
+ * the kernel lists them in, so that they can be sent back without
+ * printing and parsing them. After the image head the records are
+ * netlink attributes in host byte order:
+ *
+ *   DSET_IMAGE_SET: setname, typename, revision, family and the nested
+ *                   create data of the set
+ *   DSET_IMAGE_ELEM: the attributes of an element, any number of times
+ *   DSET_IMAGE_END: number of elements and CRC32 of the records before
+ */
+
+#define DSET_IMAGE_MAGIC "DSETIMG"
+#define DSET_IMAGE_VERSION 1
+#define DSET_IMAGE_SETLEN 1024
+
+struct dset_image_head
+{
+	char magic[8];	  /* DSET_IMAGE_MAGIC */
+	uint32_t version;  /* DSET_IMAGE_VERSION */
+	uint32_t protocol; /* Protocol of the attributes */
+};
+
+enum
+{
+	DSET_IMAGE_UNSPEC,
+	DSET_IMAGE_SET,	 /* 1: Set header */
+	DSET_IMAGE_ELEM, /* 2: Element */
+	DSET_IMAGE_END,	 /* 3: Trailer */
+};
+
+struct dset_image_end
+{
+	uint32_t elements; /* Number of elements */
+	uint32_t crc;	  /* CRC32 of the records */
+};
+
+/* Image under save */
+struct dset_image
+{
+	FILE *f;		   /* Output stream */
+	uint32_t elements; /* Saved elements */
+	uint32_t crc;	  /* CRC32 so far */
+	bool set;		   /* Set record written */
+};
+
+static uint32_t
+image_crc(uint32_t crc, const void *buf, size_t len)
+{
+	static uint32_t table[256];
+	const uint8_t *p = buf;
+	uint32_t c;
+	int i, j;
+
+	if (table[1] == 0)
+	{
+		for (i = 0; i < 256; i++)
+		{
+			c = i;
+			for (j = 0; j < 8; j++)
+				c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (len--)
+		crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static int
+image_write(struct dset_session *session, uint16_t type,
+			const void *payload, size_t len)
+{
+	static const char pad[MNL_ALIGNTO];
+	struct dset_image *image = session->image;
+	struct nlattr hdr;
+	size_t padlen = MNL_ALIGN(len) - len;
+
+	if (MNL_ATTR_HDRLEN + len > UINT16_MAX)
+		return dset_err(session, "Image record is too large");
+	hdr.nla_len = MNL_ATTR_HDRLEN + len;
+	hdr.nla_type = type;
+	if (type != DSET_IMAGE_END)
+	{
+		image->crc = image_crc(image->crc, &hdr, sizeof(hdr));
+		image->crc = image_crc(image->crc, payload, len);
+		image->crc = image_crc(image->crc, pad, padlen);
+	}
+	if (fwrite(&hdr, sizeof(hdr), 1, image->f) != 1 ||
+		fwrite(payload, 1, len, image->f) != len ||
+		fwrite(pad, 1, padlen, image->f) != padlen)
+		return dset_err(session, "Cannot write image: %s",
+						strerror(errno));
+	return 0;
+}
+
+/* The header of the set without the kernel only attributes */
+static int
+image_write_set(struct dset_session *session, struct nlattr *nla[])
+{
+	char buffer[DSET_IMAGE_SETLEN] __attribute__((aligned)) = {};
+	struct nlmsghdr *nlh = mnl_nlmsg_put_header(buffer);
+	const struct nlattr *attr;
+	struct nlattr *nested;
+	size_t len = MNL_NLMSG_HDRLEN;
+	int type;
+
+	/* Everything fits, unless the kernel is broken */
+	for (type = DSET_ATTR_SETNAME; type <= DSET_ATTR_DATA; type++)
+		if (nla[type])
+			len += MNL_ALIGN(mnl_attr_get_len(nla[type]));
+	if (len > sizeof(buffer))
+		return dset_err(session, "Image record is too large");
+
+	mnl_attr_put(nlh, DSET_ATTR_SETNAME,
+				 mnl_attr_get_payload_len(nla[DSET_ATTR_SETNAME]),
+				 mnl_attr_get_payload(nla[DSET_ATTR_SETNAME]));
+	mnl_attr_put(nlh, DSET_ATTR_TYPENAME,
+				 mnl_attr_get_payload_len(nla[DSET_ATTR_TYPENAME]),
+				 mnl_attr_get_payload(nla[DSET_ATTR_TYPENAME]));
+	mnl_attr_put_u8(nlh, DSET_ATTR_REVISION,
+					mnl_attr_get_u8(nla[DSET_ATTR_REVISION]));
+	mnl_attr_put_u8(nlh, DSET_ATTR_FAMILY,
+					mnl_attr_get_u8(nla[DSET_ATTR_FAMILY]));
+	nested = mnl_attr_nest_start(nlh, DSET_ATTR_DATA);
+	mnl_attr_for_each_nested(attr, nla[DSET_ATTR_DATA])
+	{
+		type = mnl_attr_get_type(attr);
+		if (type == DSET_ATTR_REFERENCES || type == DSET_ATTR_MEMSIZE)
+			continue;
+		/* Keep the byte order flag */
+		mnl_attr_put(nlh, attr->nla_type,
+					 mnl_attr_get_payload_len(attr),
+					 mnl_attr_get_payload(attr));
+	}
+	mnl_attr_nest_end(nlh, nested);
+
+	return image_write(session, DSET_IMAGE_SET,
+					   mnl_nlmsg_get_payload(nlh),
+					   nlh->nlmsg_len - MNL_NLMSG_HDRLEN);
+}
+
+/* The elements are copied as received from the kernel */
+static int
+image_list(struct dset_session *session, struct nlattr *nla[],
+		   enum dset_cmd cmd)
+{
+	struct dset_image *image = session->image;
+	struct nlattr *tb;
+
+	if (!nla[DSET_ATTR_SETNAME])
+		FAILURE("Broken %s kernel message: missing setname!",
+				cmd2name[cmd]);
+
+	if (nla[DSET_ATTR_DATA] != NULL)
+	{
+		if (image->set)
+			FAILURE("Broken %s kernel message: "
+					"extra DATA received!",
+					cmd2name[cmd]);
+		if (!(nla[DSET_ATTR_TYPENAME] &&
+			  nla[DSET_ATTR_FAMILY] &&
+			  nla[DSET_ATTR_REVISION]))
+			FAILURE("Broken %s kernel message: missing %s!",
+					cmd2name[cmd],
+					!nla[DSET_ATTR_TYPENAME] ? "typename" : !nla[DSET_ATTR_FAMILY] ? "family" : "revision");
+		if (image_write_set(session, nla) < 0)
+			return MNL_CB_ERROR;
+		image->set = true;
+	}
+	else if (!image->set)
+		FAILURE("Broken %s kernel message: "
+				"missing DATA part!",
+				cmd2name[cmd]);
+
+	if (nla[DSET_ATTR_ADT] == NULL)
+		return MNL_CB_OK;
+
+	mnl_attr_for_each_nested(tb, nla[DSET_ATTR_ADT])
+	{
+		if (mnl_attr_get_type(tb) != DSET_ATTR_DATA)
+			FAILURE("Broken %s kernel message: "
+					"cannot validate ADT attributes!",
+					cmd2name[cmd]);
+		if (image_write(session, DSET_IMAGE_ELEM,
+						mnl_attr_get_payload(tb),
+						mnl_attr_get_payload_len(tb)) < 0)
+			return MNL_CB_ERROR;
+		image->elements++;
+	}
+	return MNL_CB_OK;
+}
+
 static int
 callback_list(struct dset_session *session, struct nlattr *nla[],
 			  enum dset_cmd cmd)
 {
 	struct dset_data *data = session->data;
 
+	if (session->image)
+		return image_list(session, nla, cmd);
+
 	if (setjmp(printf_failure))
 	{
 		session->saved_setname[0] = '\0';
@@ -1118,6 +1477,18 @@ callback_list(struct dset_session *session, struct nlattr *nla[],
 		ATTR2DATA(session, nla, DSET_ATTR_FAMILY, cmd_attrs);
 		ATTR2DATA(session, nla, DSET_ATTR_TYPENAME, cmd_attrs);
 		ATTR2DATA(session, nla, DSET_ATTR_REVISION, cmd_attrs);
+		dset_data_flags_unset(data, DSET_FLAG(DSET_OPT_GENERATION));
+		if (nla[DSET_ATTR_GENERATION])
+			ATTR2DATA(session, nla, DSET_ATTR_GENERATION, cmd_attrs);
+		dset_data_flags_unset(data, DSET_FLAG(DSET_OPT_NETNS) |
+										DSET_FLAG(DSET_OPT_PUBLISHED) |
+										DSET_FLAG(DSET_OPT_LINK));
+		if (nla[DSET_ATTR_NETNS])
+			ATTR2DATA(session, nla, DSET_ATTR_NETNS, cmd_attrs);
+		if (nla[DSET_ATTR_PUBLISHED])
+			ATTR2DATA(session, nla, DSET_ATTR_PUBLISHED, cmd_attrs);
+		if (nla[DSET_ATTR_LINK])
+			ATTR2DATA(session, nla, DSET_ATTR_LINK, cmd_attrs);
 		// D("head: family %u, typename %s",
 		//   dset_data_family(data),
 		//   (const char *) dset_data_get(data, DSET_OPT_TYPENAME));
@@ -1279,6 +1650,99 @@ mnl_attr_parse_dbg(const struct nlmsghdr *nlh, int offset,
 }
 #endif
 
+/* An element of an add/del event */
+static int
+notify_elem(struct dset_session *session, enum dset_cmd cmd,
+			const struct nlattr *attr)
+{
+	struct nlattr *adt[DSET_ATTR_ADT_MAX + 1] = {};
+	int i;
+
+	if (mnl_attr_get_type(attr) != DSET_ATTR_DATA ||
+		mnl_attr_parse_nested(attr, adt_attr_cb, adt) < 0)
+		FAILURE("Broken %s event: cannot validate ADT attributes!",
+				cmd2name[cmd]);
+
+	/* Reset ADT specific flags */
+	dset_data_flags_unset(session->data, DSET_ADT_FLAGS);
+	for (i = DSET_ATTR_UNSPEC + 1; i <= DSET_ATTR_ADT_MAX; i++)
+		if (adt[i])
+			ATTR2DATA(session, adt, i, adt_attrs);
+
+	session->notify_ret = session->notify_fn(session, cmd,
+											 session->notify_p);
+	return session->notify_ret < 0 ? MNL_CB_ERROR : MNL_CB_OK;
+}
+
+static int
+callback_notify(struct dset_session *session, const struct nlmsghdr *nlh,
+				uint8_t cmd)
+{
+	struct dset_data *data = session->data;
+	struct nlattr *nla[DSET_ATTR_CMD_MAX + 1] = {};
+	const struct nlattr *tb;
+	int nfmsglen = MNL_ALIGN(sizeof(struct nfgenmsg));
+	int ret = MNL_CB_OK;
+
+	if (cmd <= DSET_CMD_NONE || cmd >= DSET_MSG_MAX)
+		FAILURE("Unknown event received: %u", cmd);
+
+	if (mnl_attr_parse(nlh, nfmsglen, cmd_attr_cb, nla) < MNL_CB_STOP)
+		FAILURE("Broken %s event: "
+				"cannot validate and parse attributes",
+				cmd2name[cmd]);
+
+	if (!nla[DSET_ATTR_PROTOCOL] ||
+		mnl_attr_get_u8(nla[DSET_ATTR_PROTOCOL]) != session->protocol)
+		FAILURE("Giving up: %s event does not match "
+				"our protocol version %u",
+				cmd2name[cmd], session->protocol);
+
+	dset_data_reset(data);
+	if (nla[DSET_ATTR_SETNAME])
+		ATTR2DATA(session, nla, DSET_ATTR_SETNAME, cmd_attrs);
+	if (nla[DSET_ATTR_SETNAME2])
+		ATTR2DATA(session, nla, DSET_ATTR_SETNAME2, cmd_attrs);
+	if (nla[DSET_ATTR_TYPENAME] && nla[DSET_ATTR_REVISION])
+	{
+		ATTR2DATA(session, nla, DSET_ATTR_TYPENAME, cmd_attrs);
+		ATTR2DATA(session, nla, DSET_ATTR_REVISION, cmd_attrs);
+		if (dset_type_check(session) == NULL)
+			return MNL_CB_ERROR;
+	}
+	if (nla[DSET_ATTR_GENERATION])
+		ATTR2DATA(session, nla, DSET_ATTR_GENERATION, cmd_attrs);
+	if (nla[DSET_ATTR_NETNS])
+		ATTR2DATA(session, nla, DSET_ATTR_NETNS, cmd_attrs);
+
+	switch (cmd)
+	{
+	case DSET_CMD_ADD:
+	case DSET_CMD_DEL:
+		if (!dset_data_test(data, DSET_OPT_TYPE))
+			FAILURE("Broken %s event: missing type!",
+					cmd2name[cmd]);
+		/* The elements of a batch come in one event */
+		if (nla[DSET_ATTR_DATA])
+			ret = notify_elem(session, cmd, nla[DSET_ATTR_DATA]);
+		else if (nla[DSET_ATTR_ADT])
+			mnl_attr_for_each_nested(tb, nla[DSET_ATTR_ADT])
+			{
+				ret = notify_elem(session, cmd, tb);
+				if (ret != MNL_CB_OK)
+					break;
+			}
+		break;
+	default:
+		session->notify_ret = session->notify_fn(session, cmd,
+												 session->notify_p);
+		ret = session->notify_ret < 0 ? MNL_CB_ERROR : MNL_CB_OK;
+		break;
+	}
+	dset_data_reset(data);
+	return ret;
+}
+
 static int
 callback_data(const struct nlmsghdr *nlh, void *data)
 {
@@ -1289,6 +1753,8 @@ callback_data(const struct nlmsghdr *nlh, void *data)
 
 	D("called, nlmsg_len %u", nlh->nlmsg_len);
 	cmd = dset_get_nlmsg_type(nlh);
+	if (session->notify_fn)
+		return callback_notify(session, nlh, cmd);
 	if (cmd == DSET_CMD_LIST && session->cmd == DSET_CMD_SAVE)
 		/* Kernel always send DSET_CMD_LIST */
 		cmd = DSET_CMD_SAVE;
@@ -1346,13 +1812,22 @@ callback_data(const struct nlmsghdr *nlh, void *data)
 }
 
 static int
-callback_done(const struct nlmsghdr *nlh UNUSED, void *data)
+callback_done(const struct nlmsghdr *nlh, void *data)
 {
 	struct dset_session *session = data;
 
 	D(" called");
 	if (session->cmd == DSET_CMD_LIST || session->cmd == DSET_CMD_SAVE)
 		return print_set_done(session, true);
+	if (session->cmd == DSET_CMD_CHANGES)
+	{
+		/* The dump of the changes may fail after its start */
+		const int *err = mnl_nlmsg_get_payload(nlh);
+
+		if (nlh->nlmsg_len >= mnl_nlmsg_size(sizeof(int)) && *err < 0)
+			return dset_errcode(session, DSET_CMD_CHANGES, -*err);
+		return MNL_CB_STOP;
+	}
 
 	FAILURE("Invalid message received in non LIST or SAVE state.");
 }
@@ -1588,6 +2063,23 @@ rawdata2attr(struct dset_session *session, struct nlmsghdr *nlh,
 	case MNL_TYPE_NUL_STRING:
 		alen = strlen((const char *)d) + 1;
 		break;
+	case MNL_TYPE_NESTED:
+		if (attr->opt == DSET_OPT_IP)
+		{
+			const struct dset_ipaddr *ip = d;
+			struct nlattr *nested;
+
+			nested = mnl_attr_nest_start(nlh, type);
+			if (ip->family == NFPROTO_IPV4)
+				mnl_attr_put(nlh, DSET_ATTR_IPADDR_IPV4 | NLA_F_NET_BYTEORDER,
+							 sizeof(ip->in), &ip->in);
+			else
+				mnl_attr_put(nlh, DSET_ATTR_IPADDR_IPV6 | NLA_F_NET_BYTEORDER,
+							 sizeof(ip->in6), &ip->in6);
+			mnl_attr_nest_end(nlh, nested);
+			return 0;
+		}
+		break;
 	default:
 		break;
 	}
@@ -1647,6 +2139,32 @@ addattr_adt(struct dset_session *session,
 	return 0;
 }
 
+/* Wait for the replies to the pipelined messages until at most
+ * @window of them are in flight.
+ */
+static int
+commit_drain(struct dset_session *session, unsigned int window)
+{
+	int ret;
+
+	if (session->handle == NULL)
+		return 0;
+
+	ret = session->transport->drain(session->handle,
+									session->rcvbuffer,
+									session->rcvbufsize,
+									window);
+	if (ret < 0)
+	{
+		if (session->report[0] != '\0')
+			return -1;
+		else
+			return dset_err(session,
+							"Internal protocol error");
+	}
+	return 0;
+}
+
 #define PRIVATE_MSG_BUFLEN 256
 
 static int
@@ -1690,6 +2208,11 @@ build_send_private_msg(struct dset_session *session, enum dset_cmd cmd)
 						cmd);
 	}
 
+	/* Replies are matched to the current command */
+	ret = commit_drain(session, 0);
+	if (ret < 0)
+		return ret;
+
 	/* Backup, then restore real command */
 	session->cmd = cmd;
 	ret = session->transport->query(session->handle, buffer, len);
@@ -1707,6 +2230,41 @@ may_aggregate_ad(struct dset_session *session, enum dset_cmd cmd)
 		   STREQ(dset_data_setname(session->data), session->saved_setname);
 }
 
+/* The buffered add/del messages of a restore may be sent without waiting
+ * for their ACKs as long as the command and the set type do not change:
+ * the replies are decoded by those.
+ */
+static inline bool
+may_pipeline_ad(struct dset_session *session, enum dset_cmd cmd,
+				uint32_t lineno)
+{
+	return session->window > 1 &&
+		   session->lineno != 0 && lineno != 0 &&
+		   (cmd == DSET_CMD_ADD || cmd == DSET_CMD_DEL) &&
+		   cmd == session->cmd &&
+		   dset_data_get(session->data, DSET_OPT_TYPE) == session->saved_type;
+}
+
+#define NETNS_RUN_DIR "/var/run/netns/"
+
+/* The owner namespace at attach is named as by "ip netns" or by a path */
+static int
+open_netns(struct dset_session *session, const char *netns)
+{
+	char path[sizeof(NETNS_RUN_DIR) + DSET_MAXNAMELEN];
+
+	if (strchr(netns, '/'))
+		dset_strlcpy(path, netns, sizeof(path));
+	else
+		snprintf(path, sizeof(path), NETNS_RUN_DIR "%s", netns);
+	session->netns_fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (session->netns_fd < 0)
+		return dset_err(session,
+						"Cannot open network namespace %s: %s",
+						netns, strerror(errno));
+	return 0;
+}
+
 static int
 build_msg(struct dset_session *session, bool aggregate)
 {
@@ -1799,6 +2357,61 @@ build_msg(struct dset_session *session, bool aggregate)
 					dset_data_get(data, DSET_OPT_SETNAME2),
 					DSET_ATTR_SETNAME2, cmd_attrs);
 		break;
+	case DSET_CMD_PUBLISH:
+	case DSET_CMD_UNPUBLISH:
+		if (!dset_data_test(data, DSET_SETNAME))
+			return dset_err(session,
+							"Invalid %s command: missing setname",
+							session->cmd == DSET_CMD_PUBLISH ? "publish" : "unpublish");
+		ADDATTR_SETNAME(session, nlh, data);
+		break;
+	case DSET_CMD_ATTACH:
+		if (!dset_data_test(data, DSET_SETNAME))
+			return dset_err(session,
+							"Invalid attach command: missing published setname");
+		if (!dset_data_test(data, DSET_OPT_SETNAME2))
+			return dset_err(session,
+							"Invalid attach command: missing local setname");
+		ADDATTR_SETNAME(session, nlh, data);
+		ADDATTR_RAW(session, nlh,
+					dset_data_get(data, DSET_OPT_SETNAME2),
+					DSET_ATTR_SETNAME2, cmd_attrs);
+		if (dset_data_test(data, DSET_OPT_NETNS))
+		{
+			if (open_netns(session,
+						   dset_data_get(data, DSET_OPT_NETNS)) < 0)
+				return -1;
+			mnl_attr_put_u32(nlh, DSET_ATTR_NETNS_FD, session->netns_fd);
+			ADDATTR(session, nlh, data, DSET_ATTR_NETNS,
+					NFPROTO_UNSPEC, cmd_attrs);
+		}
+		break;
+	case DSET_CMD_CHANGES:
+		if (!dset_data_test(data, DSET_SETNAME))
+			return dset_err(session,
+							"Invalid changes command: missing setname");
+		if (!dset_data_test(data, DSET_OPT_GENERATION))
+			return dset_err(session,
+							"Invalid changes command: missing generation");
+		ADDATTR_SETNAME(session, nlh, data);
+		ADDATTR(session, nlh, data, DSET_ATTR_GENERATION,
+				NFPROTO_UNSPEC, cmd_attrs);
+		break;
+	case DSET_CMD_LOAD:
+		ADDATTR_RAW(session, nlh, session->load_setname,
+					DSET_ATTR_SETNAME, cmd_attrs);
+		ADDATTR_RAW(session, nlh, &session->load,
+					DSET_ATTR_LOAD, cmd_attrs);
+		if (session->load == DSET_LOAD_BEGIN &&
+			dset_data_test(data, DSET_OPT_ELEMENTS))
+		{
+			/* Expected number of elements */
+			open_nested(session, nlh, DSET_ATTR_DATA);
+			ADDATTR(session, nlh, data, DSET_ATTR_ELEMENTS,
+					NFPROTO_UNSPEC, create_attrs);
+			close_nested(session, nlh);
+		}
+		break;
 	case DSET_CMD_ADD:
 	case DSET_CMD_DEL:
 	{
@@ -1819,6 +2432,19 @@ build_msg(struct dset_session *session, bool aggregate)
 
 			/* Core options: setname */
 			ADDATTR_SETNAME(session, nlh, data);
+			if (session->load_setname[0] != '\0' &&
+				session->cmd == DSET_CMD_ADD)
+			{
+				/* Bulk load: the elements go to the shadow table */
+				if (!STREQ(dset_data_setname(data),
+						   session->load_setname))
+					return dset_err(session,
+									"Invalid add command: set %s is not "
+									"under bulk load",
+									dset_data_setname(data));
+				ADDATTR_RAW(session, nlh, &session->load,
+							DSET_ATTR_LOAD, cmd_attrs);
+			}
 			if (session->lineno != 0)
 			{
 				/* Restore mode */
@@ -1879,36 +2505,38 @@ build_msg(struct dset_session *session, bool aggregate)
 	return 0;
 }
 
-/**
- * dset_commit - commit buffered commands
- * @session: session structure
- *
- * Commit buffered commands, if there are any.
- *
- * Returns 0 on success or a negative error code.
- */
-int dset_commit(struct dset_session *session)
+static int
+commit_msg(struct dset_session *session, bool pipeline)
 {
 	struct nlmsghdr *nlh;
 	int ret = 0, i;
 
 	assert(session);
 
+	/* Everything else waits for the pipelined messages */
+	if (!pipeline && commit_drain(session, 0) < 0)
+		ret = -1;
+
 	nlh = session->buffer;
-	D("send buffer: len %u, cmd %s",
-	  nlh->nlmsg_len, cmd2name[session->cmd]);
+	D("send buffer: len %u, cmd %s, pipeline %s",
+	  nlh->nlmsg_len, cmd2name[session->cmd], pipeline ? "yes" : "no");
 	if (nlh->nlmsg_len == 0)
 		/* Nothing to do */
-		return 0;
+		return ret;
 
 	/* Close nested data blocks */
 	for (i = session->nestid - 1; i >= 0; i--)
 		close_nested(session, nlh);
 
 	/* Send buffer */
-	ret = session->transport->query(session->handle,
-									session->buffer,
-									session->bufsize);
+	if (ret == 0 && pipeline)
+		ret = session->transport->send(session->handle,
+									   session->buffer,
+									   session->bufsize);
+	else if (ret == 0)
+		ret = session->transport->query(session->handle,
+										session->buffer,
+										session->bufsize);
 
 	/* Reset saved data and nested state */
 	session->saved_setname[0] = '\0';
@@ -1928,9 +2556,25 @@ int dset_commit(struct dset_session *session)
 			return dset_err(session,
 							"Internal protocol error");
 	}
+	if (pipeline)
+		return commit_drain(session, session->window - 1);
 	return 0;
 }
 
+/**
+ * dset_commit - commit buffered commands
+ * @session: session structure
+ *
+ * Commit buffered commands, if there are any, and wait for the
+ * replies to all the pipelined ones.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_commit(struct dset_session *session)
+{
+	return commit_msg(session, false);
+}
+
 static mnl_cb_t cb_ctl[] = {
 	[NLMSG_NOOP] = callback_noop,
 	[NLMSG_ERROR] = callback_error,
@@ -2004,7 +2648,7 @@ int dset_cmd(struct dset_session *session, enum dset_cmd cmd, uint32_t lineno)
 	if (!aggregate)
 	{
 		/* Flush possible aggregated commands */
-		ret = dset_commit(session);
+		ret = commit_msg(session, may_pipeline_ad(session, cmd, lineno));
 		if (ret < 0)
 			return ret;
 	}
@@ -2037,7 +2681,7 @@ int dset_cmd(struct dset_session *session, enum dset_cmd cmd, uint32_t lineno)
 	if (ret > 0)
 	{
 		/* Buffer is full, send buffered commands */
-		ret = dset_commit(session);
+		ret = commit_msg(session, may_pipeline_ad(session, cmd, lineno));
 		if (ret < 0)
 			goto cleanup;
 		ret = build_msg(session, false);
@@ -2065,6 +2709,11 @@ int dset_cmd(struct dset_session *session, enum dset_cmd cmd, uint32_t lineno)
 
 cleanup:
 	D("reset data");
+	if (session->netns_fd >= 0)
+	{
+		close(session->netns_fd);
+		session->netns_fd = -1;
+	}
 	dset_data_reset(data);
 	return ret;
 }
@@ -2105,6 +2754,635 @@ int dset_session_print_outfn(struct dset_session *session,
 	return 0;
 }
 
+/**
+ * dset_session_list_elemfn - set element listing function
+ * @session: session structure
+ * @elemfn: function called for the listed elements
+ * @p: pointer to private area
+ *
+ * When set, @elemfn is called for each element received by a list or
+ * save command, with the element in the session data, instead of
+ * printing it. A negative return value stops the listing. NULL
+ * restores printing.
+ *
+ * Returns 0.
+ */
+int dset_session_list_elemfn(struct dset_session *session,
+							 dset_list_elemfn elemfn, void *p)
+{
+	assert(session);
+	session->list_elemfn = elemfn;
+	session->list_p = p;
+	return 0;
+}
+
+static int
+alloc_buffers(struct dset_session *session, size_t bufsize)
+{
+	/* An error report quotes the whole message */
+	size_t rcvbufsize = bufsize + getpagesize();
+	void *buffer, *rcvbuffer;
+
+	buffer = calloc(1, bufsize);
+	rcvbuffer = calloc(1, rcvbufsize);
+	if (buffer == NULL || rcvbuffer == NULL)
+	{
+		free(buffer);
+		free(rcvbuffer);
+		return -ENOMEM;
+	}
+	free(session->buffer);
+	free(session->rcvbuffer);
+	session->buffer = buffer;
+	session->bufsize = bufsize;
+	session->rcvbuffer = rcvbuffer;
+	session->rcvbufsize = rcvbufsize;
+
+	return 0;
+}
+
+/**
+ * dset_session_bufsize - set the size of the kernel messages
+ * @session: session structure
+ * @bufsize: message size in bytes
+ *
+ * Set the size of the messages the add/del commands are aggregated
+ * into in restore mode. The size is rounded up to the page size and
+ * must not exceed DSET_BUFSIZE_MAX. Buffered commands are committed
+ * before the buffer is replaced.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_bufsize(struct dset_session *session, size_t bufsize)
+{
+	size_t pagesize = getpagesize();
+
+	assert(session);
+
+	if (bufsize == 0 || bufsize > DSET_BUFSIZE_MAX)
+		return dset_err(session,
+						"Message size must be between 1 and %u bytes",
+						DSET_BUFSIZE_MAX);
+	bufsize = (bufsize + pagesize - 1) / pagesize * pagesize;
+	if (bufsize > DSET_BUFSIZE_MAX)
+		bufsize = DSET_BUFSIZE_MAX;
+	if (bufsize == session->bufsize)
+		return 0;
+
+	if (dset_commit(session) < 0)
+		return -1;
+	if (alloc_buffers(session, bufsize) < 0)
+		return dset_err(session, "Cannot allocate message buffer");
+
+	return 0;
+}
+
+/**
+ * dset_session_window - set the number of pipelined messages
+ * @session: session structure
+ * @window: messages in flight
+ *
+ * Set how many add/del messages may be sent in restore mode before
+ * waiting for the ACK of the oldest one. Errors are still reported
+ * with the line number of the failing element, but the lines
+ * following it in the window may already have been applied.
+ * The default of 1 waits for every ACK.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_window(struct dset_session *session, unsigned int window)
+{
+	assert(session);
+
+	if (window == 0 || window > DSET_WINDOW_MAX)
+		return dset_err(session,
+						"Window must be between 1 and %u messages",
+						DSET_WINDOW_MAX);
+	session->window = window;
+
+	return 0;
+}
+
+/**
+ * dset_session_load - begin, commit or abort the bulk load of a set
+ * @session: session structure
+ * @phase: DSET_LOAD_BEGIN, DSET_LOAD_COMMIT or DSET_LOAD_ABORT
+ *
+ * At begin the set is named by the setname in the session data and
+ * the expected number of elements may be given by the elements option.
+ * From then on the added elements of the set go to a shadow table in
+ * the kernel, which replaces the content of the set at commit.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_load(struct dset_session *session,
+					  enum dset_load_phase phase)
+{
+	int ret;
+
+	assert(session);
+
+	if (phase == DSET_LOAD_BEGIN)
+	{
+		if (!dset_data_test(session->data, DSET_SETNAME))
+			return dset_err(session,
+							"Invalid load command: missing setname");
+		dset_strlcpy(session->load_setname,
+					 dset_data_setname(session->data), DSET_MAXNAMELEN);
+	}
+	else if (phase == DSET_LOAD_DATA ||
+			 session->load_setname[0] == '\0')
+		return dset_err(session, "No bulk load is in progress");
+
+	session->load = phase;
+	ret = dset_cmd(session, DSET_CMD_LOAD, 0);
+	session->load = DSET_LOAD_DATA;
+	/* A failed commit may still be aborted */
+	if (phase == DSET_LOAD_BEGIN ? ret < 0
+								 : (ret == 0 || phase == DSET_LOAD_ABORT))
+		session->load_setname[0] = '\0';
+
+	return ret;
+}
+
+/**
+ * dset_session_image_save - save the image of a set
+ * @session: session structure
+ *
+ * Write the image of the set named by the setname in the session data
+ * to the output stream of the session. The image holds the elements
+ * as the kernel lists them, see dset_session_image_load().
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_image_save(struct dset_session *session)
+{
+	struct dset_image image = {
+		.f = session->ostream,
+	};
+	struct dset_image_head head = {
+		.magic = DSET_IMAGE_MAGIC,
+		.version = DSET_IMAGE_VERSION,
+	};
+	struct dset_image_end end;
+	enum dset_output_mode mode = session->mode;
+	int ret;
+
+	assert(session);
+
+	if (!dset_data_test(session->data, DSET_SETNAME))
+		return dset_err(session,
+						"Invalid snapshot command: missing setname");
+	/* Check protocol version */
+	if (dset_cmd(session, DSET_CMD_NONE, 0) < 0)
+		return -1;
+
+	head.protocol = session->protocol;
+	if (fwrite(&head, sizeof(head), 1, image.f) != 1)
+		return dset_err(session, "Cannot write image: %s",
+						strerror(errno));
+
+	/* Nothing is printed while the set is listed into the image */
+	session->image = &image;
+	session->mode = DSET_LIST_SAVE;
+	ret = dset_cmd(session, DSET_CMD_SAVE, 0);
+	session->image = NULL;
+	session->mode = mode;
+	if (ret < 0)
+		return ret;
+	if (!image.set)
+		return dset_err(session, "Kernel did not list the set");
+
+	end.elements = image.elements;
+	end.crc = image.crc;
+	session->image = &image;
+	ret = image_write(session, DSET_IMAGE_END, &end, sizeof(end));
+	session->image = NULL;
+	if (ret == 0 && fflush(image.f) != 0)
+		return dset_err(session, "Cannot write image: %s",
+						strerror(errno));
+	return ret;
+}
+
+/* Read the next record of an image into rec, which can hold any */
+static int
+image_read(struct dset_session *session, FILE *f, struct nlattr *rec,
+		   uint32_t *crc)
+{
+	size_t len;
+
+	if (fread(rec, sizeof(*rec), 1, f) != 1)
+		return dset_err(session, "Broken image: %s",
+						ferror(f) ? strerror(errno) : "truncated");
+	if (rec->nla_len < MNL_ATTR_HDRLEN)
+		return dset_err(session, "Broken image: invalid record");
+	len = MNL_ALIGN(rec->nla_len) - MNL_ATTR_HDRLEN;
+	if (fread(mnl_attr_get_payload(rec), 1, len, f) != len)
+		return dset_err(session, "Broken image: %s",
+						ferror(f) ? strerror(errno) : "truncated");
+	if (rec->nla_type != DSET_IMAGE_END)
+		*crc = image_crc(*crc, rec, MNL_ATTR_HDRLEN + len);
+	return rec->nla_type;
+}
+
+/* Create the set from the set record, unless the same set exists */
+static int
+image_create(struct dset_session *session, struct nlattr *tb[])
+{
+	struct nlmsghdr *nlh = session->buffer;
+	const struct nlattr *attr;
+	struct nlattr *nested;
+
+	if (mnl_attr_get_len(tb[DSET_ATTR_DATA]) + DSET_IMAGE_SETLEN >
+		session->bufsize)
+		return dset_err(session, "Broken image: invalid set record");
+
+	session->transport->fill_hdr(session->handle, DSET_CMD_CREATE,
+								 session->buffer, session->bufsize,
+								 session->envopts | DSET_ENV_EXIST);
+	ADDATTR_PROTOCOL(nlh, session->protocol);
+	ADDATTR_SETNAME(session, nlh, session->data);
+	mnl_attr_put(nlh, DSET_ATTR_TYPENAME,
+				 mnl_attr_get_payload_len(tb[DSET_ATTR_TYPENAME]),
+				 mnl_attr_get_payload(tb[DSET_ATTR_TYPENAME]));
+	mnl_attr_put_u8(nlh, DSET_ATTR_REVISION,
+					mnl_attr_get_u8(tb[DSET_ATTR_REVISION]));
+	mnl_attr_put_u8(nlh, DSET_ATTR_FAMILY,
+					mnl_attr_get_u8(tb[DSET_ATTR_FAMILY]));
+	nested = mnl_attr_nest_start(nlh, DSET_ATTR_DATA);
+	mnl_attr_for_each_nested(attr, tb[DSET_ATTR_DATA])
+		mnl_attr_put(nlh, attr->nla_type,
+					 mnl_attr_get_payload_len(attr),
+					 mnl_attr_get_payload(attr));
+	mnl_attr_nest_end(nlh, nested);
+
+	session->cmd = DSET_CMD_CREATE;
+	return commit_msg(session, false);
+}
+
+/* Aggregate the element records into bulk load messages */
+static int
+image_add(struct dset_session *session, const char *setname,
+		  const struct nlattr *rec, uint32_t lineno)
+{
+	struct nlmsghdr *nlh = session->buffer;
+	uint8_t load = DSET_LOAD_DATA;
+	size_t len = MNL_ALIGN(mnl_attr_get_payload_len(rec));
+	/* The element, its line number and room for the error report */
+	size_t need = 2 * MNL_ATTR_HDRLEN + len + MNL_ALIGN(sizeof(lineno)) +
+				  MNL_ALIGN(sizeof(struct nlmsgerr));
+	struct nlattr *nested;
+
+	if (nlh->nlmsg_len != 0 && nlh->nlmsg_len + need > session->bufsize &&
+		commit_msg(session, session->window > 1) < 0)
+		return -1;
+
+	session->cmd = DSET_CMD_ADD;
+	session->lineno = lineno;
+	if (nlh->nlmsg_len == 0)
+	{
+		session->transport->fill_hdr(session->handle, DSET_CMD_ADD,
+									 session->buffer, session->bufsize,
+									 session->envopts);
+		ADDATTR_PROTOCOL(nlh, session->protocol);
+		ADDATTR_RAW(session, nlh, setname,
+					DSET_ATTR_SETNAME, cmd_attrs);
+		ADDATTR_RAW(session, nlh, &load, DSET_ATTR_LOAD, cmd_attrs);
+		ADDATTR_RAW(session, nlh, &lineno,
+					DSET_ATTR_LINENO, cmd_attrs);
+		open_nested(session, nlh, DSET_ATTR_ADT);
+		if (nlh->nlmsg_len + need > session->bufsize)
+			return dset_err(session,
+							"Image element is too large for the "
+							"message size");
+	}
+
+	nested = mnl_attr_nest_start(nlh, DSET_ATTR_DATA);
+	memcpy(mnl_nlmsg_get_payload_tail(nlh),
+		   mnl_attr_get_payload(rec), len);
+	nlh->nlmsg_len += len;
+	ADDATTR_RAW(session, nlh, &lineno, DSET_ATTR_LINENO, cmd_attrs);
+	mnl_attr_nest_end(nlh, nested);
+
+	return 0;
+}
+
+/* Drop the unsent elements and the shadow table of the failed load */
+static void
+image_abort(struct dset_session *session)
+{
+	struct nlmsghdr *nlh = session->buffer;
+	char report[DSET_ERRORBUFLEN];
+	enum dset_err_type err_type = session->err_type;
+	int i;
+
+	for (i = session->nestid - 1; i >= 0; i--)
+		session->nested[i] = NULL;
+	session->nestid = 0;
+	nlh->nlmsg_len = 0;
+	session->lineno = 0;
+
+	/* Keep the report of the failure */
+	memcpy(report, session->report, sizeof(report));
+	dset_session_load(session, DSET_LOAD_ABORT);
+	memcpy(session->report, report, sizeof(report));
+	session->err_type = err_type;
+}
+
+/**
+ * dset_session_image_load - load the image of a set
+ * @session: session structure
+ *
+ * Read an image written by dset_session_image_save() from the input
+ * stream of the session. The set is created unless it exists with the
+ * same parameters, then the elements of the image are bulk loaded into
+ * it: the content of the set is replaced only when the whole image
+ * is received and its checksum verified. The setname in the session
+ * data, if any, overrides the name of the set in the image.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_image_load(struct dset_session *session)
+{
+	struct dset_data *data = session->data;
+	FILE *f = session->istream;
+	struct dset_image_head head;
+	struct dset_image_end end;
+	struct nlattr *rec, *tb[DSET_ATTR_CMD_MAX + 1] = {};
+	struct nlattr *cattr[DSET_ATTR_CREATE_MAX + 1] = {};
+	struct nlattr *adt[DSET_ATTR_ADT_MAX + 1];
+	const struct dset_type *type;
+	char setname[DSET_MAXNAMELEN];
+	uint32_t elements = 0, crc = 0;
+	uint8_t revision;
+	int ret;
+
+	assert(session);
+
+	/* Check protocol version */
+	if (dset_cmd(session, DSET_CMD_NONE, 0) < 0 ||
+		dset_commit(session) < 0)
+		return -1;
+
+	if (fread(&head, sizeof(head), 1, f) != 1 ||
+		memcmp(head.magic, DSET_IMAGE_MAGIC, sizeof(head.magic)) != 0)
+		return dset_err(session, "Input is not a set image");
+	if (bswap_32(head.version) == DSET_IMAGE_VERSION)
+		return dset_err(session,
+						"Image is written on a host with "
+						"different byte order");
+	if (head.version != DSET_IMAGE_VERSION)
+		return dset_err(session, "Unsupported image version %u",
+						head.version);
+	if (head.protocol != session->protocol)
+		return dset_err(session,
+						"Image with protocol %u cannot be loaded "
+						"with protocol %u",
+						head.protocol, session->protocol);
+
+	/* Room for the largest record */
+	rec = malloc(MNL_ALIGN(UINT16_MAX));
+	if (rec == NULL)
+		return dset_err(session, "Cannot allocate image record");
+
+	ret = image_read(session, f, rec, &crc);
+	if (ret < 0)
+		goto out;
+	if (ret != DSET_IMAGE_SET ||
+		mnl_attr_parse_nested(rec, cmd_attr_cb, tb) < MNL_CB_STOP ||
+		!(tb[DSET_ATTR_SETNAME] && tb[DSET_ATTR_TYPENAME] &&
+		  tb[DSET_ATTR_REVISION] && tb[DSET_ATTR_FAMILY] &&
+		  tb[DSET_ATTR_DATA]) ||
+		mnl_attr_parse_nested(tb[DSET_ATTR_DATA],
+							  create_attr_cb, cattr) < MNL_CB_STOP)
+	{
+		ret = dset_err(session, "Broken image: invalid set record");
+		goto out;
+	}
+
+	if (!dset_data_test(data, DSET_SETNAME))
+		dset_data_set(data, DSET_SETNAME,
+					  mnl_attr_get_payload(tb[DSET_ATTR_SETNAME]));
+	dset_strlcpy(setname, dset_data_setname(data), DSET_MAXNAMELEN);
+	revision = mnl_attr_get_u8(tb[DSET_ATTR_REVISION]);
+	dset_data_set(data, DSET_OPT_TYPENAME,
+				  mnl_attr_get_payload(tb[DSET_ATTR_TYPENAME]));
+	dset_data_set(data, DSET_OPT_REVISION, &revision);
+	type = dset_type_check(session);
+	if (type == NULL)
+	{
+		ret = -1;
+		goto out;
+	}
+
+	ret = image_create(session, tb);
+	dset_data_reset(data);
+	if (ret < 0)
+		goto out;
+
+	/* The element count of the saved set presizes the shadow table */
+	dset_data_set(data, DSET_SETNAME, setname);
+	if (cattr[DSET_ATTR_ELEMENTS])
+	{
+		uint32_t hint = ntohl(mnl_attr_get_u32(cattr[DSET_ATTR_ELEMENTS]));
+
+		dset_data_set(data, DSET_OPT_ELEMENTS, &hint);
+	}
+	ret = dset_session_load(session, DSET_LOAD_BEGIN);
+	if (ret < 0)
+		goto out;
+
+	session->saved_type = type;
+	for (;;)
+	{
+		ret = image_read(session, f, rec, &crc);
+		if (ret < 0)
+			goto abort;
+		if (ret == DSET_IMAGE_END)
+			break;
+		memset(adt, 0, sizeof(adt));
+		if (ret != DSET_IMAGE_ELEM ||
+			mnl_attr_parse_nested(rec, adt_attr_cb, adt) < MNL_CB_STOP)
+		{
+			ret = dset_err(session,
+						   "Broken image: invalid element record");
+			goto abort;
+		}
+		ret = image_add(session, setname, rec, ++elements);
+		if (ret < 0)
+			goto abort;
+	}
+
+	if (mnl_attr_get_payload_len(rec) != sizeof(end))
+	{
+		ret = dset_err(session, "Broken image: invalid end record");
+		goto abort;
+	}
+	memcpy(&end, mnl_attr_get_payload(rec), sizeof(end));
+	if (end.elements != elements || end.crc != crc)
+	{
+		ret = dset_err(session, "Broken image: checksum mismatch");
+		goto abort;
+	}
+
+	ret = dset_commit(session);
+	if (ret < 0)
+		goto abort;
+	session->lineno = 0;
+	ret = dset_session_load(session, DSET_LOAD_COMMIT);
+	if (ret < 0)
+		goto abort;
+	goto out;
+
+abort:
+	image_abort(session);
+out:
+	session->lineno = 0;
+	dset_data_reset(data);
+	free(rec);
+	return ret < 0 ? ret : 0;
+}
+
+/**
+ * dset_session_subscribe - subscribe to the changes of the sets
+ * @session: session structure
+ * @notifyfn: function called for the changes
+ * @p: pointer to private area
+ *
+ * Join the multicast group on which the kernel publishes the changes
+ * made to the sets from userspace. The changes are received by
+ * dset_session_receive(): @notifyfn is called with the command and
+ * the setnames, the type and the element of the change in the session
+ * data. The session cannot be used to send commands afterwards.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+int dset_session_subscribe(struct dset_session *session,
+						   dset_notify_fn notifyfn, void *p)
+{
+	size_t rcvbufsize = DSET_BUFSIZE_MAX + getpagesize();
+	void *rcvbuffer;
+
+	assert(session);
+	assert(notifyfn);
+
+	/* Check protocol version */
+	if (dset_cmd(session, DSET_CMD_NONE, 0) < 0 ||
+		dset_commit(session) < 0)
+		return -1;
+
+	/* The elements of a restore message come in one event */
+	if (session->rcvbufsize < rcvbufsize)
+	{
+		rcvbuffer = calloc(1, rcvbufsize);
+		if (rcvbuffer == NULL)
+			return dset_err(session,
+							"Cannot allocate receive buffer");
+		free(session->rcvbuffer);
+		session->rcvbuffer = rcvbuffer;
+		session->rcvbufsize = rcvbufsize;
+	}
+
+	if (session->transport->subscribe(session->handle) < 0)
+		return dset_err(session,
+						"Cannot subscribe to the changes: %s",
+						strerror(errno));
+	session->notify_fn = notifyfn;
+	session->notify_p = p;
+
+	return 0;
+}
+
+/**
+ * dset_session_receive - receive changes of the sets
+ * @session: session structure
+ *
+ * Wait for the next changes published by the kernel and call the
+ * notify function of dset_session_subscribe() for each of them. When
+ * the receive buffer of the socket overruns, changes are lost and an
+ * error is reported: the sets have to be listed again.
+ *
+ * Returns 0 on success, the negative return value of the notify
+ * function or a negative error code.
+ */
+int dset_session_receive(struct dset_session *session)
+{
+	int ret;
+
+	assert(session);
+
+	if (!session->notify_fn)
+		return dset_err(session,
+						"Session is not subscribed to the changes");
+
+	session->notify_ret = 0;
+	ret = session->transport->receive(session->handle,
+									  session->rcvbuffer,
+									  session->rcvbufsize);
+	if (session->notify_ret < 0)
+		return session->notify_ret;
+	if (ret >= 0)
+		return 0;
+	if (session->report[0] != '\0')
+		return -1;
+	if (errno == ENOBUFS)
+		return dset_err(session,
+						"Changes are lost, the sets have to be "
+						"listed again");
+	return dset_err(session, "Cannot receive the changes: %s",
+					strerror(errno));
+}
+
+/**
+ * dset_session_changes - get the changes of a set since a generation
+ * @session: session structure
+ * @notifyfn: function called for the changes
+ * @p: pointer to private area
+ *
+ * Ask the kernel for the changes of the set named in the session data
+ * since the generation in the session data, which is the generation of
+ * a listing or of a change seen before. @notifyfn is called first with
+ * DSET_CMD_CHANGES and the current generation of the set, then for the
+ * changes in order like at dset_session_receive(), with the generation
+ * of each change. When the changes are not kept anymore by the kernel,
+ * an error is reported and the set has to be listed again.
+ *
+ * Returns 0 on success, the negative return value of the notify
+ * function or a negative error code.
+ */
+int dset_session_changes(struct dset_session *session,
+						 dset_notify_fn notifyfn, void *p)
+{
+	size_t bufsize;
+	int ret;
+
+	assert(session);
+	assert(notifyfn);
+
+	if (session->notify_fn)
+		return dset_err(session,
+						"Session is subscribed to the changes");
+	/* The replies are received into the message buffer and the
+	 * elements of a restore message come in one change
+	 */
+	bufsize = session->bufsize;
+	if (dset_session_bufsize(session, DSET_BUFSIZE_MAX) < 0)
+		return -1;
+
+	session->notify_fn = notifyfn;
+	session->notify_p = p;
+	session->notify_ret = 0;
+	ret = dset_cmd(session, DSET_CMD_CHANGES, 0);
+	session->notify_fn = NULL;
+	session->notify_p = NULL;
+	if (session->notify_ret < 0)
+		ret = session->notify_ret;
+
+	if (dset_session_bufsize(session, bufsize) < 0 && ret == 0)
+		ret = -1;
+	return ret;
+}
+
 /**
  * dset_session_init - initialize an dset session
  * @outfn: output printing function
@@ -2120,18 +3398,19 @@ struct dset_session *
 dset_session_init(dset_print_outfn print_outfn, void *p)
 {
 	struct dset_session *session;
-	size_t bufsize = getpagesize();
 
 	/* Create session object */
-	session = calloc(1, sizeof(struct dset_session) + bufsize);
+	session = calloc(1, sizeof(struct dset_session));
 	if (session == NULL)
 		return NULL;
 	session->outbuf = calloc(1, DSET_OUTBUFLEN);
 	if (session->outbuf == NULL)
 		goto free_session;
 	session->outbuflen = DSET_OUTBUFLEN;
-	session->bufsize = bufsize;
-	session->buffer = session + 1;
+	if (alloc_buffers(session, getpagesize()) < 0)
+		goto free_outbuf;
+	session->window = 1;
+	session->netns_fd = -1;
 	session->istream = stdin;
 	session->ostream = stdout;
 	session->protocol = DSET_PROTOCOL;
@@ -2147,11 +3426,14 @@ dset_session_init(dset_print_outfn print_outfn, void *p)
 	/* Initialize data structures */
 	session->data = dset_data_init();
 	if (session->data == NULL)
-		goto free_outbuf;
+		goto free_buffers;
 
 	dset_cache_init();
 	return session;
 
+free_buffers:
+	free(session->buffer);
+	free(session->rcvbuffer);
 free_outbuf:
 	free(session->outbuf);
 free_session:
@@ -2395,6 +3677,8 @@ int dset_session_fini(struct dset_session *session)
 		list_del(&pos->list);
 		free(pos);
 	}
+	free(session->buffer);
+	free(session->rcvbuffer);
 	free(session->outbuf);
 	free(session);
 	return 0;
@@ -0,0 +1,27 @@
+# Batch: Generate the commands of a large set
+0 (echo create test hash:domain hashsize 64; seq 3000 | sed 's/^/add test d/; s/$/.example.com/') > .foo.restore
+# Batch: Restore the elements in large messages
+0 dset -buffer 65536 restore < .foo.restore
+# Batch: All elements are added
+0 dset list test | grep -q '^Number of entries: 3000$'
+# Batch: Hash is grown for the batches
+0 ! dset list -t test | grep -q '^Header: hashsize 64 '
+# Batch: First and last elements can be tested
+0 dset test test d1.example.com && dset test test d3000.example.com
+# Batch: Delete the elements in large messages
+0 grep '^add ' .foo.restore | sed 's/^add/del/' | dset -buffer 65536 restore
+# Batch: All elements are deleted
+0 dset list test | grep -q '^Number of entries: 0$'
+# Batch: Destroy set
+0 dset destroy test
+# Batch: Generate more elements than the set can hold
+0 (echo create test hash:domain maxelem 100; seq 150 | sed 's/^/add test d/; s/$/.example.com/') > .foo.restore
+# Batch: Restore stops when the set is full
+1 dset -buffer 65536 restore < .foo.restore
+# Batch: Error reports the first element over the limit
+0 grep -q 'Error in line 102:' .foo.err
+# Batch: Set holds the elements up to the limit
+0 dset list test | grep -q '^Number of entries: 100$'
+# Batch: Destroy set
+0 dset destroy test
+# eof
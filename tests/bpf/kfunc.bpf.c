@@ -0,0 +1,38 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* XDP program calling bpf_xdp_dset_test() for kfunc_run */
+
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+#include "kfunc.h"
+
+extern int bpf_xdp_dset_test(struct xdp_md *x, __u32 index, __u32 offset,
+			     __u32 flags) __ksym;
+
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(max_entries, 1);
+	__type(key, __u32);
+	__type(value, struct kfunc_args);
+} args SEC(".maps");
+
+SEC("xdp")
+int kfunc_test(struct xdp_md *ctx)
+{
+	struct kfunc_args *a;
+	__u32 key = 0;
+
+	a = bpf_map_lookup_elem(&args, &key);
+	if (!a)
+		return XDP_ABORTED;
+
+	a->ret = bpf_xdp_dset_test(ctx, a->index, a->offset, a->flags);
+
+	return XDP_PASS;
+}
+
+char _license[] SEC("license") = "GPL";
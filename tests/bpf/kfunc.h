@@ -0,0 +1,18 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef KFUNC_H
+#define KFUNC_H
+
+/* Arguments of the kfunc call, passed in the single element of the
+ * args map, and its return value.
+ */
+struct kfunc_args {
+	__u32 index;
+	__u32 offset;
+	__u32 flags;
+	__s32 ret;
+};
+
+#endif /* KFUNC_H */
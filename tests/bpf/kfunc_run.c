@@ -0,0 +1,271 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Run bpf_xdp_dset_test() through BPF_PROG_TEST_RUN on a DNS packet
+ *
+ * kfunc_run [-f FLAGS] [-o OFFSET] [-l LENGTH] [-c CNAME] [-p] SETNAME QNAME
+ *
+ * builds an Ethernet/IPv4/UDP packet carrying a query for QNAME, or a
+ * response with a CNAME answer pointing QNAME to CNAME, and tests it
+ * against the set SETNAME. The options pass other kfunc flags or DNS
+ * offset, truncate the packet to LENGTH bytes and replace the question
+ * by a compression pointer to itself. Without arguments the program is
+ * loaded only, to check that the kernel provides the kfunc.
+ *
+ * Exit status: 0 if the packet matches, 1 if it does not, 2 if the
+ * kfunc rejects the arguments and 3 on any other failure.
+ */
+
+#include <errno.h>      /* errno */
+#include <libgen.h>     /* dirname */
+#include <limits.h>     /* PATH_MAX */
+#include <linux/bpf.h>  /* XDP_PASS */
+#include <linux/if_ether.h> /* ETH_P_IP */
+#include <netinet/in.h> /* IPPROTO_* */
+#include <stdio.h>      /* fprintf */
+#include <stdlib.h>     /* strtoul */
+#include <string.h>     /* strlen */
+#include <sys/socket.h> /* getsockopt */
+#include <unistd.h>     /* getopt */
+
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+#include <libdset/linux_domain_set.h> /* SO_DOMAIN_SET */
+
+#include "kfunc.h"
+
+#define KFUNC_OBJ	"kfunc.bpf.o"
+#define IP_HLEN		20
+#define UDP_HLEN	8
+#define DNS_OFFSET	(ETH_HLEN + IP_HLEN + UDP_HLEN)
+#define PKT_MAX		1024
+
+enum
+{
+	KFUNC_MATCH,
+	KFUNC_NOMATCH,
+	KFUNC_EINVAL,
+	KFUNC_FAIL,
+};
+
+static domain_set_id_t
+get_set_index(const char *setname)
+{
+	struct domain_set_req_get_set req;
+	socklen_t size = sizeof(req);
+	int fd, ret;
+
+	fd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW);
+	if (fd < 0)
+		return DSET_INVALID_ID;
+
+	memset(&req, 0, sizeof(req));
+	req.op = DOMAIN_SET_OP_GET_BYNAME;
+	req.version = DSET_PROTOCOL;
+	strncpy(req.set.name, setname, DSET_MAXNAMELEN - 1);
+	ret = getsockopt(fd, SOL_IP, SO_DOMAIN_SET, &req, &size);
+	close(fd);
+
+	return ret < 0 ? DSET_INVALID_ID : req.set.index;
+}
+
+/* Encode a dotted name in DNS wire format, return its length */
+static size_t
+put_name(unsigned char *p, const char *name)
+{
+	size_t len = 0, label;
+	const char *dot;
+
+	while (*name)
+	{
+		dot = strchr(name, '.');
+		label = dot ? (size_t)(dot - name) : strlen(name);
+		p[len++] = label;
+		memcpy(p + len, name, label);
+		len += label;
+		name += label;
+		if (*name == '.')
+			name++;
+	}
+	p[len++] = 0;
+
+	return len;
+}
+
+static size_t
+put_u16(unsigned char *p, unsigned int v)
+{
+	p[0] = v >> 8;
+	p[1] = v & 0xff;
+	return 2;
+}
+
+static size_t
+build_packet(unsigned char *pkt, const char *qname, const char *cname,
+			 int selfptr)
+{
+	unsigned char *dns = pkt + DNS_OFFSET, *ip = pkt + ETH_HLEN;
+	unsigned char *udp = ip + IP_HLEN;
+	size_t len = 0, rdlen;
+
+	/* Header: id, flags, qdcount, ancount, nscount, arcount */
+	len += put_u16(dns + len, 0x1234);
+	len += put_u16(dns + len, cname ? 0x8180 : 0x0100);
+	len += put_u16(dns + len, 1);
+	len += put_u16(dns + len, cname ? 1 : 0);
+	len += put_u16(dns + len, 0);
+	len += put_u16(dns + len, 0);
+
+	/* Question */
+	if (selfptr)
+		len += put_u16(dns + len, 0xc000 | len);
+	else
+		len += put_name(dns + len, qname);
+	len += put_u16(dns + len, 1); /* A */
+	len += put_u16(dns + len, 1); /* IN */
+
+	/* Answer owned by the question, compressed */
+	if (cname)
+	{
+		len += put_u16(dns + len, 0xc000 | 12);
+		len += put_u16(dns + len, 5); /* CNAME */
+		len += put_u16(dns + len, 1);
+		len += put_u16(dns + len, 0);
+		len += put_u16(dns + len, 300);
+		rdlen = put_name(dns + len + 2, cname);
+		len += put_u16(dns + len, rdlen);
+		len += rdlen;
+	}
+
+	/* UDP */
+	put_u16(udp, cname ? 53 : 40000);
+	put_u16(udp + 2, cname ? 40000 : 53);
+	put_u16(udp + 4, UDP_HLEN + len);
+
+	/* IPv4, loopback to loopback */
+	ip[0] = 0x45;
+	put_u16(ip + 2, IP_HLEN + UDP_HLEN + len);
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	ip[12] = ip[16] = 127;
+	ip[15] = ip[19] = 1;
+
+	/* Ethernet */
+	put_u16(pkt + 12, ETH_P_IP);
+
+	return DNS_OFFSET + len;
+}
+
+int main(int argc, char *argv[])
+{
+	LIBBPF_OPTS(bpf_test_run_opts, topts);
+	struct kfunc_args args = {.offset = DNS_OFFSET};
+	unsigned char pkt[PKT_MAX] = {};
+	char path[PATH_MAX], self[PATH_MAX];
+	const char *cname = NULL;
+	struct bpf_object *obj;
+	struct bpf_program *prog;
+	struct bpf_map *map;
+	size_t len, cut = 0;
+	int c, selfptr = 0, ret = KFUNC_FAIL;
+	__u32 key = 0;
+
+	while ((c = getopt(argc, argv, "f:o:l:c:p")) != -1)
+	{
+		switch (c)
+		{
+		case 'f':
+			args.flags = strtoul(optarg, NULL, 0);
+			break;
+		case 'o':
+			args.offset = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			cut = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cname = optarg;
+			break;
+		case 'p':
+			selfptr = 1;
+			break;
+		default:
+			return KFUNC_FAIL;
+		}
+	}
+	if (optind != argc && optind + 2 != argc)
+	{
+		fprintf(stderr, "Usage: %s [-f FLAGS] [-o OFFSET] [-l LENGTH] "
+				"[-c CNAME] [-p] [SETNAME QNAME]\n", argv[0]);
+		return KFUNC_FAIL;
+	}
+
+	/* The object is built next to the program */
+	snprintf(self, sizeof(self), "%s", argv[0]);
+	snprintf(path, sizeof(path), "%s/%s", dirname(self), KFUNC_OBJ);
+	obj = bpf_object__open_file(path, NULL);
+	if (!obj)
+	{
+		fprintf(stderr, "Cannot open %s\n", path);
+		return KFUNC_FAIL;
+	}
+	if (bpf_object__load(obj))
+	{
+		fprintf(stderr, "Cannot load %s: no bpf_xdp_dset_test kfunc?\n",
+				path);
+		goto out;
+	}
+	if (optind == argc)
+	{
+		ret = KFUNC_MATCH;
+		goto out;
+	}
+
+	prog = bpf_object__find_program_by_name(obj, "kfunc_test");
+	map = bpf_object__find_map_by_name(obj, "args");
+	if (!prog || !map)
+		goto out;
+
+	/* An unknown set is passed on as DSET_INVALID_ID */
+	args.index = get_set_index(argv[optind]);
+	if (bpf_map__update_elem(map, &key, sizeof(key), &args, sizeof(args),
+							 BPF_ANY))
+		goto out;
+
+	len = build_packet(pkt, argv[optind + 1], cname, selfptr);
+	if (cut)
+	{
+		if (cut < ETH_HLEN || cut > len)
+		{
+			fprintf(stderr, "Length must be between %d and %zu\n",
+					ETH_HLEN, len);
+			goto out;
+		}
+		len = cut;
+	}
+	topts.data_in = pkt;
+	topts.data_size_in = len;
+	topts.repeat = 1;
+
+	if (bpf_prog_test_run_opts(bpf_program__fd(prog), &topts) ||
+		topts.retval != XDP_PASS)
+	{
+		fprintf(stderr, "Test run failed: %s\n", strerror(errno));
+		goto out;
+	}
+	if (bpf_map__lookup_elem(map, &key, sizeof(key), &args, sizeof(args), 0))
+		goto out;
+
+	printf("%d\n", args.ret);
+	if (args.ret == -EINVAL)
+		ret = KFUNC_EINVAL;
+	else if (args.ret < 0)
+		ret = KFUNC_FAIL;
+	else
+		ret = args.ret ? KFUNC_MATCH : KFUNC_NOMATCH;
+out:
+	bpf_object__close(obj);
+	return ret;
+}
@@ -0,0 +1,55 @@
+# Category: Create a set with categories
+0 dset create test hash:domain categories
+# Category: Add an element with a category identifier
+0 dset add test ads.example.com category 0x1
+# Category: Add an element with a category bitmask
+0 dset add test malware.example.net category 0x6
+# Category: Add an element without category
+0 dset add test example.org
+# Category: Header lists the categories flag
+0 dset list test | grep -q '^Header: .* categories'
+# Category: Category identifier is listed
+0 dset list test | grep -q '^ads.example.com category 1$'
+# Category: Category bitmask is listed
+0 dset list test | grep -q '^malware.example.net category 6$'
+# Category: Save set
+0 dset save test > .foo.saved
+# Category: Destroy set
+0 dset destroy test
+# Category: Restore the saved set
+0 dset restore < .foo.saved
+# Category: Restored set keeps the categories
+0 dset save test | diff -u - .foo.saved
+# Category: Build the rule loader
+skip make -s -C nft
+# Category: Check that the kernel provides the dset expression
+skip ./nft/nft_rule add test
+# Category: Delete the table of the check
+0 ./nft/nft_rule del
+# Category: Load a rule matching category 0x1 only
+0 ./nft/nft_rule add -c 0x1 test
+# Category: Rule is listed with the category mask
+0 ./nft/nft_rule list | grep -q '^dset test flags 0x0 category 0x1 packets 0$'
+# Category: Query for the element of the category matches
+0 ./dnsmsg.sh ads.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Category: Query for an element of other categories does not match
+0 ./dnsmsg.sh malware.example.net && ./nft/nft_rule list | grep -q ' packets 1$'
+# Category: Query for an element without category does not match
+0 ./dnsmsg.sh example.org && ./nft/nft_rule list | grep -q ' packets 1$'
+# Category: Delete the table
+0 ./nft/nft_rule del
+# Category: Load a rule comparing the mapped category to 6
+0 ./nft/nft_rule add -f 0x10 -e 6 test
+# Category: Query for the element of category 6 matches
+0 ./dnsmsg.sh malware.example.net && ./nft/nft_rule list | grep -q ' packets 1$'
+# Category: Query for the element of category 1 does not match
+0 ./dnsmsg.sh ads.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Category: Delete the table
+0 ./nft/nft_rule del
+# Category: Mapping the category without register is rejected
+1 ./nft/nft_rule add -f 0x10 test
+# Category: Mapping both the mark and the category is rejected
+1 ./nft/nft_rule add -f 0x18 -r test
+# Category: Destroy set
+0 dset destroy test
+# eof
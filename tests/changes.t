@@ -0,0 +1,75 @@
+# Changes: Create a set
+0 dset create test hash:domain
+# Changes: Add an element
+0 dset add test a.example.com
+# Changes: Save the set
+0 dset save test > .foo.saved
+# Changes: Save the generation of the set
+0 dset list -terse test | sed -n 's/^Generation: //p' > .foo.gen && test -s .foo.gen
+# Changes: No changes since the generation
+0 dset changes test `cat .foo.gen` > .foo && test `wc -l < .foo` -eq 1
+# Changes: Add elements
+0 dset add test b.example.com
+# Changes: Add another element
+0 dset add test c.example.com
+# Changes: Delete an element
+0 dset del test a.example.com
+# Changes: Failed commands are not logged
+1 dset del test a.example.com
+# Changes: Get the changes since the generation
+0 dset changes test `cat .foo.gen` > .foo1
+# Changes: First line names the set and its current generation
+0 head -n 1 .foo1 | grep -q "^# changes test [0-9][0-9]*$"
+# Changes: Check the changes
+0 tail -n +2 .foo1 > .foo && diff -u .foo changes.t.list0
+# Changes: Restore the saved set under another name
+0 sed 's/ test / copy /' .foo.saved | dset restore
+# Changes: Apply the changes to it
+0 sed 's/ test / copy /' .foo1 | dset -exist restore
+# Changes: Check that the sets are the same
+0 dset save test | sed 's/ test / copy /' | sort > .foo1 && dset save copy | sort > .foo2 && diff -u .foo1 .foo2
+# Changes: Destroy the copy
+0 dset destroy copy
+# Changes: Flush set
+0 dset flush test
+# Changes: Check the changes
+0 dset changes test `cat .foo.gen` | tail -n +2 > .foo && diff -u .foo changes.t.list1
+# Changes: Generation from before the set is refused
+1 dset changes test 0
+# Changes: Save the generation of the set again
+0 dset list -terse test | sed -n 's/^Generation: //p' > .foo.gen && test -s .foo.gen
+# Changes: Add more changes than the log keeps
+0 for i in $(seq 1 5000); do echo add test $i.example.com; done | dset restore
+# Changes: Changes beyond the size of the log are not kept
+1 dset changes test `cat .foo.gen`
+# Changes: Replace the content of the set
+0 dset load test < load.t.restore
+# Changes: Changes from before the load are not kept
+1 dset changes test `cat .foo.gen`
+# Changes: Destroy set
+0 dset destroy test
+# Changes: Create a set with timeout
+0 dset create test hash:domain timeout 100
+# Changes: Changes of a set with timeout are not kept
+1 dset changes test 0
+# Changes: Save the generation of the set with timeout
+0 dset list -terse test | sed -n 's/^Generation: //p' > .foo.gen && test -s .foo.gen
+# Changes: Add an element to the set with timeout
+0 dset add test a.example.com
+# Changes: Generation of the set with timeout still grows
+0 dset list -terse test | sed -n 's/^Generation: //p' > .foo && ! cmp -s .foo .foo.gen
+# Changes: Changes of the set with timeout are not kept
+1 dset changes test `cat .foo.gen`
+# Changes: Publish the set with timeout
+0 dset publish test
+# Changes: Attach the published set
+0 dset attach test link
+# Changes: Changes of an attached set are not kept
+1 dset changes link 0
+# Changes: Destroy the attached set
+0 dset destroy link
+# Changes: Unpublish the set with timeout
+0 dset unpublish test
+# Changes: Destroy set
+0 dset destroy test
+# eof
@@ -0,0 +1,19 @@
+# Concurrent: Create a small set
+0 dset create test hash:domain hashsize 64
+# Concurrent: Add different elements from parallel processes, growing the set
+0 for j in 1 2 3 4; do (for i in $(seq 1 2000); do echo add test $i.$j.example.com; done | dset restore) & done; wait
+# Concurrent: Every element is added
+0 dset list -terse test | grep -q '^Number of entries: 8000$'
+# Concurrent: Elements of every process are in the set
+0 dset test test 2000.1.example.com && dset test test 2000.4.example.com
+# Concurrent: Flush the set
+0 dset flush test
+# Concurrent: Add the same elements from parallel processes
+0 for j in 1 2 3 4; do (for i in $(seq 1 2000); do echo add test $i.example.com; done | dset -exist restore) & done; wait
+# Concurrent: Every element is added once
+0 dset list -terse test | grep -q '^Number of entries: 2000$'
+# Concurrent: Saved elements are unique
+0 dset save test | grep '^add ' | sort | uniq -d | wc -l | grep -q '^0$'
+# Concurrent: Destroy the set
+0 dset destroy test
+# eof
@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Send a DNS message over UDP to 127.0.0.1 port 10053, where nothing
+# listens: the packet path tests see it in the output path.
+#
+# dnsmsg.sh NAME		query for NAME
+# dnsmsg.sh NAME ADDR [TTL]	response to it with an A record of ADDR
+
+hex() {
+	printf '\\x%02x' "$@"
+}
+
+name() {
+	local label
+
+	for label in ${1//./ }; do
+		hex ${#label}
+		printf '%s' $label
+	done
+	hex 0
+}
+
+msg=`hex 0x12 0x34`
+if [ -z "$2" ]; then
+	msg=$msg`hex 0x01 0x00 0 1 0 0 0 0 0 0`
+else
+	msg=$msg`hex 0x81 0x80 0 1 0 1 0 0 0 0`
+fi
+msg=$msg`name $1``hex 0 1 0 1`
+if [ -n "$2" ]; then
+	ttl=${3:-300}
+	msg=$msg`hex 0xc0 12 0 1 0 1`
+	msg=$msg`hex $((ttl >> 24 & 255)) $((ttl >> 16 & 255)) \
+		     $((ttl >> 8 & 255)) $((ttl & 255))`
+	msg=$msg`hex 0 4 ${2//./ }`
+fi
+
+printf "$msg" > /dev/udp/127.0.0.1/10053
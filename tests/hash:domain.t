@@ -0,0 +1,85 @@
+# Domain: Create a set
+0 dset create test hash:domain
+# Domain: Add first element
+0 dset add test example.com
+# Domain: Add second element
+0 dset add test www.example.org
+# Domain: Add the same element again
+1 dset add test example.com
+# Domain: Test first element
+0 dset test test example.com
+# Domain: Test element not added to the set
+1 dset test test example.net
+# Domain: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Domain: Check listing
+0 diff -u -I 'Size in memory.*' .foo hash:domain.t.list0
+# Domain: Save set
+0 dset save test > .foo.saved
+# Domain: Check that the saved header keeps the number of entries
+0 grep -q '^create test hash:domain hashsize 1024 maxelem 65536 elements 2$' .foo.saved
+# Domain: Destroy set
+0 dset destroy test
+# Domain: Restore the saved set
+0 dset restore < .foo.saved
+# Domain: List restored set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Domain: Check listing of restored set
+0 diff -u -I 'Size in memory.*' .foo hash:domain.t.list0
+# Domain: Add an exception for a subdomain
+0 dset add test ads.example.com nomatch
+# Domain: Exception is listed with the nomatch flag
+0 dset list test | grep -q '^ads.example.com nomatch$'
+# Domain: Test the exception
+1 dset test test ads.example.com
+# Domain: Test the domain of the exception
+0 dset test test example.com
+# Domain: Exception is saved with the nomatch flag
+0 dset save test | grep -q '^add test ads.example.com nomatch$'
+# Domain: Add the exception again
+1 dset add test ads.example.com nomatch
+# Domain: Build the rule loader
+skip make -s -C nft
+# Domain: Check that the kernel provides the dset expression
+skip ./nft/nft_rule add test
+# Domain: Delete the table of the check
+0 ./nft/nft_rule del
+# Domain: Load a rule testing the set
+0 ./nft/nft_rule add test
+# Domain: Query for another subdomain of the domain matches
+0 ./dnsmsg.sh www.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Domain: Query for a subdomain of the exception does not match
+0 ./dnsmsg.sh www.ads.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Domain: Delete the table
+0 ./nft/nft_rule del
+# Domain: Load a rule returning the exceptions
+0 ./nft/nft_rule add -f 0x2 test
+# Domain: Query for a subdomain of the exception matches
+0 ./dnsmsg.sh www.ads.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Domain: Query for another subdomain of the domain does not match
+0 ./dnsmsg.sh www.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Domain: Delete the table
+0 ./nft/nft_rule del
+# Domain: Delete the exception
+0 dset del test ads.example.com
+# Domain: Deleted exception is not in the set
+1 dset test test ads.example.com
+# Domain: Destroy set
+0 dset destroy test
+# Domain: Create a set presized for 3000 elements
+0 dset create test hash:domain elements 3000
+# Domain: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Domain: Check that the hash has a bucket per element
+0 diff -u -I 'Size in memory.*' .foo hash:domain.t.list1
+# Domain: Destroy set
+0 dset destroy test
+# Domain: Create a set with more elements than maxelem
+0 dset create test hash:domain maxelem 1000 elements 3000
+# Domain: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Domain: Check that the hash is sized for maxelem only
+0 diff -u -I 'Size in memory.*' .foo hash:domain.t.list2
+# Domain: Destroy set
+0 dset destroy test
+# eof
@@ -0,0 +1,39 @@
+# Kfunc: Build the BPF program and its runner
+skip make -s -C bpf
+# Kfunc: Create a set to test
+0 dset create test hash:domain
+# Kfunc: Add an element
+0 dset add test example.com
+# Kfunc: Check that the kernel provides the kfunc
+skip ./bpf/kfunc_run
+# Kfunc: Query for a subdomain of an element matches
+0 ./bpf/kfunc_run test www.example.com >/dev/null
+# Kfunc: Query for the element matches
+0 ./bpf/kfunc_run test example.com >/dev/null
+# Kfunc: Query for another domain does not match
+1 ./bpf/kfunc_run test example.org >/dev/null
+# Kfunc: Query tested against a missing set does not match
+1 ./bpf/kfunc_run nonexistent www.example.com >/dev/null
+# Kfunc: Skipping the counter update is accepted
+0 ./bpf/kfunc_run -f 0x8 test www.example.com >/dev/null
+# Kfunc: Unknown flags are rejected
+2 ./bpf/kfunc_run -f 0x1 test www.example.com >/dev/null
+# Kfunc: DNS offset beyond the packet is rejected
+2 ./bpf/kfunc_run -o 1000 test www.example.com >/dev/null
+# Kfunc: Packet shorter than a DNS header is rejected
+2 ./bpf/kfunc_run -l 50 test www.example.com >/dev/null
+# Kfunc: Truncated question does not match
+1 ./bpf/kfunc_run -l 60 test www.example.com >/dev/null
+# Kfunc: Question pointing to itself does not match
+1 ./bpf/kfunc_run -p test www.example.com >/dev/null
+# Kfunc: CNAME target is not tested without answer matching
+1 ./bpf/kfunc_run -c www.example.com test cdn.example.org >/dev/null
+# Kfunc: CNAME target behind a compressed owner matches
+0 ./bpf/kfunc_run -f 0x800 -c www.example.com test cdn.example.org >/dev/null
+# Kfunc: Deleted element does not match anymore
+0 dset del test example.com
+# Kfunc: Query for a subdomain of the deleted element
+1 ./bpf/kfunc_run test www.example.com >/dev/null
+# Kfunc: Destroy the set
+0 dset destroy test
+# eof
@@ -0,0 +1,61 @@
+# Learn: Check that iptables supports the DSET target
+skip ./target.sh check
+# Learn: Create the set of the learnt addresses
+0 dset create test hash:ip timeout 3600
+# Learn: Create the set of the names to learn
+0 dset create names hash:domain
+# Learn: Add a domain to learn
+0 dset add names example.com
+# Learn: Create the chain of the rules
+0 ./target.sh start
+# Learn: Learn the answers for the names of the set
+0 ./target.sh add -M --match-set names dst -j DSET --add-set test dst --learn-answers
+# Learn: Send a response for a subdomain
+0 ./dnsmsg.sh www.example.com 192.0.2.1 300
+# Learn: Address of the answer is learnt
+0 dset test test 192.0.2.1
+# Learn: Learnt address expires with the TTL of its record
+0 dset list test | grep -qE '^192.0.2.1 timeout (29[0-9]|300)$'
+# Learn: Send a response for a name not in the set
+0 ./dnsmsg.sh www.example.org 192.0.2.2
+# Learn: Address of the other name is not learnt
+1 dset test test 192.0.2.2
+# Learn: Send a query
+0 ./dnsmsg.sh www.example.com
+# Learn: Nothing is learnt from a query
+0 dset list test | grep -q '^Number of entries: 1$'
+# Learn: Learn every response with a timeout cap
+0 ./target.sh flush && ./target.sh add -j DSET --add-set test dst --learn-answers --timeout 10
+# Learn: Send a response with a long TTL
+0 ./dnsmsg.sh www.example.net 192.0.2.3 600
+# Learn: TTL is capped by the timeout of the rule
+0 dset list test | grep -qE '^192.0.2.3 timeout ([0-9]|10)$'
+# Learn: Send a response with a zero TTL
+0 ./dnsmsg.sh www.example.net 192.0.2.4 0
+# Learn: Address of a zero TTL is learnt
+0 dset test test 192.0.2.4
+# Learn: Address of a zero TTL expires after one second
+0 sleep 2
+# Learn: Address of a zero TTL has expired
+1 dset test test 192.0.2.4
+# Learn: Delete the answers instead
+0 ./target.sh flush && ./target.sh add -j DSET --del-set test dst --learn-answers
+# Learn: Send the first response again
+0 ./dnsmsg.sh www.example.com 192.0.2.1
+# Learn: Address of the answer is deleted
+1 dset test test 192.0.2.1
+# Learn: Delete the chain
+0 ./target.sh stop
+# Learn: Build the rule loader
+skip make -s -C nft
+# Learn: Check that the kernel provides the dset expression
+skip ./nft/nft_rule add test
+# Learn: Delete the table of the check
+0 ./nft/nft_rule del
+# Learn: Set of addresses is rejected with the TLS SNI payload
+1 ./nft/nft_rule add -p 1 test
+# Learn: Set of addresses is rejected with the HTTP Host payload
+1 ./nft/nft_rule add -p 2 test
+# Learn: Destroy the sets
+0 dset destroy test && dset destroy names
+# eof
@@ -0,0 +1,71 @@
+# List: Create the first member set
+0 dset create malware hash:domain
+# List: Create the second member set
+0 dset create ads hash:domain
+# List: Create a list of sets
+0 dset create blocked list:set
+# List: Add the first member
+0 dset add blocked malware
+# List: Add the second member after the first one
+0 dset add blocked ads after malware
+# List: Add the same member again
+1 dset add blocked malware
+# List: Add a set which does not exist
+1 dset add blocked missing
+# List: Create another list of sets
+0 dset create other list:set
+# List: A list of sets cannot be a member
+1 dset add blocked other
+# List: Destroy the other list
+0 dset destroy other
+# List: Test the member after the first one
+0 dset test blocked ads after malware
+# List: Test the member before the first one
+1 dset test blocked ads before malware
+# List: Save the members
+0 dset save blocked | grep '^add ' > .foo
+# List: Check that the members are saved in order
+0 diff -u .foo list:set.t.list0
+# List: Member set cannot be destroyed
+1 dset destroy ads
+# List: Add a domain to the first member
+0 dset add malware example.net
+# List: Add an exception to the first member
+0 dset add malware www.example.org nomatch
+# List: Add the domain of the exception to the second member
+0 dset add ads example.org
+# List: Build the rule loader
+skip make -s -C nft
+# List: Check that the kernel provides the dset expression
+skip ./nft/nft_rule add blocked
+# List: Delete the table of the check
+0 ./nft/nft_rule del
+# List: Load a rule testing the list
+0 ./nft/nft_rule add blocked
+# List: Query matching the first member
+0 ./dnsmsg.sh www.example.net && ./nft/nft_rule list | grep -q ' packets 1$'
+# List: Exception of the first member does not hide the second member
+0 ./dnsmsg.sh www.example.org && ./nft/nft_rule list | grep -q ' packets 2$'
+# List: Query matching no member
+0 ./dnsmsg.sh www.example.com && ./nft/nft_rule list | grep -q ' packets 2$'
+# List: Delete the second member
+0 dset del blocked ads
+# List: Exception of the first member decides now
+0 ./dnsmsg.sh www.example.org && ./nft/nft_rule list | grep -q ' packets 2$'
+# List: Create a new feed
+0 dset create feed hash:domain
+# List: Add a domain to the new feed
+0 dset add feed example.com
+# List: Swap the new feed with the first member
+0 dset swap feed malware
+# List: Domain of the swapped in feed matches
+0 ./dnsmsg.sh www.example.com && ./nft/nft_rule list | grep -q ' packets 3$'
+# List: Domain of the swapped out feed does not match
+0 ./dnsmsg.sh www.example.net && ./nft/nft_rule list | grep -q ' packets 3$'
+# List: Delete the table
+0 ./nft/nft_rule del
+# List: Destroy the list
+0 dset destroy blocked
+# List: Destroy the member sets
+0 dset destroy malware && dset destroy ads && dset destroy feed
+# eof
@@ -0,0 +1,83 @@
+# Load: Create a set
+0 dset create test hash:domain
+# Load: Add an element to be replaced
+0 dset add test old.example.com
+# Load: Replace the content of the set
+0 dset load test < load.t.restore
+# Load: Element of the old content is gone
+1 dset test test old.example.com
+# Load: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Load: Check listing
+0 diff -u -I 'Size in memory.*' .foo load.t.list0
+# Load: Replace the content with a table presized for 3000 elements
+0 dset load test elements 3000 < load.t.restore
+# Load: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Load: Check listing
+0 diff -u -I 'Size in memory.*' .foo load.t.list1
+# Load: Entries of another set are refused
+2 echo 'add other x.example.com' | dset load test
+# Load: Other commands are refused
+2 echo 'del test a.example.com' | dset load test
+# Load: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Load: Check that the set keeps its content after a failed load
+0 diff -u -I 'Size in memory.*' .foo load.t.list1
+# Sync: Make the set hold other entries
+0 dset sync test < load.t.sync
+# Sync: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Sync: Check listing
+0 diff -u -I 'Size in memory.*' .foo load.t.list2
+# Sync: Sync the same entries again
+0 dset sync test < load.t.sync
+# Sync: Check that nothing changed
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0 && diff -u -I 'Size in memory.*' .foo load.t.list2
+# Snapshot: Save the image of the set
+0 dset snapshot test > .foo.image
+# Import: Import the image into a new set
+0 dset import copy < .foo.image
+# Import: Check that the new set is the same
+0 dset save test | sed 's/ test / copy /' | sort > .foo1 && dset save copy | sort > .foo2 && diff -u .foo1 .foo2
+# Import: Destroy the new set
+0 dset destroy copy
+# Import: Flush set
+0 dset flush test
+# Import: Replace the content of the set with the image
+0 dset import test < .foo.image
+# Import: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Import: Check listing
+0 diff -u -I 'Size in memory.*' .foo load.t.list2
+# Import: Truncated image is refused
+1 head -c 64 .foo.image | dset import test
+# Import: Corrupted image is refused
+1 sed 's/d.example/e.example/' .foo.image | dset import test
+# Import: List set
+0 dset list test | grep -Ev 'Revision:|Generation:' > .foo0 && ./sort.sh .foo0
+# Import: Check that the set keeps its content after a failed import
+0 diff -u -I 'Size in memory.*' .foo load.t.list2
+# Load: Destroy set
+0 dset destroy test
+# Load: Generate the commands of 3000 elements
+0 seq 3000 | sed 's/^/add test d/; s/$/.example.com/' > .foo.restore
+# Load: Create a set presized for them
+0 dset create test hash:domain elements 3000
+# Load: Save the header of the set
+0 dset list -t test | grep '^Header:' > .foo1
+# Load: Restore the elements
+0 dset restore < .foo.restore
+# Load: All elements are added
+0 dset list test | grep -q '^Number of entries: 3000$'
+# Load: Check that the hash was not resized by the restore
+0 dset list -t test | grep '^Header:' | diff -u .foo1 -
+# Load: Load the elements into a table presized for them
+0 dset load test elements 3000 < .foo.restore
+# Load: All elements are loaded
+0 dset list test | grep -q '^Number of entries: 3000$'
+# Load: Check that the hash was not resized by the load
+0 dset list -t test | grep '^Header:' | diff -u .foo1 -
+# Load: Destroy set
+0 dset destroy test
+# eof
@@ -0,0 +1,43 @@
+# Monitor: Check that iptables supports the DSET target
+skip ./target.sh check
+# Monitor: Create a set with timeout
+0 dset create test hash:domain timeout 3600
+# Monitor: Start the monitor in the background
+0 dset monitor > .foo.mon & echo $! > .foo.pid
+# Monitor: Let the monitor subscribe
+0 sleep 1
+# Monitor: Check that the kernel publishes the changes
+skip kill -0 $(cat .foo.pid)
+# Monitor: Add an element from userspace
+0 dset add test www.example.org
+# Monitor: Create the chain of the rules
+0 ./target.sh start
+# Monitor: Add the queried names to the set, refreshing the existing ones
+0 ./target.sh add -j DSET --add-set test dst --exist --timeout 600
+# Monitor: Send a query
+0 ./dnsmsg.sh www.example.com
+# Monitor: Send the query again to refresh the element
+0 ./dnsmsg.sh www.example.com
+# Monitor: Send a query for the element added from userspace
+0 ./dnsmsg.sh www.example.org
+# Monitor: Delete the queried names from the set instead
+0 ./target.sh flush && ./target.sh add -j DSET --del-set test dst
+# Monitor: Send the query to delete the element
+0 ./dnsmsg.sh www.example.com
+# Monitor: Send the query for the deleted element again
+0 ./dnsmsg.sh www.example.com
+# Monitor: Wait for the pending events of the packet path
+0 sleep 1
+# Monitor: Stop the monitor
+0 kill $(cat .foo.pid)
+# Monitor: Element added from userspace is published once
+0 [ "$(grep -cE '^add test www.example.org( |$)' .foo.mon)" = 1 ]
+# Monitor: Element inserted by the packet path is published once
+0 [ "$(grep -cE '^add test www.example.com( |$)' .foo.mon)" = 1 ]
+# Monitor: Element removed by the packet path is published once
+0 [ "$(grep -cE '^del test www.example.com( |$)' .foo.mon)" = 1 ]
+# Monitor: Delete the chain
+0 ./target.sh stop
+# Monitor: Destroy the set
+0 dset destroy test
+# eof
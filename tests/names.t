@@ -0,0 +1,31 @@
+# Names: Create a set
+0 dset create test hash:domain
+# Names: Generate a name of the largest length
+0 printf '%063d.%063d.%063d.%061d' 0 0 0 0 | tr 0 a > .foo.name
+# Names: Add the longest name
+0 dset add test `cat .foo.name`
+# Names: Add a short name
+0 dset add test x.org
+# Names: Longest name is listed whole
+0 dset list test | grep -qx `cat .foo.name`
+# Names: Short name is listed
+0 dset list test | grep -qx 'x.org'
+# Names: Save set
+0 dset save test > .foo.saved
+# Names: Longest name is saved whole
+0 grep -qx "add test `cat .foo.name`" .foo.saved
+# Names: Destroy set
+0 dset destroy test
+# Names: Restore the saved set
+0 dset restore < .foo.saved
+# Names: Restored set saves the same
+0 dset save test | diff -u .foo.saved -
+# Names: Add many elements
+0 seq 20000 | sed 's/^/add test n/; s/$/.example.com/' | dset restore
+# Names: Every element is listed over the dump messages
+0 test `dset list test | grep -c 'example.com$'` -eq 20000
+# Names: Every element is saved
+0 test `dset save test | grep -c '^add test n'` -eq 20000
+# Names: Destroy set
+0 dset destroy test
+# eof
@@ -0,0 +1,33 @@
+# Nft: Build the rule loader
+skip make -s -C nft
+# Nft: Create a set to test
+0 dset create test hash:domain
+# Nft: Add an element
+0 dset add test example.com
+# Nft: Check that the kernel provides the dset expression
+skip ./nft/nft_rule add test
+# Nft: Delete the table of the check
+0 ./nft/nft_rule del
+# Nft: Load a rule testing the set
+0 ./nft/nft_rule add test
+# Nft: Rule is listed with the set name
+0 ./nft/nft_rule list | grep -q '^dset test flags 0x0 packets 0$'
+# Nft: Set referenced by the rule cannot be destroyed
+1 dset destroy test
+# Nft: Query for a subdomain of the element matches
+0 ./dnsmsg.sh www.example.com && ./nft/nft_rule list | grep -q ' packets 1$'
+# Nft: Query for another domain does not match
+0 ./dnsmsg.sh www.example.org && ./nft/nft_rule list | grep -q ' packets 1$'
+# Nft: Rule testing a missing set is rejected
+1 ./nft/nft_rule add nonexistent
+# Nft: Inverted match storing into a register is rejected
+1 ./nft/nft_rule add -f 0x1 -r test
+# Nft: Unknown flags are rejected
+1 ./nft/nft_rule add -f 0x100 test
+# Nft: Unknown payload is rejected
+1 ./nft/nft_rule add -p 100 test
+# Nft: Delete the table
+0 ./nft/nft_rule del
+# Nft: Set is not referenced anymore
+0 dset destroy test
+# eof
@@ -0,0 +1,444 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Load, list and delete nftables rules with the dset expression
+ *
+ * nft_rule add [-f FLAGS] [-p PAYLOAD] [-c CATEGORY] [-r] [-e VALUE] SETNAME...
+ * nft_rule list
+ * nft_rule del
+ *
+ * add creates the inet table "dtest" with a base chain on the output
+ * hook, unless they exist, and appends a rule made of a dset expression
+ * testing the sets and of a counter. With -r the expression stores its
+ * result into the first 32 bit register, and with -e VALUE the register
+ * is compared with VALUE before the counter. list prints a line per
+ * rule of the table:
+ *
+ *	dset SETNAME... flags FLAGS [dreg] [category C] [payload P] packets N
+ *
+ * and del deletes the table. nft(8) does not know the expression, so the
+ * messages are built here.
+ *
+ * Exit status: 0 on success, 1 if the kernel rejects a message and 2 on
+ * any other failure.
+ */
+
+#include <endian.h>     /* be64toh */
+#include <errno.h>      /* errno */
+#include <stdio.h>      /* printf */
+#include <stdlib.h>     /* strtoul */
+#include <string.h>     /* strcmp */
+#include <time.h>       /* time */
+#include <unistd.h>     /* getopt */
+#include <arpa/inet.h>  /* htonl */
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>  /* NFPROTO_INET */
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include <linux/netfilter/nft_dset.h>
+
+#define TABLE	"dtest"
+#define CHAIN	"output"
+
+enum
+{
+	NFT_RULE_OK,
+	NFT_RULE_REJECTED,
+	NFT_RULE_FAIL,
+};
+
+struct rule_args
+{
+	uint32_t flags;
+	uint32_t payload;
+	uint32_t category;
+	uint32_t value;
+	int has_payload;
+	int has_category;
+	int has_dreg;
+	int has_value;
+};
+
+static struct mnl_socket *nl;
+static unsigned int portid;
+static uint32_t seq;
+
+static struct nlmsghdr *
+put_msg(void *buf, uint16_t type, uint16_t flags, uint8_t family,
+		uint16_t resid)
+{
+	struct nlmsghdr *nlh = mnl_nlmsg_put_header(buf);
+	struct nfgenmsg *nfg;
+
+	nlh->nlmsg_type = type;
+	nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+	nlh->nlmsg_seq = ++seq;
+
+	nfg = mnl_nlmsg_put_extra_header(nlh, sizeof(*nfg));
+	nfg->nfgen_family = family;
+	nfg->version = NFNETLINK_V0;
+	nfg->res_id = htons(resid);
+
+	return nlh;
+}
+
+static struct nlmsghdr *
+put_nft_msg(struct mnl_nlmsg_batch *b, uint16_t type, uint16_t flags)
+{
+	return put_msg(mnl_nlmsg_batch_current(b),
+				   (NFNL_SUBSYS_NFTABLES << 8) | type,
+				   flags | NLM_F_ACK, NFPROTO_INET, 0);
+}
+
+static void
+put_batch_msg(struct mnl_nlmsg_batch *b, uint16_t type)
+{
+	put_msg(mnl_nlmsg_batch_current(b), type, 0, AF_UNSPEC,
+			NFNL_SUBSYS_NFTABLES);
+	mnl_nlmsg_batch_next(b);
+}
+
+/* Send the batch and wait for the acknowledgement of its messages,
+ * return the first error reported by the kernel
+ */
+static int
+send_batch(struct mnl_nlmsg_batch *b, unsigned int msgs)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	const struct nlmsgerr *err;
+	struct nlmsghdr *nlh;
+	int len;
+
+	if (mnl_socket_sendto(nl, mnl_nlmsg_batch_head(b),
+						  mnl_nlmsg_batch_size(b)) < 0)
+		return -errno;
+
+	while (msgs)
+	{
+		len = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+		if (len < 0)
+			return -errno;
+		for (nlh = (struct nlmsghdr *)buf; mnl_nlmsg_ok(nlh, len);
+			 nlh = mnl_nlmsg_next(nlh, &len))
+		{
+			if (nlh->nlmsg_type != NLMSG_ERROR)
+				continue;
+			err = mnl_nlmsg_get_payload(nlh);
+			if (err->error)
+				return err->error;
+			msgs--;
+		}
+	}
+	return 0;
+}
+
+static void
+put_expr_dset(struct nlmsghdr *nlh, char *sets[], int nsets,
+			  const struct rule_args *args)
+{
+	struct nlattr *elem, *data, *list;
+	int i;
+
+	elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+	mnl_attr_put_strz(nlh, NFTA_EXPR_NAME, "dset");
+	data = mnl_attr_nest_start(nlh, NFTA_EXPR_DATA);
+	list = mnl_attr_nest_start(nlh, NFTA_DSET_SETS);
+	for (i = 0; i < nsets; i++)
+		mnl_attr_put_strz(nlh, NFTA_DSET_SET_NAME, sets[i]);
+	mnl_attr_nest_end(nlh, list);
+	if (args->flags)
+		mnl_attr_put_u32(nlh, NFTA_DSET_FLAGS, htonl(args->flags));
+	if (args->has_dreg)
+		mnl_attr_put_u32(nlh, NFTA_DSET_DREG, htonl(NFT_REG32_00));
+	if (args->has_category)
+		mnl_attr_put_u32(nlh, NFTA_DSET_CATEGORY, htonl(args->category));
+	if (args->has_payload)
+		mnl_attr_put_u32(nlh, NFTA_DSET_PAYLOAD, htonl(args->payload));
+	mnl_attr_nest_end(nlh, data);
+	mnl_attr_nest_end(nlh, elem);
+}
+
+/* The register holds the value in host byte order */
+static void
+put_expr_cmp(struct nlmsghdr *nlh, uint32_t value)
+{
+	struct nlattr *elem, *data, *cmp;
+
+	elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+	mnl_attr_put_strz(nlh, NFTA_EXPR_NAME, "cmp");
+	data = mnl_attr_nest_start(nlh, NFTA_EXPR_DATA);
+	mnl_attr_put_u32(nlh, NFTA_CMP_SREG, htonl(NFT_REG32_00));
+	mnl_attr_put_u32(nlh, NFTA_CMP_OP, htonl(NFT_CMP_EQ));
+	cmp = mnl_attr_nest_start(nlh, NFTA_CMP_DATA);
+	mnl_attr_put(nlh, NFTA_DATA_VALUE, sizeof(value), &value);
+	mnl_attr_nest_end(nlh, cmp);
+	mnl_attr_nest_end(nlh, data);
+	mnl_attr_nest_end(nlh, elem);
+}
+
+static void
+put_expr_counter(struct nlmsghdr *nlh)
+{
+	struct nlattr *elem;
+
+	elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+	mnl_attr_put_strz(nlh, NFTA_EXPR_NAME, "counter");
+	mnl_attr_nest_end(nlh, elem);
+}
+
+static int
+rule_add(char *sets[], int nsets, const struct rule_args *args)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct mnl_nlmsg_batch *b;
+	struct nlmsghdr *nlh;
+	struct nlattr *nest;
+	int ret;
+
+	b = mnl_nlmsg_batch_start(buf, sizeof(buf));
+	put_batch_msg(b, NFNL_MSG_BATCH_BEGIN);
+
+	nlh = put_nft_msg(b, NFT_MSG_NEWTABLE, NLM_F_CREATE);
+	mnl_attr_put_strz(nlh, NFTA_TABLE_NAME, TABLE);
+	mnl_nlmsg_batch_next(b);
+
+	nlh = put_nft_msg(b, NFT_MSG_NEWCHAIN, NLM_F_CREATE);
+	mnl_attr_put_strz(nlh, NFTA_CHAIN_TABLE, TABLE);
+	mnl_attr_put_strz(nlh, NFTA_CHAIN_NAME, CHAIN);
+	mnl_attr_put_strz(nlh, NFTA_CHAIN_TYPE, "filter");
+	nest = mnl_attr_nest_start(nlh, NFTA_CHAIN_HOOK);
+	mnl_attr_put_u32(nlh, NFTA_HOOK_HOOKNUM, htonl(NF_INET_LOCAL_OUT));
+	mnl_attr_put_u32(nlh, NFTA_HOOK_PRIORITY, htonl(0));
+	mnl_attr_nest_end(nlh, nest);
+	mnl_nlmsg_batch_next(b);
+
+	nlh = put_nft_msg(b, NFT_MSG_NEWRULE, NLM_F_CREATE | NLM_F_APPEND);
+	mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, TABLE);
+	mnl_attr_put_strz(nlh, NFTA_RULE_CHAIN, CHAIN);
+	nest = mnl_attr_nest_start(nlh, NFTA_RULE_EXPRESSIONS);
+	put_expr_dset(nlh, sets, nsets, args);
+	if (args->has_value)
+		put_expr_cmp(nlh, args->value);
+	put_expr_counter(nlh);
+	mnl_attr_nest_end(nlh, nest);
+	mnl_nlmsg_batch_next(b);
+
+	put_batch_msg(b, NFNL_MSG_BATCH_END);
+
+	ret = send_batch(b, 3);
+	mnl_nlmsg_batch_stop(b);
+	return ret;
+}
+
+static int
+table_del(void)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct mnl_nlmsg_batch *b;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	b = mnl_nlmsg_batch_start(buf, sizeof(buf));
+	put_batch_msg(b, NFNL_MSG_BATCH_BEGIN);
+	nlh = put_nft_msg(b, NFT_MSG_DELTABLE, 0);
+	mnl_attr_put_strz(nlh, NFTA_TABLE_NAME, TABLE);
+	mnl_nlmsg_batch_next(b);
+	put_batch_msg(b, NFNL_MSG_BATCH_END);
+
+	ret = send_batch(b, 1);
+	mnl_nlmsg_batch_stop(b);
+	return ret;
+}
+
+struct attrs
+{
+	const struct nlattr **tb;
+	unsigned int max;
+};
+
+static int
+attr_cb(const struct nlattr *attr, void *data)
+{
+	struct attrs *a = data;
+	unsigned int type = mnl_attr_get_type(attr);
+
+	if (type <= a->max)
+		a->tb[type] = attr;
+	return MNL_CB_OK;
+}
+
+static void
+parse_nested(const struct nlattr *nest, const struct nlattr **tb,
+			 unsigned int max)
+{
+	struct attrs a = {tb, max};
+
+	mnl_attr_parse_nested(nest, attr_cb, &a);
+}
+
+static void
+print_dset(const struct nlattr *nest)
+{
+	const struct nlattr *tb[NFTA_DSET_MAX + 1] = {};
+	const struct nlattr *set;
+
+	parse_nested(nest, tb, NFTA_DSET_MAX);
+	printf("dset");
+	if (tb[NFTA_DSET_SETS])
+		mnl_attr_for_each_nested(set, tb[NFTA_DSET_SETS])
+			printf(" %s", mnl_attr_get_str(set));
+	if (tb[NFTA_DSET_FLAGS])
+		printf(" flags 0x%x", ntohl(mnl_attr_get_u32(tb[NFTA_DSET_FLAGS])));
+	if (tb[NFTA_DSET_DREG])
+		printf(" dreg");
+	if (tb[NFTA_DSET_CATEGORY])
+		printf(" category 0x%x",
+			   ntohl(mnl_attr_get_u32(tb[NFTA_DSET_CATEGORY])));
+	if (tb[NFTA_DSET_PAYLOAD])
+		printf(" payload %u",
+			   ntohl(mnl_attr_get_u32(tb[NFTA_DSET_PAYLOAD])));
+}
+
+static void
+print_counter(const struct nlattr *nest)
+{
+	const struct nlattr *tb[NFTA_COUNTER_MAX + 1] = {};
+
+	parse_nested(nest, tb, NFTA_COUNTER_MAX);
+	if (tb[NFTA_COUNTER_PACKETS])
+		printf(" packets %llu", (unsigned long long)
+			   be64toh(mnl_attr_get_u64(tb[NFTA_COUNTER_PACKETS])));
+}
+
+static int
+rule_cb(const struct nlmsghdr *nlh, void *data)
+{
+	const struct nlattr *tb[NFTA_RULE_MAX + 1] = {};
+	const struct nlattr *etb[NFTA_EXPR_MAX + 1];
+	struct attrs a = {tb, NFTA_RULE_MAX};
+	const struct nlattr *elem;
+	const char *name;
+
+	mnl_attr_parse(nlh, sizeof(struct nfgenmsg), attr_cb, &a);
+	if (!tb[NFTA_RULE_EXPRESSIONS])
+		return MNL_CB_OK;
+
+	mnl_attr_for_each_nested(elem, tb[NFTA_RULE_EXPRESSIONS])
+	{
+		memset(etb, 0, sizeof(etb));
+		parse_nested(elem, etb, NFTA_EXPR_MAX);
+		if (!etb[NFTA_EXPR_NAME] || !etb[NFTA_EXPR_DATA])
+			continue;
+		name = mnl_attr_get_str(etb[NFTA_EXPR_NAME]);
+		if (strcmp(name, "dset") == 0)
+			print_dset(etb[NFTA_EXPR_DATA]);
+		else if (strcmp(name, "counter") == 0)
+			print_counter(etb[NFTA_EXPR_DATA]);
+	}
+	printf("\n");
+	return MNL_CB_OK;
+}
+
+static int
+rule_list(void)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nlmsghdr *nlh;
+	int ret;
+
+	nlh = put_msg(buf, (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_GETRULE,
+				  NLM_F_DUMP, NFPROTO_INET, 0);
+	mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, TABLE);
+	if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0)
+		return -errno;
+
+	ret = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+	while (ret > 0)
+	{
+		ret = mnl_cb_run(buf, ret, seq, portid, rule_cb, NULL);
+		if (ret <= 0)
+			break;
+		ret = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+	}
+	return ret < 0 ? -errno : 0;
+}
+
+static int
+usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s add [-f FLAGS] [-p PAYLOAD] [-c CATEGORY] "
+			"[-r] [-e VALUE] SETNAME...\n"
+			"       %s list\n"
+			"       %s del\n", prog, prog, prog);
+	return NFT_RULE_FAIL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct rule_args args = {};
+	const char *cmd;
+	int c, ret;
+
+	if (argc < 2)
+		return usage(argv[0]);
+	cmd = argv[1];
+
+	optind = 2;
+	while ((c = getopt(argc, argv, "f:p:c:re:")) != -1)
+	{
+		switch (c)
+		{
+		case 'f':
+			args.flags = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			args.payload = strtoul(optarg, NULL, 0);
+			args.has_payload = 1;
+			break;
+		case 'c':
+			args.category = strtoul(optarg, NULL, 0);
+			args.has_category = 1;
+			break;
+		case 'r':
+			args.has_dreg = 1;
+			break;
+		case 'e':
+			args.value = strtoul(optarg, NULL, 0);
+			args.has_value = args.has_dreg = 1;
+			break;
+		default:
+			return usage(argv[0]);
+		}
+	}
+	if ((strcmp(cmd, "add") == 0) == (optind == argc))
+		return usage(argv[0]);
+
+	nl = mnl_socket_open(NETLINK_NETFILTER);
+	if (!nl || mnl_socket_bind(nl, 0, MNL_SOCKET_AUTOPID) < 0)
+	{
+		perror("mnl_socket");
+		return NFT_RULE_FAIL;
+	}
+	portid = mnl_socket_get_portid(nl);
+	seq = time(NULL);
+
+	if (strcmp(cmd, "add") == 0)
+		ret = rule_add(argv + optind, argc - optind, &args);
+	else if (strcmp(cmd, "list") == 0)
+		ret = rule_list();
+	else if (strcmp(cmd, "del") == 0)
+		ret = table_del();
+	else
+		ret = usage(argv[0]);
+	mnl_socket_close(nl);
+
+	if (ret < 0)
+	{
+		fprintf(stderr, "%s: %s\n", cmd, strerror(-ret));
+		return NFT_RULE_REJECTED;
+	}
+	return ret;
+}
@@ -0,0 +1,5 @@
+# Parser: Check for a compiler
+skip which cc
+# Parser: Build and run the tests of the DNS and payload parsers
+0 make -s -C parser check > .foo.err 2>&1
+# eof
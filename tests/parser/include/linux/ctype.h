@@ -0,0 +1,10 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _PARSER_LINUX_CTYPE_H
+#define _PARSER_LINUX_CTYPE_H
+
+#include <ctype.h>
+
+#endif /* _PARSER_LINUX_CTYPE_H */
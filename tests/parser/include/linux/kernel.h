@@ -0,0 +1,25 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace shim: the kernel helpers used by the parsers */
+
+#ifndef _PARSER_LINUX_KERNEL_H
+#define _PARSER_LINUX_KERNEL_H
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <linux/types.h>
+
+#define CONFIG_IPV6		1
+#define IS_ENABLED(option)	(option)
+
+#define EXPORT_SYMBOL_GPL(sym)
+#define __packed		__attribute__((packed))
+
+#define min(x, y)		((x) < (y) ? (x) : (y))
+#define min_t(type, x, y)	min((type)(x), (type)(y))
+
+#endif /* _PARSER_LINUX_KERNEL_H */
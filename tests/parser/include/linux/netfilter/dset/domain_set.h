@@ -0,0 +1,13 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace shim: the parsers need the uapi part only */
+
+#ifndef _PARSER_DOMAIN_SET_H
+#define _PARSER_DOMAIN_SET_H
+
+#include <uapi/linux/netfilter/dset/domain_set.h>
+
+#endif /* _PARSER_DOMAIN_SET_H */
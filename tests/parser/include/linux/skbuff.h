@@ -0,0 +1,42 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace shim: a packet in a flat buffer. Only the first headlen
+ * bytes are readable in place, the rest is copied by
+ * skb_header_pointer() like from the pages of a nonlinear skb.
+ */
+
+#ifndef _PARSER_LINUX_SKBUFF_H
+#define _PARSER_LINUX_SKBUFF_H
+
+#include <linux/kernel.h>
+
+struct sk_buff {
+	const u8 *data;
+	unsigned int len;
+	unsigned int headlen;
+	unsigned int network_header;
+};
+
+static inline int
+skb_network_offset(const struct sk_buff *skb)
+{
+	return skb->network_header;
+}
+
+static inline const void *
+skb_header_pointer(const struct sk_buff *skb, int offset, int len,
+		   void *buffer)
+{
+	if (offset < 0 || len < 0 || (unsigned int)offset > skb->len ||
+	    (unsigned int)len > skb->len - offset)
+		return NULL;
+	if ((unsigned int)(offset + len) <= skb->headlen)
+		return skb->data + offset;
+	memcpy(buffer, skb->data + offset, len);
+	return buffer;
+}
+
+#endif /* _PARSER_LINUX_SKBUFF_H */
@@ -0,0 +1,21 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace shim: the kernel integer types on top of the uapi ones */
+
+#ifndef _PARSER_LINUX_TYPES_H
+#define _PARSER_LINUX_TYPES_H
+
+/* glibc first, so that the uapi headers do not redefine in6_addr */
+#include <arpa/inet.h>
+#include <stdbool.h>
+#include_next <linux/types.h>
+
+typedef __u8 u8;
+typedef __u16 u16;
+typedef __u32 u32;
+typedef __u64 u64;
+
+#endif /* _PARSER_LINUX_TYPES_H */
@@ -0,0 +1,11 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef _PARSER_NET_IP_H
+#define _PARSER_NET_IP_H
+
+#define IP_MF		0x2000
+#define IP_OFFSET	0x1FFF
+
+#endif /* _PARSER_NET_IP_H */
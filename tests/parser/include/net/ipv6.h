@@ -0,0 +1,45 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace shim: ipv6_skip_exthdr() for the extension headers the
+ * tests build, hop-by-hop, destination options and fragment.
+ */
+
+#ifndef _PARSER_NET_IPV6_H
+#define _PARSER_NET_IPV6_H
+
+#include <linux/skbuff.h>
+
+#define NEXTHDR_HOP		0
+#define NEXTHDR_FRAGMENT	44
+#define NEXTHDR_DEST		60
+
+static inline int
+ipv6_skip_exthdr(const struct sk_buff *skb, int start, u8 *nexthdrp,
+		 __be16 *frag_offp)
+{
+	u8 nexthdr = *nexthdrp, buf[8];
+	const u8 *hp;
+
+	*frag_offp = 0;
+	while (nexthdr == NEXTHDR_HOP || nexthdr == NEXTHDR_DEST ||
+	       nexthdr == NEXTHDR_FRAGMENT) {
+		hp = skb_header_pointer(skb, start, sizeof(buf), buf);
+		if (!hp)
+			return -1;
+		if (nexthdr == NEXTHDR_FRAGMENT) {
+			memcpy(frag_offp, hp + 2, sizeof(*frag_offp));
+			start += 8;
+		} else {
+			start += (hp[1] + 1) * 8;
+		}
+		nexthdr = hp[0];
+	}
+	*nexthdrp = nexthdr;
+
+	return start;
+}
+
+#endif /* _PARSER_NET_IPV6_H */
@@ -0,0 +1,783 @@
+/* This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/* Userspace tests of the DNS walker and of the payload name extraction
+ *
+ * The kernel sources are built against the shims of include/. Every
+ * packet test runs twice: with the whole packet readable in place and
+ * with the payload copied by skb_header_pointer(), like from the pages
+ * of a nonlinear skb.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../kernel/net/netfilter/dset/domain_set_dns.c"
+#include "../../kernel/net/netfilter/dset/domain_set_payload.c"
+
+#define BUF_SIZE	4096
+
+struct buf {
+	u8 data[BUF_SIZE];
+	unsigned int len;
+};
+
+static unsigned int tests, failures;
+static bool paged;
+
+static void
+check(bool ok, const char *what, int line)
+{
+	tests++;
+	if (!ok)
+		failures++;
+	printf("%s %u - %s%s\n", ok ? "ok" : "not ok", tests, what,
+	       paged ? " (paged)" : "");
+	if (!ok)
+		printf("# failed at line %d\n", line);
+}
+
+#define CHECK(cond, what)	check(!!(cond), what, __LINE__)
+
+/* Message builders */
+
+static void
+put8(struct buf *b, unsigned int v)
+{
+	b->data[b->len++] = v;
+}
+
+static void
+put16(struct buf *b, unsigned int v)
+{
+	put8(b, v >> 8);
+	put8(b, v);
+}
+
+static void
+put32(struct buf *b, u32 v)
+{
+	put16(b, v >> 16);
+	put16(b, v);
+}
+
+static void
+putmem(struct buf *b, const void *p, unsigned int len)
+{
+	memcpy(b->data + b->len, p, len);
+	b->len += len;
+}
+
+static void
+putname(struct buf *b, const char *name)
+{
+	const char *dot;
+	unsigned int len;
+
+	while (*name) {
+		dot = strchr(name, '.');
+		len = dot ? (unsigned int)(dot - name) : strlen(name);
+		put8(b, len);
+		putmem(b, name, len);
+		name += len;
+		if (*name == '.')
+			name++;
+	}
+	put8(b, 0);
+}
+
+static void
+putptr(struct buf *b, unsigned int target)
+{
+	put16(b, 0xC000 | target);
+}
+
+static void
+dnshdr(struct buf *b, unsigned int flags, unsigned int qd, unsigned int an)
+{
+	b->len = 0;
+	put16(b, 0x1234);
+	put16(b, flags);
+	put16(b, qd);
+	put16(b, an);
+	put16(b, 0);
+	put16(b, 0);
+}
+
+static void
+rrhdr(struct buf *b, unsigned int type, unsigned int rdlen)
+{
+	put16(b, type);
+	put16(b, DSET_DNS_CLASS_IN);
+	put32(b, 300);
+	put16(b, rdlen);
+}
+
+static void
+question(struct buf *b, const char *name)
+{
+	putname(b, name);
+	put16(b, DSET_DNS_TYPE_A);
+	put16(b, DSET_DNS_CLASS_IN);
+}
+
+static void
+query(struct buf *b, const char *name)
+{
+	dnshdr(b, 0x0100, 1, 0);
+	question(b, name);
+}
+
+/* Packet builders: IPv4 or IPv6 header, UDP or TCP header, payload */
+
+struct pkt {
+	u8 data[BUF_SIZE];
+	struct sk_buff skb;
+};
+
+static void
+pkt_build(struct pkt *p, u8 family, u8 proto, unsigned int sport,
+	  unsigned int dport, const struct buf *payload)
+{
+	struct buf b = { .len = 0 };
+	unsigned int thlen = proto == IPPROTO_TCP ? 20 : 8;
+	unsigned int tlen = thlen + payload->len, thoff;
+
+	if (family == NFPROTO_IPV4) {
+		put8(&b, 0x45);
+		put8(&b, 0);
+		put16(&b, 20 + tlen);
+		put32(&b, 0);
+		put8(&b, 64);
+		put8(&b, proto);
+		put16(&b, 0);
+		put32(&b, 0x7F000001);
+		put32(&b, 0x7F000001);
+	} else {
+		put32(&b, 0x60000000);
+		put16(&b, tlen);
+		put8(&b, proto);
+		put8(&b, 64);
+		memset(b.data + b.len, 0, 32);
+		b.data[b.len + 15] = b.data[b.len + 31] = 1;
+		b.len += 32;
+	}
+	thoff = b.len;
+	put16(&b, sport);
+	put16(&b, dport);
+	if (proto == IPPROTO_TCP) {
+		put32(&b, 1);
+		put32(&b, 1);
+		put8(&b, 5 << 4);
+		put8(&b, 0x18);
+		put16(&b, 65535);
+		put32(&b, 0);
+	} else {
+		put16(&b, tlen);
+		put16(&b, 0);
+	}
+	putmem(&b, payload->data, payload->len);
+
+	memcpy(p->data, b.data, b.len);
+	p->skb.data = p->data;
+	p->skb.len = b.len;
+	p->skb.network_header = 0;
+	p->skb.headlen = paged ? thoff + thlen : b.len;
+}
+
+static void
+udp4(struct pkt *p, const struct buf *payload)
+{
+	pkt_build(p, NFPROTO_IPV4, IPPROTO_UDP, 40000, DSET_DNS_PORT, payload);
+}
+
+static void
+tcp4(struct pkt *p, unsigned int sport, unsigned int dport,
+     const struct buf *payload)
+{
+	pkt_build(p, NFPROTO_IPV4, IPPROTO_TCP, sport, dport, payload);
+}
+
+/* Walk callback: records "<section>:<name>;" for every visited record
+ * and the address of the A answers
+ */
+
+struct walk {
+	char out[BUF_SIZE];
+	unsigned int records;
+};
+
+static int
+walk_rr(const struct dset_dns_msg *msg, const struct dset_dns_rr *rr,
+	void *priv)
+{
+	struct walk *w = priv;
+	size_t len = strlen(w->out);
+	union nf_inet_addr addr;
+
+	w->records++;
+	snprintf(w->out + len, sizeof(w->out) - len, "%c:%s;",
+		 rr->section == DSET_DNS_QUESTION ? 'Q' :
+		 rr->section == DSET_DNS_ANSWER ? 'A' : 'C', rr->name);
+	if (domain_set_dns_addr(msg, rr, &addr) == NFPROTO_IPV4) {
+		len = strlen(w->out);
+		snprintf(w->out + len, sizeof(w->out) - len, "@%08x;",
+			 ntohl(addr.ip));
+	}
+	return 0;
+}
+
+static int
+walk(const struct dset_dns_msg *msg, u8 sections, struct walk *w)
+{
+	memset(w, 0, sizeof(*w));
+	return domain_set_dns_walk(msg, sections, walk_rr, w);
+}
+
+static void
+linear(struct dset_dns_msg *msg, const struct buf *b)
+{
+	memset(msg, 0, sizeof(*msg));
+	msg->data = b->data;
+	msg->len = b->len;
+	msg->pktlen = b->len;
+}
+
+static int
+name_at(const struct buf *b, unsigned int pos, char *name,
+	unsigned int *end)
+{
+	struct dset_dns_msg msg;
+	int ret;
+
+	linear(&msg, b);
+	ret = domain_set_dns_name(&msg, &pos, name);
+	if (end)
+		*end = pos;
+	return ret;
+}
+
+/* Names and compression */
+
+static void
+test_names(void)
+{
+	char name[DSET_MAX_DOMAIN_LEN];
+	unsigned int pos, ptr, i;
+	struct buf b;
+
+	query(&b, "www.example.com");
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, &pos) == 15 &&
+	      strcmp(name, "www.example.com") == 0 &&
+	      pos == DSET_DNS_HDRLEN + 17,
+	      "plain name");
+
+	query(&b, "");
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, &pos) == 0 && !*name &&
+	      pos == DSET_DNS_HDRLEN + 1,
+	      "root name");
+
+	/* www + pointer to example.com */
+	query(&b, "example.com");
+	ptr = b.len;
+	put8(&b, 3);
+	putmem(&b, "www", 3);
+	putptr(&b, DSET_DNS_HDRLEN);
+	CHECK(name_at(&b, ptr, name, &pos) == 15 &&
+	      strcmp(name, "www.example.com") == 0 && pos == ptr + 6,
+	      "compressed name resumes after the pointer");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	putptr(&b, DSET_DNS_HDRLEN);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -ELOOP,
+	      "pointer to itself");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	putptr(&b, DSET_DNS_HDRLEN + 2);
+	putname(&b, "example.com");
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -ELOOP,
+	      "forward pointer");
+
+	/* A chain of backward pointers to the name "a" */
+	query(&b, "a");
+	ptr = b.len;
+	putptr(&b, DSET_DNS_HDRLEN);
+	for (i = 1; i <= DSET_DNS_MAX_PTRS; i++)
+		putptr(&b, ptr + 2 * (i - 1));
+	CHECK(name_at(&b, ptr + 2 * (DSET_DNS_MAX_PTRS - 1), name,
+		      NULL) == 1 && strcmp(name, "a") == 0,
+	      "longest pointer chain");
+	CHECK(name_at(&b, ptr + 2 * DSET_DNS_MAX_PTRS, name, NULL) == -ELOOP,
+	      "too long pointer chain");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	put8(&b, 20);
+	putmem(&b, "example", 7);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -EINVAL,
+	      "label beyond the message");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	put8(&b, 7);
+	putmem(&b, "example", 7);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -EINVAL,
+	      "name without terminating label");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	put8(&b, 0xC0);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -EINVAL,
+	      "pointer cut by the end of the message");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	for (i = 0; i < 5; i++) {
+		put8(&b, 63);
+		memset(b.data + b.len, 'a', 63);
+		b.len += 63;
+	}
+	put8(&b, 0);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -ENAMETOOLONG,
+	      "name too long");
+
+	dnshdr(&b, 0x0100, 1, 0);
+	put8(&b, 0x41);
+	put8(&b, 0);
+	CHECK(name_at(&b, DSET_DNS_HDRLEN, name, NULL) == -EINVAL,
+	      "extended label type");
+}
+
+/* Sections of a response: cdn.example.org is a CNAME of www.example.com,
+ * whose A record follows, and an unrelated record is injected
+ */
+
+static void
+response(struct buf *b)
+{
+	unsigned int target;
+
+	dnshdr(b, 0x8180, 1, 3);
+	question(b, "cdn.example.org");
+	putptr(b, DSET_DNS_HDRLEN);
+	rrhdr(b, DSET_DNS_TYPE_CNAME, 17);
+	target = b->len;
+	putname(b, "www.example.com");
+	putptr(b, target);
+	rrhdr(b, DSET_DNS_TYPE_A, 4);
+	put32(b, 0x01020304);
+	putname(b, "evil.example.net");
+	rrhdr(b, DSET_DNS_TYPE_A, 4);
+	put32(b, 0x05060708);
+}
+
+static void
+test_walk(void)
+{
+	struct dset_dns_msg msg;
+	struct walk w;
+	struct buf b;
+	unsigned int i;
+
+	query(&b, "www.example.com");
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:www.example.com;") == 0,
+	      "question of a query");
+
+	response(&b);
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:cdn.example.org;") == 0,
+	      "question of a response");
+	CHECK(walk(&msg, DSET_DNS_QUESTION | DSET_DNS_ANSWER, &w) == 0 &&
+	      strcmp(w.out, "Q:cdn.example.org;A:cdn.example.org;"
+			    "A:www.example.com;@01020304;"
+			    "A:evil.example.net;@05060708;") == 0,
+	      "answers with compressed owners");
+	CHECK(walk(&msg, DSET_DNS_QUESTION | DSET_DNS_ANSWER | DSET_DNS_CNAME,
+		   &w) == 0 &&
+	      strcmp(w.out, "Q:cdn.example.org;A:cdn.example.org;"
+			    "C:www.example.com;"
+			    "A:evil.example.net;@05060708;") == 0,
+	      "CNAME target passed once");
+	CHECK(walk(&msg, DSET_DNS_QUESTION | DSET_DNS_ANSWER | DSET_DNS_CHAIN,
+		   &w) == 0 &&
+	      strcmp(w.out, "Q:cdn.example.org;A:cdn.example.org;"
+			    "A:www.example.com;@01020304;") == 0,
+	      "answers off the CNAME chain ignored");
+
+	/* The last record is cut */
+	b.len -= 2;
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION | DSET_DNS_ANSWER, &w) == -EINVAL &&
+	      w.records == 3,
+	      "truncated answer");
+
+	/* More answers announced than present */
+	response(&b);
+	b.data[7] = 4;
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION | DSET_DNS_ANSWER, &w) == -EINVAL,
+	      "missing answer");
+
+	query(&b, "www.example.com");
+	b.len -= 3;
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION, &w) == -EINVAL && !w.records,
+	      "truncated question");
+
+	b.len = DSET_DNS_HDRLEN - 1;
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION, &w) == -EINVAL,
+	      "truncated header");
+
+	dnshdr(&b, 0x0100, 2 * DSET_DNS_MAX_RECORDS, 0);
+	for (i = 0; i < 2 * DSET_DNS_MAX_RECORDS; i++)
+		question(&b, "");
+	linear(&msg, &b);
+	CHECK(walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      w.records == DSET_DNS_MAX_RECORDS,
+	      "record limit");
+}
+
+/* Locating the message in UDP */
+
+static void
+test_udp(void)
+{
+	struct dset_dns_msg msg;
+	struct walk w;
+	struct buf b;
+	struct pkt p;
+
+	query(&b, "www.example.com");
+	udp4(&p, &b);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == 0 &&
+	      msg.len == b.len && msg.off == 28 &&
+	      walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:www.example.com;") == 0 &&
+	      domain_set_dns_next(&msg) == -ENOENT,
+	      "IPv4 UDP query");
+
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_UNSPEC, &msg) == 0 &&
+	      msg.off == 28,
+	      "family from the network header");
+
+	pkt_build(&p, NFPROTO_IPV6, IPPROTO_UDP, 40000, DSET_DNS_PORT, &b);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV6, &msg) == 0 &&
+	      msg.off == 48 && walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:www.example.com;") == 0,
+	      "IPv6 UDP query");
+
+	udp4(&p, &b);
+	p.data[24] = 0;
+	p.data[25] = 8 + DSET_DNS_HDRLEN - 1;
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -EINVAL,
+	      "UDP length shorter than a DNS header");
+
+	udp4(&p, &b);
+	p.data[24] = 0xFF;
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == 0 &&
+	      msg.len == b.len,
+	      "UDP length beyond the packet");
+
+	udp4(&p, &b);
+	p.data[7] = 1;
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -EINVAL,
+	      "non-first fragment");
+
+	pkt_build(&p, NFPROTO_IPV4, IPPROTO_ICMP, 0, 0, &b);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) ==
+	      -EPROTONOSUPPORT,
+	      "other protocol");
+}
+
+/* TCP length prefixes, the messages after the first are not aligned */
+
+static void
+framed(struct buf *seg, const struct buf *m)
+{
+	put16(seg, m->len);
+	putmem(seg, m->data, m->len);
+}
+
+static void
+test_tcp(void)
+{
+	struct dset_dns_msg msg;
+	struct buf b, seg;
+	struct walk w;
+	struct pkt p;
+	char name[16];
+	unsigned int i;
+	int ret;
+
+	/* The second header and length prefix start at an odd offset */
+	seg.len = 0;
+	query(&b, "first.example.com");
+	framed(&seg, &b);
+	query(&b, "second.example.com");
+	framed(&seg, &b);
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	ret = domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg);
+	CHECK(ret == 0 && walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:first.example.com;") == 0,
+	      "first message of a segment");
+	ret = domain_set_dns_next(&msg);
+	CHECK(ret == 0 && walk(&msg, DSET_DNS_QUESTION, &w) == 0 &&
+	      strcmp(w.out, "Q:second.example.com;") == 0,
+	      "second message of a segment");
+	CHECK(domain_set_dns_next(&msg) == -ENOENT, "end of the segment");
+
+	tcp4(&p, DSET_DNS_PORT, 40000, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == 0,
+	      "segment from the DNS port");
+
+	seg.len -= 5;
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -ENOENT,
+	      "segment cut in a message");
+
+	seg.len = 0;
+	query(&b, "www.example.com");
+	framed(&seg, &b);
+	put8(&seg, 0);
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -ENOENT,
+	      "trailing byte after a message");
+
+	seg.len = 0;
+	put16(&seg, DSET_DNS_HDRLEN - 1);
+	memset(seg.data + seg.len, 0, DSET_DNS_HDRLEN - 1);
+	seg.len += DSET_DNS_HDRLEN - 1;
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -ENOENT,
+	      "message shorter than a DNS header");
+
+	seg.len = 0;
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -ENOENT,
+	      "segment without payload");
+
+	seg.len = 0;
+	query(&b, "www.example.com");
+	framed(&seg, &b);
+	tcp4(&p, 40000, 853, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) ==
+	      -EPROTONOSUPPORT,
+	      "segment of another port");
+
+	seg.len = 0;
+	for (i = 0; i < DSET_DNS_MAX_TCP_MSGS; i++) {
+		snprintf(name, sizeof(name), "m%u.example", i);
+		query(&b, name);
+		framed(&seg, &b);
+	}
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	ret = domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg);
+	for (i = 1; ret == 0; i++)
+		ret = domain_set_dns_next(&msg);
+	CHECK(ret == -ENOENT && i == DSET_DNS_MAX_TCP_MSGS + 1,
+	      "most messages of a segment");
+
+	framed(&seg, &b);
+	tcp4(&p, 40000, DSET_DNS_PORT, &seg);
+	CHECK(domain_set_dns_locate(&p.skb, NFPROTO_IPV4, &msg) == -ENOENT,
+	      "too many messages in a segment");
+}
+
+/* TLS ClientHello with the server_name extension after a padding one */
+
+static void
+client_hello(struct buf *b, const char *sni, unsigned int nametype)
+{
+	struct buf ext = { .len = 0 }, hello = { .len = 0 };
+	unsigned int len;
+
+	put16(&ext, 21);
+	put16(&ext, 4);
+	put32(&ext, 0);
+	if (sni) {
+		len = strlen(sni);
+		put16(&ext, DSET_TLS_EXT_SERVER_NAME);
+		put16(&ext, len + 5);
+		put16(&ext, len + 3);
+		put8(&ext, nametype);
+		put16(&ext, len);
+		putmem(&ext, sni, len);
+	}
+
+	put16(&hello, 0x0303);
+	memset(hello.data + hello.len, 0xAA, 32);
+	hello.len += 32;
+	put8(&hello, 32);
+	memset(hello.data + hello.len, 0xBB, 32);
+	hello.len += 32;
+	put16(&hello, 2);
+	put16(&hello, 0x1301);
+	put8(&hello, 1);
+	put8(&hello, 0);
+	put16(&hello, ext.len);
+	putmem(&hello, ext.data, ext.len);
+
+	b->len = 0;
+	put8(b, DSET_TLS_HANDSHAKE);
+	put16(b, 0x0301);
+	put16(b, DSET_TLS_HANDSHAKE_HDRLEN + hello.len);
+	put8(b, DSET_TLS_CLIENT_HELLO);
+	put8(b, hello.len >> 16);
+	put16(b, hello.len);
+	putmem(b, hello.data, hello.len);
+}
+
+static int
+payload_name(const struct buf *b, u8 payload, char *name)
+{
+	struct dset_dns_msg msg;
+	struct dset_dns_rr rr;
+	struct pkt p;
+
+	tcp4(&p, 40000, payload == DSET_PAYLOAD_TLS_SNI ? 443 : 80, b);
+	return domain_set_payload_name(&p.skb, NFPROTO_IPV4, payload, &msg,
+				       &rr, name);
+}
+
+static void
+test_tls(void)
+{
+	char name[DSET_MAX_DOMAIN_LEN], longname[300];
+	struct dset_dns_msg msg;
+	struct dset_dns_rr rr;
+	struct buf b;
+	struct pkt p;
+	int ret;
+
+	client_hello(&b, "WWW.Example.COM.", DSET_TLS_SNI_HOST_NAME);
+	tcp4(&p, 40000, 443, &b);
+	ret = domain_set_payload_name(&p.skb, NFPROTO_IPV4,
+				      DSET_PAYLOAD_TLS_SNI, &msg, &rr, name);
+	CHECK(ret == 15 && strcmp(name, "www.example.com") == 0 &&
+	      rr.name == name && rr.namelen == 15 &&
+	      rr.section == DSET_DNS_QUESTION,
+	      "TLS SNI normalized");
+
+	client_hello(&b, NULL, 0);
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -ENOENT,
+	      "TLS ClientHello without SNI");
+
+	client_hello(&b, "www.example.com", DSET_TLS_SNI_HOST_NAME);
+	b.len -= 8;
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -EINVAL,
+	      "TLS SNI cut by the end of the segment");
+
+	client_hello(&b, "www.example.com", DSET_TLS_SNI_HOST_NAME);
+	b.len = 60;
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -EINVAL,
+	      "TLS ClientHello cut before the extensions");
+
+	client_hello(&b, "www.example.com", 1);
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -EINVAL,
+	      "TLS SNI of another name type");
+
+	client_hello(&b, "", DSET_TLS_SNI_HOST_NAME);
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -EINVAL,
+	      "TLS empty SNI");
+
+	memset(longname, 'a', sizeof(longname) - 1);
+	longname[sizeof(longname) - 1] = '\0';
+	client_hello(&b, longname, DSET_TLS_SNI_HOST_NAME);
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -ENAMETOOLONG,
+	      "TLS SNI too long");
+
+	client_hello(&b, "www.example.com", DSET_TLS_SNI_HOST_NAME);
+	b.data[0] = 23;
+	CHECK(payload_name(&b, DSET_PAYLOAD_TLS_SNI, name) == -EINVAL,
+	      "TLS application data record");
+
+	client_hello(&b, "www.example.com", DSET_TLS_SNI_HOST_NAME);
+	udp4(&p, &b);
+	CHECK(domain_set_payload_name(&p.skb, NFPROTO_IPV4,
+				      DSET_PAYLOAD_TLS_SNI, &msg, &rr,
+				      name) == -EPROTONOSUPPORT,
+	      "TLS over UDP");
+}
+
+static int
+http_host(const char *request, char *name)
+{
+	struct buf b = { .len = 0 };
+
+	putmem(&b, request, strlen(request));
+	return payload_name(&b, DSET_PAYLOAD_HTTP_HOST, name);
+}
+
+static void
+test_http(void)
+{
+	char name[DSET_MAX_DOMAIN_LEN], *request;
+	size_t len;
+	int ret;
+
+	ret = http_host("GET / HTTP/1.1\r\nHost: www.Example.com:8080\r\n"
+			"Accept: */*\r\n\r\n", name);
+	CHECK(ret == 15 && strcmp(name, "www.example.com") == 0,
+	      "HTTP Host with port");
+
+	ret = http_host("POST /x HTTP/1.1\r\nUser-Agent: t\r\n"
+			"hOsT:\twww.example.org.\r\n\r\n", name);
+	CHECK(ret == 15 && strcmp(name, "www.example.org") == 0,
+	      "HTTP Host in other case");
+
+	ret = http_host("GET / HTTP/1.1\r\nX-Host: evil.example\r\n"
+			"Host: good.example\r\n\r\n", name);
+	CHECK(ret == 12 && strcmp(name, "good.example") == 0,
+	      "HTTP header ending in Host");
+
+	CHECK(http_host("GET / HTTP/1.1\r\nAccept: */*\r\n\r\n", name) ==
+	      -ENOENT,
+	      "HTTP request without Host");
+
+	CHECK(http_host("GET / HTTP/1.1\r\nAccept: */*\r\n\r\n"
+			"Host: body.example\r\n", name) == -ENOENT,
+	      "HTTP Host in the body");
+
+	CHECK(http_host("GET / HTTP/1.1\r\nHost: www.exam", name) == -EINVAL,
+	      "HTTP Host cut by the end of the segment");
+
+	CHECK(http_host("GET / HTTP/1.1\r\nHost: [::1]:80\r\n\r\n", name) ==
+	      -EINVAL,
+	      "HTTP Host of an IPv6 literal");
+
+	CHECK(http_host("HTTP/1.1 200 OK\r\nHost: www.example.com\r\n\r\n",
+			name) == -EINVAL,
+	      "HTTP response");
+
+	request = malloc(DSET_HTTP_MAX_SCAN + 64);
+	if (!request)
+		return;
+	strcpy(request, "GET / HTTP/1.1\r\nX-Pad: ");
+	len = strlen(request);
+	memset(request + len, 'a', DSET_HTTP_MAX_SCAN);
+	strcpy(request + len + DSET_HTTP_MAX_SCAN, "\r\nHost: a.example\r\n");
+	CHECK(http_host(request, name) == -ENOENT,
+	      "HTTP Host beyond the scanned bytes");
+	free(request);
+}
+
+int main(void)
+{
+	test_names();
+	test_walk();
+	for (paged = false; ; paged = true) {
+		test_udp();
+		test_tcp();
+		test_tls();
+		test_http();
+		if (paged)
+			break;
+	}
+
+	printf("1..%u\n", tests);
+	if (failures)
+		printf("# %u of %u tests failed\n", failures, tests);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+# Publish: Create a set
+0 dset create test hash:domain
+# Publish: Add an element
+0 dset add test example.com
+# Publish: Publish the set
+0 dset publish test
+# Publish: Publish the set again
+1 dset publish test
+# Publish: Attach the published set
+0 dset attach test link
+# Publish: Attach it again under the same name
+1 dset attach test link
+# Publish: Attach a set which is not published
+1 dset attach missing link2
+# Publish: Test element through the attached set
+0 dset test link example.com
+# Publish: Test element not in the set through the attached set
+1 dset test link example.net
+# Publish: Add to the attached set is refused
+1 dset add link www.example.net
+# Publish: Element added to the published set is seen through the attached set
+0 dset add test www.example.net && dset test link www.example.net
+# Publish: Published set cannot be destroyed
+1 dset destroy test
+# Publish: Published set cannot be renamed
+1 dset rename test other
+# Publish: Published set cannot be unpublished while attached
+1 dset unpublish test
+# Publish: List the sets
+0 dset list -terse | grep -E '^(Name|Type|Header|Published|Attached):' > .foo
+# Publish: Check listing
+0 diff -u .foo publish.t.list0
+# Publish: Save the sets
+0 dset save > .foo.saved
+# Publish: Check the saved sets
+0 sort .foo.saved > .foo && diff -u .foo publish.t.list1
+# Publish: Destroy the attached set
+0 dset destroy link
+# Publish: Unpublish the set
+0 dset unpublish test
+# Publish: Destroy the set
+0 dset destroy test
+# Publish: Restore the saved sets
+0 dset restore < .foo.saved
+# Publish: Check the restored sets
+0 dset save | sort > .foo && diff -u .foo publish.t.list1
+# Publish: Destroy the attached set
+0 dset destroy link
+# Publish: Unpublish the set
+0 dset unpublish test
+# Publish: Destroy the set
+0 dset destroy test
+# Publish: Create a network namespace
+skip ip netns add nstest
+# Publish: Create a set in the namespace
+0 ip netns exec nstest dset create test hash:domain
+# Publish: Add an element in the namespace
+0 ip netns exec nstest dset add test example.com
+# Publish: Publish the set in the namespace
+0 ip netns exec nstest dset publish test
+# Publish: Attach the set of the namespace
+0 dset attach test link netns nstest
+# Publish: Test element through the attached set
+0 dset test link example.com
+# Publish: List the attached set
+0 dset list -terse link | grep '^Attached:' > .foo && diff -u .foo publish.t.list2
+# Publish: Delete the namespace
+0 ip netns del nstest
+# Publish: Wait for the namespace to go away
+0 sleep 2
+# Publish: Attached set of a deleted namespace matches nothing
+1 dset test link example.com
+# Publish: Destroy the attached set
+0 dset destroy link
+# eof
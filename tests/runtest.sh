@@ -3,6 +3,7 @@
 # set -x
 
 ipset=${IPSET_BIN:-../src/ipset}
+dset=${DSET_BIN:-../src/dset}
 
 tests="init"
 tests="$tests ipmap bitmap:ip"
@@ -17,6 +18,7 @@ tests="$tests hash:net,port,net hash:net6,port,net6"
 tests="$tests hash:net,iface.t hash:mac.t"
 tests="$tests comment setlist restore"
 # tests="$tests iptree iptreemap"
+tests="$tests parser nft kfunc target category skbinfo hash:domain publish list:set learn window batch load names monitor changes concurrent"
 
 # For correct sorting:
 LC_ALL=C
@@ -78,6 +80,7 @@ chmod a+x check_* *.sh
 
 for types in $tests; do
     $ipset -X test >/dev/null 2>&1
+    $dset -X test >/dev/null 2>&1
     if [ -f $types ]; then
     	filename=$types
     else
@@ -107,6 +110,8 @@ for types in $tests; do
 	cmd=`echo $cmd | sed "s|ipset|$ipset 2>.foo.err|"`
 	# For the case: ipset list | ... | xargs -n1 ipset
 	cmd=`echo $cmd | sed "s|ipset|$ipset|2g"`
+	cmd=`echo $cmd | sed "s|dset|$dset 2>.foo.err|"`
+	cmd=`echo $cmd | sed "s|dset|$dset|2g"`
 	eval $cmd
 	r=$?
 	# echo $ret $r
@@ -123,6 +128,7 @@ for types in $tests; do
 done
 # Remove test sets created by setlist.t
 $ipset -X >/dev/null 2>&1
+$dset -X >/dev/null 2>&1
 for x in $tests; do
 	case $x in
 	init)
@@ -131,10 +137,14 @@ for x in $tests; do
 		for x in `lsmod | grep ip_set_ | awk '{print $1}'`; do
 			rmmod $x >/dev/null 2>&1
 		done
+		for x in `lsmod | grep domain_set_ | awk '{print $1}'`; do
+			rmmod $x >/dev/null 2>&1
+		done
 		;;
 	esac
 done
 rmmod ip_set >/dev/null 2>&1
+rmmod domain_set >/dev/null 2>&1
 rm -f .foo*
 echo "All tests are passed"
 
@@ -0,0 +1,31 @@
+# Skbinfo: Check that iptables supports the DSET target
+skip ./target.sh check
+# Skbinfo: Create a set with skbinfo
+0 dset create test hash:domain skbinfo
+# Skbinfo: Add an element with a mark, priority and queue
+0 dset add test example.com skbmark 0x1111/0xff00ffff skbprio 1:10 skbqueue 2
+# Skbinfo: Skbinfo of the element is listed
+0 dset list test | grep -q '^example.com skbmark 0x1111/0xff00ffff skbprio 1:10 skbqueue 2$'
+# Skbinfo: Create the chain of the rules
+0 ./target.sh start
+# Skbinfo: Map the mark of the matching element
+0 ./target.sh add -j DSET --map-set test dst --map-mark
+# Skbinfo: Count the packets with the mapped mark
+0 ./target.sh add -m mark --mark 0x1111/0xff00ffff
+# Skbinfo: Query for a subdomain of the element gets the mark
+0 ./dnsmsg.sh www.example.com && test `./target.sh count 2` -eq 1
+# Skbinfo: Query for another domain does not get the mark
+0 ./dnsmsg.sh www.example.org && test `./target.sh count 2` -eq 1
+# Skbinfo: Priority and queue can be mapped from the OUTPUT chain
+0 ./target.sh add -j DSET --map-set test dst --map-prio --map-queue
+# Skbinfo: Priority cannot be mapped from the INPUT chain
+1 iptables -t mangle -A INPUT -j DSET --map-set test dst --map-prio
+# Skbinfo: Queue cannot be mapped from the PREROUTING chain
+1 iptables -t mangle -A PREROUTING -j DSET --map-set test dst --map-queue
+# Skbinfo: Mark cannot be mapped outside of the mangle table
+1 iptables -t filter -A OUTPUT -j DSET --map-set test dst --map-mark
+# Skbinfo: Delete the chain
+0 ./target.sh stop
+# Skbinfo: Destroy set
+0 dset destroy test
+# eof
@@ -0,0 +1,50 @@
+#!/bin/sh
+
+# Rules with the dset match and DSET target in the DTEST chain of the
+# mangle table, which sees the DNS messages dnsmsg.sh sends to
+# 127.0.0.1 port 10053.
+#
+# target.sh check		the DSET target is supported
+# target.sh start		create the chain
+# target.sh add RULE...		append RULE, where -M stands for the dset match
+# target.sh flush		delete the rules
+# target.sh count N		print the packets which reached the Nth rule
+# target.sh stop		delete the chain
+
+cmd=iptables
+
+case "$1" in
+check)
+	$cmd -j DSET -h 2>/dev/null | grep -q -- --add-set
+	;;
+start)
+	$cmd -t mangle -N DTEST
+	$cmd -t mangle -A OUTPUT -p udp --dport 10053 -j DTEST
+	;;
+add)
+	shift
+	rule=
+	for arg in "$@"; do
+		case "$arg" in
+		-M)	rule="$rule -m dset" ;;
+		*)	rule="$rule $arg" ;;
+		esac
+	done
+	$cmd -t mangle -A DTEST $rule
+	;;
+flush)
+	$cmd -t mangle -F DTEST
+	;;
+count)
+	$cmd -t mangle -L DTEST -n -v -x | awk -v n=$2 'NR == n + 2 { print $1 }'
+	;;
+stop)
+	$cmd -t mangle -D OUTPUT -p udp --dport 10053 -j DTEST
+	$cmd -t mangle -F DTEST
+	$cmd -t mangle -X DTEST
+	;;
+*)
+	echo "Usage: $0 check|start|add RULE...|flush|count N|stop"
+	exit 1
+	;;
+esac
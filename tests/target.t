@@ -0,0 +1,37 @@
+# Target: Check that iptables supports the DSET target
+skip ./target.sh check
+# Target: Create a set to fill
+0 dset create test hash:domain
+# Target: Create the chain of the rules
+0 ./target.sh start
+# Target: Add the queried names to the set
+0 ./target.sh add -j DSET --add-set test dst
+# Target: Send a query
+0 ./dnsmsg.sh www.example.com
+# Target: Queried name is in the set
+0 dset test test www.example.com
+# Target: Other name is not in the set
+1 dset test test www.example.org
+# Target: Delete the queried names from the set instead
+0 ./target.sh flush && ./target.sh add -j DSET --del-set test dst
+# Target: Send the query again
+0 ./dnsmsg.sh www.example.com
+# Target: Queried name is deleted from the set
+1 dset test test www.example.com
+# Target: Publish the set
+0 ./target.sh flush && dset publish test
+# Target: Attach the published set
+0 dset attach test link
+# Target: Attached set cannot be the add set
+1 ./target.sh add -j DSET --add-set link dst
+# Target: Attached set cannot be the delete set
+1 ./target.sh add -j DSET --del-set link dst
+# Target: Attached set is not referenced by the rejected rules
+0 dset destroy link
+# Target: Unpublish the set
+0 dset unpublish test
+# Target: Delete the chain
+0 ./target.sh stop
+# Target: Destroy the set
+0 dset destroy test
+# eof
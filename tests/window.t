@@ -0,0 +1,35 @@
+# Window: Generate the commands of a large set
+0 (echo create test hash:domain; seq 5000 | sed 's/^/add test d/; s/$/.example.com/') > .foo.restore
+# Window: Restore with large messages and a window of them in flight
+0 dset -buffer 65536 -window 16 restore < .foo.restore
+# Window: All elements are added
+0 dset list test | grep -q '^Number of entries: 5000$'
+# Window: Save the set
+0 dset save test | grep '^add ' | sort > .foo
+# Window: Check the saved elements
+0 grep '^add ' .foo.restore | sort | diff -u - .foo
+# Window: Delete the elements with a window of messages
+0 grep '^add ' .foo.restore | sed 's/^add/del/' | dset -buffer 65536 -window 16 restore
+# Window: All elements are deleted
+0 dset list test | grep -q '^Number of entries: 0$'
+# Window: Destroy set
+0 dset destroy test
+# Window: Generate commands with a clashing element in the middle
+0 (echo create test hash:domain; seq 5000 | sed 's/^/add test d/; s/$/.example.com/'; echo add test d10.example.com; seq 5001 6000 | sed 's/^/add test d/; s/$/.example.com/') > .foo.restore
+# Window: Restore fails at the clashing element
+1 dset -buffer 65536 -window 16 restore < .foo.restore
+# Window: Error reports the line of the clashing element
+0 grep -q 'Error in line 5002:' .foo.err
+# Window: Elements before the clashing one are added
+0 test `dset list test | sed -n 's/^Number of entries: //p'` -ge 5000
+# Window: Restore again, ignoring the existing elements
+0 dset -exist -buffer 65536 -window 16 restore < .foo.restore
+# Window: All elements are added
+0 dset list test | grep -q '^Number of entries: 6000$'
+# Window: Destroy set
+0 dset destroy test
+# Window: Message size over the limit is refused
+1 dset -buffer 65537 restore < /dev/null
+# Window: Window over the limit is refused
+1 dset -window 65 restore < /dev/null
+# eof